@@ -40,7 +40,7 @@ struct APIGrammar : qi::grammar<Iterator>
 	explicit APIGrammar(HandlerT * h) : APIGrammar::base_type(api_call), handler(h)
 	{
 		api_call = qi::lit('/') >> string[boost::bind(&HandlerT::setService, handler, ::_1)] >> *(query) >> -(uturns);
-		query    = ('?') >> (+(zoom | output | jsonp | checksum | location | hint | u | cmp | language | instruction | geometry | alt_route | old_API | num_results) ) ;
+		query    = ('?') >> (+(zoom | output | jsonp | checksum | location | hint | u | cmp | language | instruction | geometry | alt_route | old_API | num_results | timeout) ) ;
 
 		zoom        = (-qi::lit('&')) >> qi::lit('z')            >> '=' >> qi::short_[boost::bind(&HandlerT::setZoomLevel, handler, ::_1)];
 		output      = (-qi::lit('&')) >> qi::lit("output")       >> '=' >> string[boost::bind(&HandlerT::setOutputFormat, handler, ::_1)];
@@ -57,6 +57,7 @@ struct APIGrammar : qi::grammar<Iterator>
 		alt_route   = (-qi::lit('&')) >> qi::lit("alt")          >> '=' >> qi::bool_[boost::bind(&HandlerT::setAlternateRouteFlag, handler, ::_1)];
 		old_API     = (-qi::lit('&')) >> qi::lit("geomformat")   >> '=' >> string[boost::bind(&HandlerT::setDeprecatedAPIFlag, handler, ::_1)];
 		num_results = (-qi::lit('&')) >> qi::lit("num_results")  >> '=' >> qi::short_[boost::bind(&HandlerT::setNumberOfResults, handler, ::_1)];
+		timeout     = (-qi::lit('&')) >> qi::lit("timeout")      >> '=' >> qi::uint_[boost::bind(&HandlerT::setTimeout, handler, ::_1)];
 
 		string            = +(qi::char_("a-zA-Z"));
 		stringwithDot     = +(qi::char_("a-zA-Z0-9_.-"));
@@ -66,7 +67,7 @@ struct APIGrammar : qi::grammar<Iterator>
 	qi::rule<Iterator> api_call, query;
 	qi::rule<Iterator, std::string()> service, zoom, output, string, jsonp, checksum, location, hint,
 	stringwithDot, stringwithPercent, language, instruction, geometry,
-	cmp, alt_route, u, uturns, old_API, num_results;
+	cmp, alt_route, u, uturns, old_API, num_results, timeout;
 
 	HandlerT * handler;
 };
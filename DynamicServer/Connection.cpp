@@ -4,9 +4,8 @@
 
 #include <boost/assert.hpp>
 #include <boost/bind.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -14,7 +13,8 @@ namespace http
 {
 
 Connection::Connection(boost::asio::io_service &io_service, RequestHandler &handler)
-	: strand(io_service), TCP_socket(io_service), request_handler(handler)
+	: strand(io_service), TCP_socket(io_service), request_handler(handler),
+	  compressed_input_position(0), compression_finished(true)
 {
 }
 
@@ -53,29 +53,55 @@ void Connection::handle_read(const boost::system::error_code &error, std::size_t
 		request.endpoint = TCP_socket.remote_endpoint().address();
 		request_handler.handle_request(request, reply);
 
-		// Header compression_header;
-		std::vector<char> compressed_output;
 		std::vector<boost::asio::const_buffer> output_buffer;
 
+		// tiny replies do not gain anything from compression
+		if (reply.content.size() < ZlibCompressor::MinimumCompressibleSize)
+		{
+			compression_type = noCompression;
+		}
+
 		// compress the result w/ gzip/deflate if requested
 		switch (compression_type)
 		{
 		case deflateRFC1951:
-			// use deflate for compression
-			reply.headers.insert(reply.headers.begin(), {"Content-Encoding", "deflate"});
-			CompressBufferCollection(reply.content, compression_type, compressed_output);
-			reply.SetSize(static_cast<unsigned>(compressed_output.size()));
-			output_buffer = reply.HeaderstoBuffers();
-			output_buffer.push_back(boost::asio::buffer(compressed_output));
-			break;
 		case gzipRFC1952:
-			// use gzip for compression
-			reply.headers.insert(reply.headers.begin(), {"Content-Encoding", "gzip"});
-			CompressBufferCollection(reply.content, compression_type, compressed_output);
-			reply.SetSize(static_cast<unsigned>(compressed_output.size()));
+		{
+			reply.headers.insert(reply.headers.begin(),
+								 {"Content-Encoding",
+								  (gzipRFC1952 == compression_type ? "gzip" : "deflate")});
+			// the compressed length is not known before the last chunk is done.
+			// the body is delimited by closing the connection instead.
+			reply.headers.erase(std::remove_if(reply.headers.begin(),
+											   reply.headers.end(),
+											   [](const Header &header)
+											   {
+												   return "Content-Length" == header.name;
+											   }),
+								reply.headers.end());
+
+			compressor = ZlibCompressor::Acquire();
+			compressor->Reset(compression_type,
+							  ZlibCompressor::LevelForSize(reply.content.size()));
+			compressed_input_position = 0;
+			compression_finished = false;
+
+			current_chunk.clear();
+			CompressNextChunk(current_chunk);
 			output_buffer = reply.HeaderstoBuffers();
-			output_buffer.push_back(boost::asio::buffer(compressed_output));
-			break;
+			output_buffer.push_back(boost::asio::buffer(current_chunk));
+			boost::asio::async_write(
+				TCP_socket,
+				output_buffer,
+				strand.wrap(boost::bind(&Connection::handle_compressed_write,
+										this->shared_from_this(),
+										boost::asio::placeholders::error)));
+
+			// compress the next chunk while the first one is on the wire
+			pending_chunk.clear();
+			CompressNextChunk(pending_chunk);
+			return;
+		}
 		case noCompression:
 			// don't use any compression
 			reply.SetUncompressedSize();
@@ -122,26 +148,47 @@ void Connection::handle_write(const boost::system::error_code &error)
 	}
 }
 
-void Connection::CompressBufferCollection(std::vector<char> uncompressed_data,
-										  CompressionType compression_type,
-										  std::vector<char> &compressed_data)
+void Connection::handle_compressed_write(const boost::system::error_code &error)
 {
-	boost::iostreams::gzip_params compression_parameters;
+	if (error || pending_chunk.empty())
+	{
+		ReleaseCompressor();
+		handle_write(error);
+		return;
+	}
+
+	current_chunk.swap(pending_chunk);
+	boost::asio::async_write(TCP_socket,
+							 boost::asio::buffer(current_chunk),
+							 strand.wrap(boost::bind(&Connection::handle_compressed_write,
+													 this->shared_from_this(),
+													 boost::asio::placeholders::error)));
+	pending_chunk.clear();
+	CompressNextChunk(pending_chunk);
+}
 
-	// there's a trade-off between speed and size. speed wins
-	compression_parameters.level = boost::iostreams::zlib::best_speed;
-	// check which compression flavor is used
-	if (deflateRFC1951 == compression_type)
+void Connection::CompressNextChunk(std::vector<char> &chunk)
+{
+	BOOST_ASSERT(chunk.empty());
+	// zlib may buffer a whole chunk internally without emitting anything
+	while (!compression_finished && chunk.empty())
 	{
-		compression_parameters.noheader = true;
+		BOOST_ASSERT(compressor);
+		const std::size_t remaining = reply.content.size() - compressed_input_position;
+		const std::size_t length = std::min(remaining, ZlibCompressor::ChunkSize);
+		const bool is_last_chunk = (length == remaining);
+		compression_finished = compressor->Compress(
+			reply.content.data() + compressed_input_position, length, is_last_chunk, chunk);
+		compressed_input_position += length;
 	}
+}
 
-	BOOST_ASSERT(compressed_data.empty());
-	// plug data into boost's compression stream
-	boost::iostreams::filtering_ostream gzip_stream;
-	gzip_stream.push(boost::iostreams::gzip_compressor(compression_parameters));
-	gzip_stream.push(boost::iostreams::back_inserter(compressed_data));
-	gzip_stream.write(&uncompressed_data[0], uncompressed_data.size());
-	boost::iostreams::close(gzip_stream);
+void Connection::ReleaseCompressor()
+{
+	compression_finished = true;
+	if (compressor)
+	{
+		ZlibCompressor::Release(std::move(compressor));
+	}
 }
 }
@@ -32,6 +32,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "BaseDataFacade.h"
 
+#include "../../data_structures/geometry_coding.hpp"
 #include "../../data_structures/original_edge_data.hpp"
 #include "../../data_structures/query_node.hpp"
 #include "../../data_structures/query_edge.hpp"
@@ -41,11 +42,18 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../../data_structures/range_table.hpp"
 #include "../../Util/BoostFileSystemFix.h"
 #include "../../Util/graph_loader.hpp"
+#include "../../Util/osrm_exception.hpp"
 #include "../../Util/simple_logger.hpp"
 
 #include <osrm/Coordinate.h>
 #include <osrm/ServerPaths.h>
 
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <cstdint>
+#include <cstring>
+
 template <class EdgeDataT> class InternalDataFacade : public BaseDataFacade<EdgeDataT>
 {
 
@@ -69,8 +77,10 @@ private:
 	ShM<TravelMode, false>::vector m_travel_mode_list;
 	ShM<char, false>::vector m_names_char_list;
 	ShM<bool, false>::vector m_edge_is_compressed;
-	ShM<unsigned, false>::vector m_geometry_indices;
-	ShM<unsigned, false>::vector m_geometry_list;
+	boost::interprocess::file_mapping m_geometry_mapping;
+	boost::interprocess::mapped_region m_geometry_region;
+	ShM<std::uint64_t, true>::vector m_geometry_indices;
+	ShM<unsigned char, true>::vector m_geometry_list;
 
 	boost::thread_specific_ptr<
 	StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, false>::vector, false>> m_static_rtree;
@@ -169,32 +179,47 @@ private:
 		edges_input_stream.close();
 	}
 
+	// The geometries are used in place from a read-only mapping of the file,
+	// pages that are never asked for are never read.
 	void LoadGeometries(const boost::filesystem::path &geometry_file)
 	{
-		std::ifstream geometry_stream(geometry_file.string().c_str(), std::ios::binary);
-		unsigned number_of_indices = 0;
-		unsigned number_of_compressed_geometries = 0;
-
-		geometry_stream.read((char *)&number_of_indices, sizeof(unsigned));
-
-		m_geometry_indices.resize(number_of_indices);
-		if (number_of_indices > 0)
+		boost::interprocess::file_mapping mapping(geometry_file.string().c_str(),
+												  boost::interprocess::read_only);
+		boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only);
+		char *data = static_cast<char *>(region.get_address());
+		const std::size_t size = region.get_size();
+
+		std::uint64_t number_of_indices = 0;
+		if (size < sizeof(std::uint64_t))
 		{
-			geometry_stream.read((char *)&(m_geometry_indices[0]),
-					number_of_indices * sizeof(unsigned));
+			throw osrm::exception(geometry_file.string() + " is truncated");
 		}
+		std::memcpy(&number_of_indices, data, sizeof(std::uint64_t));
+		const std::size_t list_offset = (1 + number_of_indices) * sizeof(std::uint64_t);
 
-		geometry_stream.read((char *)&number_of_compressed_geometries, sizeof(unsigned));
-
-		BOOST_ASSERT(m_geometry_indices.back() == number_of_compressed_geometries);
-		m_geometry_list.resize(number_of_compressed_geometries);
-
-		if (number_of_compressed_geometries > 0)
+		std::uint64_t number_of_bytes = 0;
+		if (size < list_offset + sizeof(std::uint64_t))
+		{
+			throw osrm::exception(geometry_file.string() + " is truncated");
+		}
+		std::memcpy(&number_of_bytes, data + list_offset, sizeof(std::uint64_t));
+		if (size < list_offset + sizeof(std::uint64_t) + number_of_bytes)
 		{
-			geometry_stream.read((char *)&(m_geometry_list[0]),
-					number_of_compressed_geometries * sizeof(unsigned));
+			throw osrm::exception(geometry_file.string() + " is truncated");
 		}
-		geometry_stream.close();
+
+		ShM<std::uint64_t, true>::vector geometry_indices(
+			reinterpret_cast<std::uint64_t *>(data + sizeof(std::uint64_t)), number_of_indices);
+		ShM<unsigned char, true>::vector geometry_list(
+			reinterpret_cast<unsigned char *>(data + list_offset + sizeof(std::uint64_t)),
+			number_of_bytes);
+		BOOST_ASSERT(geometry_indices.empty() ||
+					 geometry_indices[geometry_indices.size() - 1] == number_of_bytes);
+
+		m_geometry_mapping.swap(mapping);
+		m_geometry_region.swap(region);
+		m_geometry_indices.swap(geometry_indices);
+		m_geometry_list.swap(geometry_list);
 	}
 
 	void LoadRTree()
@@ -325,6 +350,18 @@ public:
 
 	EdgeDataT &GetEdgeData(const EdgeID e) const final { return m_query_graph->GetEdgeData(e); }
 
+	// the dynamic server keeps its edge layout, the hot fields are gathered on access
+	QueryEdgeHotData GetHotData(const EdgeID e) const final
+	{
+		const EdgeDataT &data = m_query_graph->GetEdgeData(e);
+		QueryEdgeHotData hot_data;
+		hot_data.target = m_query_graph->GetTarget(e);
+		hot_data.distance = data.distance;
+		hot_data.forward = data.forward;
+		hot_data.backward = data.backward;
+		return hot_data;
+	}
+
 	EdgeID BeginEdges(const NodeID n) const final { return m_query_graph->BeginEdges(n); }
 
 	EdgeID EndEdges(const NodeID n) const final { return m_query_graph->EndEdges(n); }
@@ -413,6 +450,8 @@ public:
 
 	unsigned GetCheckSum() const final { return m_check_sum; }
 
+	unsigned GetDataGeneration() const final { return 0; }
+
 	unsigned GetNameIndexFromEdgeID(const unsigned id) const final
 	{
 		return m_name_ID_list.at(id);
@@ -445,12 +484,8 @@ public:
 	virtual void GetUncompressedGeometry(const unsigned id,
 										 std::vector<unsigned> &result_nodes) const final
 	{
-		const unsigned begin = m_geometry_indices.at(id);
-		const unsigned end = m_geometry_indices.at(id + 1);
-
-		result_nodes.clear();
-		result_nodes.insert(
-					result_nodes.begin(), m_geometry_list.begin() + begin, m_geometry_list.begin() + end);
+		GeometryCoding::Decode(m_geometry_list, m_geometry_indices.at(id),
+							   m_geometry_indices.at(id + 1), result_nodes);
 	}
 
 	std::string GetTimestamp() const final { return m_timestamp; }
@@ -25,15 +25,18 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 
-#ifndef SHARED_DATA_FACADE_H
-#define SHARED_DATA_FACADE_H
+#ifndef DYNAMIC_SHARED_DATA_FACADE_H
+#define DYNAMIC_SHARED_DATA_FACADE_H
 
-// implements all data storage when shared memory _IS_ used
+// implements all data storage of the dynamic server when shared memory _IS_ used
 
 #include "BaseDataFacade.h"
 #include "SharedDataType.h"
+#include "SharedGeneration.h"
 
+#include "../../data_structures/geometry_coding.hpp"
 #include "../../data_structures/range_table.hpp"
+#include "../../data_structures/shared_memory_factory.hpp"
 #include "../../data_structures/static_graph.hpp"
 #include "../../data_structures/static_rtree.hpp"
 #include "../../Util/BoostFileSystemFix.h"
@@ -41,19 +44,21 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../../Util/simple_logger.hpp"
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 
-template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDataT>
+// The graph is split over two regions: the topology with the first edge of
+// every node and the target of every edge, and the weights with the edge data.
+// All d_server processes share the topology, new weights replace only the
+// weights region.
+template <class EdgeDataT> class SharedDynamicDataFacade : public BaseDataFacade<EdgeDataT>
 {
 
   private:
     typedef EdgeDataT EdgeData;
     typedef BaseDataFacade<EdgeData> super;
-    typedef StaticGraph<EdgeData, true> QueryGraph;
     typedef typename StaticGraph<EdgeData, true>::NodeArrayEntry GraphNode;
-    typedef typename StaticGraph<EdgeData, true>::EdgeArrayEntry GraphEdge;
     typedef typename RangeTable<16, true>::BlockT NameIndexBlock;
-    typedef typename QueryGraph::InputEdge InputEdge;
     typedef typename super::RTreeLeaf RTreeLeaf;
     using SharedRTree = StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, true>::vector, true>;
     using TimeStampedRTreePair = std::pair<unsigned, std::shared_ptr<SharedRTree>>;
@@ -61,30 +66,34 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
 
     SharedDataLayout *data_layout;
     char *shared_memory;
-    SharedDataTimestamp *data_timestamp_ptr;
+    DynamicDataTimestamp *data_timestamp_ptr;
 
-    SharedDataType CURRENT_LAYOUT;
-    SharedDataType CURRENT_DATA;
-    unsigned CURRENT_TIMESTAMP;
+    // generation of the topology and weights in use
+    unsigned CURRENT_GENERATION;
+    // publish counter of the topology in use
+    unsigned CURRENT_TOPOLOGY;
 
     unsigned m_check_sum;
-    std::unique_ptr<QueryGraph> m_query_graph;
     std::unique_ptr<SharedMemory> m_layout_memory;
     std::unique_ptr<SharedMemory> m_large_memory;
+    std::unique_ptr<SharedMemory> m_weights_memory;
     std::string m_timestamp;
 
+    typename ShM<GraphNode, true>::vector m_graph_nodes;
+    ShM<NodeID, true>::vector m_graph_targets;
+    typename ShM<EdgeDataT, true>::vector m_edge_data;
+
     std::shared_ptr<ShM<FixedPointCoordinate, true>::vector> m_coordinate_list;
     ShM<NodeID, true>::vector m_via_node_list;
     ShM<unsigned, true>::vector m_name_ID_list;
     ShM<TurnInstruction, true>::vector m_turn_instruction_list;
     ShM<TravelMode, true>::vector m_travel_mode_list;
     ShM<char, true>::vector m_names_char_list;
-    ShM<unsigned, true>::vector m_name_begin_indices;
     ShM<bool, true>::vector m_edge_is_compressed;
-    ShM<unsigned, true>::vector m_geometry_indices;
-    ShM<unsigned, true>::vector m_geometry_list;
+    ShM<std::uint64_t, true>::vector m_geometry_indices;
+    ShM<unsigned char, true>::vector m_geometry_list;
 
-    boost::thread_specific_ptr<std::pair<unsigned, std::shared_ptr<SharedRTree>>> m_static_rtree;
+    boost::thread_specific_ptr<TimeStampedRTreePair> m_static_rtree;
     boost::filesystem::path file_index_path;
 
     std::shared_ptr<RangeTable<16, true>> m_name_table;
@@ -112,7 +121,7 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
 
         RTreeNode *tree_ptr =
             data_layout->GetBlockPtr<RTreeNode>(shared_memory, SharedDataLayout::R_SEARCH_TREE);
-        m_static_rtree.reset(new TimeStampedRTreePair(CURRENT_TIMESTAMP,
+        m_static_rtree.reset(new TimeStampedRTreePair(CURRENT_TOPOLOGY,
             osrm::make_unique<SharedRTree>(
                 tree_ptr,
                 data_layout->num_entries[SharedDataLayout::R_SEARCH_TREE],
@@ -124,15 +133,15 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
     {
         GraphNode *graph_nodes_ptr =
             data_layout->GetBlockPtr<GraphNode>(shared_memory, SharedDataLayout::GRAPH_NODE_LIST);
-
-        GraphEdge *graph_edges_ptr =
-            data_layout->GetBlockPtr<GraphEdge>(shared_memory, SharedDataLayout::GRAPH_EDGE_LIST);
-
-        typename ShM<GraphNode, true>::vector node_list(
+        typename ShM<GraphNode, true>::vector graph_nodes(
             graph_nodes_ptr, data_layout->num_entries[SharedDataLayout::GRAPH_NODE_LIST]);
-        typename ShM<GraphEdge, true>::vector edge_list(
-            graph_edges_ptr, data_layout->num_entries[SharedDataLayout::GRAPH_EDGE_LIST]);
-        m_query_graph.reset(new QueryGraph(node_list, edge_list));
+        m_graph_nodes.swap(graph_nodes);
+
+        NodeID *graph_targets_ptr =
+            data_layout->GetBlockPtr<NodeID>(shared_memory, SharedDataLayout::GRAPH_EDGE_LIST);
+        typename ShM<NodeID, true>::vector graph_targets(
+            graph_targets_ptr, data_layout->num_entries[SharedDataLayout::GRAPH_EDGE_LIST]);
+        m_graph_targets.swap(graph_targets);
     }
 
     void LoadNodeAndEdgeInformation()
@@ -203,120 +212,186 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
             data_layout->num_entries[SharedDataLayout::GEOMETRIES_INDICATORS]);
         m_edge_is_compressed.swap(edge_is_compressed);
 
-        unsigned *geometries_index_ptr =
-            data_layout->GetBlockPtr<unsigned>(shared_memory, SharedDataLayout::GEOMETRIES_INDEX);
-        typename ShM<unsigned, true>::vector geometry_begin_indices(
+        std::uint64_t *geometries_index_ptr = data_layout->GetBlockPtr<std::uint64_t>(
+            shared_memory, SharedDataLayout::GEOMETRIES_INDEX);
+        typename ShM<std::uint64_t, true>::vector geometry_begin_indices(
             geometries_index_ptr, data_layout->num_entries[SharedDataLayout::GEOMETRIES_INDEX]);
         m_geometry_indices.swap(geometry_begin_indices);
 
-        unsigned *geometries_list_ptr =
-            data_layout->GetBlockPtr<unsigned>(shared_memory, SharedDataLayout::GEOMETRIES_LIST);
-        typename ShM<unsigned, true>::vector geometry_list(
+        unsigned char *geometries_list_ptr = data_layout->GetBlockPtr<unsigned char>(
+            shared_memory, SharedDataLayout::GEOMETRIES_LIST);
+        typename ShM<unsigned char, true>::vector geometry_list(
             geometries_list_ptr, data_layout->num_entries[SharedDataLayout::GEOMETRIES_LIST]);
         m_geometry_list.swap(geometry_list);
     }
 
+    void LoadTopology(const DynamicGenerationPin &pin, const unsigned topology_counter)
+    {
+        m_layout_memory.reset(SharedMemoryFactory::Get(pin.TopologyLayout()));
+        data_layout = (SharedDataLayout *)(m_layout_memory->Ptr());
+
+        m_large_memory.reset(SharedMemoryFactory::Get(pin.TopologyData()));
+        shared_memory = (char *)(m_large_memory->Ptr());
+
+        const char *file_index_ptr =
+            data_layout->GetBlockPtr<char>(shared_memory, SharedDataLayout::FILE_INDEX_PATH);
+        file_index_path = boost::filesystem::path(file_index_ptr);
+        if (!boost::filesystem::exists(file_index_path))
+        {
+            SimpleLogger().Write(logDEBUG) << "Leaf file name " << file_index_path.string();
+            throw osrm::exception("Could not load leaf index file."
+                                  "Is any data loaded into shared memory?");
+        }
+
+        LoadGraph();
+        LoadChecksum();
+        LoadNodeAndEdgeInformation();
+        LoadGeometries();
+        LoadTimestamp();
+        LoadViaNodeList();
+        LoadNames();
+        CURRENT_TOPOLOGY = topology_counter;
+
+        data_layout->PrintInformation();
+    }
+
   public:
-    virtual ~SharedDataFacade() {}
+    virtual ~SharedDynamicDataFacade() {}
 
-    SharedDataFacade()
+    SharedDynamicDataFacade()
     {
-        data_timestamp_ptr = (SharedDataTimestamp *)SharedMemoryFactory::Get(
-                                 CURRENT_REGIONS, sizeof(SharedDataTimestamp), false, false)->Ptr();
-        CURRENT_LAYOUT = LAYOUT_NONE;
-        CURRENT_DATA = DATA_NONE;
-        CURRENT_TIMESTAMP = 0;
+        data_timestamp_ptr = (DynamicDataTimestamp *)SharedMemoryFactory::Get(
+                                 DYNAMIC_REGIONS, sizeof(DynamicDataTimestamp), false, false)->Ptr();
+        CURRENT_GENERATION = 0;
+        CURRENT_TOPOLOGY = 0;
 
         // load data
         CheckAndReloadFacade();
     }
 
+    DynamicDataTimestamp *GetSharedTimestamp() const { return data_timestamp_ptr; }
+
+    bool IsLoaded(const DynamicGenerationPin &pin) const
+    {
+        return CURRENT_GENERATION == pin.Generation();
+    }
+
     void CheckAndReloadFacade()
     {
-        if (CURRENT_LAYOUT != data_timestamp_ptr->layout ||
-            CURRENT_DATA != data_timestamp_ptr->data ||
-            CURRENT_TIMESTAMP != data_timestamp_ptr->timestamp)
+        const DynamicGenerationPin pin(data_timestamp_ptr);
+        if (0 == pin.Counter())
         {
-            // release the previous shared memory segments
-            SharedMemory::Remove(CURRENT_LAYOUT);
-            SharedMemory::Remove(CURRENT_DATA);
-
-            CURRENT_LAYOUT = data_timestamp_ptr->layout;
-            CURRENT_DATA = data_timestamp_ptr->data;
-            CURRENT_TIMESTAMP = data_timestamp_ptr->timestamp;
-
-            m_layout_memory.reset(SharedMemoryFactory::Get(CURRENT_LAYOUT));
+            throw osrm::exception("No data loaded into shared memory, run d_datastore.");
+        }
+        Reload(pin);
+    }
 
-            data_layout = (SharedDataLayout *)(m_layout_memory->Ptr());
+    // The caller keeps the pin for the whole reload and makes sure that no
+    // other query of this process uses the facade meanwhile. New weights only
+    // replace the edge data, the topology is reloaded when it changed as well.
+    void Reload(const DynamicGenerationPin &pin)
+    {
+        if (IsLoaded(pin))
+        {
+            return;
+        }
 
-            m_large_memory.reset(SharedMemoryFactory::Get(CURRENT_DATA));
-            shared_memory = (char *)(m_large_memory->Ptr());
+        m_weights_memory.reset(SharedMemoryFactory::Get(pin.Weights()));
+        const SharedWeightsHeader *weights_header =
+            (const SharedWeightsHeader *)(m_weights_memory->Ptr());
 
-            const char *file_index_ptr =
-                data_layout->GetBlockPtr<char>(shared_memory, SharedDataLayout::FILE_INDEX_PATH);
-            file_index_path = boost::filesystem::path(file_index_ptr);
-            if (!boost::filesystem::exists(file_index_path))
-            {
-                SimpleLogger().Write(logDEBUG) << "Leaf file name " << file_index_path.string();
-                throw osrm::exception("Could not load leaf index file."
-                                    "Is any data loaded into shared memory?");
-            }
+        if (0 == CURRENT_TOPOLOGY || CURRENT_TOPOLOGY != weights_header->topology_counter)
+        {
+            LoadTopology(pin, weights_header->topology_counter);
+        }
 
-            LoadGraph();
-            LoadChecksum();
-            LoadNodeAndEdgeInformation();
-            LoadGeometries();
-            LoadTimestamp();
-            LoadViaNodeList();
-            LoadNames();
+        if (m_check_sum != weights_header->topology_checksum ||
+            m_graph_targets.size() != weights_header->number_of_edges)
+        {
+            throw osrm::exception("weights in shared memory do not match the topology");
+        }
 
-            data_layout->PrintInformation();
+        EdgeDataT *edge_data_ptr = (EdgeDataT *)(weights_header + 1);
+        typename ShM<EdgeDataT, true>::vector edge_data(edge_data_ptr,
+                                                         weights_header->number_of_edges);
+        m_edge_data.swap(edge_data);
 
-            SimpleLogger().Write() << "number of geometries: " << m_coordinate_list->size();
-            for (unsigned i = 0; i < m_coordinate_list->size(); ++i)
-            {
-                if (!GetCoordinateOfNode(i).is_valid())
-                {
-                    SimpleLogger().Write() << "coordinate " << i << " not valid";
-                }
-            }
-        }
+        CURRENT_GENERATION = pin.Generation();
+        SimpleLogger().Write() << "switched to weights of generation " << pin.Counter();
     }
 
     // search graph access
-    unsigned GetNumberOfNodes() const final { return m_query_graph->GetNumberOfNodes(); }
+    unsigned GetNumberOfNodes() const final
+    {
+        return static_cast<unsigned>(m_graph_nodes.size() - 1);
+    }
 
-    unsigned GetNumberOfEdges() const final { return m_query_graph->GetNumberOfEdges(); }
+    unsigned GetNumberOfEdges() const final
+    {
+        return static_cast<unsigned>(m_graph_targets.size());
+    }
 
-    unsigned GetOutDegree(const NodeID n) const final { return m_query_graph->GetOutDegree(n); }
+    unsigned GetOutDegree(const NodeID n) const final { return EndEdges(n) - BeginEdges(n); }
 
-    NodeID GetTarget(const EdgeID e) const final { return m_query_graph->GetTarget(e); }
+    NodeID GetTarget(const EdgeID e) const final { return m_graph_targets[e]; }
 
-    EdgeDataT &GetEdgeData(const EdgeID e) const final { return m_query_graph->GetEdgeData(e); }
+    const EdgeDataT &GetEdgeData(const EdgeID e) const final { return m_edge_data[e]; }
 
-    EdgeID BeginEdges(const NodeID n) const final { return m_query_graph->BeginEdges(n); }
+    QueryEdgeHotData GetHotData(const EdgeID e) const final
+    {
+        const EdgeDataT &data = m_edge_data[e];
+        QueryEdgeHotData hot_data;
+        hot_data.target = m_graph_targets[e];
+        hot_data.distance = data.distance;
+        hot_data.forward = data.forward;
+        hot_data.backward = data.backward;
+        return hot_data;
+    }
+
+    EdgeID BeginEdges(const NodeID n) const final { return m_graph_nodes.at(n).first_edge; }
 
-    EdgeID EndEdges(const NodeID n) const final { return m_query_graph->EndEdges(n); }
+    EdgeID EndEdges(const NodeID n) const final { return m_graph_nodes.at(n + 1).first_edge; }
 
     EdgeRange GetAdjacentEdgeRange(const NodeID node) const final
     {
-        return m_query_graph->GetAdjacentEdgeRange(node);
+        return osrm::irange(BeginEdges(node), EndEdges(node));
     };
 
     // searches for a specific edge
     EdgeID FindEdge(const NodeID from, const NodeID to) const final
     {
-        return m_query_graph->FindEdge(from, to);
+        EdgeID smallest_edge = SPECIAL_EDGEID;
+        EdgeWeight smallest_weight = INVALID_EDGE_WEIGHT;
+        for (const auto edge : GetAdjacentEdgeRange(from))
+        {
+            const EdgeWeight weight = GetEdgeData(edge).distance;
+            if (GetTarget(edge) == to && weight < smallest_weight)
+            {
+                smallest_edge = edge;
+                smallest_weight = weight;
+            }
+        }
+        return smallest_edge;
     }
 
     EdgeID FindEdgeInEitherDirection(const NodeID from, const NodeID to) const final
     {
-        return m_query_graph->FindEdgeInEitherDirection(from, to);
+        const EdgeID edge = FindEdge(from, to);
+        return (SPECIAL_EDGEID != edge ? edge : FindEdge(to, from));
     }
 
     EdgeID FindEdgeIndicateIfReverse(const NodeID from, const NodeID to, bool &result) const final
     {
-        return m_query_graph->FindEdgeIndicateIfReverse(from, to, result);
+        EdgeID edge = FindEdge(from, to);
+        if (SPECIAL_EDGEID == edge)
+        {
+            edge = FindEdge(to, from);
+            if (SPECIAL_EDGEID != edge)
+            {
+                result = true;
+            }
+        }
+        return edge;
     }
 
     // node and edge information access
@@ -333,12 +408,8 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
     virtual void GetUncompressedGeometry(const unsigned id,
                                          std::vector<unsigned> &result_nodes) const final
     {
-        const unsigned begin = m_geometry_indices.at(id);
-        const unsigned end = m_geometry_indices.at(id + 1);
-
-        result_nodes.clear();
-        result_nodes.insert(
-            result_nodes.begin(), m_geometry_list.begin() + begin, m_geometry_list.begin() + end);
+        GeometryCoding::Decode(m_geometry_list, m_geometry_indices.at(id),
+                               m_geometry_indices.at(id + 1), result_nodes);
     }
 
     virtual unsigned GetGeometryIndexForEdgeID(const unsigned id) const final
@@ -360,7 +431,7 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
                                             FixedPointCoordinate &result,
                                             const unsigned zoom_level = 18) final
     {
-        if (!m_static_rtree.get() || CURRENT_TIMESTAMP != m_static_rtree->first)
+        if (!m_static_rtree.get() || CURRENT_TOPOLOGY != m_static_rtree->first)
         {
             LoadRTree();
         }
@@ -390,7 +461,7 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
                                             std::vector<PhantomNode> &resulting_phantom_node_vector,
                                             const unsigned number_of_results) final
     {
-        if (!m_static_rtree.get() || CURRENT_TIMESTAMP != m_static_rtree->first)
+        if (!m_static_rtree.get() || CURRENT_TOPOLOGY != m_static_rtree->first)
         {
             LoadRTree();
         }
@@ -399,7 +470,11 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
             input_coordinate, resulting_phantom_node_vector, number_of_results);
     }
 
-    unsigned GetCheckSum() const final { return m_check_sum; }
+    // changes with every published generation, so results that were computed
+    // on older weights are never taken for current ones
+    unsigned GetCheckSum() const final { return m_check_sum ^ CURRENT_GENERATION; }
+
+    unsigned GetDataGeneration() const final { return CURRENT_GENERATION; }
 
     unsigned GetNameIndexFromEdgeID(const unsigned id) const final
     {
@@ -428,4 +503,4 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
     std::string GetTimestamp() const final { return m_timestamp; }
 };
 
-#endif // SHARED_DATA_FACADE_H
+#endif // DYNAMIC_SHARED_DATA_FACADE_H
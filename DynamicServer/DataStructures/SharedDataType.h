@@ -25,169 +25,74 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 
-#ifndef SHARED_DATA_TYPE_H_
-#define SHARED_DATA_TYPE_H_
 
-#include "../../Util/osrm_exception.hpp"
-#include "../../Util/simple_logger.hpp"
-
-#include <cstdint>
-
-#include <array>
-
-// Added at the start and end of each block as sanity check
-static const char CANARY[] = "OSRM";
-
-struct SharedDataLayout
+#ifndef DYNAMIC_SHARED_DATA_TYPE_H
+#define DYNAMIC_SHARED_DATA_TYPE_H
+
+#include "../../Server/DataStructures/SharedDataType.h"
+
+#include <atomic>
+
+// Regions of the dataset d_datastore publishes for the dynamic server. They
+// are numbered apart from the regions of osrm-datastore, so both datasets can
+// be loaded on the same machine.
+//
+// The topology regions use the block layout of osrm-datastore. Its graph
+// blocks hold the first edge of every node (GRAPH_NODE_LIST) and the target of
+// every edge (GRAPH_EDGE_LIST), HSGR_CHECKSUM holds the .expanded checksum.
+// The edge data with the weights lives in a weights region of its own.
+enum DynamicDataType
+{ DYNAMIC_REGIONS = 16,
+  TOPOLOGY_LAYOUT_1,
+  TOPOLOGY_DATA_1,
+  TOPOLOGY_LAYOUT_2,
+  TOPOLOGY_DATA_2,
+  WEIGHTS_1,
+  WEIGHTS_2 };
+
+// Start of a weights region, followed by the edge data of all edges.
+struct SharedWeightsHeader
 {
-    enum BlockID {
-        NAME_OFFSETS = 0,
-        NAME_BLOCKS,
-        NAME_CHAR_LIST,
-        NAME_ID_LIST,
-        VIA_NODE_LIST,
-        GRAPH_NODE_LIST,
-        GRAPH_EDGE_LIST,
-        COORDINATE_LIST,
-        TURN_INSTRUCTION,
-        TRAVEL_MODE,
-        R_SEARCH_TREE,
-        GEOMETRIES_INDEX,
-        GEOMETRIES_LIST,
-        GEOMETRIES_INDICATORS,
-        HSGR_CHECKSUM,
-        TIMESTAMP,
-        FILE_INDEX_PATH,
-        NUM_BLOCKS
-    };
-
-    std::array<uint64_t, NUM_BLOCKS> num_entries;
-    std::array<uint64_t, NUM_BLOCKS> entry_size;
-
-    SharedDataLayout()
-    : num_entries()
-    , entry_size()
-    {
-    }
+    // checksum and publish counter of the topology the weights belong to
+    unsigned topology_checksum;
+    unsigned topology_counter;
+    unsigned number_of_edges;
+};
 
-    void PrintInformation() const
-    {
-        SimpleLogger().Write(logDEBUG) << "-";
-        SimpleLogger().Write(logDEBUG) << "name_offsets_size:          " << num_entries[NAME_OFFSETS];
-        SimpleLogger().Write(logDEBUG) << "name_blocks_size:           " << num_entries[NAME_BLOCKS];
-        SimpleLogger().Write(logDEBUG) << "name_char_list_size:        " << num_entries[NAME_CHAR_LIST];
-        SimpleLogger().Write(logDEBUG) << "name_id_list_size:          " << num_entries[NAME_ID_LIST];
-        SimpleLogger().Write(logDEBUG) << "via_node_list_size:         " << num_entries[VIA_NODE_LIST];
-        SimpleLogger().Write(logDEBUG) << "graph_node_list_size:       " << num_entries[GRAPH_NODE_LIST];
-        SimpleLogger().Write(logDEBUG) << "graph_edge_list_size:       " << num_entries[GRAPH_EDGE_LIST];
-        SimpleLogger().Write(logDEBUG) << "timestamp_length:           " << num_entries[TIMESTAMP];
-        SimpleLogger().Write(logDEBUG) << "coordinate_list_size:       " << num_entries[COORDINATE_LIST];
-        SimpleLogger().Write(logDEBUG) << "turn_instruction_list_size: " << num_entries[TURN_INSTRUCTION];
-        SimpleLogger().Write(logDEBUG) << "travel_mode_list_size:      " << num_entries[TRAVEL_MODE];
-        SimpleLogger().Write(logDEBUG) << "r_search_tree_size:         " << num_entries[R_SEARCH_TREE];
-        SimpleLogger().Write(logDEBUG) << "geometries_indicators:      " << num_entries[GEOMETRIES_INDICATORS]
-                                       << "/" << ((num_entries[GEOMETRIES_INDICATORS] / 8) + 1);
-        SimpleLogger().Write(logDEBUG) << "geometries_index_list_size: " << num_entries[GEOMETRIES_INDEX];
-        SimpleLogger().Write(logDEBUG) << "geometries_list_size:       " << num_entries[GEOMETRIES_LIST];
-        SimpleLogger().Write(logDEBUG) << "sizeof(checksum):           " << entry_size[HSGR_CHECKSUM];
-
-        SimpleLogger().Write(logDEBUG) << "NAME_OFFSETS         " << ": " << GetBlockSize(NAME_OFFSETS         );
-        SimpleLogger().Write(logDEBUG) << "NAME_BLOCKS          " << ": " << GetBlockSize(NAME_BLOCKS          );
-        SimpleLogger().Write(logDEBUG) << "NAME_CHAR_LIST       " << ": " << GetBlockSize(NAME_CHAR_LIST       );
-        SimpleLogger().Write(logDEBUG) << "NAME_ID_LIST         " << ": " << GetBlockSize(NAME_ID_LIST         );
-        SimpleLogger().Write(logDEBUG) << "VIA_NODE_LIST        " << ": " << GetBlockSize(VIA_NODE_LIST        );
-        SimpleLogger().Write(logDEBUG) << "GRAPH_NODE_LIST      " << ": " << GetBlockSize(GRAPH_NODE_LIST      );
-        SimpleLogger().Write(logDEBUG) << "GRAPH_EDGE_LIST      " << ": " << GetBlockSize(GRAPH_EDGE_LIST      );
-        SimpleLogger().Write(logDEBUG) << "COORDINATE_LIST      " << ": " << GetBlockSize(COORDINATE_LIST      );
-        SimpleLogger().Write(logDEBUG) << "TURN_INSTRUCTION     " << ": " << GetBlockSize(TURN_INSTRUCTION     );
-        SimpleLogger().Write(logDEBUG) << "TRAVEL_MODE          " << ": " << GetBlockSize(TRAVEL_MODE          );
-        SimpleLogger().Write(logDEBUG) << "R_SEARCH_TREE        " << ": " << GetBlockSize(R_SEARCH_TREE        );
-        SimpleLogger().Write(logDEBUG) << "GEOMETRIES_INDEX     " << ": " << GetBlockSize(GEOMETRIES_INDEX     );
-        SimpleLogger().Write(logDEBUG) << "GEOMETRIES_LIST      " << ": " << GetBlockSize(GEOMETRIES_LIST      );
-        SimpleLogger().Write(logDEBUG) << "GEOMETRIES_INDICATORS" << ": " << GetBlockSize(GEOMETRIES_INDICATORS);
-        SimpleLogger().Write(logDEBUG) << "HSGR_CHECKSUM        " << ": " << GetBlockSize(HSGR_CHECKSUM        );
-        SimpleLogger().Write(logDEBUG) << "TIMESTAMP            " << ": " << GetBlockSize(TIMESTAMP            );
-        SimpleLogger().Write(logDEBUG) << "FILE_INDEX_PATH      " << ": " << GetBlockSize(FILE_INDEX_PATH      );
-    }
+// Lives in the DYNAMIC_REGIONS segment. generation packs a publish counter
+// with the topology pair (bit 1) and weights region (bit 0) in use, queries
+// read it without taking any lock. The reader counters count the queries of
+// all processes that run on the regions _1 (index 0) and _2 (index 1).
+struct DynamicDataTimestamp
+{
+    std::atomic<unsigned> generation;
+    std::atomic<int> topology_readers[2];
+    std::atomic<int> weights_readers[2];
 
-    template<typename T>
-    inline void SetBlockSize(BlockID bid, uint64_t entries)
+    static unsigned PackGeneration(const unsigned counter,
+                                   const unsigned topology_index,
+                                   const unsigned weights_index)
     {
-        num_entries[bid] = entries;
-        entry_size[bid] = sizeof(T);
+        return (counter << 2) | (topology_index << 1) | weights_index;
     }
 
-    inline uint64_t GetBlockSize(BlockID bid) const
-    {
-        // special encoding
-        if (bid == GEOMETRIES_INDICATORS)
-        {
-            return (num_entries[GEOMETRIES_INDICATORS]/32 + 1) * entry_size[GEOMETRIES_INDICATORS];
-        }
+    static unsigned Counter(const unsigned generation) { return generation >> 2; }
 
-        return num_entries[bid] * entry_size[bid];
-    }
+    static unsigned TopologyIndex(const unsigned generation) { return (generation >> 1) & 1; }
 
-    inline uint64_t GetSizeOfLayout() const
-    {
-        return GetBlockOffset(NUM_BLOCKS) + NUM_BLOCKS*2*sizeof(CANARY);
-    }
+    static unsigned WeightsIndex(const unsigned generation) { return generation & 1; }
 
-    inline uint64_t GetBlockOffset(BlockID bid) const
+    static DynamicDataType TopologyLayout(const unsigned index)
     {
-        uint64_t result = sizeof(CANARY);
-        for (auto i = 0; i < bid; i++)
-        {
-            result += GetBlockSize((BlockID) i) + 2*sizeof(CANARY);
-        }
-        return result;
+        return index ? TOPOLOGY_LAYOUT_2 : TOPOLOGY_LAYOUT_1;
     }
 
-    template<typename T, bool WRITE_CANARY=false>
-    inline T* GetBlockPtr(char* shared_memory, BlockID bid)
+    static DynamicDataType TopologyData(const unsigned index)
     {
-        T* ptr = (T*)(shared_memory + GetBlockOffset(bid));
-        if (WRITE_CANARY)
-        {
-            char* start_canary_ptr = shared_memory + GetBlockOffset(bid) - sizeof(CANARY);
-            char* end_canary_ptr = shared_memory + GetBlockOffset(bid) + GetBlockSize(bid);
-            std::copy(CANARY, CANARY + sizeof(CANARY), start_canary_ptr);
-            std::copy(CANARY, CANARY + sizeof(CANARY), end_canary_ptr);
-        }
-        else
-        {
-            char* start_canary_ptr = shared_memory + GetBlockOffset(bid) - sizeof(CANARY);
-            char* end_canary_ptr = shared_memory + GetBlockOffset(bid) + GetBlockSize(bid);
-            bool start_canary_alive = std::equal(CANARY, CANARY + sizeof(CANARY), start_canary_ptr);
-            bool end_canary_alive = std::equal(CANARY, CANARY + sizeof(CANARY), end_canary_ptr);
-            if (!start_canary_alive)
-            {
-                throw osrm::exception("Start canary of block corrupted.");
-            }
-            if (!end_canary_alive)
-            {
-                throw osrm::exception("End canary of block corrupted.");
-            }
-        }
-
-        return ptr;
+        return index ? TOPOLOGY_DATA_2 : TOPOLOGY_DATA_1;
     }
-};
 
-enum SharedDataType
-{ CURRENT_REGIONS,
-  LAYOUT_1,
-  DATA_1,
-  LAYOUT_2,
-  DATA_2,
-  LAYOUT_NONE,
-  DATA_NONE };
-
-struct SharedDataTimestamp
-{
-    SharedDataType layout;
-    SharedDataType data;
-    unsigned timestamp;
+    static DynamicDataType Weights(const unsigned index) { return index ? WEIGHTS_2 : WEIGHTS_1; }
 };
 
-#endif /* SHARED_DATA_TYPE_H_ */
+#endif // DYNAMIC_SHARED_DATA_TYPE_H
@@ -0,0 +1,129 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef DYNAMIC_SHARED_GENERATION_H
+#define DYNAMIC_SHARED_GENERATION_H
+
+#include "SharedDataType.h"
+
+#include <boost/assert.hpp>
+
+#include <chrono>
+#include <thread>
+
+// Keeps the topology and the weights that were published when it was created
+// from being freed by d_datastore, works like SharedGenerationPin.
+class DynamicGenerationPin
+{
+  public:
+    explicit DynamicGenerationPin(DynamicDataTimestamp *shared) : shared(shared)
+    {
+        BOOST_ASSERT(nullptr != shared);
+        for (;;)
+        {
+            generation = shared->generation.load();
+            Count(1);
+            // the writer publishes before it counts readers, so either it sees
+            // this pin or the re-read below sees its new generation
+            if (generation == shared->generation.load())
+            {
+                break;
+            }
+            Count(-1);
+        }
+    }
+
+    DynamicGenerationPin(const DynamicGenerationPin &) = delete;
+
+    ~DynamicGenerationPin() { Count(-1); }
+
+    unsigned Generation() const { return generation; }
+    unsigned Counter() const { return DynamicDataTimestamp::Counter(generation); }
+    DynamicDataType TopologyLayout() const
+    {
+        return DynamicDataTimestamp::TopologyLayout(DynamicDataTimestamp::TopologyIndex(generation));
+    }
+    DynamicDataType TopologyData() const
+    {
+        return DynamicDataTimestamp::TopologyData(DynamicDataTimestamp::TopologyIndex(generation));
+    }
+    DynamicDataType Weights() const
+    {
+        return DynamicDataTimestamp::Weights(DynamicDataTimestamp::WeightsIndex(generation));
+    }
+
+  private:
+    void Count(const int delta)
+    {
+        shared->topology_readers[DynamicDataTimestamp::TopologyIndex(generation)].fetch_add(delta);
+        shared->weights_readers[DynamicDataTimestamp::WeightsIndex(generation)].fetch_add(delta);
+    }
+
+    DynamicDataTimestamp *shared;
+    unsigned generation;
+};
+
+namespace DynamicGeneration
+{
+// makes the given regions visible to all new queries
+inline void Publish(DynamicDataTimestamp *shared,
+                    const unsigned topology_index,
+                    const unsigned weights_index)
+{
+    const unsigned counter = DynamicDataTimestamp::Counter(shared->generation.load()) + 1;
+    shared->generation.store(
+        DynamicDataTimestamp::PackGeneration(counter, topology_index, weights_index));
+}
+
+// Waits until no query runs on the given reader counter anymore. A process
+// that died while it held a pin never releases it, hence the time limit.
+inline bool WaitForReaders(std::atomic<int> &readers, const std::chrono::milliseconds limit)
+{
+    const auto deadline = std::chrono::steady_clock::now() + limit;
+    while (0 < readers.load())
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// for osrm-unlock-all, after a crashed process left its pins behind
+inline void ResetReaders(DynamicDataTimestamp *shared)
+{
+    shared->topology_readers[0].store(0);
+    shared->topology_readers[1].store(0);
+    shared->weights_readers[0].store(0);
+    shared->weights_readers[1].store(0);
+}
+}
+
+#endif // DYNAMIC_SHARED_GENERATION_H
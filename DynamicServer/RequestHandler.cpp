@@ -4,6 +4,8 @@
 #include "../Server/Http/Request.h"
 
 #include "../data_structures/json_container.hpp"
+#include "../data_structures/query_scheduler.hpp"
+#include "../data_structures/request_coalescer.hpp"
 #include "../LibDRM/DRM.h"
 #include "../Util/json_renderer.hpp"
 #include "../Util/simple_logger.hpp"
@@ -16,9 +18,15 @@
 #include <ctime>
 
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 
-RequestHandler::RequestHandler() : d_routing_machine(nullptr) {}
+RequestHandler::RequestHandler()
+	: d_routing_machine(nullptr), max_query_time(0), coalescer(new RequestCoalescer<http::Reply>())
+{
+}
+
+RequestHandler::~RequestHandler() {}
 
 void RequestHandler::handle_request(const http::Request &req, http::Reply &reply)
 {
@@ -72,6 +80,49 @@ void RequestHandler::handle_request(const http::Request &req, http::Reply &reply
 			return;
 		}
 
+		// the server wide limit wins over anything more generous the client asked for
+		if (0 != max_query_time &&
+			(0 == route_parameters.timeout || route_parameters.timeout > max_query_time))
+		{
+			route_parameters.timeout = max_query_time;
+		}
+
+		// an identical request that is already being answered is not computed twice
+		auto flight = coalescer->Join(request);
+		if (!flight.IsLeader())
+		{
+			// waiting parks this thread, so it counts against the admission limits
+			const QueryScheduler::Follower follower(scheduler.get());
+			if (!follower.Admitted() ||
+				!flight.WaitFor(std::chrono::milliseconds(route_parameters.timeout)))
+			{
+				reply = http::Reply::StockReply(http::Reply::serviceUnavailable);
+				reply.headers.emplace_back("Retry-After", "1");
+				SimpleLogger().Write(logDEBUG) << "[overloaded] rejected follower uri: " << req.uri;
+				return;
+			}
+			const auto shared_reply = flight.Wait();
+			if (shared_reply)
+			{
+				reply = *shared_reply;
+				SimpleLogger().Write(logDEBUG) << "[coalesced] uri: " << req.uri
+											   << ", total: " << coalescer->Coalesced();
+				return;
+			}
+		}
+
+		// table queries and long routes must not crowd out the cheap ones
+		const QueryScheduler::Slot slot(
+			scheduler.get(),
+			QueryScheduler::Classify(route_parameters.service, route_parameters.coordinates.size()));
+		if (!slot.Admitted())
+		{
+			reply = http::Reply::StockReply(http::Reply::serviceUnavailable);
+			reply.headers.emplace_back("Retry-After", "1");
+			SimpleLogger().Write(logDEBUG) << "[overloaded] rejected uri: " << req.uri;
+			return;
+		}
+
 		// parsing done, lets call the right plugin to handle the request
 		BOOST_ASSERT_MSG(d_routing_machine != nullptr, "pointer not init'ed");
 
@@ -103,6 +154,12 @@ void RequestHandler::handle_request(const http::Request &req, http::Reply &reply
 			reply.headers.emplace_back("Content-Type", "text/javascript; charset=UTF-8");
 			reply.headers.emplace_back("Content-Disposition", "inline; filename=\"response.js\"");
 		}
+		// a timeout or error of the leader says nothing about the followers, which
+		// compute the query themselves within their own limits once the flight is dropped
+		if (http::Reply::ok == reply.status)
+		{
+			flight.Publish(reply);
+		}
 	}
 	catch (const std::exception &e)
 	{
@@ -114,3 +171,13 @@ void RequestHandler::handle_request(const http::Request &req, http::Reply &reply
 }
 
 void RequestHandler::RegisterRoutingMachine(DRM *drm) { d_routing_machine = drm; }
+
+void RequestHandler::SetMaxQueryTime(const unsigned milliseconds)
+{
+	max_query_time = milliseconds;
+}
+
+void RequestHandler::EnableAdmissionControl(const unsigned thread_count)
+{
+	scheduler = QueryScheduler::ForThreads(thread_count);
+}
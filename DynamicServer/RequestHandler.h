@@ -3,10 +3,13 @@
 
 #include "../LibDRM/DRM.h"
 
+#include <memory>
 #include <string>
 
 template <typename Iterator, class HandlerT> struct APIGrammar;
 struct RouteParameters;
+class QueryScheduler;
+template <typename ResultT> class RequestCoalescer;
 class OSRM;
 
 namespace http
@@ -23,12 +26,20 @@ public:
 
 	RequestHandler();
 	RequestHandler(const RequestHandler &) = delete;
+	~RequestHandler();
 
 	void handle_request(const http::Request &req, http::Reply &rep);
 	void RegisterRoutingMachine(DRM *drm);
+	// caps the time budget of every query, 0 means unlimited
+	void SetMaxQueryTime(const unsigned milliseconds);
+	// bounds the queries running and waiting per class, scaled to the server threads
+	void EnableAdmissionControl(const unsigned thread_count);
 
 private:
 	DRM *d_routing_machine;
+	unsigned max_query_time;
+	std::unique_ptr<QueryScheduler> scheduler;
+	std::unique_ptr<RequestCoalescer<http::Reply>> coalescer;
 };
 
 #endif // REQUEST_HANDLER_H
@@ -39,13 +39,18 @@ namespace http
 
 const char okHTML[] = "";
 const char badRequestHTML[] = "{\"status\": 400,\"status_message\":\"Bad Request\"}";
+const char requestTimeoutHTML[] = "{\"status\": 408,\"status_message\":\"Request Timeout\"}";
 const char internalServerErrorHTML[] =
     "{\"status\": 500,\"status_message\":\"Internal Server Error\"}";
+const char serviceUnavailableHTML[] =
+    "{\"status\": 503,\"status_message\":\"Service Unavailable\"}";
 const char seperators[] = {':', ' '};
 const char crlf[] = {'\r', '\n'};
 const std::string okString = "HTTP/1.0 200 OK\r\n";
 const std::string badRequestString = "HTTP/1.0 400 Bad Request\r\n";
+const std::string requestTimeoutString = "HTTP/1.0 408 Request Timeout\r\n";
 const std::string internalServerErrorString = "HTTP/1.0 500 Internal Server Error\r\n";
+const std::string serviceUnavailableString = "HTTP/1.0 503 Service Unavailable\r\n";
 
 class Reply
 {
@@ -53,7 +58,9 @@ class Reply
     enum status_type
     { ok = 200,
       badRequest = 400,
-      internalServerError = 500 } status;
+      requestTimeout = 408,
+      internalServerError = 500,
+      serviceUnavailable = 503 } status;
 
     std::vector<Header> headers;
     std::vector<boost::asio::const_buffer> ToBuffers();
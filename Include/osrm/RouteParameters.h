@@ -69,6 +69,8 @@ struct RouteParameters
 
 	void setCompressionFlag(const bool flag);
 
+	void setTimeout(const unsigned milliseconds);
+
 	void addCoordinate(const boost::fusion::vector<double, double> &coordinates);
 
 	short zoom_level;
@@ -80,6 +82,8 @@ struct RouteParameters
 	bool uturn_default;
 	unsigned check_sum;
 	short num_results;
+	// query time budget in milliseconds, 0 means unlimited
+	unsigned timeout;
 	std::string service;
 	std::string output_format;
 	std::string jsonp_parameter;
@@ -46,7 +46,7 @@ private:
 	std::unique_ptr<DRM_impl> DRM_pimpl_;
 
 public:
-	explicit DRM(ServerPaths paths);
+	explicit DRM(ServerPaths paths, const bool use_shared_memory = false);
 	~DRM();
 	void RunQuery(RouteParameters &route_parameters, http::Reply &reply);
 };
@@ -20,28 +20,34 @@ namespace boost { namespace interprocess { class named_mutex; } }
 #include "../plugins/nodeid.hpp"
 #include "../plugins/baseroute.hpp"
 
-#include "../Server/DataStructures/BaseDataFacade.h"
-#include "../Server/DataStructures/InternalDataFacade.h"
-#include "../Server/DataStructures/SharedBarriers.h"
-#include "../Server/DataStructures/SharedDataFacade.h"
+#include "../DynamicServer/DataStructures/BaseDataFacade.h"
+#include "../DynamicServer/DataStructures/InternalDataFacade.h"
+#include "../DynamicServer/DataStructures/SharedDataFacade.h"
 #include "../Util/make_unique.hpp"
 #include "../Util/ProgramOptions.h"
 #include "../Util/simple_logger.hpp"
 
 #include <boost/assert.hpp>
-#include <boost/interprocess/sync/named_condition.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/thread/locks.hpp>
 
 #include <algorithm>
 #include <fstream>
 #include <utility>
 #include <vector>
 
-DRM_impl::DRM_impl(ServerPaths server_paths)
+DRM_impl::DRM_impl(ServerPaths server_paths, const bool use_shared_memory)
 {
-	// populate base path
-	populate_base_path(server_paths);
-	query_data_facade = new InternalDataFacade<QueryEdge::EdgeData>(server_paths);
+	if (use_shared_memory)
+	{
+		reload_mutex = osrm::make_unique<boost::shared_mutex>();
+		query_data_facade = new SharedDynamicDataFacade<QueryEdge::EdgeData>();
+	}
+	else
+	{
+		// populate base path
+		populate_base_path(server_paths);
+		query_data_facade = new InternalDataFacade<QueryEdge::EdgeData>(server_paths);
+	}
 
 	/*
 	// The following plugins handle all requests.
@@ -82,21 +88,43 @@ void DRM_impl::RunQuery(RouteParameters &route_parameters, http::Reply &reply)
 {
 	const PluginMap::const_iterator &iter = plugin_map.find(route_parameters.service);
 
-	if (plugin_map.end() != iter)
+	if (plugin_map.end() == iter)
+	{
+		reply = http::Reply::StockReply(http::Reply::badRequest);
+		return;
+	}
+
+	reply.status = http::Reply::ok;
+	if (!reload_mutex)
 	{
-		reply.status = http::Reply::ok;
 		iter->second->HandleRequest(route_parameters, reply);
+		return;
 	}
-	else
+
+	auto shared_facade = static_cast<SharedDynamicDataFacade<QueryEdge::EdgeData> *>(query_data_facade);
+	for (;;)
 	{
-		reply = http::Reply::StockReply(http::Reply::badRequest);
+		// d_datastore does not free the pinned topology and weights before the pin is gone
+		const DynamicGenerationPin pin(shared_facade->GetSharedTimestamp());
+		{
+			boost::shared_lock<boost::shared_mutex> query_lock(*reload_mutex);
+			if (shared_facade->IsLoaded(pin))
+			{
+				iter->second->HandleRequest(route_parameters, reply);
+				return;
+			}
+		}
+
+		// the first query to see new weights switches the facade over
+		boost::unique_lock<boost::shared_mutex> reload_lock(*reload_mutex);
+		shared_facade->Reload(pin);
 	}
 }
 
 // proxy code for compilation firewall
 
-DRM::DRM(ServerPaths paths)
-	: DRM_pimpl_(osrm::make_unique<DRM_impl>(paths))
+DRM::DRM(ServerPaths paths, const bool use_shared_memory)
+	: DRM_pimpl_(osrm::make_unique<DRM_impl>(paths, use_shared_memory))
 {
 }
 
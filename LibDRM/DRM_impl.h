@@ -8,13 +8,14 @@ struct RouteParameters;
 #include <osrm/ServerPaths.h>
 
 #include "../data_structures/query_edge.hpp"
-#include "../DynamicServer/DataStructures/InternalDataFacade.h"
+
+#include <boost/thread/shared_mutex.hpp>
 
 #include <memory>
 #include <unordered_map>
 #include <string>
 
-//template <class EdgeDataT> class BaseDataFacade;
+template <class EdgeDataT> class BaseDataFacade;
 
 class DRM_impl
 {
@@ -22,7 +23,7 @@ private:
 	using PluginMap = std::unordered_map<std::string, BasePlugin *>;
 
 public:
-	DRM_impl(ServerPaths paths);
+	DRM_impl(ServerPaths paths, const bool use_shared_memory);
 	DRM_impl(const DRM_impl &) = delete;
 	virtual ~DRM_impl();
 	void RunQuery(RouteParameters &route_parameters, http::Reply &reply);
@@ -30,8 +31,11 @@ public:
 private:
 	void RegisterPlugin(BasePlugin *plugin);
 	PluginMap plugin_map;
+	// will only be initialized if shared memory is used. Queries of this
+	// process share it, switching the facade to new data takes it exclusively.
+	std::unique_ptr<boost::shared_mutex> reload_mutex;
 	// base class pointer to the objects
-	InternalDataFacade<QueryEdge::EdgeData> *query_data_facade;
+	BaseDataFacade<QueryEdge::EdgeData> *query_data_facade;
 };
 
 #endif // DRM_IMPL_H
@@ -25,8 +25,6 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 
-namespace boost { namespace interprocess { class named_mutex; } }
-
 #include "OSRM_impl.h"
 #include "OSRM.h"
 
@@ -42,15 +40,13 @@ namespace boost { namespace interprocess { class named_mutex; } }
 #include "../plugins/viaroute.hpp"
 #include "../Server/DataStructures/BaseDataFacade.h"
 #include "../Server/DataStructures/InternalDataFacade.h"
-#include "../Server/DataStructures/SharedBarriers.h"
 #include "../Server/DataStructures/SharedDataFacade.h"
 #include "../Util/make_unique.hpp"
 #include "../Util/ProgramOptions.h"
 #include "../Util/simple_logger.hpp"
 
 #include <boost/assert.hpp>
-#include <boost/interprocess/sync/named_condition.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/thread/locks.hpp>
 
 #include <algorithm>
 #include <fstream>
@@ -61,7 +57,7 @@ OSRM_impl::OSRM_impl(ServerPaths server_paths, const bool use_shared_memory)
 {
 	if (use_shared_memory)
 	{
-		barrier = osrm::make_unique<SharedBarriers>();
+		reload_mutex = osrm::make_unique<boost::shared_mutex>();
 		query_data_facade = new SharedDataFacade<QueryEdge::EdgeData>();
 	}
 	else
@@ -103,50 +99,36 @@ void OSRM_impl::RunQuery(RouteParameters &route_parameters, http::Reply &reply)
 {
 	const PluginMap::const_iterator &iter = plugin_map.find(route_parameters.service);
 
-	if (plugin_map.end() != iter)
+	if (plugin_map.end() == iter)
 	{
-		reply.status = http::Reply::ok;
-		if (barrier)
-		{
-			// lock update pending
-			boost::interprocess::scoped_lock<boost::interprocess::named_mutex> pending_lock(
-						barrier->pending_update_mutex);
-
-			// lock query
-			boost::interprocess::scoped_lock<boost::interprocess::named_mutex> query_lock(
-						barrier->query_mutex);
-
-			// unlock update pending
-			pending_lock.unlock();
-
-			// increment query count
-			++(barrier->number_of_queries);
-
-			(static_cast<SharedDataFacade<QueryEdge::EdgeData> *>(query_data_facade))
-					->CheckAndReloadFacade();
-		}
+		reply = http::Reply::StockReply(http::Reply::badRequest);
+		return;
+	}
 
+	reply.status = http::Reply::ok;
+	if (!reload_mutex)
+	{
 		iter->second->HandleRequest(route_parameters, reply);
-		if (barrier)
-		{
-			// lock query
-			boost::interprocess::scoped_lock<boost::interprocess::named_mutex> query_lock(
-						barrier->query_mutex);
-
-			// decrement query count
-			--(barrier->number_of_queries);
-			BOOST_ASSERT_MSG(0 <= barrier->number_of_queries, "invalid number of queries");
+		return;
+	}
 
-			// notify all processes that were waiting for this condition
-			if (0 == barrier->number_of_queries)
+	auto shared_facade = static_cast<SharedDataFacade<QueryEdge::EdgeData> *>(query_data_facade);
+	for (;;)
+	{
+		// osrm-datastore does not free the pinned dataset before the pin is gone
+		const SharedGenerationPin pin(shared_facade->GetSharedTimestamp());
+		{
+			boost::shared_lock<boost::shared_mutex> query_lock(*reload_mutex);
+			if (shared_facade->IsLoaded(pin))
 			{
-				barrier->no_running_queries_condition.notify_all();
+				iter->second->HandleRequest(route_parameters, reply);
+				return;
 			}
 		}
-	}
-	else
-	{
-		reply = http::Reply::StockReply(http::Reply::badRequest);
+
+		// the first query to see a new dataset switches the facade over
+		boost::unique_lock<boost::shared_mutex> reload_lock(*reload_mutex);
+		shared_facade->Reload(pin);
 	}
 }
 
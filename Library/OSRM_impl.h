@@ -36,11 +36,12 @@ struct RouteParameters;
 
 #include "../data_structures/query_edge.hpp"
 
+#include <boost/thread/shared_mutex.hpp>
+
 #include <memory>
 #include <unordered_map>
 #include <string>
 
-struct SharedBarriers;
 template <class EdgeDataT> class BaseDataFacade;
 
 class OSRM_impl
@@ -57,8 +58,9 @@ public:
 private:
 	void RegisterPlugin(BasePlugin *plugin);
 	PluginMap plugin_map;
-	// will only be initialized if shared memory is used
-	std::unique_ptr<SharedBarriers> barrier;
+	// will only be initialized if shared memory is used. Queries of this
+	// process share it, switching the facade to new data takes it exclusively.
+	std::unique_ptr<boost::shared_mutex> reload_mutex;
 	// base class pointer to the objects
 	BaseDataFacade<QueryEdge::EdgeData> *query_data_facade;
 };
@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // #include "RequestParser.h"
 #include "Http/CompressionType.h"
+#include "Http/ZlibCompressor.h"
 #include "Http/Request.h"
 
 #include <osrm/Reply.h>
@@ -87,9 +88,13 @@ class Connection : public std::enable_shared_from_this<Connection>
     /// Handle completion of a write operation.
     void handle_write(const boost::system::error_code &e);
 
-    void CompressBufferCollection(std::vector<char> uncompressed_data,
-                                  CompressionType compression_type,
-                                  std::vector<char> &compressed_data);
+    /// Handle completion of a write of a compressed chunk.
+    void handle_compressed_write(const boost::system::error_code &e);
+
+    /// Compress the next slice of the reply into the given buffer.
+    void CompressNextChunk(std::vector<char> &chunk);
+
+    void ReleaseCompressor();
 
     boost::asio::io_service::strand strand;
     boost::asio::ip::tcp::socket TCP_socket;
@@ -97,6 +102,12 @@ class Connection : public std::enable_shared_from_this<Connection>
     boost::array<char, 8192> incoming_data_buffer;
     Request request;
     Reply reply;
+    std::unique_ptr<ZlibCompressor> compressor;
+    std::size_t compressed_input_position;
+    bool compression_finished;
+    // the chunk on the wire and the one compressed while it is being sent
+    std::vector<char> current_chunk;
+    std::vector<char> pending_chunk;
 };
 
 } // namespace http
@@ -33,6 +33,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../../data_structures/edge_based_node.hpp"
 #include "../../data_structures/external_memory_node.hpp"
 #include "../../data_structures/phantom_node.hpp"
+#include "../../data_structures/query_edge.hpp"
 #include "../../data_structures/turn_instructions.hpp"
 #include "../../Util/integer_range.hpp"
 #include "../../Util/osrm_exception.hpp"
@@ -64,7 +65,11 @@ template <class EdgeDataT> class BaseDataFacade
 
 	// virtual EdgeDataT &GetEdgeData(const EdgeID e) = 0;
 
-	virtual const EdgeDataT &GetEdgeData(const EdgeID e) const = 0;
+	// by value, a packed search graph has no EdgeDataT to refer to
+	virtual EdgeDataT GetEdgeData(const EdgeID e) const = 0;
+
+	// target, distance and direction flags, all a search needs to relax the edge
+	virtual QueryEdgeHotData GetHotData(const EdgeID e) const = 0;
 
 	virtual EdgeID BeginEdges(const NodeID n) const = 0;
 
@@ -109,6 +114,9 @@ template <class EdgeDataT> class BaseDataFacade
 
 	virtual unsigned GetCheckSum() const = 0;
 
+	// counts the reloads of the dataset, zero if it is never reloaded
+	virtual unsigned GetDataGeneration() const = 0;
+
 	virtual unsigned GetNameIndexFromEdgeID(const unsigned id) const = 0;
 
 	virtual void GetName(const unsigned name_id, std::string &result) const = 0;
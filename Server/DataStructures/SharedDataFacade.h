@@ -32,8 +32,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "BaseDataFacade.h"
 #include "SharedDataType.h"
+#include "SharedGeneration.h"
 
+#include "../../data_structures/geometry_coding.hpp"
 #include "../../data_structures/range_table.hpp"
+#include "../../data_structures/search_graph.hpp"
 #include "../../data_structures/static_graph.hpp"
 #include "../../data_structures/static_rtree.hpp"
 #include "../../Util/BoostFileSystemFix.h"
@@ -41,6 +44,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../../Util/simple_logger.hpp"
 
 #include <algorithm>
+#include <cstdint>
+#include <array>
 #include <memory>
 
 template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDataT>
@@ -49,9 +54,10 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
   private:
     typedef EdgeDataT EdgeData;
     typedef BaseDataFacade<EdgeData> super;
-    typedef StaticGraph<EdgeData, true> QueryGraph;
-    typedef typename StaticGraph<EdgeData, true>::NodeArrayEntry GraphNode;
-    typedef typename StaticGraph<EdgeData, true>::EdgeArrayEntry GraphEdge;
+    typedef SearchGraph<EdgeData, true> QueryGraph;
+    typedef typename QueryGraph::NodeArrayEntry GraphNode;
+    typedef typename QueryGraph::HotEdgeArrayEntry GraphHotEdge;
+    typedef typename QueryGraph::ColdEdgeArrayEntry GraphColdEdge;
     typedef typename RangeTable<16, true>::BlockT NameIndexBlock;
     typedef typename QueryGraph::InputEdge InputEdge;
     typedef typename super::RTreeLeaf RTreeLeaf;
@@ -59,50 +65,96 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
     using TimeStampedRTreePair = std::pair<unsigned, std::shared_ptr<SharedRTree>>;
     using RTreeNode = typename SharedRTree::TreeNode;
 
-    SharedDataLayout *data_layout;
-    char *shared_memory;
+    // the region of one segment, which starts with the layout of its blocks
+    struct Segment
+    {
+        SharedDataType region = REGION_NONE;
+        unsigned load_timestamp = 0;
+        std::unique_ptr<SharedMemory> memory;
+        SharedDataLayout *layout = nullptr;
+        char *data = nullptr;
+    };
+
     SharedDataTimestamp *data_timestamp_ptr;
+    std::array<Segment, SharedDataLayout::NUM_SEGMENTS> m_segments;
 
-    SharedDataType CURRENT_LAYOUT;
-    SharedDataType CURRENT_DATA;
     unsigned CURRENT_TIMESTAMP;
+    unsigned CURRENT_R_TREE_TIMESTAMP;
 
     unsigned m_check_sum;
     std::unique_ptr<QueryGraph> m_query_graph;
-    std::unique_ptr<SharedMemory> m_layout_memory;
-    std::unique_ptr<SharedMemory> m_large_memory;
     std::string m_timestamp;
 
     std::shared_ptr<ShM<FixedPointCoordinate, true>::vector> m_coordinate_list;
     ShM<NodeID, true>::vector m_via_node_list;
+    ShM<NodeID, true>::vector m_node_id_map;
     ShM<unsigned, true>::vector m_name_ID_list;
     ShM<TurnInstruction, true>::vector m_turn_instruction_list;
     ShM<TravelMode, true>::vector m_travel_mode_list;
     ShM<char, true>::vector m_names_char_list;
     ShM<unsigned, true>::vector m_name_begin_indices;
     ShM<bool, true>::vector m_edge_is_compressed;
-    ShM<unsigned, true>::vector m_geometry_indices;
-    ShM<unsigned, true>::vector m_geometry_list;
+    ShM<std::uint64_t, true>::vector m_geometry_indices;
+    ShM<unsigned char, true>::vector m_geometry_list;
 
     boost::thread_specific_ptr<std::pair<unsigned, std::shared_ptr<SharedRTree>>> m_static_rtree;
     boost::filesystem::path file_index_path;
 
     std::shared_ptr<RangeTable<16, true>> m_name_table;
 
+    template <typename T> T *GetBlockPtr(const SharedDataLayout::BlockID bid) const
+    {
+        const Segment &segment = m_segments[SharedDataLayout::GetSegment(bid)];
+        return segment.layout->template GetBlockPtr<T>(segment.data, bid);
+    }
+
+    uint64_t GetNumEntries(const SharedDataLayout::BlockID bid) const
+    {
+        return m_segments[SharedDataLayout::GetSegment(bid)].layout->num_entries[bid];
+    }
+
+    uint64_t GetBlockSize(const SharedDataLayout::BlockID bid) const
+    {
+        return m_segments[SharedDataLayout::GetSegment(bid)].layout->GetBlockSize(bid);
+    }
+
+    // maps the region of the segment that the pin holds, unless it is mapped already
+    bool LoadSegment(const SharedGenerationPin &pin, const SharedDataLayout::SegmentID id)
+    {
+        Segment &segment = m_segments[id];
+        if (segment.region == pin.Region(id) && segment.load_timestamp == pin.LoadTimestamp(id))
+        {
+            return false;
+        }
+
+        // release the previous shared memory segment, unless it was refilled in place
+        segment.memory.reset();
+        if (REGION_NONE != segment.region && segment.region != pin.Region(id))
+        {
+            SharedMemory::Remove(segment.region);
+        }
+
+        segment.region = pin.Region(id);
+        segment.load_timestamp = pin.LoadTimestamp(id);
+        segment.memory.reset(SharedMemoryFactory::Get(segment.region));
+        segment.layout = static_cast<SharedDataLayout *>(segment.memory->Ptr());
+        segment.data = static_cast<char *>(segment.memory->Ptr()) + sizeof(SharedDataLayout);
+        segment.layout->PrintInformation();
+        return true;
+    }
+
     void LoadChecksum()
     {
-        m_check_sum =
-            *data_layout->GetBlockPtr<unsigned>(shared_memory, SharedDataLayout::HSGR_CHECKSUM);
+        m_check_sum = *GetBlockPtr<unsigned>(SharedDataLayout::HSGR_CHECKSUM);
         SimpleLogger().Write() << "set checksum: " << m_check_sum;
     }
 
     void LoadTimestamp()
     {
-        char *timestamp_ptr =
-            data_layout->GetBlockPtr<char>(shared_memory, SharedDataLayout::TIMESTAMP);
-        m_timestamp.resize(data_layout->GetBlockSize(SharedDataLayout::TIMESTAMP));
+        char *timestamp_ptr = GetBlockPtr<char>(SharedDataLayout::TIMESTAMP);
+        m_timestamp.resize(GetBlockSize(SharedDataLayout::TIMESTAMP));
         std::copy(timestamp_ptr,
-                  timestamp_ptr + data_layout->GetBlockSize(SharedDataLayout::TIMESTAMP),
+                  timestamp_ptr + GetBlockSize(SharedDataLayout::TIMESTAMP),
                   m_timestamp.begin());
     }
 
@@ -110,84 +162,110 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
     {
         BOOST_ASSERT_MSG(!m_coordinate_list->empty(), "coordinates must be loaded before r-tree");
 
-        RTreeNode *tree_ptr =
-            data_layout->GetBlockPtr<RTreeNode>(shared_memory, SharedDataLayout::R_SEARCH_TREE);
-        m_static_rtree.reset(new TimeStampedRTreePair(CURRENT_TIMESTAMP,
+        RTreeNode *tree_ptr = GetBlockPtr<RTreeNode>(SharedDataLayout::R_SEARCH_TREE);
+        m_static_rtree.reset(new TimeStampedRTreePair(CURRENT_R_TREE_TIMESTAMP,
             osrm::make_unique<SharedRTree>(
                 tree_ptr,
-                data_layout->num_entries[SharedDataLayout::R_SEARCH_TREE],
+                GetNumEntries(SharedDataLayout::R_SEARCH_TREE),
                 file_index_path,
                 m_coordinate_list)));
     }
 
     void LoadGraph()
     {
-        GraphNode *graph_nodes_ptr =
-            data_layout->GetBlockPtr<GraphNode>(shared_memory, SharedDataLayout::GRAPH_NODE_LIST);
+        GraphNode *graph_nodes_ptr = GetBlockPtr<GraphNode>(SharedDataLayout::GRAPH_NODE_LIST);
 
-        GraphEdge *graph_edges_ptr =
-            data_layout->GetBlockPtr<GraphEdge>(shared_memory, SharedDataLayout::GRAPH_EDGE_LIST);
+        GraphHotEdge *graph_hot_edges_ptr =
+            GetBlockPtr<GraphHotEdge>(SharedDataLayout::GRAPH_EDGE_LIST);
+
+        GraphColdEdge *graph_cold_edges_ptr =
+            GetBlockPtr<GraphColdEdge>(SharedDataLayout::GRAPH_EDGE_COLD_LIST);
 
         typename ShM<GraphNode, true>::vector node_list(
-            graph_nodes_ptr, data_layout->num_entries[SharedDataLayout::GRAPH_NODE_LIST]);
-        typename ShM<GraphEdge, true>::vector edge_list(
-            graph_edges_ptr, data_layout->num_entries[SharedDataLayout::GRAPH_EDGE_LIST]);
-        m_query_graph.reset(new QueryGraph(node_list, edge_list));
+            graph_nodes_ptr, GetNumEntries(SharedDataLayout::GRAPH_NODE_LIST));
+        typename ShM<GraphHotEdge, true>::vector hot_edge_list(
+            graph_hot_edges_ptr, GetNumEntries(SharedDataLayout::GRAPH_EDGE_LIST));
+        typename ShM<GraphColdEdge, true>::vector cold_edge_list(
+            graph_cold_edges_ptr, GetNumEntries(SharedDataLayout::GRAPH_EDGE_COLD_LIST));
+        m_query_graph.reset(new QueryGraph(node_list, hot_edge_list, cold_edge_list));
+
+        NodeID *node_id_map_ptr = GetBlockPtr<NodeID>(SharedDataLayout::GRAPH_NODE_ID_MAP);
+        typename ShM<NodeID, true>::vector node_id_map(
+            node_id_map_ptr, GetNumEntries(SharedDataLayout::GRAPH_NODE_ID_MAP));
+        m_node_id_map.swap(node_id_map);
     }
 
-    void LoadNodeAndEdgeInformation()
+    void LoadCoordinates()
     {
-
-        FixedPointCoordinate *coordinate_list_ptr = data_layout->GetBlockPtr<FixedPointCoordinate>(
-            shared_memory, SharedDataLayout::COORDINATE_LIST);
+        FixedPointCoordinate *coordinate_list_ptr =
+            GetBlockPtr<FixedPointCoordinate>(SharedDataLayout::COORDINATE_LIST);
         m_coordinate_list = osrm::make_unique<ShM<FixedPointCoordinate, true>::vector>(
-            coordinate_list_ptr, data_layout->num_entries[SharedDataLayout::COORDINATE_LIST]);
+            coordinate_list_ptr, GetNumEntries(SharedDataLayout::COORDINATE_LIST));
 
-        TravelMode *travel_mode_list_ptr = data_layout->GetBlockPtr<TravelMode>(
-            shared_memory, SharedDataLayout::TRAVEL_MODE);
+        SimpleLogger().Write() << "number of geometries: " << m_coordinate_list->size();
+        for (unsigned i = 0; i < m_coordinate_list->size(); ++i)
+        {
+            if (!GetCoordinateOfNode(i).is_valid())
+            {
+                SimpleLogger().Write() << "coordinate " << i << " not valid";
+            }
+        }
+
+        const char *file_index_ptr = GetBlockPtr<char>(SharedDataLayout::FILE_INDEX_PATH);
+        file_index_path = boost::filesystem::path(file_index_ptr);
+        if (!boost::filesystem::exists(file_index_path))
+        {
+            SimpleLogger().Write(logDEBUG) << "Leaf file name " << file_index_path.string();
+            throw osrm::exception("Could not load leaf index file."
+                                "Is any data loaded into shared memory?");
+        }
+    }
+
+    void LoadEdgeInformation()
+    {
+        TravelMode *travel_mode_list_ptr = GetBlockPtr<TravelMode>(SharedDataLayout::TRAVEL_MODE);
         typename ShM<TravelMode, true>::vector travel_mode_list(
             travel_mode_list_ptr,
-            data_layout->num_entries[SharedDataLayout::TRAVEL_MODE]);
+            GetNumEntries(SharedDataLayout::TRAVEL_MODE));
         m_travel_mode_list.swap(travel_mode_list);
 
-        TurnInstruction *turn_instruction_list_ptr = data_layout->GetBlockPtr<TurnInstruction>(
-            shared_memory, SharedDataLayout::TURN_INSTRUCTION);
+        TurnInstruction *turn_instruction_list_ptr =
+            GetBlockPtr<TurnInstruction>(SharedDataLayout::TURN_INSTRUCTION);
         typename ShM<TurnInstruction, true>::vector turn_instruction_list(
             turn_instruction_list_ptr,
-            data_layout->num_entries[SharedDataLayout::TURN_INSTRUCTION]);
+            GetNumEntries(SharedDataLayout::TURN_INSTRUCTION));
         m_turn_instruction_list.swap(turn_instruction_list);
 
-        unsigned *name_id_list_ptr =
-            data_layout->GetBlockPtr<unsigned>(shared_memory, SharedDataLayout::NAME_ID_LIST);
+        unsigned *name_id_list_ptr = GetBlockPtr<unsigned>(SharedDataLayout::NAME_ID_LIST);
         typename ShM<unsigned, true>::vector name_id_list(
-            name_id_list_ptr, data_layout->num_entries[SharedDataLayout::NAME_ID_LIST]);
+            name_id_list_ptr, GetNumEntries(SharedDataLayout::NAME_ID_LIST));
         m_name_ID_list.swap(name_id_list);
-    }
 
-    void LoadViaNodeList()
-    {
-        NodeID *via_node_list_ptr =
-            data_layout->GetBlockPtr<NodeID>(shared_memory, SharedDataLayout::VIA_NODE_LIST);
+        NodeID *via_node_list_ptr = GetBlockPtr<NodeID>(SharedDataLayout::VIA_NODE_LIST);
         typename ShM<NodeID, true>::vector via_node_list(
-            via_node_list_ptr, data_layout->num_entries[SharedDataLayout::VIA_NODE_LIST]);
+            via_node_list_ptr, GetNumEntries(SharedDataLayout::VIA_NODE_LIST));
         m_via_node_list.swap(via_node_list);
+
+        unsigned *geometries_compressed_ptr =
+            GetBlockPtr<unsigned>(SharedDataLayout::GEOMETRIES_INDICATORS);
+        typename ShM<bool, true>::vector edge_is_compressed(
+            geometries_compressed_ptr,
+            GetNumEntries(SharedDataLayout::GEOMETRIES_INDICATORS));
+        m_edge_is_compressed.swap(edge_is_compressed);
     }
 
     void LoadNames()
     {
-        unsigned *offsets_ptr =
-            data_layout->GetBlockPtr<unsigned>(shared_memory, SharedDataLayout::NAME_OFFSETS);
-        NameIndexBlock *blocks_ptr =
-            data_layout->GetBlockPtr<NameIndexBlock>(shared_memory, SharedDataLayout::NAME_BLOCKS);
+        unsigned *offsets_ptr = GetBlockPtr<unsigned>(SharedDataLayout::NAME_OFFSETS);
+        NameIndexBlock *blocks_ptr = GetBlockPtr<NameIndexBlock>(SharedDataLayout::NAME_BLOCKS);
         typename ShM<unsigned, true>::vector name_offsets(
-            offsets_ptr, data_layout->num_entries[SharedDataLayout::NAME_OFFSETS]);
+            offsets_ptr, GetNumEntries(SharedDataLayout::NAME_OFFSETS));
         typename ShM<NameIndexBlock, true>::vector name_blocks(
-            blocks_ptr, data_layout->num_entries[SharedDataLayout::NAME_BLOCKS]);
+            blocks_ptr, GetNumEntries(SharedDataLayout::NAME_BLOCKS));
 
-        char *names_list_ptr =
-            data_layout->GetBlockPtr<char>(shared_memory, SharedDataLayout::NAME_CHAR_LIST);
+        char *names_list_ptr = GetBlockPtr<char>(SharedDataLayout::NAME_CHAR_LIST);
         typename ShM<char, true>::vector names_char_list(
-            names_list_ptr, data_layout->num_entries[SharedDataLayout::NAME_CHAR_LIST]);
+            names_list_ptr, GetNumEntries(SharedDataLayout::NAME_CHAR_LIST));
         m_name_table = osrm::make_unique<RangeTable<16, true>>(
             name_offsets, name_blocks, static_cast<unsigned>(names_char_list.size()));
 
@@ -196,23 +274,16 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
 
     void LoadGeometries()
     {
-        unsigned *geometries_compressed_ptr = data_layout->GetBlockPtr<unsigned>(
-            shared_memory, SharedDataLayout::GEOMETRIES_INDICATORS);
-        typename ShM<bool, true>::vector edge_is_compressed(
-            geometries_compressed_ptr,
-            data_layout->num_entries[SharedDataLayout::GEOMETRIES_INDICATORS]);
-        m_edge_is_compressed.swap(edge_is_compressed);
-
-        unsigned *geometries_index_ptr =
-            data_layout->GetBlockPtr<unsigned>(shared_memory, SharedDataLayout::GEOMETRIES_INDEX);
-        typename ShM<unsigned, true>::vector geometry_begin_indices(
-            geometries_index_ptr, data_layout->num_entries[SharedDataLayout::GEOMETRIES_INDEX]);
+        std::uint64_t *geometries_index_ptr =
+            GetBlockPtr<std::uint64_t>(SharedDataLayout::GEOMETRIES_INDEX);
+        typename ShM<std::uint64_t, true>::vector geometry_begin_indices(
+            geometries_index_ptr, GetNumEntries(SharedDataLayout::GEOMETRIES_INDEX));
         m_geometry_indices.swap(geometry_begin_indices);
 
-        unsigned *geometries_list_ptr =
-            data_layout->GetBlockPtr<unsigned>(shared_memory, SharedDataLayout::GEOMETRIES_LIST);
-        typename ShM<unsigned, true>::vector geometry_list(
-            geometries_list_ptr, data_layout->num_entries[SharedDataLayout::GEOMETRIES_LIST]);
+        unsigned char *geometries_list_ptr =
+            GetBlockPtr<unsigned char>(SharedDataLayout::GEOMETRIES_LIST);
+        typename ShM<unsigned char, true>::vector geometry_list(
+            geometries_list_ptr, GetNumEntries(SharedDataLayout::GEOMETRIES_LIST));
         m_geometry_list.swap(geometry_list);
     }
 
@@ -223,63 +294,67 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
     {
         data_timestamp_ptr = (SharedDataTimestamp *)SharedMemoryFactory::Get(
                                  CURRENT_REGIONS, sizeof(SharedDataTimestamp), false, false)->Ptr();
-        CURRENT_LAYOUT = LAYOUT_NONE;
-        CURRENT_DATA = DATA_NONE;
         CURRENT_TIMESTAMP = 0;
+        CURRENT_R_TREE_TIMESTAMP = 0;
 
         // load data
         CheckAndReloadFacade();
     }
 
+    SharedDataTimestamp *GetSharedTimestamp() const { return data_timestamp_ptr; }
+
+    bool IsLoaded(const SharedGenerationPin &pin) const
+    {
+        return CURRENT_TIMESTAMP == pin.Timestamp();
+    }
+
     void CheckAndReloadFacade()
     {
-        if (CURRENT_LAYOUT != data_timestamp_ptr->layout ||
-            CURRENT_DATA != data_timestamp_ptr->data ||
-            CURRENT_TIMESTAMP != data_timestamp_ptr->timestamp)
+        const SharedGenerationPin pin(data_timestamp_ptr);
+        if (0 == pin.Timestamp())
         {
-            // release the previous shared memory segments
-            SharedMemory::Remove(CURRENT_LAYOUT);
-            SharedMemory::Remove(CURRENT_DATA);
-
-            CURRENT_LAYOUT = data_timestamp_ptr->layout;
-            CURRENT_DATA = data_timestamp_ptr->data;
-            CURRENT_TIMESTAMP = data_timestamp_ptr->timestamp;
-
-            m_layout_memory.reset(SharedMemoryFactory::Get(CURRENT_LAYOUT));
-
-            data_layout = (SharedDataLayout *)(m_layout_memory->Ptr());
-
-            m_large_memory.reset(SharedMemoryFactory::Get(CURRENT_DATA));
-            shared_memory = (char *)(m_large_memory->Ptr());
+            throw osrm::exception("No data loaded into shared memory, run osrm-datastore.");
+        }
+        Reload(pin);
+    }
 
-            const char *file_index_ptr =
-                data_layout->GetBlockPtr<char>(shared_memory, SharedDataLayout::FILE_INDEX_PATH);
-            file_index_path = boost::filesystem::path(file_index_ptr);
-            if (!boost::filesystem::exists(file_index_path))
-            {
-                SimpleLogger().Write(logDEBUG) << "Leaf file name " << file_index_path.string();
-                throw osrm::exception("Could not load leaf index file."
-                                    "Is any data loaded into shared memory?");
-            }
+    // The caller keeps the pin for the whole reload and makes sure that no
+    // other query of this process uses the facade meanwhile. Only the segments
+    // that osrm-datastore replaced since the last reload are mapped again.
+    void Reload(const SharedGenerationPin &pin)
+    {
+        if (IsLoaded(pin))
+        {
+            return;
+        }
+        CURRENT_TIMESTAMP = pin.Timestamp();
 
+        if (LoadSegment(pin, SharedDataLayout::GRAPH_SEGMENT))
+        {
             LoadGraph();
             LoadChecksum();
-            LoadNodeAndEdgeInformation();
+        }
+        if (LoadSegment(pin, SharedDataLayout::ORIGINAL_EDGES_SEGMENT))
+        {
+            LoadEdgeInformation();
+        }
+        if (LoadSegment(pin, SharedDataLayout::GEOMETRIES_SEGMENT))
+        {
             LoadGeometries();
-            LoadTimestamp();
-            LoadViaNodeList();
+        }
+        if (LoadSegment(pin, SharedDataLayout::NAMES_SEGMENT))
+        {
             LoadNames();
-
-            data_layout->PrintInformation();
-
-            SimpleLogger().Write() << "number of geometries: " << m_coordinate_list->size();
-            for (unsigned i = 0; i < m_coordinate_list->size(); ++i)
-            {
-                if (!GetCoordinateOfNode(i).is_valid())
-                {
-                    SimpleLogger().Write() << "coordinate " << i << " not valid";
-                }
-            }
+        }
+        if (LoadSegment(pin, SharedDataLayout::R_TREE_SEGMENT))
+        {
+            LoadCoordinates();
+            // the r-trees of all threads are rebuilt on their next query
+            CURRENT_R_TREE_TIMESTAMP = CURRENT_TIMESTAMP;
+        }
+        if (LoadSegment(pin, SharedDataLayout::TIMESTAMP_SEGMENT))
+        {
+            LoadTimestamp();
         }
     }
 
@@ -292,7 +367,9 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
 
     NodeID GetTarget(const EdgeID e) const final { return m_query_graph->GetTarget(e); }
 
-    EdgeDataT &GetEdgeData(const EdgeID e) const final { return m_query_graph->GetEdgeData(e); }
+    EdgeDataT GetEdgeData(const EdgeID e) const final { return m_query_graph->GetEdgeData(e); }
+
+    QueryEdgeHotData GetHotData(const EdgeID e) const final { return m_query_graph->GetHotData(e); }
 
     EdgeID BeginEdges(const NodeID n) const final { return m_query_graph->BeginEdges(n); }
 
@@ -333,12 +410,8 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
     virtual void GetUncompressedGeometry(const unsigned id,
                                          std::vector<unsigned> &result_nodes) const final
     {
-        const unsigned begin = m_geometry_indices.at(id);
-        const unsigned end = m_geometry_indices.at(id + 1);
-
-        result_nodes.clear();
-        result_nodes.insert(
-            result_nodes.begin(), m_geometry_list.begin() + begin, m_geometry_list.begin() + end);
+        GeometryCoding::Decode(m_geometry_list, m_geometry_indices.at(id),
+                               m_geometry_indices.at(id + 1), result_nodes);
     }
 
     virtual unsigned GetGeometryIndexForEdgeID(const unsigned id) const final
@@ -360,7 +433,7 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
                                             FixedPointCoordinate &result,
                                             const unsigned zoom_level = 18) final
     {
-        if (!m_static_rtree.get() || CURRENT_TIMESTAMP != m_static_rtree->first)
+        if (!m_static_rtree.get() || CURRENT_R_TREE_TIMESTAMP != m_static_rtree->first)
         {
             LoadRTree();
         }
@@ -390,16 +463,36 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
                                             std::vector<PhantomNode> &resulting_phantom_node_vector,
                                             const unsigned number_of_results) final
     {
-        if (!m_static_rtree.get() || CURRENT_TIMESTAMP != m_static_rtree->first)
+        if (!m_static_rtree.get() || CURRENT_R_TREE_TIMESTAMP != m_static_rtree->first)
         {
             LoadRTree();
         }
 
-        return m_static_rtree->second->IncrementalFindPhantomNodeForCoordinate(
+        const bool result = m_static_rtree->second->IncrementalFindPhantomNodeForCoordinate(
             input_coordinate, resulting_phantom_node_vector, number_of_results);
+        // the r-tree holds edge-based node ids, the graph may be numbered differently
+        if (!m_node_id_map.empty())
+        {
+            for (PhantomNode &phantom_node : resulting_phantom_node_vector)
+            {
+                if (SPECIAL_NODEID != phantom_node.forward_node_id)
+                {
+                    phantom_node.forward_node_id = m_node_id_map[phantom_node.forward_node_id];
+                }
+                if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+                {
+                    phantom_node.reverse_node_id = m_node_id_map[phantom_node.reverse_node_id];
+                }
+            }
+        }
+        return result;
     }
 
-    unsigned GetCheckSum() const final { return m_check_sum; }
+    // includes the reload, so hints do not outlive an update that only
+    // swapped the names or geometries
+    unsigned GetCheckSum() const final { return m_check_sum ^ CURRENT_TIMESTAMP; }
+
+    unsigned GetDataGeneration() const final { return CURRENT_TIMESTAMP; }
 
     unsigned GetNameIndexFromEdgeID(const unsigned id) const final
     {
@@ -34,6 +34,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <cstdint>
 
 #include <array>
+#include <atomic>
 
 // Added at the start and end of each block as sanity check
 static const char CANARY[] = "OSRM";
@@ -48,6 +49,8 @@ struct SharedDataLayout
         VIA_NODE_LIST,
         GRAPH_NODE_LIST,
         GRAPH_EDGE_LIST,
+        GRAPH_EDGE_COLD_LIST,
+        GRAPH_NODE_ID_MAP,
         COORDINATE_LIST,
         TURN_INSTRUCTION,
         TRAVEL_MODE,
@@ -61,6 +64,19 @@ struct SharedDataLayout
         NUM_BLOCKS
     };
 
+    // The blocks that are loaded from the same input files share a segment.
+    // osrm-datastore swaps segments one by one, so a reload only copies the
+    // files that changed.
+    enum SegmentID {
+        GRAPH_SEGMENT = 0,
+        ORIGINAL_EDGES_SEGMENT,
+        GEOMETRIES_SEGMENT,
+        NAMES_SEGMENT,
+        R_TREE_SEGMENT,
+        TIMESTAMP_SEGMENT,
+        NUM_SEGMENTS
+    };
+
     std::array<uint64_t, NUM_BLOCKS> num_entries;
     std::array<uint64_t, NUM_BLOCKS> entry_size;
 
@@ -80,6 +96,8 @@ struct SharedDataLayout
         SimpleLogger().Write(logDEBUG) << "via_node_list_size:         " << num_entries[VIA_NODE_LIST];
         SimpleLogger().Write(logDEBUG) << "graph_node_list_size:       " << num_entries[GRAPH_NODE_LIST];
         SimpleLogger().Write(logDEBUG) << "graph_edge_list_size:       " << num_entries[GRAPH_EDGE_LIST];
+        SimpleLogger().Write(logDEBUG) << "graph_edge_cold_list_size:  " << num_entries[GRAPH_EDGE_COLD_LIST];
+        SimpleLogger().Write(logDEBUG) << "graph_node_id_map_size:     " << num_entries[GRAPH_NODE_ID_MAP];
         SimpleLogger().Write(logDEBUG) << "timestamp_length:           " << num_entries[TIMESTAMP];
         SimpleLogger().Write(logDEBUG) << "coordinate_list_size:       " << num_entries[COORDINATE_LIST];
         SimpleLogger().Write(logDEBUG) << "turn_instruction_list_size: " << num_entries[TURN_INSTRUCTION];
@@ -98,6 +116,8 @@ struct SharedDataLayout
         SimpleLogger().Write(logDEBUG) << "VIA_NODE_LIST        " << ": " << GetBlockSize(VIA_NODE_LIST        );
         SimpleLogger().Write(logDEBUG) << "GRAPH_NODE_LIST      " << ": " << GetBlockSize(GRAPH_NODE_LIST      );
         SimpleLogger().Write(logDEBUG) << "GRAPH_EDGE_LIST      " << ": " << GetBlockSize(GRAPH_EDGE_LIST      );
+        SimpleLogger().Write(logDEBUG) << "GRAPH_EDGE_COLD_LIST " << ": " << GetBlockSize(GRAPH_EDGE_COLD_LIST );
+        SimpleLogger().Write(logDEBUG) << "GRAPH_NODE_ID_MAP    " << ": " << GetBlockSize(GRAPH_NODE_ID_MAP    );
         SimpleLogger().Write(logDEBUG) << "COORDINATE_LIST      " << ": " << GetBlockSize(COORDINATE_LIST      );
         SimpleLogger().Write(logDEBUG) << "TURN_INSTRUCTION     " << ": " << GetBlockSize(TURN_INSTRUCTION     );
         SimpleLogger().Write(logDEBUG) << "TRAVEL_MODE          " << ": " << GetBlockSize(TRAVEL_MODE          );
@@ -128,6 +148,38 @@ struct SharedDataLayout
         return num_entries[bid] * entry_size[bid];
     }
 
+    static SegmentID GetSegment(BlockID bid)
+    {
+        switch (bid)
+        {
+        case GRAPH_NODE_LIST:
+        case GRAPH_EDGE_LIST:
+        case GRAPH_EDGE_COLD_LIST:
+        case GRAPH_NODE_ID_MAP:
+        case HSGR_CHECKSUM:
+            return GRAPH_SEGMENT;
+        case VIA_NODE_LIST:
+        case NAME_ID_LIST:
+        case TRAVEL_MODE:
+        case TURN_INSTRUCTION:
+        case GEOMETRIES_INDICATORS:
+            return ORIGINAL_EDGES_SEGMENT;
+        case GEOMETRIES_INDEX:
+        case GEOMETRIES_LIST:
+            return GEOMETRIES_SEGMENT;
+        case NAME_OFFSETS:
+        case NAME_BLOCKS:
+        case NAME_CHAR_LIST:
+            return NAMES_SEGMENT;
+        case COORDINATE_LIST:
+        case R_SEARCH_TREE:
+        case FILE_INDEX_PATH:
+            return R_TREE_SEGMENT;
+        default: // TIMESTAMP
+            return TIMESTAMP_SEGMENT;
+        }
+    }
+
     inline uint64_t GetSizeOfLayout() const
     {
         return GetBlockOffset(NUM_BLOCKS) + NUM_BLOCKS*2*sizeof(CANARY);
@@ -174,20 +226,61 @@ struct SharedDataLayout
     }
 };
 
+// Every segment is double buffered in the regions <segment>_1 and <segment>_2,
+// which start with the SharedDataLayout of their blocks.
 enum SharedDataType
 { CURRENT_REGIONS,
-  LAYOUT_1,
-  DATA_1,
-  LAYOUT_2,
-  DATA_2,
-  LAYOUT_NONE,
-  DATA_NONE };
+  GRAPH_1,
+  GRAPH_2,
+  ORIGINAL_EDGES_1,
+  ORIGINAL_EDGES_2,
+  GEOMETRIES_1,
+  GEOMETRIES_2,
+  NAMES_1,
+  NAMES_2,
+  R_TREE_1,
+  R_TREE_2,
+  TIMESTAMP_1,
+  TIMESTAMP_2,
+  REGION_NONE };
+
+static_assert(2 == ATOMIC_INT_LOCK_FREE, "shared memory needs address-free atomics");
 
+// Lives in the CURRENT_REGIONS segment. osrm-datastore fills the regions of the
+// segments that changed and then publishes them together with the unchanged
+// ones as one word in generation, which queries read without taking any lock.
+// Bit i of the generation selects the region of segment i, the remaining bits
+// count the reloads. readers counts the queries of all processes per region,
+// checksums identifies the input files that were loaded into it and
+// load_timestamps the reload that filled it last. The region index alone comes
+// back to the same value after two reloads of a segment.
 struct SharedDataTimestamp
 {
-    SharedDataType layout;
-    SharedDataType data;
-    unsigned timestamp;
+    std::atomic<unsigned> generation;
+    unsigned checksums[SharedDataLayout::NUM_SEGMENTS][2];
+    unsigned load_timestamps[SharedDataLayout::NUM_SEGMENTS][2];
+    std::atomic<int> readers[SharedDataLayout::NUM_SEGMENTS][2];
+
+    static unsigned PackGeneration(const unsigned timestamp, const unsigned region_mask)
+    {
+        return (timestamp << SharedDataLayout::NUM_SEGMENTS) | region_mask;
+    }
+
+    static unsigned Timestamp(const unsigned generation)
+    {
+        return generation >> SharedDataLayout::NUM_SEGMENTS;
+    }
+
+    static unsigned RegionIndex(const unsigned generation,
+                                const SharedDataLayout::SegmentID segment)
+    {
+        return (generation >> segment) & 1;
+    }
+
+    static SharedDataType Region(const SharedDataLayout::SegmentID segment, const unsigned index)
+    {
+        return static_cast<SharedDataType>(GRAPH_1 + 2 * segment + index);
+    }
 };
 
 #endif /* SHARED_DATA_TYPE_H_ */
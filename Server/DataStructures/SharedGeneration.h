@@ -0,0 +1,148 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef SHARED_GENERATION_H
+#define SHARED_GENERATION_H
+
+#include "SharedDataType.h"
+
+#include <boost/assert.hpp>
+
+#include <chrono>
+#include <thread>
+
+// Keeps the dataset generation that was published when it was created from
+// being freed by osrm-datastore. Pinning costs one atomic increment per segment
+// on the shared reader counters and no cross-process lock.
+class SharedGenerationPin
+{
+  public:
+    explicit SharedGenerationPin(SharedDataTimestamp *shared) : shared(shared)
+    {
+        BOOST_ASSERT(nullptr != shared);
+        for (;;)
+        {
+            generation = shared->generation.load();
+            AddReaders(1);
+            // the writer publishes before it counts readers, so either it sees
+            // this pin or the re-read below sees its new generation
+            if (generation == shared->generation.load())
+            {
+                break;
+            }
+            AddReaders(-1);
+        }
+    }
+
+    SharedGenerationPin(const SharedGenerationPin &) = delete;
+
+    ~SharedGenerationPin() { AddReaders(-1); }
+
+    unsigned Timestamp() const { return SharedDataTimestamp::Timestamp(generation); }
+
+    SharedDataType Region(const SharedDataLayout::SegmentID segment) const
+    {
+        return SharedDataTimestamp::Region(segment,
+                                           SharedDataTimestamp::RegionIndex(generation, segment));
+    }
+
+    // the reload that filled the region of the segment
+    unsigned LoadTimestamp(const SharedDataLayout::SegmentID segment) const
+    {
+        return shared->load_timestamps[segment]
+                                      [SharedDataTimestamp::RegionIndex(generation, segment)];
+    }
+
+  private:
+    void AddReaders(const int count)
+    {
+        for (int segment = 0; segment < SharedDataLayout::NUM_SEGMENTS; ++segment)
+        {
+            const auto index = SharedDataTimestamp::RegionIndex(
+                generation, static_cast<SharedDataLayout::SegmentID>(segment));
+            shared->readers[segment][index].fetch_add(count);
+        }
+    }
+
+    SharedDataTimestamp *shared;
+    unsigned generation;
+};
+
+namespace SharedGeneration
+{
+// records the input files and the reload of a region that was just filled
+inline void RecordLoad(SharedDataTimestamp *shared,
+                       const SharedDataLayout::SegmentID segment,
+                       const unsigned index,
+                       const unsigned timestamp,
+                       const unsigned checksum)
+{
+    shared->checksums[segment][index] = checksum;
+    shared->load_timestamps[segment][index] = timestamp;
+}
+
+// makes the loaded regions visible to all new queries
+inline void Publish(SharedDataTimestamp *shared,
+                    const unsigned timestamp,
+                    const unsigned region_mask)
+{
+    shared->generation.store(SharedDataTimestamp::PackGeneration(timestamp, region_mask));
+}
+
+// Waits until no query runs on the given region of a segment anymore. A
+// process that died while it held a pin never releases it, hence the time limit.
+inline bool WaitForReaders(SharedDataTimestamp *shared,
+                           const SharedDataLayout::SegmentID segment,
+                           const unsigned index,
+                           const std::chrono::milliseconds limit)
+{
+    const auto deadline = std::chrono::steady_clock::now() + limit;
+    std::atomic<int> &readers = shared->readers[segment][index];
+    while (0 < readers.load())
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// for osrm-unlock-all, after a crashed process left its pins behind
+inline void ResetReaders(SharedDataTimestamp *shared)
+{
+    for (auto &segment_readers : shared->readers)
+    {
+        segment_readers[0].store(0);
+        segment_readers[1].store(0);
+    }
+}
+}
+
+#endif // SHARED_GENERATION_H
@@ -102,6 +102,14 @@ std::string Reply::ToString(Reply::status_type status)
     {
         return badRequestHTML;
     }
+    if (Reply::requestTimeout == status)
+    {
+        return requestTimeoutHTML;
+    }
+    if (Reply::serviceUnavailable == status)
+    {
+        return serviceUnavailableHTML;
+    }
     return internalServerErrorHTML;
 }
 
@@ -115,6 +123,14 @@ boost::asio::const_buffer Reply::ToBuffer(Reply::status_type status)
     {
         return boost::asio::buffer(internalServerErrorString);
     }
+    if (Reply::requestTimeout == status)
+    {
+        return boost::asio::buffer(requestTimeoutString);
+    }
+    if (Reply::serviceUnavailable == status)
+    {
+        return boost::asio::buffer(serviceUnavailableString);
+    }
     return boost::asio::buffer(badRequestString);
 }
 
@@ -0,0 +1,172 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "ZlibCompressor.h"
+
+#include "../../Util/osrm_exception.hpp"
+
+#include <boost/assert.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <cstring>
+
+#include <utility>
+
+namespace http
+{
+
+namespace
+{
+boost::thread_specific_ptr<ZlibCompressor> cached_compressor;
+
+// size of the output window handed to zlib in one go
+constexpr std::size_t OutputBlockSize = 16 * 1024;
+// replies up to this size are compressed with the default level
+constexpr std::size_t SmallReplySize = 64 * 1024;
+}
+
+constexpr std::size_t ZlibCompressor::MinimumCompressibleSize;
+constexpr std::size_t ZlibCompressor::ChunkSize;
+
+ZlibCompressor::ZlibCompressor()
+    : gzip_initialized(false), deflate_initialized(false), gzip_level(Z_DEFAULT_COMPRESSION),
+      deflate_level(Z_DEFAULT_COMPRESSION), current_stream(nullptr)
+{
+    std::memset(&gzip_stream, 0, sizeof(z_stream));
+    std::memset(&deflate_stream, 0, sizeof(z_stream));
+}
+
+ZlibCompressor::~ZlibCompressor()
+{
+    if (gzip_initialized)
+    {
+        deflateEnd(&gzip_stream);
+    }
+    if (deflate_initialized)
+    {
+        deflateEnd(&deflate_stream);
+    }
+}
+
+std::unique_ptr<ZlibCompressor> ZlibCompressor::Acquire()
+{
+    std::unique_ptr<ZlibCompressor> compressor(cached_compressor.release());
+    if (!compressor)
+    {
+        compressor.reset(new ZlibCompressor());
+    }
+    return compressor;
+}
+
+void ZlibCompressor::Release(std::unique_ptr<ZlibCompressor> compressor)
+{
+    // a write may complete on a different thread than the one that started it.
+    // keep at most one compressor per thread and drop any surplus.
+    if (nullptr == cached_compressor.get())
+    {
+        cached_compressor.reset(compressor.release());
+    }
+}
+
+int ZlibCompressor::LevelForSize(const std::size_t size)
+{
+    if (size <= SmallReplySize)
+    {
+        return Z_DEFAULT_COMPRESSION;
+    }
+    return Z_BEST_SPEED;
+}
+
+z_stream &ZlibCompressor::StreamFor(const CompressionType compression_type)
+{
+    BOOST_ASSERT(noCompression != compression_type);
+    return (gzipRFC1952 == compression_type ? gzip_stream : deflate_stream);
+}
+
+void ZlibCompressor::Reset(const CompressionType compression_type, const int level)
+{
+    const bool is_gzip = (gzipRFC1952 == compression_type);
+    bool &initialized = (is_gzip ? gzip_initialized : deflate_initialized);
+    int &current_level = (is_gzip ? gzip_level : deflate_level);
+    z_stream &stream = StreamFor(compression_type);
+
+    if (!initialized)
+    {
+        // 15 window bits, +16 adds the gzip wrapper, negative yields raw deflate
+        const int window_bits = (is_gzip ? 15 + 16 : -15);
+        if (Z_OK != deflateInit2(&stream, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY))
+        {
+            throw osrm::exception("could not initialize zlib stream");
+        }
+        initialized = true;
+        current_level = level;
+    }
+    else
+    {
+        deflateReset(&stream);
+        if (current_level != level)
+        {
+            // no data has been fed since the reset, so this never needs to flush
+            deflateParams(&stream, level, Z_DEFAULT_STRATEGY);
+            current_level = level;
+        }
+    }
+    current_stream = &stream;
+}
+
+bool ZlibCompressor::Compress(const char *data,
+                              const std::size_t length,
+                              const bool finish,
+                              std::vector<char> &output)
+{
+    BOOST_ASSERT_MSG(nullptr != current_stream, "compressor has not been reset");
+    z_stream &stream = *current_stream;
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = static_cast<uInt>(length);
+
+    const int flush = (finish ? Z_FINISH : Z_NO_FLUSH);
+    int status = Z_OK;
+    do
+    {
+        const std::size_t old_size = output.size();
+        output.resize(old_size + OutputBlockSize);
+        stream.next_out = reinterpret_cast<Bytef *>(&output[old_size]);
+        stream.avail_out = static_cast<uInt>(OutputBlockSize);
+        status = deflate(&stream, flush);
+        if (Z_STREAM_ERROR == status)
+        {
+            throw osrm::exception("zlib stream is in an inconsistent state");
+        }
+        output.resize(old_size + OutputBlockSize - stream.avail_out);
+        // a full output window means zlib has more to say
+    } while (0 == stream.avail_out);
+
+    BOOST_ASSERT(0 == stream.avail_in);
+    return (Z_STREAM_END == status);
+}
+
+} // namespace http
@@ -0,0 +1,87 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ZLIB_COMPRESSOR_H
+#define ZLIB_COMPRESSOR_H
+
+#include "CompressionType.h"
+
+#include <zlib.h>
+
+#include <cstddef>
+
+#include <memory>
+#include <vector>
+
+namespace http
+{
+
+// Wraps a zlib deflate stream that is reset between replies instead of being
+// re-allocated for every single one. Instances are cached per thread.
+class ZlibCompressor
+{
+  public:
+    // replies below this size are sent as they are
+    static constexpr std::size_t MinimumCompressibleSize = 1024;
+    // amount of uncompressed input that is consumed per write to the socket
+    static constexpr std::size_t ChunkSize = 64 * 1024;
+
+    ZlibCompressor();
+    ~ZlibCompressor();
+    ZlibCompressor(const ZlibCompressor &) = delete;
+    ZlibCompressor &operator=(const ZlibCompressor &) = delete;
+
+    // take the compressor of the calling thread, or a fresh one if there is none
+    static std::unique_ptr<ZlibCompressor> Acquire();
+    // hand a compressor back to the cache of the calling thread
+    static void Release(std::unique_ptr<ZlibCompressor> compressor);
+
+    // small replies are cheap to squeeze hard, large ones favor speed
+    static int LevelForSize(const std::size_t size);
+
+    void Reset(const CompressionType compression_type, const int level);
+
+    // appends the compressed form of [data, data+length) to output. Returns true
+    // once the stream has been finished.
+    bool Compress(const char *data, const std::size_t length, const bool finish, std::vector<char> &output);
+
+  private:
+    z_stream &StreamFor(const CompressionType compression_type);
+
+    // gzip and raw deflate use different window bits and hence different streams
+    z_stream gzip_stream;
+    z_stream deflate_stream;
+    bool gzip_initialized;
+    bool deflate_initialized;
+    int gzip_level;
+    int deflate_level;
+    z_stream *current_stream;
+};
+
+} // namespace http
+
+#endif // ZLIB_COMPRESSOR_H
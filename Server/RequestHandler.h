@@ -28,10 +28,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef REQUEST_HANDLER_H
 #define REQUEST_HANDLER_H
 
+#include <memory>
 #include <string>
 
 template <typename Iterator, class HandlerT> struct APIGrammar;
 struct RouteParameters;
+class QueryScheduler;
+template <typename ResultT> class RequestCoalescer;
 class OSRM;
 
 namespace http
@@ -48,12 +51,20 @@ class RequestHandler
 
     RequestHandler();
     RequestHandler(const RequestHandler &) = delete;
+	~RequestHandler();
 
     void handle_request(const http::Request &req, http::Reply &rep);
 	void RegisterRoutingMachine(OSRM *osrm);
+	// caps the time budget of every query, 0 means unlimited
+	void SetMaxQueryTime(const unsigned milliseconds);
+	// bounds the queries running and waiting per class, scaled to the server threads
+	void EnableAdmissionControl(const unsigned thread_count);
 
   private:
 	OSRM *routing_machine;
+	unsigned max_query_time;
+	std::unique_ptr<QueryScheduler> scheduler;
+	std::unique_ptr<RequestCoalescer<http::Reply>> coalescer;
 };
 
 #endif // REQUEST_HANDLER_H
@@ -175,4 +175,29 @@ BOOST_FIXTURE_TEST_CASE_TEMPLATE(decrease_key_test, T, storage_types, RandomData
     }
 }
 
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(prefetch_test, T, storage_types, RandomDataFixture<NUM_NODES>)
+{
+    BinaryHeap<TestNodeID, TestKey, TestWeight, TestData, T> heap(NUM_NODES);
+
+    for (unsigned idx : order)
+    {
+        if (idx % 2 == 0)
+        {
+            heap.Insert(ids[idx], weights[idx], data[idx]);
+        }
+    }
+
+    // prefetching is only a hint, it must not add the nodes it is asked about
+    for (auto id : ids)
+    {
+        heap.PrefetchIndex(id);
+        heap.PrefetchData(id);
+    }
+    BOOST_CHECK_EQUAL(heap.Size(), NUM_NODES / 2);
+    for (auto id : ids)
+    {
+        BOOST_CHECK_EQUAL(heap.WasInserted(id), id % 2 == 0);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,105 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../data_structures/geometry_coding.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <limits>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(geometry_coding)
+
+namespace
+{
+std::vector<unsigned char> encode(const std::vector<NodeID> &node_ids)
+{
+    std::vector<unsigned char> bytes;
+    NodeID previous_node_id = 0;
+    for (const NodeID node_id : node_ids)
+    {
+        GeometryCoding::Encode(node_id, previous_node_id, bytes);
+    }
+    return bytes;
+}
+}
+
+BOOST_AUTO_TEST_CASE(round_trip)
+{
+    const std::vector<NodeID> node_ids = {17, 18, 20, 4, 5, 300000, 299999, 0};
+    const auto bytes = encode(node_ids);
+
+    std::vector<NodeID> decoded;
+    GeometryCoding::Decode(bytes, 0, bytes.size(), decoded);
+    BOOST_CHECK_EQUAL_COLLECTIONS(decoded.begin(), decoded.end(), node_ids.begin(),
+                                  node_ids.end());
+}
+
+BOOST_AUTO_TEST_CASE(close_ids_take_one_byte)
+{
+    const std::vector<NodeID> node_ids = {10, 11, 12, 13, 12, 11};
+    BOOST_CHECK_EQUAL(encode(node_ids).size(), node_ids.size());
+}
+
+BOOST_AUTO_TEST_CASE(extreme_ids)
+{
+    const std::vector<NodeID> node_ids = {std::numeric_limits<NodeID>::max() - 1, 0,
+                                          std::numeric_limits<NodeID>::max() - 1, 1};
+    const auto bytes = encode(node_ids);
+
+    std::vector<NodeID> decoded;
+    GeometryCoding::Decode(bytes, 0, bytes.size(), decoded);
+    BOOST_CHECK_EQUAL_COLLECTIONS(decoded.begin(), decoded.end(), node_ids.begin(),
+                                  node_ids.end());
+}
+
+BOOST_AUTO_TEST_CASE(geometries_are_addressed_by_byte_offset)
+{
+    std::vector<unsigned char> bytes;
+    std::vector<std::uint64_t> offsets = {0};
+    const std::vector<std::vector<NodeID>> geometries = {{5, 6, 7}, {}, {900, 2}};
+    for (const auto &geometry : geometries)
+    {
+        NodeID previous_node_id = 0;
+        for (const NodeID node_id : geometry)
+        {
+            GeometryCoding::Encode(node_id, previous_node_id, bytes);
+        }
+        offsets.push_back(bytes.size());
+    }
+
+    std::vector<NodeID> decoded;
+    for (std::size_t i = 0; i < geometries.size(); ++i)
+    {
+        GeometryCoding::Decode(bytes, offsets[i], offsets[i + 1], decoded);
+        BOOST_CHECK_EQUAL_COLLECTIONS(decoded.begin(), decoded.end(), geometries[i].begin(),
+                                      geometries[i].end());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
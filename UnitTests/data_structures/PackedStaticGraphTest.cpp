@@ -0,0 +1,182 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../data_structures/packed_static_graph.hpp"
+#include "../../data_structures/query_edge.hpp"
+#include "../../data_structures/static_graph.hpp"
+#include "../../typedefs.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <random>
+
+BOOST_AUTO_TEST_SUITE(packed_static_graph)
+
+typedef QueryEdge::EdgeData TestData;
+typedef StaticGraph<TestData> TestStaticGraph;
+typedef PackedStaticGraph<TestData> TestPackedStaticGraph;
+
+constexpr unsigned TEST_NUM_NODES = 1000;
+constexpr unsigned TEST_NUM_EDGES = 5000;
+// Choosen by a fair W20 dice roll (this value is completely arbitrary)
+constexpr unsigned RANDOM_SEED = 15;
+
+TestData MakeData(NodeID id, bool shortcut, int distance, bool forward, bool backward)
+{
+    TestData data;
+    data.id = id;
+    data.shortcut = shortcut;
+    data.distance = distance;
+    data.forward = forward;
+    data.backward = backward;
+    return data;
+}
+
+void CheckSameGraph(const TestStaticGraph &graph, const TestPackedStaticGraph &packed_graph)
+{
+    BOOST_CHECK_EQUAL(packed_graph.GetNumberOfNodes(), graph.GetNumberOfNodes());
+    BOOST_CHECK_EQUAL(packed_graph.GetNumberOfEdges(), graph.GetNumberOfEdges());
+    for (const auto node : osrm::irange(0u, graph.GetNumberOfNodes()))
+    {
+        BOOST_CHECK_EQUAL(packed_graph.BeginEdges(node), graph.BeginEdges(node));
+        BOOST_CHECK_EQUAL(packed_graph.EndEdges(node), graph.EndEdges(node));
+        for (const auto edge : graph.GetAdjacentEdgeRange(node))
+        {
+            BOOST_CHECK_EQUAL(packed_graph.GetTarget(edge), graph.GetTarget(edge));
+            const TestData data = packed_graph.GetEdgeData(edge);
+            const TestData &expected = graph.GetEdgeData(edge);
+            BOOST_CHECK_EQUAL(data.id, expected.id);
+            BOOST_CHECK_EQUAL(data.shortcut, expected.shortcut);
+            BOOST_CHECK_EQUAL(data.distance, expected.distance);
+            BOOST_CHECK_EQUAL(data.forward, expected.forward);
+            BOOST_CHECK_EQUAL(data.backward, expected.backward);
+            const QueryEdgeHotData hot_data = packed_graph.GetHotData(edge);
+            BOOST_CHECK_EQUAL(hot_data.target, graph.GetTarget(edge));
+            BOOST_CHECK_EQUAL(hot_data.distance, expected.distance);
+            BOOST_CHECK_EQUAL(hot_data.forward, expected.forward);
+            BOOST_CHECK_EQUAL(hot_data.backward, expected.backward);
+        }
+    }
+}
+
+// packs a copy of the arrays, so they can still build the plain graph
+TestPackedStaticGraph PackGraph(const std::vector<TestStaticGraph::NodeArrayEntry> &nodes,
+                                const std::vector<TestStaticGraph::EdgeArrayEntry> &edges)
+{
+    std::vector<TestPackedStaticGraph::NodeArrayEntry> packed_nodes;
+    for (const auto &node : nodes)
+    {
+        packed_nodes.emplace_back(TestPackedStaticGraph::NodeArrayEntry{node.first_edge});
+    }
+    std::vector<TestStaticGraph::EdgeArrayEntry> edges_copy(edges);
+    return TestPackedStaticGraph(packed_nodes, edges_copy);
+}
+
+BOOST_AUTO_TEST_CASE(random_graph_test)
+{
+    std::mt19937 g(RANDOM_SEED);
+    std::uniform_int_distribution<> node_udist(0, TEST_NUM_NODES - 1);
+    std::uniform_int_distribution<> edge_udist(0, TEST_NUM_EDGES - 1);
+    std::uniform_int_distribution<> distance_udist(1, (1 << 29) - 1);
+    std::uniform_int_distribution<> id_udist(0, (1u << 31) - 1);
+    std::bernoulli_distribution flag_dist(0.5);
+
+    std::vector<unsigned> offsets;
+    for (unsigned i = 0; i < TEST_NUM_NODES; ++i)
+    {
+        offsets.push_back(edge_udist(g));
+    }
+    std::sort(offsets.begin(), offsets.end());
+    offsets.front() = 0;
+    offsets.push_back(TEST_NUM_EDGES);
+
+    std::vector<TestStaticGraph::NodeArrayEntry> nodes;
+    for (const auto offset : offsets)
+    {
+        nodes.emplace_back(TestStaticGraph::NodeArrayEntry{offset});
+    }
+    std::vector<TestStaticGraph::EdgeArrayEntry> edges;
+    for (unsigned i = 0; i < TEST_NUM_EDGES; ++i)
+    {
+        edges.emplace_back(TestStaticGraph::EdgeArrayEntry{
+            static_cast<NodeID>(node_udist(g)),
+            MakeData(static_cast<NodeID>(id_udist(g)), flag_dist(g), distance_udist(g),
+                     flag_dist(g), flag_dist(g))});
+    }
+
+    const TestPackedStaticGraph packed_graph = PackGraph(nodes, edges);
+    const TestStaticGraph graph(nodes, edges);
+    CheckSameGraph(graph, packed_graph);
+}
+
+BOOST_AUTO_TEST_CASE(small_values_test)
+{
+    // neighbouring targets and small weights take only a few bits per edge
+    std::vector<TestStaticGraph::NodeArrayEntry> nodes;
+    std::vector<TestStaticGraph::EdgeArrayEntry> edges;
+    for (unsigned node = 0; node < TEST_NUM_NODES; ++node)
+    {
+        nodes.emplace_back(TestStaticGraph::NodeArrayEntry{static_cast<unsigned>(edges.size())});
+        for (const NodeID target : {node + 1, node + 2})
+        {
+            if (target < TEST_NUM_NODES)
+            {
+                edges.emplace_back(TestStaticGraph::EdgeArrayEntry{
+                    target, MakeData(node % 7, 0 == node % 2, 1 + node % 100, true, false)});
+            }
+        }
+    }
+    nodes.emplace_back(TestStaticGraph::NodeArrayEntry{static_cast<unsigned>(edges.size())});
+
+    const TestPackedStaticGraph packed_graph = PackGraph(nodes, edges);
+    BOOST_CHECK_LT(packed_graph.GetMemoryUsage(),
+                   nodes.size() * sizeof(TestStaticGraph::NodeArrayEntry) +
+                       edges.size() * sizeof(TestStaticGraph::EdgeArrayEntry) / 2);
+    const TestStaticGraph graph(nodes, edges);
+    CheckSameGraph(graph, packed_graph);
+
+    BOOST_CHECK_EQUAL(packed_graph.FindEdge(3, 5), graph.FindEdge(3, 5));
+    BOOST_CHECK_EQUAL(packed_graph.FindEdge(5, 3), SPECIAL_EDGEID);
+    bool reverse = false;
+    BOOST_CHECK_EQUAL(packed_graph.FindEdgeIndicateIfReverse(5, 4, reverse), graph.FindEdge(4, 5));
+    BOOST_CHECK(reverse);
+}
+
+BOOST_AUTO_TEST_CASE(empty_graph_test)
+{
+    std::vector<TestStaticGraph::NodeArrayEntry> nodes(3, TestStaticGraph::NodeArrayEntry{0});
+    std::vector<TestStaticGraph::EdgeArrayEntry> edges;
+
+    const TestPackedStaticGraph packed_graph = PackGraph(nodes, edges);
+    BOOST_CHECK_EQUAL(packed_graph.GetNumberOfNodes(), 2);
+    BOOST_CHECK_EQUAL(packed_graph.GetNumberOfEdges(), 0);
+    BOOST_CHECK_EQUAL(packed_graph.GetOutDegree(1), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
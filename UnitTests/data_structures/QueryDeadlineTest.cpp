@@ -0,0 +1,75 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../data_structures/query_deadline.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(query_deadline)
+
+BOOST_AUTO_TEST_CASE(unlimited_test)
+{
+    QueryDeadline deadline;
+    for (unsigned i = 0; i < 4 * QueryDeadline::CheckInterval; ++i)
+    {
+        BOOST_CHECK(!deadline.Expired());
+    }
+    BOOST_CHECK(!deadline.ExpiredNow());
+    BOOST_CHECK(!deadline.HasExpired());
+
+    QueryDeadline zero_budget(std::chrono::milliseconds(0));
+    BOOST_CHECK(!zero_budget.ExpiredNow());
+}
+
+BOOST_AUTO_TEST_CASE(expiry_test)
+{
+    QueryDeadline deadline(std::chrono::milliseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    // the clock is only consulted once per check interval
+    for (unsigned i = 1; i < QueryDeadline::CheckInterval; ++i)
+    {
+        BOOST_CHECK(!deadline.Expired());
+    }
+    BOOST_CHECK(deadline.Expired());
+    BOOST_CHECK(deadline.HasExpired());
+    // and stays expired
+    BOOST_CHECK(deadline.Expired());
+}
+
+BOOST_AUTO_TEST_CASE(expired_now_test)
+{
+    QueryDeadline deadline(std::chrono::milliseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    BOOST_CHECK(deadline.ExpiredNow());
+    BOOST_CHECK(deadline.HasExpired());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,190 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../data_structures/query_scheduler.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(query_scheduler)
+
+BOOST_AUTO_TEST_CASE(classify_test)
+{
+    BOOST_CHECK(QueryClass::Bulk == QueryScheduler::Classify("table", 2));
+    BOOST_CHECK(QueryClass::Interactive == QueryScheduler::Classify("viaroute", 2));
+    BOOST_CHECK(QueryClass::Interactive == QueryScheduler::Classify("nearest", 1));
+    BOOST_CHECK(QueryClass::Bulk ==
+                QueryScheduler::Classify("viaroute", QueryScheduler::BulkCoordinateThreshold + 1));
+}
+
+BOOST_AUTO_TEST_CASE(reject_when_full_test)
+{
+    QueryScheduler scheduler(1, {1, 0, 1}, {1, 0, 1});
+    {
+        const QueryScheduler::Slot first(&scheduler, QueryClass::Interactive);
+        BOOST_CHECK(first.Admitted());
+        const QueryScheduler::Slot second(&scheduler, QueryClass::Bulk);
+        BOOST_CHECK(!second.Admitted());
+        BOOST_CHECK_EQUAL(scheduler.Rejected(QueryClass::Bulk), 1u);
+    }
+    // the slot has been given back
+    const QueryScheduler::Slot third(&scheduler, QueryClass::Bulk);
+    BOOST_CHECK(third.Admitted());
+
+    const QueryScheduler::Slot unscheduled(nullptr, QueryClass::Bulk);
+    BOOST_CHECK(unscheduled.Admitted());
+}
+
+BOOST_AUTO_TEST_CASE(follower_test)
+{
+    QueryScheduler scheduler(1, {1, 2, 1}, {1, 2, 1});
+    const QueryScheduler::Follower first(&scheduler);
+    BOOST_CHECK(first.Admitted());
+    {
+        // followers and queued queries share the interactive waiting places
+        const QueryScheduler::Follower second(&scheduler);
+        BOOST_CHECK(second.Admitted());
+        const QueryScheduler::Follower third(&scheduler);
+        BOOST_CHECK(!third.Admitted());
+        BOOST_CHECK_EQUAL(scheduler.Rejected(QueryClass::Interactive), 1u);
+    }
+
+    std::thread waiter;
+    {
+        const QueryScheduler::Slot running(&scheduler, QueryClass::Interactive);
+        BOOST_CHECK(running.Admitted());
+        waiter = std::thread([&scheduler]
+                             {
+                                 const QueryScheduler::Slot slot(&scheduler,
+                                                                 QueryClass::Interactive);
+                             });
+        while (0 == scheduler.Waiting(QueryClass::Interactive))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const QueryScheduler::Follower over_limit(&scheduler);
+        BOOST_CHECK(!over_limit.Admitted());
+        BOOST_CHECK_EQUAL(scheduler.Rejected(QueryClass::Interactive), 2u);
+    }
+    waiter.join();
+
+    const QueryScheduler::Follower unscheduled(nullptr);
+    BOOST_CHECK(unscheduled.Admitted());
+}
+
+BOOST_AUTO_TEST_CASE(thread_limits_test)
+{
+    const unsigned threads = 2 * std::max(1u, std::thread::hardware_concurrency()) + 8;
+    const auto scheduler = QueryScheduler::ForThreads(threads);
+    const auto interactive = scheduler->Limits(QueryClass::Interactive);
+    const auto bulk = scheduler->Limits(QueryClass::Bulk);
+    BOOST_CHECK_LT(scheduler->Slots() + interactive.max_waiting + bulk.max_waiting, threads);
+    BOOST_REQUIRE_GT(interactive.max_waiting, 0u);
+
+    std::vector<std::unique_ptr<QueryScheduler::Slot>> running;
+    for (unsigned i = 0; i < scheduler->Slots(); ++i)
+    {
+        running.emplace_back(new QueryScheduler::Slot(scheduler.get(), QueryClass::Interactive));
+        BOOST_CHECK(running.back()->Admitted());
+    }
+    std::vector<std::thread> waiters;
+    for (unsigned i = 0; i < interactive.max_waiting; ++i)
+    {
+        waiters.emplace_back([&scheduler]
+                             {
+                                 const QueryScheduler::Slot slot(scheduler.get(),
+                                                                 QueryClass::Interactive);
+                             });
+    }
+    while (scheduler->Waiting(QueryClass::Interactive) < interactive.max_waiting)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // the first waiter over the cap does not park a thread
+    const QueryScheduler::Slot over_cap(scheduler.get(), QueryClass::Interactive);
+    BOOST_CHECK(!over_cap.Admitted());
+    BOOST_CHECK_EQUAL(scheduler->Rejected(QueryClass::Interactive), 1u);
+
+    running.clear();
+    for (std::thread &waiter : waiters)
+    {
+        waiter.join();
+    }
+    BOOST_CHECK_EQUAL(scheduler->Waiting(QueryClass::Interactive), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(weighted_dispatch_test)
+{
+    constexpr unsigned per_class = 4;
+    QueryScheduler scheduler(1, {1, per_class, 3}, {1, per_class, 1});
+
+    std::mutex order_mutex;
+    std::vector<QueryClass> order;
+    std::vector<std::thread> waiters;
+    {
+        const QueryScheduler::Slot blocker(&scheduler, QueryClass::Interactive);
+        for (unsigned i = 0; i < per_class; ++i)
+        {
+            for (const QueryClass query_class : {QueryClass::Interactive, QueryClass::Bulk})
+            {
+                waiters.emplace_back([&, query_class]
+                                     {
+                                         const QueryScheduler::Slot slot(&scheduler, query_class);
+                                         std::lock_guard<std::mutex> lock(order_mutex);
+                                         order.push_back(query_class);
+                                     });
+            }
+        }
+        while (scheduler.Waiting(QueryClass::Interactive) < per_class ||
+               scheduler.Waiting(QueryClass::Bulk) < per_class)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    for (std::thread &waiter : waiters)
+    {
+        waiter.join();
+    }
+
+    BOOST_REQUIRE_EQUAL(order.size(), 2 * per_class);
+    // weights 3:1 let three interactive queries pass for every bulk query
+    const std::vector<QueryClass> expected = {QueryClass::Interactive, QueryClass::Interactive,
+                                              QueryClass::Bulk,        QueryClass::Interactive,
+                                              QueryClass::Interactive, QueryClass::Bulk,
+                                              QueryClass::Bulk,        QueryClass::Bulk};
+    BOOST_CHECK(expected == order);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,111 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../data_structures/request_coalescer.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(request_coalescer)
+
+BOOST_AUTO_TEST_CASE(share_result_test)
+{
+    RequestCoalescer<std::string> coalescer;
+
+    auto leader = coalescer.Join("/viaroute?loc=1,2&loc=3,4");
+    BOOST_CHECK(leader.IsLeader());
+
+    std::string followed;
+    std::thread follower([&]
+                         {
+                             auto flight = coalescer.Join("/viaroute?loc=1,2&loc=3,4");
+                             BOOST_CHECK(!flight.IsLeader());
+                             followed = *flight.Wait();
+                         });
+
+    // an unrelated request is not held up
+    auto other = coalescer.Join("/nearest?loc=1,2");
+    BOOST_CHECK(other.IsLeader());
+    other.Publish("other");
+
+    while (0 == coalescer.Coalesced())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    leader.Publish("route");
+    follower.join();
+
+    BOOST_CHECK_EQUAL(followed, "route");
+    BOOST_CHECK_EQUAL(coalescer.Led(), 2u);
+    BOOST_CHECK_EQUAL(coalescer.Coalesced(), 1u);
+
+    // finished requests are computed anew
+    auto again = coalescer.Join("/viaroute?loc=1,2&loc=3,4");
+    BOOST_CHECK(again.IsLeader());
+}
+
+BOOST_AUTO_TEST_CASE(abandoned_test)
+{
+    RequestCoalescer<std::string> coalescer;
+
+    auto leader = coalescer.Join("/table?loc=1,2");
+    auto follower = coalescer.Join("/table?loc=1,2");
+    BOOST_CHECK(!follower.IsLeader());
+
+    try
+    {
+        auto moved = std::move(leader);
+        throw std::runtime_error("query failed");
+    }
+    catch (const std::runtime_error &)
+    {
+    }
+    BOOST_CHECK(nullptr == follower.Wait());
+}
+
+BOOST_AUTO_TEST_CASE(stuck_leader_test)
+{
+    RequestCoalescer<std::string> coalescer;
+
+    auto leader = coalescer.Join("/viaroute?loc=5,6&loc=7,8");
+    auto follower = coalescer.Join("/viaroute?loc=5,6&loc=7,8");
+    BOOST_CHECK(!follower.IsLeader());
+
+    // the follower gives up once its own time is over
+    BOOST_CHECK(!follower.WaitFor(std::chrono::milliseconds(5)));
+
+    leader.Publish("route");
+    BOOST_CHECK(follower.WaitFor(std::chrono::milliseconds(5)));
+    BOOST_CHECK_EQUAL(*follower.Wait(), "route");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,114 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../data_structures/route_result_cache.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(route_result_cache)
+
+namespace
+{
+// the options the cache key looks at
+struct TestParameters
+{
+    short zoom_level = 18;
+    bool print_instructions = false;
+    bool geometry = true;
+    bool compression = true;
+    bool alternate_route = true;
+    bool uturn_default = false;
+    std::vector<bool> uturns;
+};
+
+std::vector<PhantomNodes> MakeLegs(const NodeID source, const NodeID target)
+{
+    PhantomNodes leg;
+    leg.source_phantom.forward_node_id = source;
+    leg.target_phantom.forward_node_id = target;
+    return {leg};
+}
+}
+
+BOOST_AUTO_TEST_CASE(key_test)
+{
+    TestParameters parameters;
+    const std::string key = RouteResultCache::MakeKey(parameters, MakeLegs(1, 2), 0);
+    BOOST_CHECK(key == RouteResultCache::MakeKey(parameters, MakeLegs(1, 2), 0));
+    BOOST_CHECK(key != RouteResultCache::MakeKey(parameters, MakeLegs(2, 1), 0));
+    BOOST_CHECK(key != RouteResultCache::MakeKey(parameters, MakeLegs(1, 2), 1));
+
+    parameters.print_instructions = true;
+    BOOST_CHECK(key != RouteResultCache::MakeKey(parameters, MakeLegs(1, 2), 0));
+}
+
+BOOST_AUTO_TEST_CASE(fetch_test)
+{
+    RouteResultCache cache;
+    TestParameters parameters;
+    const std::string key = RouteResultCache::MakeKey(parameters, MakeLegs(1, 2), 0);
+    const std::string content = "{\"status\":0}";
+
+    const std::uint64_t version = RouteResultCache::DataVersion(42, 0);
+
+    std::vector<char> output = {'c', 'b', '('};
+    BOOST_CHECK(!cache.Fetch(key, version, output));
+    cache.Insert(key, version, content.begin(), content.end());
+    BOOST_CHECK(cache.Fetch(key, version, output));
+    BOOST_CHECK_EQUAL(std::string(output.begin(), output.end()), "cb(" + content);
+
+    // other data, other answer
+    BOOST_CHECK(!cache.Fetch(key, RouteResultCache::DataVersion(43, 0), output));
+
+    // a reload of the same files is another dataset as well
+    const std::uint64_t reloaded = RouteResultCache::DataVersion(42, 1);
+    BOOST_CHECK(!cache.Fetch(key, reloaded, output));
+    cache.Insert(key, reloaded, content.begin(), content.end());
+    BOOST_CHECK(cache.Fetch(key, reloaded, output));
+
+    BOOST_CHECK_EQUAL(cache.Hits(), 2u);
+    BOOST_CHECK_EQUAL(cache.Lookups(), 5u);
+}
+
+BOOST_AUTO_TEST_CASE(oversized_entry_test)
+{
+    RouteResultCache cache;
+    TestParameters parameters;
+    const std::string key = RouteResultCache::MakeKey(parameters, MakeLegs(1, 2), 0);
+    const std::vector<char> content(RouteResultCache::MaximumEntrySize + 1, 'x');
+
+    cache.Insert(key, 42, content.begin(), content.end());
+    std::vector<char> output;
+    BOOST_CHECK(!cache.Fetch(key, 42, output));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,119 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../Server/DataStructures/SharedGeneration.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+
+BOOST_AUTO_TEST_SUITE(shared_generation)
+
+BOOST_AUTO_TEST_CASE(pin_test)
+{
+    SharedDataTimestamp shared{};
+    const unsigned all_second_regions = (1u << SharedDataLayout::NUM_SEGMENTS) - 1;
+    SharedGeneration::Publish(&shared, 1, all_second_regions);
+    {
+        const SharedGenerationPin pin(&shared);
+        BOOST_CHECK_EQUAL(pin.Timestamp(), 1u);
+        BOOST_CHECK_EQUAL(pin.Region(SharedDataLayout::GRAPH_SEGMENT), GRAPH_2);
+        BOOST_CHECK_EQUAL(pin.Region(SharedDataLayout::NAMES_SEGMENT), NAMES_2);
+        BOOST_CHECK_EQUAL(shared.readers[SharedDataLayout::GRAPH_SEGMENT][1].load(), 1);
+
+        // only the names are swapped while the pin keeps the old ones alive
+        SharedGeneration::Publish(&shared, 2,
+                                  all_second_regions ^ (1u << SharedDataLayout::NAMES_SEGMENT));
+        const SharedGenerationPin newer_pin(&shared);
+        BOOST_CHECK_EQUAL(newer_pin.Timestamp(), 2u);
+        BOOST_CHECK_EQUAL(newer_pin.Region(SharedDataLayout::NAMES_SEGMENT), NAMES_1);
+        BOOST_CHECK_EQUAL(newer_pin.Region(SharedDataLayout::GRAPH_SEGMENT), GRAPH_2);
+        BOOST_CHECK_EQUAL(shared.readers[SharedDataLayout::GRAPH_SEGMENT][1].load(), 2);
+
+        BOOST_CHECK(!SharedGeneration::WaitForReaders(&shared, SharedDataLayout::NAMES_SEGMENT, 1,
+                                                      std::chrono::milliseconds(5)));
+    }
+    BOOST_CHECK(SharedGeneration::WaitForReaders(&shared, SharedDataLayout::NAMES_SEGMENT, 1,
+                                                 std::chrono::milliseconds(5)));
+    BOOST_CHECK_EQUAL(shared.readers[SharedDataLayout::GRAPH_SEGMENT][1].load(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(reload_twice_test)
+{
+    SharedDataTimestamp shared{};
+    const auto graph = SharedDataLayout::GRAPH_SEGMENT;
+    const unsigned graph_bit = 1u << graph;
+    SharedGeneration::RecordLoad(&shared, graph, 0, 1, 42);
+    SharedGeneration::Publish(&shared, 1, 0);
+
+    SharedDataType mapped_region;
+    unsigned mapped_load;
+    {
+        const SharedGenerationPin first_query(&shared);
+        mapped_region = first_query.Region(graph);
+        mapped_load = first_query.LoadTimestamp(graph);
+    }
+
+    // the graph is reloaded twice while no query runs, so it is back in region _1
+    SharedGeneration::RecordLoad(&shared, graph, 1, 2, 43);
+    SharedGeneration::Publish(&shared, 2, graph_bit);
+    SharedGeneration::RecordLoad(&shared, graph, 0, 3, 44);
+    SharedGeneration::Publish(&shared, 3, 0);
+
+    const SharedGenerationPin second_query(&shared);
+    BOOST_CHECK_EQUAL(second_query.Region(graph), mapped_region);
+    BOOST_CHECK_NE(second_query.LoadTimestamp(graph), mapped_load);
+    BOOST_CHECK_EQUAL(second_query.LoadTimestamp(graph), 3u);
+    BOOST_CHECK_EQUAL(shared.checksums[graph][0], 44u);
+}
+
+BOOST_AUTO_TEST_CASE(region_test)
+{
+    for (int segment = 0; segment < SharedDataLayout::NUM_SEGMENTS; ++segment)
+    {
+        const auto id = static_cast<SharedDataLayout::SegmentID>(segment);
+        BOOST_CHECK_NE(SharedDataTimestamp::Region(id, 0), SharedDataTimestamp::Region(id, 1));
+        BOOST_CHECK_LT(SharedDataTimestamp::Region(id, 1), REGION_NONE);
+    }
+    BOOST_CHECK_EQUAL(SharedDataTimestamp::Region(SharedDataLayout::TIMESTAMP_SEGMENT, 1),
+                      TIMESTAMP_2);
+    BOOST_CHECK_EQUAL(SharedDataLayout::GetSegment(SharedDataLayout::COORDINATE_LIST),
+                      SharedDataLayout::R_TREE_SEGMENT);
+}
+
+BOOST_AUTO_TEST_CASE(reset_test)
+{
+    SharedDataTimestamp shared{};
+    SharedGeneration::Publish(&shared, 1, 0);
+    shared.readers[SharedDataLayout::R_TREE_SEGMENT][0].store(3);
+    SharedGeneration::ResetReaders(&shared);
+    BOOST_CHECK(SharedGeneration::WaitForReaders(&shared, SharedDataLayout::R_TREE_SEGMENT, 0,
+                                                 std::chrono::milliseconds(0)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,109 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../data_structures/query_edge.hpp"
+#include "../../data_structures/split_static_graph.hpp"
+#include "../../data_structures/static_graph.hpp"
+#include "../../typedefs.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+
+BOOST_AUTO_TEST_SUITE(split_static_graph)
+
+typedef QueryEdge::EdgeData TestData;
+typedef StaticGraph<TestData> TestStaticGraph;
+typedef SplitStaticGraph<TestData> TestSplitStaticGraph;
+
+constexpr unsigned TEST_NUM_NODES = 100;
+// Choosen by a fair W20 dice roll (this value is completely arbitrary)
+constexpr unsigned RANDOM_SEED = 15;
+
+BOOST_AUTO_TEST_CASE(split_test)
+{
+    std::mt19937 g(RANDOM_SEED);
+    std::uniform_int_distribution<> degree_udist(0, 5);
+    std::uniform_int_distribution<> node_udist(0, TEST_NUM_NODES - 1);
+    std::uniform_int_distribution<> distance_udist(1, (1 << 29) - 1);
+    std::bernoulli_distribution flag_dist(0.5);
+
+    std::vector<TestStaticGraph::NodeArrayEntry> nodes;
+    std::vector<TestSplitStaticGraph::NodeArrayEntry> split_nodes;
+    std::vector<TestStaticGraph::EdgeArrayEntry> edges;
+    for (unsigned node = 0; node <= TEST_NUM_NODES; ++node)
+    {
+        nodes.emplace_back(TestStaticGraph::NodeArrayEntry{static_cast<unsigned>(edges.size())});
+        split_nodes.emplace_back(
+            TestSplitStaticGraph::NodeArrayEntry{static_cast<unsigned>(edges.size())});
+        const int degree = (node < TEST_NUM_NODES ? degree_udist(g) : 0);
+        for (int i = 0; i < degree; ++i)
+        {
+            TestData data;
+            data.id = static_cast<NodeID>(edges.size());
+            data.shortcut = flag_dist(g);
+            data.distance = distance_udist(g);
+            data.forward = flag_dist(g);
+            data.backward = flag_dist(g);
+            edges.emplace_back(
+                TestStaticGraph::EdgeArrayEntry{static_cast<NodeID>(node_udist(g)), data});
+        }
+    }
+
+    std::vector<TestStaticGraph::EdgeArrayEntry> split_edges(edges);
+    const TestSplitStaticGraph split_graph(split_nodes, split_edges);
+    BOOST_CHECK(split_edges.empty());
+    const TestStaticGraph graph(nodes, edges);
+
+    BOOST_CHECK_EQUAL(split_graph.GetNumberOfNodes(), graph.GetNumberOfNodes());
+    BOOST_CHECK_EQUAL(split_graph.GetNumberOfEdges(), graph.GetNumberOfEdges());
+    for (const auto node : osrm::irange(0u, graph.GetNumberOfNodes()))
+    {
+        BOOST_CHECK_EQUAL(split_graph.BeginEdges(node), graph.BeginEdges(node));
+        BOOST_CHECK_EQUAL(split_graph.EndEdges(node), graph.EndEdges(node));
+        for (const auto edge : graph.GetAdjacentEdgeRange(node))
+        {
+            const TestData &expected = graph.GetEdgeData(edge);
+            const QueryEdgeHotData &hot_data = split_graph.GetHotData(edge);
+            BOOST_CHECK_EQUAL(hot_data.target, graph.GetTarget(edge));
+            BOOST_CHECK_EQUAL(hot_data.distance, expected.distance);
+            BOOST_CHECK_EQUAL(hot_data.forward, expected.forward);
+            BOOST_CHECK_EQUAL(hot_data.backward, expected.backward);
+            const TestData data = split_graph.GetEdgeData(edge);
+            BOOST_CHECK_EQUAL(data.id, expected.id);
+            BOOST_CHECK_EQUAL(data.shortcut, expected.shortcut);
+            BOOST_CHECK_EQUAL(data.distance, expected.distance);
+        }
+        for (const auto target : osrm::irange(0u, graph.GetNumberOfNodes()))
+        {
+            BOOST_CHECK_EQUAL(split_graph.FindEdge(node, target), graph.FindEdge(node, target));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
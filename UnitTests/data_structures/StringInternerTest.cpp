@@ -0,0 +1,148 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../data_structures/string_interner.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(string_interner)
+
+namespace
+{
+std::vector<std::string> ReadNames(const StringInterner &interner)
+{
+    std::stringstream stream;
+    interner.Write(stream);
+
+    RangeTable<> table;
+    stream >> table;
+    unsigned total_length = 0;
+    stream.read((char *)&total_length, sizeof(unsigned));
+    std::string characters(total_length, '\0');
+    stream.read(&characters[0], total_length);
+
+    std::vector<std::string> names;
+    for (unsigned id = 0; id < interner.Size(); ++id)
+    {
+        const auto range = table.GetRange(id);
+        names.emplace_back(characters.substr(range.front(), range.back() + 1 - range.front()));
+    }
+    return names;
+}
+}
+
+BOOST_AUTO_TEST_CASE(intern_test)
+{
+    StringInterner interner;
+    BOOST_CHECK_EQUAL(interner.Intern(""), 0u);
+    BOOST_CHECK_EQUAL(interner.Intern("Main Street"), 1u);
+    BOOST_CHECK_EQUAL(interner.Intern("Broadway"), 2u);
+    BOOST_CHECK_EQUAL(interner.Intern("Main Street"), 1u);
+    BOOST_CHECK_EQUAL(interner.Intern(std::string("Main")), 3u);
+    BOOST_CHECK_EQUAL(interner.Size(), 4u);
+
+    const std::vector<std::string> names = ReadNames(interner);
+    BOOST_CHECK_EQUAL(names.size(), 4u);
+    BOOST_CHECK_EQUAL(names[0], "");
+    BOOST_CHECK_EQUAL(names[1], "Main Street");
+    BOOST_CHECK_EQUAL(names[2], "Broadway");
+    BOOST_CHECK_EQUAL(names[3], "Main");
+}
+
+BOOST_AUTO_TEST_CASE(long_name_test)
+{
+    StringInterner interner;
+    const std::string prefix(StringInterner::MaximumLength, 'a');
+    const unsigned first_id = interner.Intern(prefix + "first");
+    // names are told apart in full, even if they are written the same
+    const unsigned second_id = interner.Intern(prefix + "second");
+    BOOST_CHECK_NE(first_id, second_id);
+    BOOST_CHECK_EQUAL(interner.Intern(prefix + "first"), first_id);
+    const unsigned prefix_id = interner.Intern(prefix);
+    BOOST_CHECK_NE(prefix_id, first_id);
+    BOOST_CHECK_EQUAL(interner.Size(), 4u);
+
+    const std::vector<std::string> names = ReadNames(interner);
+    BOOST_CHECK_EQUAL(names[first_id], prefix);
+    BOOST_CHECK_EQUAL(names[second_id], prefix);
+    BOOST_CHECK_EQUAL(names[prefix_id], prefix);
+}
+
+BOOST_AUTO_TEST_CASE(many_names_test)
+{
+    // more than a chunk of characters and many rehashes
+    StringInterner interner;
+    std::vector<std::string> expected = {""};
+    for (unsigned i = 0; i < 20000; ++i)
+    {
+        expected.push_back(std::to_string(i) + std::string(100, 'x'));
+        BOOST_CHECK_EQUAL(interner.Intern(expected.back()), i + 1);
+    }
+    BOOST_CHECK_EQUAL(interner.Intern(expected[1234]), 1234u);
+    BOOST_CHECK(ReadNames(interner) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_test)
+{
+    StringInterner interner;
+    const unsigned number_of_threads = 8;
+    const unsigned number_of_names = 5000;
+    std::vector<std::vector<unsigned>> ids(number_of_threads);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < number_of_threads; ++t)
+    {
+        threads.emplace_back([&, t]()
+                             {
+                                 for (unsigned i = 0; i < number_of_names; ++i)
+                                 {
+                                     ids[t].push_back(interner.Intern("name " + std::to_string(i)));
+                                 }
+                             });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    BOOST_CHECK_EQUAL(interner.Size(), number_of_names + 1);
+    for (unsigned t = 1; t < number_of_threads; ++t)
+    {
+        BOOST_CHECK(ids[t] == ids[0]);
+    }
+    const std::vector<std::string> names = ReadNames(interner);
+    for (unsigned i = 0; i < number_of_names; ++i)
+    {
+        BOOST_CHECK_EQUAL(names[ids[0][i]], "name " + std::to_string(i));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
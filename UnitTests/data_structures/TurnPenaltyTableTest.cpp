@@ -0,0 +1,78 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../data_structures/turn_penalty_table.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+
+BOOST_AUTO_TEST_SUITE(turn_penalty_table)
+
+namespace
+{
+// grows with the deviation from going straight, like the turnbot profile
+int penalty_of_angle(const double angle) { return static_cast<int>(10 * std::abs(180. - angle)); }
+}
+
+BOOST_AUTO_TEST_CASE(default_constructed_is_empty)
+{
+    const TurnPenaltyTable table;
+    BOOST_CHECK(table.empty());
+}
+
+BOOST_AUTO_TEST_CASE(sampled_angles_match)
+{
+    const TurnPenaltyTable table(penalty_of_angle);
+    BOOST_CHECK(!table.empty());
+    for (unsigned index = 0; index <= 360 * TurnPenaltyTable::SamplesPerDegree; index += 7)
+    {
+        const double angle = TurnPenaltyTable::AngleOf(index);
+        BOOST_CHECK_EQUAL(table(angle), penalty_of_angle(angle));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(nearest_sample_is_returned)
+{
+    const TurnPenaltyTable table([](const double angle)
+                                 {
+                                     return static_cast<int>(
+                                         std::lround(angle * TurnPenaltyTable::SamplesPerDegree));
+                                 });
+    BOOST_CHECK_EQUAL(table(90.004), 9000);
+    BOOST_CHECK_EQUAL(table(90.006), 9001);
+    BOOST_CHECK_EQUAL(table(359.999), 36000);
+}
+
+BOOST_AUTO_TEST_CASE(angles_out_of_range_are_clamped)
+{
+    const TurnPenaltyTable table(penalty_of_angle);
+    BOOST_CHECK_EQUAL(table(-0.5), penalty_of_angle(0.));
+    BOOST_CHECK_EQUAL(table(360.5), penalty_of_angle(360.));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
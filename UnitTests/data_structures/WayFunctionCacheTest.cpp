@@ -0,0 +1,102 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../extractor/way_function_cache.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(way_function_cache)
+
+namespace
+{
+struct TestTag
+{
+    const char *key() const { return tag.first; }
+    const char *value() const { return tag.second; }
+    std::pair<const char *, const char *> tag;
+};
+
+std::string MakeKey(const std::vector<TestTag> &tags)
+{
+    std::string key;
+    WayFunctionCache::MakeKey(tags, key);
+    return key;
+}
+}
+
+BOOST_AUTO_TEST_CASE(key_test)
+{
+    const std::vector<TestTag> residential = {{{"highway", "residential"}}, {{"name", "Main"}}};
+    const std::string key = MakeKey(residential);
+    BOOST_CHECK(key == MakeKey(residential));
+    BOOST_CHECK(key != MakeKey({{{"highway", "residential"}}}));
+    BOOST_CHECK(key != MakeKey({{{"highway", "residential"}}, {{"name", "Main Street"}}}));
+    // the boundary between key and value is part of the key
+    BOOST_CHECK(MakeKey({{{"ab", "c"}}}) != MakeKey({{{"a", "bc"}}}));
+    BOOST_CHECK(MakeKey({}).empty());
+}
+
+BOOST_AUTO_TEST_CASE(fetch_test)
+{
+    WayFunctionCache cache(2);
+    const std::string key = MakeKey({{{"highway", "primary"}}});
+
+    ExtractionWay result;
+    BOOST_CHECK(!cache.Fetch(key, result));
+
+    result.forward_speed = 50;
+    result.name = "B1";
+    result.backward_travel_mode = TRAVEL_MODE_INACCESSIBLE;
+    cache.Insert(key, result);
+
+    ExtractionWay cached;
+    BOOST_CHECK(cache.Fetch(key, cached));
+    BOOST_CHECK_EQUAL(cached.forward_speed, 50);
+    BOOST_CHECK_EQUAL(cached.name, "B1");
+    BOOST_CHECK(cached.backward_travel_mode == TRAVEL_MODE_INACCESSIBLE);
+
+    BOOST_CHECK_EQUAL(cache.Lookups(), 2u);
+    BOOST_CHECK_EQUAL(cache.Hits(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(capacity_test)
+{
+    WayFunctionCache cache(2);
+    ExtractionWay result;
+    cache.Insert("a", result);
+    cache.Insert("b", result);
+    cache.Insert("c", result);
+    BOOST_CHECK(!cache.Fetch("a", result));
+    BOOST_CHECK(cache.Fetch("b", result));
+    BOOST_CHECK(cache.Fetch("c", result));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,203 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../expander/edge_based_graph_factory.hpp"
+#include "../../Util/make_unique.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(edge_based_graph_factory)
+
+namespace
+{
+using CompressedNodes = std::vector<GeometryCompressor::CompressedNode>;
+
+struct TestEdge
+{
+    NodeID source;
+    NodeID target;
+    EdgeWeight weight;
+    unsigned name_id;
+};
+
+// a node based graph of bidirectional edges and the factory compressing it
+struct TestGraph
+{
+    TestGraph(const unsigned number_of_nodes,
+              const std::vector<TestEdge> &test_edges,
+              std::vector<NodeID> traffic_lights = {},
+              const int traffic_signal_penalty = 0)
+        : node_info(number_of_nodes)
+    {
+        std::vector<ImportEdge> edges;
+        for (const TestEdge &edge : test_edges)
+        {
+            edges.emplace_back(edge.source, edge.target, edge.name_id, edge.weight, true, true,
+                               false, false, false, TRAVEL_MODE_DEFAULT, false);
+        }
+        graph = NodeBasedDynamicGraphFromImportEdges(number_of_nodes, edges);
+
+        EdgeBasedGraphFactory::SpeedProfileProperties speed_profile;
+        speed_profile.traffic_signal_penalty = traffic_signal_penalty;
+        std::vector<NodeID> barriers;
+        factory = osrm::make_unique<EdgeBasedGraphFactory>(
+            graph, osrm::make_unique<RestrictionMap>(std::vector<TurnRestriction>()), barriers,
+            traffic_lights, node_info, speed_profile);
+        factory->CompressGeometry();
+    }
+
+    // the weight of the edge from source to target, 0 if there is none
+    EdgeWeight Weight(const NodeID source, const NodeID target) const
+    {
+        const EdgeID edge = graph->FindEdge(source, target);
+        return graph->EndEdges(source) == edge ? 0 : graph->GetEdgeData(edge).distance;
+    }
+
+    // the removed nodes and the target of the edge with their weights, empty if
+    // the edge is not compressed
+    CompressedNodes Geometry(const NodeID source, const NodeID target) const
+    {
+        const EdgeID edge = graph->FindEdge(source, target);
+        BOOST_REQUIRE(graph->EndEdges(source) != edge);
+        const GeometryCompressor &compressor = factory->GetGeometryCompressor();
+        if (!compressor.HasEntryForID(edge))
+        {
+            return {};
+        }
+        const auto bucket = compressor.GetBucketReference(edge);
+        return CompressedNodes(bucket.begin(), bucket.end());
+    }
+
+    std::vector<QueryNode> node_info;
+    std::shared_ptr<NodeBasedDynamicGraph> graph;
+    std::unique_ptr<EdgeBasedGraphFactory> factory;
+};
+}
+
+BOOST_AUTO_TEST_CASE(chain_test)
+{
+    // 0 - 1 - 2 - 3 with a traffic signal at 2
+    const TestGraph test(4, {{0, 1, 10, 0}, {1, 2, 20, 0}, {2, 3, 30, 0}}, {2}, 7);
+    const auto &graph = *test.graph;
+
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(0), 1u);
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(1), 0u);
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(2), 0u);
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(3), 1u);
+    BOOST_CHECK_EQUAL(test.Weight(0, 3), 67);
+    BOOST_CHECK_EQUAL(test.Weight(3, 0), 67);
+
+    // the signal is passed once either way, on the segment leading to it
+    BOOST_CHECK(test.Geometry(0, 3) == CompressedNodes({{1, 10}, {2, 27}, {3, 30}}));
+    BOOST_CHECK(test.Geometry(3, 0) == CompressedNodes({{2, 37}, {1, 20}, {0, 10}}));
+}
+
+BOOST_AUTO_TEST_CASE(parallel_chains_test)
+{
+    // 0 - 1 - 2 - 3 and 0 - 4 - 5 - 3 with 6 - 0 and 3 - 7 keeping 0 and 3
+    const TestGraph test(8, {{0, 1, 1, 0}, {1, 2, 2, 0}, {2, 3, 3, 0},
+                             {0, 4, 4, 0}, {4, 5, 5, 0}, {5, 3, 6, 0},
+                             {6, 0, 1, 0}, {3, 7, 1, 0}});
+    const auto &graph = *test.graph;
+
+    // the first chain collapses into a single edge
+    BOOST_CHECK_EQUAL(test.Weight(0, 3), 6);
+    BOOST_CHECK_EQUAL(test.Weight(3, 0), 6);
+    BOOST_CHECK(test.Geometry(0, 3) == CompressedNodes({{1, 1}, {2, 2}, {3, 3}}));
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(1), 0u);
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(2), 0u);
+
+    // the second one keeps the node next to 3, there is no parallel edge
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(0), 3u);
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(3), 3u);
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(4), 0u);
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(5), 2u);
+    BOOST_CHECK_EQUAL(test.Weight(0, 5), 9);
+    BOOST_CHECK_EQUAL(test.Weight(5, 0), 9);
+    BOOST_CHECK_EQUAL(test.Weight(5, 3), 6);
+    BOOST_CHECK(test.Geometry(0, 5) == CompressedNodes({{4, 4}, {5, 5}}));
+    BOOST_CHECK(test.Geometry(5, 0) == CompressedNodes({{4, 5}, {0, 4}}));
+    BOOST_CHECK(test.Geometry(5, 3).empty());
+}
+
+BOOST_AUTO_TEST_CASE(loop_test)
+{
+    // the ring 0 - 1 - 2 - 3 - 0 hangs off 4 - 0
+    const TestGraph test(5, {{0, 1, 1, 0}, {1, 2, 2, 0}, {2, 3, 3, 0},
+                             {3, 0, 4, 0}, {4, 0, 1, 0}});
+    const auto &graph = *test.graph;
+
+    // the two nodes next to the end of the loop stay
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(0), 3u);
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(1), 0u);
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(2), 2u);
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(3), 2u);
+    BOOST_CHECK_EQUAL(test.Weight(0, 2), 3);
+    BOOST_CHECK_EQUAL(test.Weight(2, 0), 3);
+    BOOST_CHECK(test.Geometry(0, 2) == CompressedNodes({{1, 1}, {2, 2}}));
+    BOOST_CHECK(test.Geometry(2, 0) == CompressedNodes({{1, 2}, {0, 1}}));
+    BOOST_CHECK_EQUAL(test.Weight(2, 3), 3);
+    BOOST_CHECK_EQUAL(test.Weight(3, 0), 4);
+}
+
+BOOST_AUTO_TEST_CASE(ring_test)
+{
+    // a ring of removable nodes has no end to keep, nothing is removed
+    const TestGraph test(4, {{0, 1, 1, 0}, {1, 2, 2, 0}, {2, 3, 3, 0}, {3, 0, 4, 0}});
+    const auto &graph = *test.graph;
+
+    for (const NodeID node : {0u, 1u, 2u, 3u})
+    {
+        BOOST_CHECK_EQUAL(graph.GetOutDegree(node), 2u);
+    }
+    BOOST_CHECK_EQUAL(test.Weight(0, 1), 1);
+    BOOST_CHECK_EQUAL(test.Weight(3, 0), 4);
+    BOOST_CHECK(test.Geometry(0, 1).empty());
+}
+
+BOOST_AUTO_TEST_CASE(incompatible_edges_test)
+{
+    // 0 - 1 - 2 - 3 - 4 where the name changes at 2
+    const TestGraph test(5, {{0, 1, 1, 0}, {1, 2, 2, 0}, {2, 3, 3, 1}, {3, 4, 4, 1}});
+    const auto &graph = *test.graph;
+
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(1), 0u);
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(2), 2u);
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(3), 0u);
+    BOOST_CHECK_EQUAL(test.Weight(0, 2), 3);
+    BOOST_CHECK_EQUAL(test.Weight(2, 4), 7);
+    BOOST_CHECK_EQUAL(graph.GetEdgeData(graph.FindEdge(0, 2)).nameID, 0u);
+    BOOST_CHECK_EQUAL(graph.GetEdgeData(graph.FindEdge(2, 4)).nameID, 1u);
+    BOOST_CHECK(test.Geometry(0, 2) == CompressedNodes({{1, 1}, {2, 2}}));
+    BOOST_CHECK(test.Geometry(2, 4) == CompressedNodes({{3, 3}, {4, 4}}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
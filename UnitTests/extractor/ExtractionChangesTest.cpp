@@ -0,0 +1,208 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../extractor/extraction_changes.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(extraction_changes)
+
+namespace
+{
+using Segments = std::vector<std::pair<NodeID, NodeID>>;
+
+ExternalMemoryNode MakeNode(const NodeID node_id)
+{
+    return ExternalMemoryNode(node_id, node_id, node_id, false, false);
+}
+
+ExtractionStateWay MakeWay(const std::uint64_t id, const std::vector<NodeID> &nodes)
+{
+    ExtractionStateWay way;
+    way.id = id;
+    way.nodes = nodes;
+    way.result.forward_speed = 30;
+    way.result.backward_speed = 30;
+    return way;
+}
+
+// a state in a directory of its own, removed with everything in it
+struct State
+{
+    State(const std::vector<NodeID> &node_ids,
+          const std::vector<ExtractionStateWay> &ways,
+          const std::vector<std::uint64_t> &restriction_ids)
+        : directory(boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path("osrm-state-%%%%-%%%%-%%%%")),
+          state_file_name((directory / "map.osrm").string())
+    {
+        boost::filesystem::create_directory(directory);
+        ExtractionStateWriter writer(state_file_name);
+        for (const NodeID node_id : node_ids)
+        {
+            writer.WriteNode(MakeNode(node_id));
+        }
+        for (const ExtractionStateWay &way : ways)
+        {
+            writer.WriteWay(way);
+        }
+        for (const std::uint64_t restriction_id : restriction_ids)
+        {
+            writer.WriteRestriction({restriction_id, InputRestrictionContainer()});
+        }
+        BOOST_REQUIRE(writer.Commit());
+    }
+
+    ~State() { boost::filesystem::remove_all(directory); }
+
+    const boost::filesystem::path directory;
+    const std::string state_file_name;
+};
+
+// records what the merge hands on, ways without segments are not routable
+struct RecordingCallbacks
+{
+    void ProcessNode(const ExternalMemoryNode &node) { node_ids.push_back(node.node_id); }
+
+    bool ProcessWay(ExtractionStateWay &way)
+    {
+        if (way.nodes.size() <= 1)
+        {
+            return false;
+        }
+        ways.push_back(way);
+        return true;
+    }
+
+    void ProcessRestriction(const ExtractionStateRestriction &restriction)
+    {
+        restriction_ids.push_back(restriction.id);
+    }
+
+    std::vector<NodeID> node_ids;
+    std::vector<ExtractionStateWay> ways;
+    std::vector<std::uint64_t> restriction_ids;
+};
+
+Segments Apply(const State &state, const ChangeSet &changes, RecordingCallbacks &callbacks)
+{
+    ExtractionStateReader reader(state.state_file_name);
+    Segments changed_segments;
+    apply_changes(reader, changes, callbacks, changed_segments);
+    return changed_segments;
+}
+}
+
+BOOST_AUTO_TEST_CASE(version_test)
+{
+    ChangeSet changes;
+    ChangeSet::Set(changes.nodes, NodeID(1), 2, ExternalMemoryNode(20, 0, 1, false, false));
+    // an older version is ignored
+    ChangeSet::Set(changes.nodes, NodeID(1), 1, ExternalMemoryNode(10, 0, 1, false, false));
+    BOOST_CHECK_EQUAL(changes.nodes[1].version, 2u);
+    BOOST_CHECK(changes.nodes[1].has_object);
+    BOOST_CHECK_EQUAL(changes.nodes[1].object.lat, 20);
+
+    // a newer version replaces it
+    ChangeSet::Set(changes.nodes, NodeID(1), 3, ExternalMemoryNode(30, 0, 1, false, false));
+    BOOST_CHECK_EQUAL(changes.nodes[1].version, 3u);
+    BOOST_CHECK(changes.nodes[1].has_object);
+    BOOST_CHECK_EQUAL(changes.nodes[1].object.lat, 30);
+
+    // and so does a newer deletion, which an older version does not revive
+    ChangeSet::Delete(changes.nodes, NodeID(1), 4);
+    ChangeSet::Set(changes.nodes, NodeID(1), 3, ExternalMemoryNode(30, 0, 1, false, false));
+    BOOST_CHECK_EQUAL(changes.nodes[1].version, 4u);
+    BOOST_CHECK(!changes.nodes[1].has_object);
+    BOOST_CHECK_EQUAL(changes.nodes.size(), 1u);
+
+    // ways keep their name through any number of versions
+    ExtractionStateWay way = MakeWay(10, {1, 2});
+    way.result.name = "Main Street";
+    ChangeSet::Set(changes.ways, std::uint64_t(10), 1, way);
+    way.result.name = "Market Street, a name too long for the small string buffer";
+    ChangeSet::Set(changes.ways, std::uint64_t(10), 2, way);
+    BOOST_CHECK_EQUAL(changes.ways[10].object.result.name, way.result.name);
+}
+
+BOOST_AUTO_TEST_CASE(merge_test)
+{
+    const State state({1, 2, 3, 5}, {MakeWay(10, {1, 2}), MakeWay(20, {2, 3}), MakeWay(30, {3, 5})},
+                      {7, 8});
+
+    ChangeSet changes;
+    ChangeSet::Set(changes.nodes, NodeID(4), 1, MakeNode(4));
+    ChangeSet::Set(changes.ways, std::uint64_t(20), 2, MakeWay(20, {2, 3, 4}));
+    ChangeSet::Set(changes.ways, std::uint64_t(40), 1, MakeWay(40, {1, 4}));
+    ChangeSet::Delete(changes.restrictions, std::uint64_t(8), 2);
+
+    RecordingCallbacks callbacks;
+    const Segments changed_segments = Apply(state, changes, callbacks);
+
+    BOOST_CHECK(callbacks.node_ids == std::vector<NodeID>({1, 2, 3, 4, 5}));
+    BOOST_REQUIRE_EQUAL(callbacks.ways.size(), 4u);
+    BOOST_CHECK_EQUAL(callbacks.ways[0].id, 10u);
+    BOOST_CHECK_EQUAL(callbacks.ways[1].id, 20u);
+    BOOST_CHECK(callbacks.ways[1].nodes == std::vector<NodeID>({2, 3, 4}));
+    BOOST_CHECK_EQUAL(callbacks.ways[2].id, 30u);
+    BOOST_CHECK_EQUAL(callbacks.ways[3].id, 40u);
+    BOOST_CHECK(callbacks.restriction_ids == std::vector<std::uint64_t>({7}));
+
+    // the segments of the changed ways, old and new, and none of the others
+    BOOST_CHECK(changed_segments == Segments({{1, 4}, {2, 3}, {3, 4}}));
+}
+
+BOOST_AUTO_TEST_CASE(deletion_test)
+{
+    const State state({1, 2, 3, 4, 5},
+                      {MakeWay(10, {1, 2, 3}), MakeWay(20, {3, 4}), MakeWay(30, {4, 5})}, {});
+
+    ChangeSet changes;
+    ChangeSet::Delete(changes.nodes, NodeID(5), 3);
+    ChangeSet::Delete(changes.ways, std::uint64_t(20), 3);
+    // a change older than the deletion does not bring the way back
+    ChangeSet::Set(changes.ways, std::uint64_t(20), 2, MakeWay(20, {3, 4}));
+    // nor does a change to a way that drops out of the graph
+    ChangeSet::Set(changes.ways, std::uint64_t(10), 2, MakeWay(10, {1}));
+
+    RecordingCallbacks callbacks;
+    const Segments changed_segments = Apply(state, changes, callbacks);
+
+    BOOST_CHECK(callbacks.node_ids == std::vector<NodeID>({1, 2, 3, 4}));
+    BOOST_REQUIRE_EQUAL(callbacks.ways.size(), 1u);
+    BOOST_CHECK_EQUAL(callbacks.ways[0].id, 30u);
+
+    // the segments of the deleted ways and the one at the deleted node
+    BOOST_CHECK(changed_segments == Segments({{1, 2}, {2, 3}, {3, 4}, {4, 5}}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
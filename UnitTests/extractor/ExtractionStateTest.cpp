@@ -0,0 +1,220 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../extractor/extraction_state.hpp"
+#include "../../Util/osrm_exception.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(extraction_state)
+
+namespace
+{
+// an empty directory for the state files, removed with everything in it
+struct StateDirectory
+{
+    StateDirectory()
+        : directory(boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path("osrm-state-%%%%-%%%%-%%%%")),
+          state_file_name((directory / "map.osrm").string())
+    {
+        boost::filesystem::create_directory(directory);
+    }
+
+    ~StateDirectory() { boost::filesystem::remove_all(directory); }
+
+    bool HasFile(const std::string &suffix) const
+    {
+        return boost::filesystem::exists(state_file_name + suffix);
+    }
+
+    const boost::filesystem::path directory;
+    const std::string state_file_name;
+};
+
+ExtractionStateWay MakeWay(const std::uint64_t id, const std::vector<NodeID> &nodes)
+{
+    ExtractionStateWay way;
+    way.id = id;
+    way.nodes = nodes;
+    way.result.forward_speed = 30;
+    way.result.backward_speed = 20;
+    return way;
+}
+
+void WriteState(const std::string &state_file_name, const std::vector<NodeID> &node_ids)
+{
+    ExtractionStateWriter writer(state_file_name);
+    for (const NodeID node_id : node_ids)
+    {
+        writer.WriteNode(ExternalMemoryNode(node_id, 2 * node_id, node_id, false, false));
+    }
+    BOOST_REQUIRE(writer.Commit());
+}
+}
+
+BOOST_AUTO_TEST_CASE(round_trip_test)
+{
+    StateDirectory state;
+    {
+        ExtractionStateWriter writer(state.state_file_name);
+        writer.WriteNode(ExternalMemoryNode(100, 200, 1, true, false));
+        writer.WriteNode(ExternalMemoryNode(300, 400, 7, false, true));
+
+        ExtractionStateWay way = MakeWay(10, {1, 7});
+        way.result.duration = 60;
+        way.result.roundabout = true;
+        way.result.ignore_in_grid = true;
+        way.result.backward_travel_mode = TRAVEL_MODE_INACCESSIBLE;
+        way.result.name = "Main Street";
+        writer.WriteWay(way);
+        writer.WriteWay(MakeWay(20, {7, 1}));
+
+        ExtractionStateRestriction restriction{5, InputRestrictionContainer(10, 20, 1)};
+        restriction.restriction.restriction.flags.is_only = true;
+        writer.WriteRestriction(restriction);
+
+        // the state being written is not visible yet
+        BOOST_CHECK(state.HasFile(".nodes.tmp"));
+        BOOST_CHECK(!state.HasFile(".nodes"));
+        BOOST_CHECK(!state.HasFile(".ways"));
+        BOOST_CHECK(!state.HasFile(".restrictions"));
+        BOOST_CHECK_THROW(ExtractionStateReader reader(state.state_file_name), osrm::exception);
+
+        BOOST_REQUIRE(writer.Commit());
+        BOOST_CHECK(state.HasFile(".nodes"));
+        BOOST_CHECK(state.HasFile(".ways"));
+        BOOST_CHECK(state.HasFile(".restrictions"));
+        BOOST_CHECK(!state.HasFile(".nodes.tmp"));
+        BOOST_CHECK(!state.HasFile(".ways.tmp"));
+        BOOST_CHECK(!state.HasFile(".restrictions.tmp"));
+    }
+    // the destructor of a committed writer keeps the state
+    BOOST_CHECK(state.HasFile(".nodes"));
+
+    ExtractionStateReader reader(state.state_file_name);
+
+    ExternalMemoryNode node;
+    BOOST_REQUIRE(reader.ReadNode(node));
+    BOOST_CHECK_EQUAL(node.node_id, 1u);
+    BOOST_CHECK_EQUAL(node.lat, 100);
+    BOOST_CHECK_EQUAL(node.lon, 200);
+    BOOST_CHECK(node.barrier);
+    BOOST_CHECK(!node.traffic_lights);
+    BOOST_REQUIRE(reader.ReadNode(node));
+    BOOST_CHECK_EQUAL(node.node_id, 7u);
+    BOOST_CHECK(!node.barrier);
+    BOOST_CHECK(node.traffic_lights);
+    BOOST_CHECK(!reader.ReadNode(node));
+
+    ExtractionStateWay way;
+    BOOST_REQUIRE(reader.ReadWay(way));
+    BOOST_CHECK_EQUAL(way.id, 10u);
+    BOOST_CHECK(way.nodes == std::vector<NodeID>({1, 7}));
+    BOOST_CHECK_EQUAL(way.result.forward_speed, 30);
+    BOOST_CHECK_EQUAL(way.result.backward_speed, 20);
+    BOOST_CHECK_EQUAL(way.result.duration, 60);
+    BOOST_CHECK(way.result.roundabout);
+    BOOST_CHECK(!way.result.is_access_restricted);
+    BOOST_CHECK(way.result.ignore_in_grid);
+    BOOST_CHECK(way.result.forward_travel_mode == TRAVEL_MODE_DEFAULT);
+    BOOST_CHECK(way.result.backward_travel_mode == TRAVEL_MODE_INACCESSIBLE);
+    BOOST_CHECK_EQUAL(way.result.name, "Main Street");
+    BOOST_REQUIRE(reader.ReadWay(way));
+    BOOST_CHECK_EQUAL(way.id, 20u);
+    BOOST_CHECK(way.nodes == std::vector<NodeID>({7, 1}));
+    BOOST_CHECK(!way.result.roundabout);
+    BOOST_CHECK(way.result.name.empty());
+    BOOST_CHECK(!reader.ReadWay(way));
+
+    ExtractionStateRestriction restriction;
+    BOOST_REQUIRE(reader.ReadRestriction(restriction));
+    BOOST_CHECK_EQUAL(restriction.id, 5u);
+    BOOST_CHECK_EQUAL(restriction.restriction.restriction.from.way, 10u);
+    BOOST_CHECK_EQUAL(restriction.restriction.restriction.to.way, 20u);
+    BOOST_CHECK(restriction.restriction.restriction.flags.is_only);
+    BOOST_CHECK(!reader.ReadRestriction(restriction));
+}
+
+BOOST_AUTO_TEST_CASE(uncommitted_test)
+{
+    StateDirectory state;
+    {
+        ExtractionStateWriter writer(state.state_file_name);
+        writer.WriteNode(ExternalMemoryNode(0, 0, 1, false, false));
+    }
+    BOOST_CHECK(!state.HasFile(".nodes.tmp"));
+    BOOST_CHECK(!state.HasFile(".ways.tmp"));
+    BOOST_CHECK(!state.HasFile(".restrictions.tmp"));
+    BOOST_CHECK(!state.HasFile(".nodes"));
+    BOOST_CHECK_THROW(ExtractionStateReader reader(state.state_file_name), osrm::exception);
+}
+
+BOOST_AUTO_TEST_CASE(unsorted_test)
+{
+    StateDirectory state;
+    WriteState(state.state_file_name, {1, 2});
+
+    {
+        ExtractionStateWriter writer(state.state_file_name);
+        writer.WriteNode(ExternalMemoryNode(0, 0, 4, false, false));
+        writer.WriteNode(ExternalMemoryNode(0, 0, 3, false, false));
+        BOOST_CHECK(!writer.Commit());
+    }
+    {
+        ExtractionStateWriter writer(state.state_file_name);
+        writer.WriteWay(MakeWay(20, {1, 2}));
+        writer.WriteWay(MakeWay(20, {2, 1}));
+        BOOST_CHECK(!writer.Commit());
+    }
+    {
+        ExtractionStateWriter writer(state.state_file_name);
+        writer.WriteRestriction({6, InputRestrictionContainer()});
+        writer.WriteRestriction({5, InputRestrictionContainer()});
+        BOOST_CHECK(!writer.Commit());
+    }
+    BOOST_CHECK(!state.HasFile(".nodes.tmp"));
+    BOOST_CHECK(!state.HasFile(".ways.tmp"));
+    BOOST_CHECK(!state.HasFile(".restrictions.tmp"));
+
+    // the state committed before is left alone
+    ExtractionStateReader reader(state.state_file_name);
+    ExternalMemoryNode node;
+    BOOST_REQUIRE(reader.ReadNode(node));
+    BOOST_CHECK_EQUAL(node.node_id, 1u);
+    BOOST_REQUIRE(reader.ReadNode(node));
+    BOOST_CHECK_EQUAL(node.node_id, 2u);
+    BOOST_CHECK(!reader.ReadNode(node));
+    ExtractionStateWay way;
+    BOOST_CHECK(!reader.ReadWay(way));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
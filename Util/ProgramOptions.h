@@ -150,6 +150,7 @@ inline unsigned GenerateServerProgramOptions(const int argc,
                                              std::string &ip_address,
                                              int &ip_port,
                                              int &requested_num_threads,
+                                             int &max_query_time,
                                              bool &use_shared_memory,
                                              bool &trial)
 {
@@ -196,6 +197,9 @@ inline unsigned GenerateServerProgramOptions(const int argc,
         "threads,t",
         boost::program_options::value<int>(&requested_num_threads)->default_value(8),
         "Number of threads to use")(
+        "querytimeout",
+        boost::program_options::value<int>(&max_query_time)->default_value(0),
+        "Query time limit in ms, 0 for none")(
         "sharedmemory,s",
         boost::program_options::value<bool>(&use_shared_memory)->implicit_value(true),
         "Load data from shared memory");
@@ -264,6 +268,11 @@ inline unsigned GenerateServerProgramOptions(const int argc,
         throw osrm::exception("Number of threads must be a positive number");
     }
 
+    if (0 > max_query_time)
+    {
+        throw osrm::exception("Query timeout must not be negative");
+    }
+
     if (!use_shared_memory && option_variables.count("base"))
     {
         return INIT_OK_START_ENGINE;
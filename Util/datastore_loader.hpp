@@ -0,0 +1,542 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef DATASTORE_LOADER_HPP
+#define DATASTORE_LOADER_HPP
+
+#include "osrm_exception.hpp"
+#include "simple_logger.hpp"
+#include "timing_util.hpp"
+#include "../data_structures/edge_based_node.hpp"
+#include "../data_structures/original_edge_data.hpp"
+#include "../data_structures/query_node.hpp"
+#include "../data_structures/range_table.hpp"
+#include "../data_structures/shared_memory_vector_wrapper.hpp"
+#include "../data_structures/static_rtree.hpp"
+#include "../data_structures/turn_instructions.hpp"
+#include "../Server/DataStructures/SharedDataType.h"
+#include "../typedefs.h"
+
+#include <osrm/Coordinate.h>
+
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_group.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Read-only mapping of an input file, the loaders copy straight out of the
+// page cache instead of going through stream buffers.
+class InputFile
+{
+  public:
+    explicit InputFile(const boost::filesystem::path &path)
+        : path(path), mapping(path.string().c_str(), boost::interprocess::read_only),
+          region(mapping, boost::interprocess::read_only)
+    {
+        region.advise(boost::interprocess::mapped_region::advice_sequential);
+    }
+
+    void CheckRange(const std::size_t offset, const std::size_t bytes) const
+    {
+        if (offset + bytes > region.get_size())
+        {
+            throw osrm::exception(path.string() + " is truncated");
+        }
+    }
+
+    const char *Data(const std::size_t offset, const std::size_t bytes) const
+    {
+        CheckRange(offset, bytes);
+        return static_cast<const char *>(region.get_address()) + offset;
+    }
+
+    template <typename T> T Read(const std::size_t offset) const
+    {
+        T value;
+        std::memcpy(&value, Data(offset, sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    std::size_t Size() const { return region.get_size(); }
+
+    const boost::filesystem::path &Path() const { return path; }
+
+  private:
+    boost::filesystem::path path;
+    boost::interprocess::file_mapping mapping;
+    boost::interprocess::mapped_region region;
+};
+
+// Large blocks are copied in parallel, which also spreads the page faults of
+// the fresh shared memory segment over all cores.
+inline void copy_block(const InputFile &input,
+                       const std::size_t offset,
+                       char *destination,
+                       const std::size_t bytes)
+{
+    const char *source = input.Data(offset, bytes);
+    const std::size_t chunk_size = 16 * 1024 * 1024;
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, bytes, chunk_size),
+                      [&](const tbb::blocked_range<std::size_t> &range)
+                      {
+        std::memcpy(destination + range.begin(), source + range.begin(), range.size());
+    });
+}
+
+inline void report_throughput(const InputFile &input, const double seconds)
+{
+    const double mebibytes = input.Size() / (1024. * 1024.);
+    SimpleLogger().Write() << "loaded " << input.Path().filename().string() << ": " << mebibytes
+                           << " MiB in " << seconds << "s, "
+                           << (seconds > 0. ? mebibytes / seconds : 0.) << " MiB/s";
+}
+
+// CRC of the whole file. The chunks are checksummed in parallel and their CRCs
+// are combined in order, so the result only depends on the file content.
+inline unsigned file_checksum(const InputFile &input)
+{
+    const std::size_t chunk_size = 16 * 1024 * 1024;
+    const std::size_t number_of_chunks = (input.Size() + chunk_size - 1) / chunk_size;
+    std::vector<unsigned> chunk_checksums(number_of_chunks);
+    tbb::parallel_for(std::size_t(0), number_of_chunks, [&](const std::size_t chunk)
+                      {
+        const std::size_t begin = chunk * chunk_size;
+        const std::size_t bytes = std::min(chunk_size, input.Size() - begin);
+        boost::crc_32_type crc;
+        crc.process_bytes(input.Data(begin, bytes), bytes);
+        chunk_checksums[chunk] = crc.checksum();
+    });
+
+    boost::crc_32_type crc;
+    crc.process_bytes(chunk_checksums.data(), chunk_checksums.size() * sizeof(unsigned));
+    return crc.checksum();
+}
+
+// The part of a shared memory dataset that does not depend on the search graph:
+// street names, original edges, geometries, coordinates, the r-tree, the
+// timestamp and the name of the leaf file. osrm-datastore and d_datastore only
+// differ in the graph they put next to it. Every segment but the graph can be
+// sized, checksummed and loaded on its own.
+class OriginalDataFiles
+{
+  public:
+    using RTreeNode =
+        StaticRTree<EdgeBasedNode, ShM<FixedPointCoordinate, true>::vector, true>::TreeNode;
+
+    OriginalDataFiles(const boost::filesystem::path &names_path,
+                      const boost::filesystem::path &edges_path,
+                      const boost::filesystem::path &geometries_path,
+                      const boost::filesystem::path &nodes_path,
+                      const boost::filesystem::path &ram_index_path,
+                      const boost::filesystem::path &timestamp_path,
+                      const std::string &file_index_path)
+        : name_file(names_path), edges_file(edges_path), geometry_file(geometries_path),
+          nodes_file(nodes_path), tree_node_file(ram_index_path), file_index_path(file_index_path)
+    {
+        if (boost::filesystem::exists(timestamp_path))
+        {
+            boost::filesystem::ifstream timestamp_stream(timestamp_path);
+            if (!timestamp_stream)
+            {
+                SimpleLogger().Write(logWARNING) << timestamp_path
+                                                 << " not found. setting to default";
+            }
+            else
+            {
+                getline(timestamp_stream, timestamp);
+                timestamp_stream.close();
+            }
+        }
+        if (timestamp.empty())
+        {
+            timestamp = "n/a";
+        }
+        if (25 < timestamp.length())
+        {
+            timestamp.resize(25);
+        }
+    }
+
+    static bool HasSegment(const SharedDataLayout::SegmentID segment)
+    {
+        return SharedDataLayout::GRAPH_SEGMENT != segment &&
+               SharedDataLayout::NUM_SEGMENTS != segment;
+    }
+
+    // collect number of elements to store in shared memory object
+    void SetBlockSizes(SharedDataLayout &layout) const
+    {
+        for (int segment = 0; segment < SharedDataLayout::NUM_SEGMENTS; ++segment)
+        {
+            if (HasSegment(static_cast<SharedDataLayout::SegmentID>(segment)))
+            {
+                SetBlockSizes(layout, static_cast<SharedDataLayout::SegmentID>(segment));
+            }
+        }
+    }
+
+    void SetBlockSizes(SharedDataLayout &layout, const SharedDataLayout::SegmentID segment) const
+    {
+        BOOST_ASSERT(HasSegment(segment));
+        switch (segment)
+        {
+        case SharedDataLayout::NAMES_SEGMENT:
+            SetNameBlockSizes(layout);
+            break;
+        case SharedDataLayout::ORIGINAL_EDGES_SEGMENT:
+            SetOriginalEdgeBlockSizes(layout);
+            break;
+        case SharedDataLayout::GEOMETRIES_SEGMENT:
+            SetGeometryBlockSizes(layout);
+            break;
+        case SharedDataLayout::R_TREE_SEGMENT:
+            SetRTreeBlockSizes(layout);
+            break;
+        default: // TIMESTAMP_SEGMENT
+            layout.SetBlockSize<char>(SharedDataLayout::TIMESTAMP, timestamp.length());
+            break;
+        }
+    }
+
+    // tells whether a segment that is already in shared memory needs a reload
+    unsigned Checksum(const SharedDataLayout::SegmentID segment) const
+    {
+        BOOST_ASSERT(HasSegment(segment));
+        switch (segment)
+        {
+        case SharedDataLayout::NAMES_SEGMENT:
+            return file_checksum(name_file);
+        case SharedDataLayout::ORIGINAL_EDGES_SEGMENT:
+            return file_checksum(edges_file);
+        case SharedDataLayout::GEOMETRIES_SEGMENT:
+            return file_checksum(geometry_file);
+        case SharedDataLayout::R_TREE_SEGMENT:
+        {
+            const unsigned file_checksums[] = {file_checksum(nodes_file),
+                                               file_checksum(tree_node_file)};
+            boost::crc_32_type crc;
+            crc.process_bytes(file_checksums, sizeof(file_checksums));
+            crc.process_bytes(file_index_path.data(), file_index_path.length());
+            return crc.checksum();
+        }
+        default: // TIMESTAMP_SEGMENT
+        {
+            boost::crc_32_type crc;
+            crc.process_bytes(timestamp.data(), timestamp.length());
+            return crc.checksum();
+        }
+        }
+    }
+
+    // Writes the small blocks right away and starts one loader per file, every
+    // file goes into its own blocks, so they are all loaded at once.
+    void Load(tbb::task_group &loaders, SharedDataLayout &layout, char *shared_memory_ptr) const
+    {
+        for (int segment = 0; segment < SharedDataLayout::NUM_SEGMENTS; ++segment)
+        {
+            if (HasSegment(static_cast<SharedDataLayout::SegmentID>(segment)))
+            {
+                Load(loaders, layout, shared_memory_ptr,
+                     static_cast<SharedDataLayout::SegmentID>(segment));
+            }
+        }
+    }
+
+    void Load(tbb::task_group &loaders,
+              SharedDataLayout &layout,
+              char *shared_memory_ptr,
+              const SharedDataLayout::SegmentID segment) const
+    {
+        BOOST_ASSERT(HasSegment(segment));
+        switch (segment)
+        {
+        case SharedDataLayout::NAMES_SEGMENT:
+            LoadNames(loaders, layout, shared_memory_ptr);
+            break;
+        case SharedDataLayout::ORIGINAL_EDGES_SEGMENT:
+            LoadOriginalEdges(loaders, layout, shared_memory_ptr);
+            break;
+        case SharedDataLayout::GEOMETRIES_SEGMENT:
+            LoadGeometries(loaders, layout, shared_memory_ptr);
+            break;
+        case SharedDataLayout::R_TREE_SEGMENT:
+            LoadRTree(loaders, layout, shared_memory_ptr);
+            break;
+        default: // TIMESTAMP_SEGMENT
+        {
+            char *timestamp_ptr =
+                layout.GetBlockPtr<char, true>(shared_memory_ptr, SharedDataLayout::TIMESTAMP);
+            std::copy(timestamp.c_str(), timestamp.c_str() + timestamp.length(), timestamp_ptr);
+            break;
+        }
+        }
+    }
+
+  private:
+    void SetNameBlockSizes(SharedDataLayout &layout) const
+    {
+        SimpleLogger().Write() << "load names from: " << name_file.Path();
+        // number of entries in name index
+        const unsigned name_blocks = name_file.Read<unsigned>(0);
+        layout.SetBlockSize<unsigned>(SharedDataLayout::NAME_OFFSETS, name_blocks);
+        layout.SetBlockSize<typename RangeTable<16, true>::BlockT>(SharedDataLayout::NAME_BLOCKS,
+                                                                   name_blocks);
+        SimpleLogger().Write() << "name offsets size: " << name_blocks;
+        BOOST_ASSERT_MSG(0 != name_blocks, "name file broken");
+
+        const unsigned number_of_chars = name_file.Read<unsigned>(sizeof(unsigned));
+        layout.SetBlockSize<char>(SharedDataLayout::NAME_CHAR_LIST, number_of_chars);
+    }
+
+    void SetOriginalEdgeBlockSizes(SharedDataLayout &layout) const
+    {
+        // Loading information for original edges
+        const unsigned number_of_original_edges = edges_file.Read<unsigned>(0);
+
+        // note: settings this all to the same size is correct, we extract them from the same struct
+        layout.SetBlockSize<NodeID>(SharedDataLayout::VIA_NODE_LIST, number_of_original_edges);
+        layout.SetBlockSize<unsigned>(SharedDataLayout::NAME_ID_LIST, number_of_original_edges);
+        layout.SetBlockSize<TravelMode>(SharedDataLayout::TRAVEL_MODE, number_of_original_edges);
+        layout.SetBlockSize<TurnInstruction>(SharedDataLayout::TURN_INSTRUCTION,
+                                             number_of_original_edges);
+        // note: there are 32 geometry indicators in one unsigned block
+        layout.SetBlockSize<unsigned>(SharedDataLayout::GEOMETRIES_INDICATORS,
+                                      number_of_original_edges);
+    }
+
+    void SetRTreeBlockSizes(SharedDataLayout &layout) const
+    {
+        layout.SetBlockSize<char>(SharedDataLayout::FILE_INDEX_PATH, file_index_path.length() + 1);
+
+        // load rsearch tree size
+        const uint32_t tree_size = tree_node_file.Read<uint32_t>(0);
+        layout.SetBlockSize<RTreeNode>(SharedDataLayout::R_SEARCH_TREE, tree_size);
+
+        // load coordinate size
+        const unsigned coordinate_list_size = nodes_file.Read<unsigned>(0);
+        layout.SetBlockSize<FixedPointCoordinate>(SharedDataLayout::COORDINATE_LIST,
+                                                  coordinate_list_size);
+    }
+
+    void SetGeometryBlockSizes(SharedDataLayout &layout) const
+    {
+        // load geometries sizes, the list holds the encoded node ids
+        const std::uint64_t number_of_geometries_indices = geometry_file.Read<std::uint64_t>(0);
+        layout.SetBlockSize<std::uint64_t>(SharedDataLayout::GEOMETRIES_INDEX,
+                                           number_of_geometries_indices);
+        const std::uint64_t number_of_geometry_bytes =
+            geometry_file.Read<std::uint64_t>(GeometryListOffset());
+        layout.SetBlockSize<unsigned char>(SharedDataLayout::GEOMETRIES_LIST,
+                                           number_of_geometry_bytes);
+    }
+
+    void LoadNames(tbb::task_group &loaders,
+                   SharedDataLayout &layout,
+                   char *shared_memory_ptr) const
+    {
+        loaders.run([this, &layout, shared_memory_ptr]
+                    {
+            TIMER_START(load_names);
+            std::size_t offset = 2 * sizeof(unsigned);
+            const std::size_t offsets_size = layout.GetBlockSize(SharedDataLayout::NAME_OFFSETS);
+            copy_block(name_file, offset,
+                       layout.GetBlockPtr<char, true>(shared_memory_ptr,
+                                                      SharedDataLayout::NAME_OFFSETS),
+                       offsets_size);
+            offset += offsets_size;
+
+            const std::size_t blocks_size = layout.GetBlockSize(SharedDataLayout::NAME_BLOCKS);
+            copy_block(name_file, offset,
+                       layout.GetBlockPtr<char, true>(shared_memory_ptr,
+                                                      SharedDataLayout::NAME_BLOCKS),
+                       blocks_size);
+            offset += blocks_size;
+
+            const unsigned temp_length = name_file.Read<unsigned>(offset);
+            offset += sizeof(unsigned);
+            BOOST_ASSERT_MSG(temp_length == layout.GetBlockSize(SharedDataLayout::NAME_CHAR_LIST),
+                             "Name file corrupted!");
+            copy_block(name_file, offset,
+                       layout.GetBlockPtr<char, true>(shared_memory_ptr,
+                                                      SharedDataLayout::NAME_CHAR_LIST),
+                       temp_length);
+            TIMER_STOP(load_names);
+            report_throughput(name_file, TIMER_SEC(load_names));
+        });
+    }
+
+    void LoadOriginalEdges(tbb::task_group &loaders,
+                           SharedDataLayout &layout,
+                           char *shared_memory_ptr) const
+    {
+        loaders.run([this, &layout, shared_memory_ptr]
+                    {
+            TIMER_START(load_edges);
+            NodeID *via_node_ptr = layout.GetBlockPtr<NodeID, true>(
+                shared_memory_ptr, SharedDataLayout::VIA_NODE_LIST);
+            unsigned *name_id_ptr = layout.GetBlockPtr<unsigned, true>(
+                shared_memory_ptr, SharedDataLayout::NAME_ID_LIST);
+            TravelMode *travel_mode_ptr = layout.GetBlockPtr<TravelMode, true>(
+                shared_memory_ptr, SharedDataLayout::TRAVEL_MODE);
+            TurnInstruction *turn_instructions_ptr = layout.GetBlockPtr<TurnInstruction, true>(
+                shared_memory_ptr, SharedDataLayout::TURN_INSTRUCTION);
+            unsigned *geometries_indicator_ptr = layout.GetBlockPtr<unsigned, true>(
+                shared_memory_ptr, SharedDataLayout::GEOMETRIES_INDICATORS);
+
+            const unsigned number_of_original_edges =
+                static_cast<unsigned>(layout.num_entries[SharedDataLayout::VIA_NODE_LIST]);
+            const OriginalEdgeData *original_edges = reinterpret_cast<const OriginalEdgeData *>(
+                edges_file.Data(sizeof(unsigned),
+                                number_of_original_edges * sizeof(OriginalEdgeData)));
+
+            // one task owns all 32 edges of an indicator bucket
+            const unsigned number_of_buckets = (number_of_original_edges + 31) / 32;
+            tbb::parallel_for(tbb::blocked_range<unsigned>(0, number_of_buckets),
+                              [&](const tbb::blocked_range<unsigned> &range)
+                              {
+                for (unsigned bucket = range.begin(); bucket != range.end(); ++bucket)
+                {
+                    unsigned indicators = 0;
+                    const unsigned bucket_end =
+                        std::min(number_of_original_edges, (bucket + 1) * 32);
+                    for (unsigned i = bucket * 32; i < bucket_end; ++i)
+                    {
+                        const OriginalEdgeData &current_edge_data = original_edges[i];
+                        via_node_ptr[i] = current_edge_data.via_node;
+                        name_id_ptr[i] = current_edge_data.name_id;
+                        travel_mode_ptr[i] = current_edge_data.travel_mode;
+                        turn_instructions_ptr[i] = current_edge_data.turn_instruction;
+                        if (current_edge_data.compressed_geometry)
+                        {
+                            indicators |= (1u << (i % 32));
+                        }
+                    }
+                    geometries_indicator_ptr[bucket] = indicators;
+                }
+            });
+            TIMER_STOP(load_edges);
+            report_throughput(edges_file, TIMER_SEC(load_edges));
+        });
+    }
+
+    void LoadGeometries(tbb::task_group &loaders,
+                        SharedDataLayout &layout,
+                        char *shared_memory_ptr) const
+    {
+        loaders.run([this, &layout, shared_memory_ptr]
+                    {
+            TIMER_START(load_geometries);
+            copy_block(geometry_file, sizeof(std::uint64_t),
+                       layout.GetBlockPtr<char, true>(shared_memory_ptr,
+                                                      SharedDataLayout::GEOMETRIES_INDEX),
+                       layout.GetBlockSize(SharedDataLayout::GEOMETRIES_INDEX));
+            copy_block(geometry_file, GeometryListOffset() + sizeof(std::uint64_t),
+                       layout.GetBlockPtr<char, true>(shared_memory_ptr,
+                                                      SharedDataLayout::GEOMETRIES_LIST),
+                       layout.GetBlockSize(SharedDataLayout::GEOMETRIES_LIST));
+            TIMER_STOP(load_geometries);
+            report_throughput(geometry_file, TIMER_SEC(load_geometries));
+        });
+    }
+
+    void LoadRTree(tbb::task_group &loaders,
+                   SharedDataLayout &layout,
+                   char *shared_memory_ptr) const
+    {
+        // ram index file name
+        char *file_index_path_ptr =
+            layout.GetBlockPtr<char, true>(shared_memory_ptr, SharedDataLayout::FILE_INDEX_PATH);
+        // make sure we have 0 ending
+        std::fill(file_index_path_ptr,
+                  file_index_path_ptr + layout.GetBlockSize(SharedDataLayout::FILE_INDEX_PATH),
+                  0);
+        std::copy(file_index_path.begin(), file_index_path.end(), file_index_path_ptr);
+
+        // Loading list of coordinates
+        loaders.run([this, &layout, shared_memory_ptr]
+                    {
+            TIMER_START(load_nodes);
+            FixedPointCoordinate *coordinates_ptr = layout.GetBlockPtr<FixedPointCoordinate, true>(
+                shared_memory_ptr, SharedDataLayout::COORDINATE_LIST);
+            const unsigned coordinate_list_size =
+                static_cast<unsigned>(layout.num_entries[SharedDataLayout::COORDINATE_LIST]);
+            const QueryNode *nodes = reinterpret_cast<const QueryNode *>(
+                nodes_file.Data(sizeof(unsigned), coordinate_list_size * sizeof(QueryNode)));
+            tbb::parallel_for(tbb::blocked_range<unsigned>(0, coordinate_list_size),
+                              [&](const tbb::blocked_range<unsigned> &range)
+                              {
+                for (unsigned i = range.begin(); i != range.end(); ++i)
+                {
+                    coordinates_ptr[i] = FixedPointCoordinate(nodes[i].lat, nodes[i].lon);
+                }
+            });
+            TIMER_STOP(load_nodes);
+            report_throughput(nodes_file, TIMER_SEC(load_nodes));
+        });
+
+        // store search tree portion of rtree
+        loaders.run([this, &layout, shared_memory_ptr]
+                    {
+            TIMER_START(load_rtree);
+            copy_block(tree_node_file, sizeof(uint32_t),
+                       layout.GetBlockPtr<char, true>(shared_memory_ptr,
+                                                      SharedDataLayout::R_SEARCH_TREE),
+                       layout.GetBlockSize(SharedDataLayout::R_SEARCH_TREE));
+            TIMER_STOP(load_rtree);
+            report_throughput(tree_node_file, TIMER_SEC(load_rtree));
+        });
+    }
+
+    std::size_t GeometryListOffset() const
+    {
+        return sizeof(std::uint64_t) +
+               geometry_file.Read<std::uint64_t>(0) * sizeof(std::uint64_t);
+    }
+
+    InputFile name_file;
+    InputFile edges_file;
+    InputFile geometry_file;
+    InputFile nodes_file;
+    InputFile tree_node_file;
+    std::string file_index_path;
+    std::string timestamp;
+};
+
+#endif // DATASTORE_LOADER_HPP
@@ -400,11 +400,14 @@ unsigned readEdgeExpandedGraph(const boost::filesystem::path &expanded_graph
 	return number_of_edge_based_nodes;
 }
 
+// node_id_map, if given, receives the hsgr id of every edge-based node. It stays empty if the
+// ids are the same.
 template <typename NodeT, typename EdgeT>
 unsigned readHSGRFromStream(const boost::filesystem::path &hsgr_file,
 							std::vector<NodeT> &node_list,
 							std::vector<EdgeT> &edge_list,
-							unsigned *check_sum)
+							unsigned *check_sum,
+							std::vector<NodeID> *node_id_map = nullptr)
 {
 	if (!boost::filesystem::exists(hsgr_file))
 	{
@@ -444,6 +447,16 @@ unsigned readHSGRFromStream(const boost::filesystem::path &hsgr_file,
 	{
 		hsgr_input_stream.read((char *)&(edge_list[0]), number_of_edges * sizeof(EdgeT));
 	}
+	if (nullptr != node_id_map)
+	{
+		unsigned node_id_map_size = 0;
+		hsgr_input_stream.read((char *)&node_id_map_size, sizeof(unsigned));
+		node_id_map->resize(hsgr_input_stream ? node_id_map_size : 0);
+		if (!node_id_map->empty())
+		{
+			hsgr_input_stream.read((char *)&((*node_id_map)[0]), node_id_map_size * sizeof(NodeID));
+		}
+	}
 	hsgr_input_stream.close();
 
 	return number_of_nodes;
@@ -28,6 +28,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef RANGE_HPP_
 #define RANGE_HPP_
 
+#include <cstddef>
+#include <iterator>
+
 namespace osrm
 {
 namespace util
@@ -40,6 +43,13 @@ template <typename Iterator> class Range
     Iterator begin() const { return begin_; }
     Iterator end() const { return end_; }
 
+    // only for random access iterators
+    std::size_t size() const { return end_ - begin_; }
+    typename std::iterator_traits<Iterator>::reference operator[](const std::size_t index) const
+    {
+        return begin_[index];
+    }
+
   private:
     Iterator begin_;
     Iterator end_;
@@ -0,0 +1,291 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../data_structures/query_edge.hpp"
+#include "../data_structures/search_engine_data.hpp"
+#include "../data_structures/split_static_graph.hpp"
+#include "../routing_algorithms/routing_base.hpp"
+#include "../Util/graph_loader.hpp"
+#include "../Util/timing_util.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Choosen by a fair W20 dice roll (this value is completely arbitrary)
+constexpr unsigned RANDOM_SEED = 13;
+constexpr unsigned NUM_QUERIES = 10000;
+// settled nodes of every plain Dijkstra search
+constexpr unsigned DIJKSTRA_SEARCH_SPACE = 100000;
+
+using EdgeData = QueryEdge::EdgeData;
+using BenchGraph = SplitStaticGraph<EdgeData>;
+using QueryHeap = SearchEngineData::QueryHeap;
+
+// the part of the data facade the routing steps use
+class BenchFacade
+{
+  public:
+    using EdgeData = ::EdgeData;
+
+    explicit BenchFacade(const BenchGraph &graph) : graph(graph) {}
+
+    unsigned GetNumberOfNodes() const { return graph.GetNumberOfNodes(); }
+
+    EdgeID BeginEdges(const NodeID n) const { return graph.BeginEdges(n); }
+
+    EdgeID EndEdges(const NodeID n) const { return graph.EndEdges(n); }
+
+    osrm::range<EdgeID> GetAdjacentEdgeRange(const NodeID n) const
+    {
+        return graph.GetAdjacentEdgeRange(n);
+    }
+
+    QueryEdgeHotData GetHotData(const EdgeID e) const { return graph.GetHotData(e); }
+
+  private:
+    const BenchGraph &graph;
+};
+
+using RoutingInterface = BasicRoutingInterface<BenchFacade>;
+
+// relaxes one edge at a time, as the routing step did before the edges were batched
+void UnbatchedRelaxOutgoingEdges(const BenchFacade &facade,
+                                 QueryHeap &heap,
+                                 const NodeID node,
+                                 const int distance,
+                                 const bool forward_direction)
+{
+    for (const auto edge : facade.GetAdjacentEdgeRange(node))
+    {
+        const QueryEdgeHotData data = facade.GetHotData(edge);
+        if (forward_direction ? data.forward : data.backward)
+        {
+            const NodeID to = data.target;
+            const int to_distance = distance + data.distance;
+            if (!heap.WasInserted(to))
+            {
+                heap.Insert(to, to_distance, node);
+            }
+            else if (to_distance < heap.GetKey(to))
+            {
+                heap.GetData(to).parent = node;
+                heap.DecreaseKey(to, to_distance);
+            }
+        }
+    }
+}
+
+void UnbatchedRoutingStep(const BenchFacade &facade,
+                          QueryHeap &forward_heap,
+                          QueryHeap &reverse_heap,
+                          NodeID *middle_node_id,
+                          int *upper_bound,
+                          const bool forward_direction)
+{
+    const NodeID node = forward_heap.DeleteMin();
+    const int distance = forward_heap.GetKey(node);
+    if (reverse_heap.WasInserted(node))
+    {
+        const int new_distance = reverse_heap.GetKey(node) + distance;
+        if (new_distance < *upper_bound && new_distance >= 0)
+        {
+            *middle_node_id = node;
+            *upper_bound = new_distance;
+        }
+    }
+    if (distance > *upper_bound)
+    {
+        forward_heap.DeleteAll();
+        return;
+    }
+    for (const auto edge : facade.GetAdjacentEdgeRange(node))
+    {
+        const QueryEdgeHotData data = facade.GetHotData(edge);
+        if ((!forward_direction) ? data.forward : data.backward)
+        {
+            const NodeID to = data.target;
+            if (forward_heap.WasInserted(to) && forward_heap.GetKey(to) + data.distance < distance)
+            {
+                return;
+            }
+        }
+    }
+    UnbatchedRelaxOutgoingEdges(facade, forward_heap, node, distance, forward_direction);
+}
+
+// bidirectional CH queries, returns the sum of their distances
+template <typename RoutingStepT>
+std::int64_t ShortestPaths(const BenchFacade &facade,
+                           const std::vector<std::pair<NodeID, NodeID>> &queries,
+                           RoutingStepT routing_step)
+{
+    QueryHeap forward_heap(facade.GetNumberOfNodes());
+    QueryHeap reverse_heap(facade.GetNumberOfNodes());
+    std::int64_t checksum = 0;
+    for (const auto &query : queries)
+    {
+        forward_heap.Clear();
+        reverse_heap.Clear();
+        forward_heap.Insert(query.first, 0, query.first);
+        reverse_heap.Insert(query.second, 0, query.second);
+        NodeID middle = SPECIAL_NODEID;
+        int upper_bound = std::numeric_limits<int>::max();
+        while (0 < (forward_heap.Size() + reverse_heap.Size()))
+        {
+            if (!forward_heap.Empty())
+            {
+                routing_step(forward_heap, reverse_heap, &middle, &upper_bound, true);
+            }
+            if (!reverse_heap.Empty())
+            {
+                routing_step(reverse_heap, forward_heap, &middle, &upper_bound, false);
+            }
+        }
+        if (SPECIAL_NODEID != middle)
+        {
+            checksum += upper_bound;
+        }
+    }
+    return checksum;
+}
+
+// plain Dijkstra searches, their heaps grow far beyond the caches
+template <typename RelaxT>
+std::int64_t SearchSpaces(const BenchFacade &facade,
+                          const std::vector<std::pair<NodeID, NodeID>> &queries,
+                          RelaxT relax)
+{
+    QueryHeap heap(facade.GetNumberOfNodes());
+    std::int64_t checksum = 0;
+    for (const auto &query : queries)
+    {
+        heap.Clear();
+        heap.Insert(query.first, 0, query.first);
+        for (unsigned settled = 0; settled < DIJKSTRA_SEARCH_SPACE && !heap.Empty(); ++settled)
+        {
+            const NodeID node = heap.DeleteMin();
+            const int distance = heap.GetKey(node);
+            checksum += distance;
+            relax(heap, node, distance);
+        }
+    }
+    return checksum;
+}
+
+void Report(const char *name, const double msec, const std::size_t num_queries, const std::int64_t checksum)
+{
+    std::cout << name << ": took " << msec << " msec for " << num_queries << " queries, "
+              << msec / num_queries << " msec/query (checksum " << checksum << ")."
+              << "\n";
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "./query-bench file.hsgr"
+                  << "\n";
+        return 1;
+    }
+
+    std::vector<BenchGraph::NodeArrayEntry> node_list;
+    std::vector<BenchGraph::UnpackedEdgeArrayEntry> edge_list;
+    unsigned check_sum = 0;
+    readHSGRFromStream(argv[1], node_list, edge_list, &check_sum);
+    const BenchGraph graph(node_list, edge_list);
+    BenchFacade facade(graph);
+    RoutingInterface routing_interface(&facade);
+
+    std::mt19937 mt_rand(RANDOM_SEED);
+    std::uniform_int_distribution<NodeID> node_udist(0, graph.GetNumberOfNodes() - 1);
+    std::vector<std::pair<NodeID, NodeID>> queries;
+    for (unsigned i = 0; i < NUM_QUERIES; ++i)
+    {
+        queries.emplace_back(node_udist(mt_rand), node_udist(mt_rand));
+    }
+
+    std::cout << "#### Bidirectional CH queries"
+              << "\n";
+    {
+        TIMER_START(unbatched);
+        const std::int64_t checksum = ShortestPaths(
+            facade, queries, [&facade](QueryHeap &forward_heap, QueryHeap &reverse_heap,
+                                       NodeID *middle, int *upper_bound, const bool forward)
+            {
+                UnbatchedRoutingStep(facade, forward_heap, reverse_heap, middle, upper_bound,
+                                     forward);
+            });
+        TIMER_STOP(unbatched);
+        Report("one edge at a time", TIMER_MSEC(unbatched), queries.size(), checksum);
+    }
+    {
+        TIMER_START(batched);
+        const std::int64_t checksum = ShortestPaths(
+            facade, queries, [&routing_interface](QueryHeap &forward_heap, QueryHeap &reverse_heap,
+                                                  NodeID *middle, int *upper_bound,
+                                                  const bool forward)
+            {
+                routing_interface.RoutingStep(forward_heap, reverse_heap, middle, upper_bound, 0,
+                                              forward);
+            });
+        TIMER_STOP(batched);
+        Report("batched with prefetching", TIMER_MSEC(batched), queries.size(), checksum);
+    }
+
+    std::cout << "#### Dijkstra searches of " << DIJKSTRA_SEARCH_SPACE << " nodes"
+              << "\n";
+    const std::vector<std::pair<NodeID, NodeID>> dijkstra_queries(queries.begin(),
+                                                                  queries.begin() + 100);
+    {
+        TIMER_START(unbatched);
+        const std::int64_t checksum = SearchSpaces(
+            facade, dijkstra_queries, [&facade](QueryHeap &heap, const NodeID node, const int distance)
+            {
+                UnbatchedRelaxOutgoingEdges(facade, heap, node, distance, true);
+            });
+        TIMER_STOP(unbatched);
+        Report("one edge at a time", TIMER_MSEC(unbatched), dijkstra_queries.size(), checksum);
+    }
+    {
+        TIMER_START(batched);
+        const std::int64_t checksum = SearchSpaces(
+            facade, dijkstra_queries,
+            [&routing_interface](QueryHeap &heap, const NodeID node, const int distance)
+            {
+                routing_interface.RelaxOutgoingEdges(heap, node, distance, true);
+            });
+        TIMER_STOP(batched);
+        Report("batched with prefetching", TIMER_MSEC(batched), dijkstra_queries.size(), checksum);
+    }
+
+    return 0;
+}
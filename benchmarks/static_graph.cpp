@@ -0,0 +1,210 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../data_structures/packed_static_graph.hpp"
+#include "../data_structures/query_edge.hpp"
+#include "../data_structures/split_static_graph.hpp"
+#include "../data_structures/static_graph.hpp"
+#include "../Util/graph_loader.hpp"
+#include "../Util/timing_util.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Choosen by a fair W20 dice roll (this value is completely arbitrary)
+constexpr unsigned RANDOM_SEED = 13;
+
+using EdgeData = QueryEdge::EdgeData;
+using BenchStaticGraph = StaticGraph<EdgeData>;
+using BenchSplitStaticGraph = SplitStaticGraph<EdgeData>;
+using BenchPackedStaticGraph = PackedStaticGraph<EdgeData>;
+
+template <typename GraphT> QueryEdgeHotData GetHotData(const GraphT &graph, const EdgeID edge)
+{
+    return graph.GetHotData(edge);
+}
+
+// the interleaved layout reads the whole entry
+QueryEdgeHotData GetHotData(const BenchStaticGraph &graph, const EdgeID edge)
+{
+    const EdgeData &data = graph.GetEdgeData(edge);
+    QueryEdgeHotData hot_data;
+    hot_data.target = graph.GetTarget(edge);
+    hot_data.distance = data.distance;
+    hot_data.forward = data.forward;
+    hot_data.backward = data.backward;
+    return hot_data;
+}
+
+// forward search from every source, like the upward half of a CH query
+template <typename GraphT>
+std::int64_t SearchSpaces(const GraphT &graph, const std::vector<NodeID> &sources)
+{
+    using QueueEntry = std::pair<int, NodeID>;
+    std::vector<int> distances(graph.GetNumberOfNodes(), std::numeric_limits<int>::max());
+    std::vector<NodeID> touched;
+    std::int64_t checksum = 0;
+    for (const NodeID source : sources)
+    {
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+        distances[source] = 0;
+        touched.push_back(source);
+        queue.emplace(0, source);
+        while (!queue.empty())
+        {
+            const QueueEntry current = queue.top();
+            queue.pop();
+            if (current.first > distances[current.second])
+            {
+                continue;
+            }
+            checksum += current.first;
+            for (const auto edge : graph.GetAdjacentEdgeRange(current.second))
+            {
+                const QueryEdgeHotData data = GetHotData(graph, edge);
+                if (!data.forward)
+                {
+                    continue;
+                }
+                const NodeID target = data.target;
+                const int distance = current.first + data.distance;
+                if (distance < distances[target])
+                {
+                    if (std::numeric_limits<int>::max() == distances[target])
+                    {
+                        touched.push_back(target);
+                    }
+                    distances[target] = distance;
+                    queue.emplace(distance, target);
+                }
+            }
+        }
+        for (const NodeID node : touched)
+        {
+            distances[node] = std::numeric_limits<int>::max();
+        }
+        touched.clear();
+    }
+    return checksum;
+}
+
+// reads every edge once in id order
+template <typename GraphT> std::int64_t Scan(const GraphT &graph)
+{
+    std::int64_t checksum = 0;
+    for (const auto node : osrm::irange(0u, graph.GetNumberOfNodes()))
+    {
+        for (const auto edge : graph.GetAdjacentEdgeRange(node))
+        {
+            checksum += graph.GetTarget(edge) + graph.GetEdgeData(edge).distance;
+        }
+    }
+    return checksum;
+}
+
+template <typename GraphT>
+void Benchmark(const char *name, const GraphT &graph, const std::vector<NodeID> &sources)
+{
+    std::cout << "#### " << name << "\n";
+
+    TIMER_START(scan);
+    const std::int64_t scan_checksum = Scan(graph);
+    TIMER_STOP(scan);
+    std::cout << "Took " << TIMER_MSEC(scan) << " msec to scan " << graph.GetNumberOfEdges()
+              << " edges (checksum " << scan_checksum << ")."
+              << "\n";
+
+    TIMER_START(search);
+    const std::int64_t search_checksum = SearchSpaces(graph, sources);
+    TIMER_STOP(search);
+    std::cout << "Took " << TIMER_MSEC(search) << " msec for " << sources.size()
+              << " searches (checksum " << search_checksum << ")."
+              << "\n";
+    std::cout << TIMER_MSEC(search) / ((double)sources.size()) << " msec/search."
+              << "\n";
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "./static-graph-bench file.hsgr"
+                  << "\n";
+        return 1;
+    }
+
+    std::vector<BenchStaticGraph::NodeArrayEntry> node_list;
+    std::vector<BenchStaticGraph::EdgeArrayEntry> edge_list;
+    unsigned check_sum = 0;
+    readHSGRFromStream(argv[1], node_list, edge_list, &check_sum);
+
+    std::vector<BenchSplitStaticGraph::NodeArrayEntry> split_node_list;
+    std::vector<BenchPackedStaticGraph::NodeArrayEntry> packed_node_list;
+    for (const auto &node : node_list)
+    {
+        split_node_list.emplace_back(BenchSplitStaticGraph::NodeArrayEntry{node.first_edge});
+        packed_node_list.emplace_back(BenchPackedStaticGraph::NodeArrayEntry{node.first_edge});
+    }
+    std::vector<BenchStaticGraph::EdgeArrayEntry> split_edge_list(edge_list);
+    std::vector<BenchStaticGraph::EdgeArrayEntry> packed_edge_list(edge_list);
+
+    const std::size_t static_graph_bytes =
+        node_list.size() * sizeof(BenchStaticGraph::NodeArrayEntry) +
+        edge_list.size() * sizeof(BenchStaticGraph::EdgeArrayEntry);
+    const BenchStaticGraph static_graph(node_list, edge_list);
+    const BenchSplitStaticGraph split_graph(split_node_list, split_edge_list);
+    const BenchPackedStaticGraph packed_graph(packed_node_list, packed_edge_list);
+
+    std::cout << "StaticGraph: " << static_graph_bytes << " bytes"
+              << "\n";
+    std::cout << "SplitStaticGraph: " << split_graph.GetMemoryUsage() << " bytes"
+              << "\n";
+    std::cout << "PackedStaticGraph: " << packed_graph.GetMemoryUsage() << " bytes ("
+              << 100. * packed_graph.GetMemoryUsage() / static_graph_bytes << "%)"
+              << "\n";
+
+    std::mt19937 mt_rand(RANDOM_SEED);
+    std::uniform_int_distribution<NodeID> node_udist(0, static_graph.GetNumberOfNodes() - 1);
+    std::vector<NodeID> sources;
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        sources.push_back(node_udist(mt_rand));
+    }
+
+    Benchmark("StaticGraph", static_graph, sources);
+    Benchmark("SplitStaticGraph", split_graph, sources);
+    Benchmark("PackedStaticGraph", packed_graph, sources);
+
+    return 0;
+}
@@ -0,0 +1,428 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "data_structures/query_edge.hpp"
+#include "data_structures/shared_memory_factory.hpp"
+#include "data_structures/static_graph.hpp"
+#include "DynamicServer/DataStructures/SharedDataType.h"
+#include "DynamicServer/DataStructures/SharedGeneration.h"
+#include "Util/BoostFileSystemFix.h"
+#include "Util/datastore_loader.hpp"
+#include "Util/git_sha.hpp"
+#include "Util/graph_loader.hpp"
+#include "Util/simple_logger.hpp"
+#include "Util/osrm_exception.hpp"
+#include "Util/timing_util.hpp"
+#include "typedefs.h"
+
+using EdgeData = QueryEdge::EdgeData;
+using GraphNode = StaticGraph<EdgeData>::NodeArrayEntry;
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_group.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+// delete a shared memory region. report warning if it could not be deleted
+void delete_region(const DynamicDataType region)
+{
+    if (SharedMemory::RegionExists(region) && !SharedMemory::Remove(region))
+    {
+        SimpleLogger().Write(logWARNING) << "could not delete shared memory region " << region;
+    }
+}
+
+// The edges of an .expanded file, sorted by source
+class ExpandedGraphFile
+{
+  public:
+    explicit ExpandedGraphFile(const boost::filesystem::path &path) : file(path)
+    {
+        check_sum = file.Read<unsigned>(0);
+        number_of_nodes = file.Read<unsigned>(sizeof(unsigned));
+        number_of_edges = file.Read<unsigned>(2 * sizeof(unsigned));
+        if (0 == number_of_nodes || 0 == number_of_edges)
+        {
+            throw osrm::exception(path.string() + " contains no graph");
+        }
+        edges = reinterpret_cast<const ExpandedEdge *>(
+            file.Data(3 * sizeof(unsigned), number_of_edges * sizeof(ExpandedEdge)));
+    }
+
+    const InputFile file;
+    unsigned check_sum;
+    unsigned number_of_nodes;
+    unsigned number_of_edges;
+    const ExpandedEdge *edges;
+};
+
+// first edge of every node plus a sentinel, found by binary search over the sources
+void load_graph_nodes(const ExpandedGraphFile &graph, GraphNode *graph_nodes)
+{
+    for (const auto edge : osrm::irange(1u, graph.number_of_edges))
+    {
+        if (graph.edges[edge - 1].source > graph.edges[edge].source)
+        {
+            throw osrm::exception(".expanded edges are not sorted by source");
+        }
+    }
+
+    tbb::parallel_for(tbb::blocked_range<unsigned>(0, graph.number_of_nodes + 1),
+                      [&](const tbb::blocked_range<unsigned> &range)
+                      {
+        for (unsigned node = range.begin(); node != range.end(); ++node)
+        {
+            const ExpandedEdge *first_edge = std::lower_bound(
+                graph.edges, graph.edges + graph.number_of_edges, node,
+                [](const ExpandedEdge &edge, const unsigned source)
+                {
+                    return edge.source < source;
+                });
+            graph_nodes[node].first_edge = static_cast<EdgeID>(first_edge - graph.edges);
+        }
+    });
+}
+
+void load_graph_targets(const ExpandedGraphFile &graph, NodeID *graph_targets)
+{
+    tbb::parallel_for(tbb::blocked_range<unsigned>(0, graph.number_of_edges),
+                      [&](const tbb::blocked_range<unsigned> &range)
+                      {
+        for (unsigned edge = range.begin(); edge != range.end(); ++edge)
+        {
+            BOOST_ASSERT(graph.edges[edge].target < graph.number_of_nodes);
+            graph_targets[edge] = graph.edges[edge].target;
+        }
+    });
+}
+
+// New weights must come from a graph with exactly the topology in shared memory.
+bool matches_topology(const ExpandedGraphFile &graph,
+                      const SharedDataLayout &layout,
+                      const GraphNode *graph_nodes,
+                      const NodeID *graph_targets)
+{
+    if (graph.number_of_nodes + 1 != layout.num_entries[SharedDataLayout::GRAPH_NODE_LIST] ||
+        graph.number_of_edges != layout.num_entries[SharedDataLayout::GRAPH_EDGE_LIST])
+    {
+        return false;
+    }
+
+    std::atomic<bool> matches(true);
+    tbb::parallel_for(tbb::blocked_range<unsigned>(0, graph.number_of_nodes),
+                      [&](const tbb::blocked_range<unsigned> &range)
+                      {
+        for (unsigned node = range.begin(); node != range.end() && matches.load(); ++node)
+        {
+            for (EdgeID edge = graph_nodes[node].first_edge;
+                 edge != graph_nodes[node + 1].first_edge; ++edge)
+            {
+                if (graph.edges[edge].source != node || graph.edges[edge].target != graph_targets[edge])
+                {
+                    matches.store(false);
+                    break;
+                }
+            }
+        }
+    });
+    return matches.load();
+}
+
+// Writes a weights region without publishing it. The region outlives this
+// process, so its SharedMemory object is never deleted.
+void load_weights(const ExpandedGraphFile &graph,
+                           const DynamicDataType region,
+                           const unsigned topology_checksum,
+                           const unsigned topology_counter)
+{
+    TIMER_START(load_weights);
+    const std::size_t weights_size =
+        sizeof(SharedWeightsHeader) + graph.number_of_edges * sizeof(EdgeData);
+    SharedMemory *weights_memory = SharedMemoryFactory::Get(region, weights_size);
+
+    SharedWeightsHeader *header = new (weights_memory->Ptr()) SharedWeightsHeader();
+    header->topology_checksum = topology_checksum;
+    header->topology_counter = topology_counter;
+    header->number_of_edges = graph.number_of_edges;
+
+    EdgeData *edge_data = reinterpret_cast<EdgeData *>(header + 1);
+    tbb::parallel_for(tbb::blocked_range<unsigned>(0, graph.number_of_edges),
+                      [&](const tbb::blocked_range<unsigned> &range)
+                      {
+        for (unsigned edge = range.begin(); edge != range.end(); ++edge)
+        {
+            const ExpandedEdge &expanded_edge = graph.edges[edge];
+            BOOST_ASSERT(0 < expanded_edge.distance);
+            edge_data[edge].distance = expanded_edge.distance;
+            edge_data[edge].id = expanded_edge.id;
+            edge_data[edge].shortcut = false;
+            edge_data[edge].forward = expanded_edge.forward;
+            edge_data[edge].backward = expanded_edge.backward;
+        }
+    });
+    TIMER_STOP(load_weights);
+    report_throughput(graph.file, TIMER_SEC(load_weights));
+}
+
+void wait_for_readers(std::atomic<int> &readers, const std::string &what)
+{
+    if (!DynamicGeneration::WaitForReaders(readers, std::chrono::seconds(60)))
+    {
+        SimpleLogger().Write(logWARNING) << "previous " << what
+                                         << " still pinned after 60 seconds, releasing it anyway";
+    }
+}
+
+// Publishes new weights for the topology that is already in shared memory.
+void publish_weights(DynamicDataTimestamp *data_timestamp_ptr,
+                     const boost::filesystem::path &weights_path)
+{
+    const unsigned generation = data_timestamp_ptr->generation.load();
+    if (0 == DynamicDataTimestamp::Counter(generation))
+    {
+        throw osrm::exception("no topology in shared memory, load the full dataset first");
+    }
+    const unsigned topology_index = DynamicDataTimestamp::TopologyIndex(generation);
+    const unsigned weights_index = DynamicDataTimestamp::WeightsIndex(generation);
+
+    std::unique_ptr<SharedMemory> layout_memory(
+        SharedMemoryFactory::Get(DynamicDataTimestamp::TopologyLayout(topology_index)));
+    SharedDataLayout *layout = static_cast<SharedDataLayout *>(layout_memory->Ptr());
+    std::unique_ptr<SharedMemory> data_memory(
+        SharedMemoryFactory::Get(DynamicDataTimestamp::TopologyData(topology_index)));
+    char *data_ptr = static_cast<char *>(data_memory->Ptr());
+    std::unique_ptr<SharedMemory> current_weights_memory(
+        SharedMemoryFactory::Get(DynamicDataTimestamp::Weights(weights_index)));
+    const SharedWeightsHeader *current_header =
+        static_cast<const SharedWeightsHeader *>(current_weights_memory->Ptr());
+
+    SimpleLogger().Write() << "load weights from: " << weights_path;
+    const ExpandedGraphFile graph(weights_path);
+    if (!matches_topology(graph,
+                          *layout,
+                          layout->GetBlockPtr<GraphNode>(data_ptr, SharedDataLayout::GRAPH_NODE_LIST),
+                          layout->GetBlockPtr<NodeID>(data_ptr, SharedDataLayout::GRAPH_EDGE_LIST)))
+    {
+        throw osrm::exception(weights_path.string() +
+                              " does not have the topology that is loaded into shared memory");
+    }
+
+    load_weights(graph, DynamicDataTimestamp::Weights(1 - weights_index),
+                 current_header->topology_checksum, current_header->topology_counter);
+
+    // new queries switch over right away, the running ones finish on the old weights
+    DynamicGeneration::Publish(data_timestamp_ptr, topology_index, 1 - weights_index);
+    wait_for_readers(data_timestamp_ptr->weights_readers[weights_index], "weights");
+    current_weights_memory.reset();
+    delete_region(DynamicDataTimestamp::Weights(weights_index));
+    SimpleLogger().Write() << "weights published";
+}
+
+// Publishes a new topology together with its weights.
+void publish_dataset(DynamicDataTimestamp *data_timestamp_ptr, const boost::filesystem::path &base)
+{
+    const std::string base_string = base.string();
+    const boost::filesystem::path expanded_path(base_string + ".expanded");
+    const boost::filesystem::path file_index_path_absolute =
+        boost::filesystem::portable_canonical(base_string + ".fileIndex");
+
+    const unsigned generation = data_timestamp_ptr->generation.load();
+    const unsigned counter = DynamicDataTimestamp::Counter(generation);
+    const unsigned topology_index =
+        0 == counter ? 0 : 1 - DynamicDataTimestamp::TopologyIndex(generation);
+    const unsigned weights_index =
+        0 == counter ? 0 : 1 - DynamicDataTimestamp::WeightsIndex(generation);
+
+    // Allocate a memory layout in shared memory, deallocate previous
+    SharedMemory *layout_memory = SharedMemoryFactory::Get(
+        DynamicDataTimestamp::TopologyLayout(topology_index), sizeof(SharedDataLayout));
+    SharedDataLayout *shared_layout_ptr = new (layout_memory->Ptr()) SharedDataLayout();
+
+    const OriginalDataFiles original_data(base_string + ".names", base_string + ".edges",
+                                          base_string + ".geometry", base_string + ".nodes",
+                                          base_string + ".ramIndex", base_string + ".timestamp",
+                                          file_index_path_absolute.string());
+    original_data.SetBlockSizes(*shared_layout_ptr);
+
+    SimpleLogger().Write() << "load graph from: " << expanded_path;
+    const ExpandedGraphFile graph(expanded_path);
+    shared_layout_ptr->SetBlockSize<unsigned>(SharedDataLayout::HSGR_CHECKSUM, 1);
+    shared_layout_ptr->SetBlockSize<GraphNode>(SharedDataLayout::GRAPH_NODE_LIST,
+                                               graph.number_of_nodes + 1);
+    shared_layout_ptr->SetBlockSize<NodeID>(SharedDataLayout::GRAPH_EDGE_LIST,
+                                            graph.number_of_edges);
+
+    // allocate shared memory block
+    SimpleLogger().Write() << "allocating shared memory of "
+                           << shared_layout_ptr->GetSizeOfLayout() << " bytes";
+    SharedMemory *shared_memory = SharedMemoryFactory::Get(
+        DynamicDataTimestamp::TopologyData(topology_index), shared_layout_ptr->GetSizeOfLayout());
+    char *shared_memory_ptr = static_cast<char *>(shared_memory->Ptr());
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    // only takes effect if transparent huge pages are enabled for shmem
+    if (0 != madvise(shared_memory_ptr, shared_layout_ptr->GetSizeOfLayout(), MADV_HUGEPAGE))
+    {
+        SimpleLogger().Write(logDEBUG) << "no huge pages for the data segment";
+    }
+#endif
+
+    *shared_layout_ptr->GetBlockPtr<unsigned, true>(shared_memory_ptr,
+                                                    SharedDataLayout::HSGR_CHECKSUM) =
+        graph.check_sum;
+
+    TIMER_START(load_all);
+    tbb::task_group loaders;
+    original_data.Load(loaders, *shared_layout_ptr, shared_memory_ptr);
+
+    // topology of the edge-based graph
+    loaders.run([&]
+                {
+        load_graph_nodes(graph, shared_layout_ptr->GetBlockPtr<GraphNode, true>(
+                                    shared_memory_ptr, SharedDataLayout::GRAPH_NODE_LIST));
+        load_graph_targets(graph, shared_layout_ptr->GetBlockPtr<NodeID, true>(
+                                      shared_memory_ptr, SharedDataLayout::GRAPH_EDGE_LIST));
+    });
+
+    loaders.run([&]
+                {
+        load_weights(graph, DynamicDataTimestamp::Weights(weights_index), graph.check_sum,
+                     counter + 1);
+    });
+
+    loaders.wait();
+    TIMER_STOP(load_all);
+    SimpleLogger().Write() << "loaded all files in " << TIMER_SEC(load_all) << "s";
+
+    // new queries switch over right away, the running ones finish on the old data
+    DynamicGeneration::Publish(data_timestamp_ptr, topology_index, weights_index);
+    BOOST_ASSERT(counter + 1 == DynamicDataTimestamp::Counter(data_timestamp_ptr->generation));
+    if (0 != counter)
+    {
+        wait_for_readers(data_timestamp_ptr->topology_readers[1 - topology_index], "topology");
+        wait_for_readers(data_timestamp_ptr->weights_readers[1 - weights_index], "weights");
+        delete_region(DynamicDataTimestamp::TopologyData(1 - topology_index));
+        delete_region(DynamicDataTimestamp::TopologyLayout(1 - topology_index));
+        delete_region(DynamicDataTimestamp::Weights(1 - weights_index));
+    }
+    SimpleLogger().Write() << "all data loaded";
+
+    shared_layout_ptr->PrintInformation();
+}
+
+int main(const int argc, const char *argv[])
+{
+    LogPolicy::GetInstance().Unmute();
+    try
+    {
+#ifdef __linux__
+        // try to disable swapping on Linux
+        const int lock_flags = MCL_CURRENT | MCL_FUTURE;
+        if (-1 == mlockall(lock_flags))
+        {
+            SimpleLogger().Write(logWARNING) << "Process " << argv[0] << " could not request RAM lock";
+        }
+#endif
+
+        boost::filesystem::path base_path, weights_path;
+
+        boost::program_options::options_description generic_options("Options");
+        generic_options.add_options()("version,v", "Show version")("help,h",
+                                                                 "Show this help message")(
+            "weights,w", boost::program_options::value<boost::filesystem::path>(&weights_path),
+            "Only publish the weights of this .expanded file for the loaded topology");
+
+        boost::program_options::options_description hidden_options("Hidden options");
+        hidden_options.add_options()(
+            "base,b", boost::program_options::value<boost::filesystem::path>(&base_path),
+            "base path to .osrm file");
+
+        boost::program_options::positional_options_description positional_options;
+        positional_options.add("base", 1);
+
+        boost::program_options::options_description cmdline_options;
+        cmdline_options.add(generic_options).add(hidden_options);
+
+        boost::program_options::options_description visible_options(
+            boost::filesystem::basename(argv[0]) + " [<options>] <base.osrm>");
+        visible_options.add(generic_options);
+
+        boost::program_options::variables_map option_variables;
+        boost::program_options::store(boost::program_options::command_line_parser(argc, argv)
+                                          .options(cmdline_options)
+                                          .positional(positional_options)
+                                          .run(),
+                                      option_variables);
+
+        if (option_variables.count("version"))
+        {
+            SimpleLogger().Write() << g_GIT_DESCRIPTION;
+            return 0;
+        }
+
+        if (option_variables.count("help") ||
+            (!option_variables.count("base") && !option_variables.count("weights")))
+        {
+            SimpleLogger().Write() << visible_options;
+            return 0;
+        }
+
+        boost::program_options::notify(option_variables);
+
+        SharedMemory *data_type_memory = SharedMemoryFactory::Get(
+            DYNAMIC_REGIONS, sizeof(DynamicDataTimestamp), true, false);
+        DynamicDataTimestamp *data_timestamp_ptr =
+            static_cast<DynamicDataTimestamp *>(data_type_memory->Ptr());
+
+        if (option_variables.count("weights"))
+        {
+            publish_weights(data_timestamp_ptr, weights_path);
+        }
+        else
+        {
+            publish_dataset(data_timestamp_ptr, base_path);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        SimpleLogger().Write(logWARNING) << "caught exception: " << e.what();
+        return 1;
+    }
+
+    return 0;
+}
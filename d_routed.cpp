@@ -23,7 +23,7 @@ int main(int argc, const char *argv[])
 
 		bool use_shared_memory = false, trial_run = false;
 		std::string ip_address;
-		int ip_port, requested_thread_num;
+		int ip_port, requested_thread_num, max_query_time;
 
 		ServerPaths server_paths;
 
@@ -33,6 +33,7 @@ int main(int argc, const char *argv[])
 																  ip_address,
 																  ip_port,
 																  requested_thread_num,
+																  max_query_time,
 																  use_shared_memory,
 																  trial_run);
 		if (init_result == INIT_OK_DO_NOT_START_ENGINE)
@@ -59,17 +60,20 @@ int main(int argc, const char *argv[])
 		SimpleLogger().Write(logDEBUG) << "Threads:\t" << requested_thread_num;
 		SimpleLogger().Write(logDEBUG) << "IP address:\t" << ip_address;
 		SimpleLogger().Write(logDEBUG) << "IP port:\t" << ip_port;
+		SimpleLogger().Write(logDEBUG) << "Query timeout:\t" << max_query_time << " ms";
 		int sig = 0;
 		sigset_t new_mask;
 		sigset_t old_mask;
 		sigfillset(&new_mask);
 		pthread_sigmask(SIG_BLOCK, &new_mask, &old_mask);
 
-		DRM drm_lib(server_paths);
+		DRM drm_lib(server_paths, use_shared_memory);
 		auto routing_server =
 				DynamicServer::CreateServer(ip_address, ip_port, requested_thread_num);
 
 		routing_server->GetRequestHandlerPtr().RegisterRoutingMachine(&drm_lib);
+		routing_server->GetRequestHandlerPtr().SetMaxQueryTime(static_cast<unsigned>(max_query_time));
+		routing_server->GetRequestHandlerPtr().EnableAdmissionControl(requested_thread_num);
 
 		if (trial_run)
 		{
@@ -38,6 +38,22 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vector>
 #include <cstring>
 
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+
+// hints that the cache line at address is read soon
+inline void PrefetchForRead(const void *address)
+{
+#if defined(__GNUC__)
+	__builtin_prefetch(address);
+#elif defined(_MSC_VER)
+	_mm_prefetch(static_cast<const char *>(address), _MM_HINT_T0);
+#else
+	(void)address;
+#endif
+}
+
 template <typename NodeID, typename Key> class ArrayStorage
 {
 public:
@@ -50,6 +66,11 @@ public:
 
 	Key &operator[](NodeID node) { return positions[node]; }
 
+	// every node has an entry
+	const Key *Find(const NodeID node) const { return &positions[node]; }
+
+	void Prefetch(const NodeID node) const { PrefetchForRead(&positions[node]); }
+
 	void Clear() {}
 
 private:
@@ -63,6 +84,16 @@ public:
 
 	Key &operator[](NodeID node) { return nodes[node]; }
 
+	// nullptr if the node was never stored
+	const Key *Find(const NodeID node) const
+	{
+		auto iter = nodes.find(node);
+		return iter == nodes.end() ? nullptr : &iter->second;
+	}
+
+	// the tree has no address to prefetch without walking it
+	void Prefetch(const NodeID) const {}
+
 	void Clear() { nodes.clear(); }
 
 private:
@@ -82,6 +113,24 @@ public:
 		return iter->second;
 	}
 
+	// nullptr if the node was never stored
+	const Key *Find(const NodeID node) const
+	{
+		auto iter = nodes.find(node);
+		return iter == nodes.end() ? nullptr : &iter->second;
+	}
+
+	// the bucket array is small and usually cached, the entry it points to is the miss
+	void Prefetch(const NodeID node) const
+	{
+		const auto bucket = nodes.bucket(node);
+		const auto entry = nodes.begin(bucket);
+		if (entry != nodes.end(bucket))
+		{
+			PrefetchForRead(&*entry);
+		}
+	}
+
 	void Clear() { nodes.clear(); }
 
 private:
@@ -155,6 +204,20 @@ public:
 		return inserted_nodes[index].key == 0;
 	}
 
+	// Prefetching the entry of a node takes two steps, the index entry has to be in cache
+	// before the heap entry it points to can be found. Issuing the first step for a batch of
+	// nodes before the second lets their misses overlap.
+	void PrefetchIndex(const NodeID node) const { node_index.Prefetch(node); }
+
+	void PrefetchData(const NodeID node) const
+	{
+		const auto *index = node_index.Find(node);
+		if (nullptr != index && static_cast<Key>(*index) < static_cast<Key>(inserted_nodes.size()))
+		{
+			PrefetchForRead(&inserted_nodes[static_cast<Key>(*index)]);
+		}
+	}
+
 	bool WasInserted(const NodeID node)
 	{
 		const Key index = node_index[node];
@@ -2,7 +2,7 @@
 #define DRM_SEARCH_ENGINE_HPP
 
 #include "search_engine_data.hpp"
-#include "../DynamicServer/DataStructures/InternalDataFacade.h"
+#include "../DynamicServer/DataStructures/BaseDataFacade.h"
 
 #include "../routing_algorithms/dijkstra.hpp"
 
@@ -11,13 +11,13 @@
 template <class EdgeDataT> class DRMSearchEngine
 {
 private:
-	InternalDataFacade<EdgeDataT> *facade;
+	BaseDataFacade<EdgeDataT> *facade;
 	SearchEngineData engine_working_data;
 
 public:
-	BasicDijkstraRouting<InternalDataFacade<EdgeDataT>> dijkstra_path;
+	BasicDijkstraRouting<BaseDataFacade<EdgeDataT>> dijkstra_path;
 
-	explicit DRMSearchEngine(InternalDataFacade<EdgeDataT> *facade)
+	explicit DRMSearchEngine(BaseDataFacade<EdgeDataT> *facade)
 		: facade(facade), dijkstra_path(facade, engine_working_data)
 	{
 		static_assert(!std::is_pointer<EdgeDataT>::value, "don't instantiate with ptr type");
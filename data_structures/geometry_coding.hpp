@@ -0,0 +1,86 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef GEOMETRY_CODING_HPP
+#define GEOMETRY_CODING_HPP
+
+#include "../typedefs.h"
+
+#include <cstdint>
+#include <vector>
+
+// The node ids of a compressed geometry are stored as the zig-zag coded
+// difference to the previous id of the geometry, the first one to 0, in
+// base-128 varints. The nodes along a way mostly have close ids, so an id
+// takes one or two bytes instead of four. Geometries are addressed by the
+// byte offset of their first id.
+struct GeometryCoding
+{
+    static void
+    Encode(const NodeID node_id, NodeID &previous_node_id, std::vector<unsigned char> &bytes)
+    {
+        const std::int64_t delta =
+            static_cast<std::int64_t>(node_id) - static_cast<std::int64_t>(previous_node_id);
+        std::uint64_t value = (static_cast<std::uint64_t>(delta) << 1) ^ (delta < 0 ? ~0ull : 0ull);
+        while (value >= 0x80)
+        {
+            bytes.push_back(static_cast<unsigned char>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<unsigned char>(value));
+        previous_node_id = node_id;
+    }
+
+    // decodes the ids in [begin, end) of bytes, which may be any indexable container
+    template <typename ByteContainer>
+    static void Decode(const ByteContainer &bytes,
+                       std::uint64_t begin,
+                       const std::uint64_t end,
+                       std::vector<NodeID> &node_ids)
+    {
+        node_ids.clear();
+        NodeID previous_node_id = 0;
+        while (begin < end)
+        {
+            std::uint64_t value = 0;
+            unsigned shift = 0;
+            unsigned char byte;
+            do
+            {
+                byte = bytes[begin++];
+                value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+            const std::int64_t delta =
+                static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+            previous_node_id = static_cast<NodeID>(previous_node_id + delta);
+            node_ids.push_back(previous_node_id);
+        }
+    }
+};
+
+#endif // GEOMETRY_CODING_HPP
@@ -44,6 +44,19 @@ template <typename KeyT, typename ValueT> class LRUCache
     std::list<CacheEntry> itemsInCache;
     std::unordered_map<KeyT, typename std::list<CacheEntry>::iterator> positionMap;
 
+    // an existing key keeps its entry, which is refreshed and moved to the front
+    bool Replace(const KeyT &key, const ValueT &value)
+    {
+        auto map_iter = positionMap.find(key);
+        if (map_iter == positionMap.end())
+        {
+            return false;
+        }
+        map_iter->second->value = value;
+        itemsInCache.splice(itemsInCache.begin(), itemsInCache, map_iter->second);
+        return true;
+    }
+
   public:
     explicit LRUCache(unsigned c) : capacity(c) {}
 
@@ -58,6 +71,10 @@ template <typename KeyT, typename ValueT> class LRUCache
 
     void Insert(const KeyT key, ValueT &value)
     {
+        if (Replace(key, value))
+        {
+            return;
+        }
         itemsInCache.push_front(CacheEntry(key, value));
         positionMap.insert(std::make_pair(key, itemsInCache.begin()));
         if (itemsInCache.size() > capacity)
@@ -69,6 +86,10 @@ template <typename KeyT, typename ValueT> class LRUCache
 
     void Insert(const KeyT key, ValueT value)
     {
+        if (Replace(key, value))
+        {
+            return;
+        }
         itemsInCache.push_front(CacheEntry(key, value));
         positionMap.insert(std::make_pair(key, itemsInCache.begin()));
         if (itemsInCache.size() > capacity)
@@ -82,12 +103,11 @@ template <typename KeyT, typename ValueT> class LRUCache
     {
         if (Holds(key))
         {
-            CacheEntry e = *(positionMap.find(key)->second);
-            result = e.value;
+            auto position = positionMap.find(key)->second;
+            result = position->value;
 
-            // move to front
-            itemsInCache.splice(positionMap.find(key)->second, itemsInCache, itemsInCache.begin());
-            positionMap.find(key)->second = itemsInCache.begin();
+            // move to front, splicing keeps the stored iterator valid
+            itemsInCache.splice(itemsInCache.begin(), itemsInCache, position);
             return true;
         }
         return false;
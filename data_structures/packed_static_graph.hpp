@@ -0,0 +1,414 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef PACKED_STATIC_GRAPH_HPP
+#define PACKED_STATIC_GRAPH_HPP
+
+#include "query_edge.hpp"
+#include "shared_memory_vector_wrapper.hpp"
+#include "static_graph.hpp"
+#include "../Util/integer_range.hpp"
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Drop-in replacement for SplitStaticGraph that keeps the edge arrays bit-packed.
+//
+// The edges stay addressable by their EdgeID, so the facades can keep handing out edge ids.
+// The entries of each array have the same width:
+//  - hot: the target relative to the smallest target of its block of kBlockSize edges, then
+//    distance, forward and backward,
+//  - cold: id and shortcut,
+// in as many bits as the largest value of the graph needs.
+// The hot words start with a header that holds the widths, followed by the block bases and
+// the entries. One zero word at the end of each array lets every read touch two words without
+// a branch.
+//
+// EdgeDataT needs the fields of QueryEdge::EdgeData.
+template <typename EdgeDataT, bool UseSharedMemory = false> class PackedStaticGraph
+{
+public:
+	using NodeIterator = NodeID;
+	using EdgeIterator = NodeID;
+	using EdgeData = EdgeDataT;
+	using EdgeRange = osrm::range<EdgeIterator>;
+	using InputEdge = typename StaticGraph<EdgeDataT>::InputEdge;
+	// layout of the edges in a .hsgr file
+	using UnpackedEdgeArrayEntry = typename StaticGraph<EdgeDataT>::EdgeArrayEntry;
+
+	static constexpr unsigned kBlockSize = 16;
+
+	struct NodeArrayEntry
+	{
+		// index of the first edge
+		EdgeIterator first_edge;
+	};
+
+	using HotEdgeArrayEntry = std::uint64_t;
+	using ColdEdgeArrayEntry = std::uint64_t;
+
+	// number of hot words for the edges, header and padding included
+	template <typename UnpackedEdgeIterator>
+	static std::size_t GetHotSize(UnpackedEdgeIterator first, UnpackedEdgeIterator last)
+	{
+		const Layout layout(first, last);
+		return layout.entries_word_offset + layout.number_of_edges * layout.hot_bits / 64 + 2;
+	}
+
+	// number of cold words for the edges, padding included
+	template <typename UnpackedEdgeIterator>
+	static std::size_t GetColdSize(UnpackedEdgeIterator first, UnpackedEdgeIterator last)
+	{
+		const Layout layout(first, last);
+		return layout.number_of_edges * layout.cold_bits / 64 + 2;
+	}
+
+	// packs the edges into GetHotSize(first, last) hot and GetColdSize(first, last) cold words
+	template <typename UnpackedEdgeIterator>
+	static void Store(UnpackedEdgeIterator first,
+					  UnpackedEdgeIterator last,
+					  HotEdgeArrayEntry *hot_words,
+					  ColdEdgeArrayEntry *cold_words)
+	{
+		const Layout layout(first, last);
+		std::fill(hot_words, hot_words + GetHotSize(first, last), 0);
+		std::fill(cold_words, cold_words + GetColdSize(first, last), 0);
+		hot_words[0] = layout.target_bits | (layout.id_bits << 8) | (layout.distance_bits << 16);
+		hot_words[1] = layout.number_of_edges;
+
+		// a group of kBlocksPerStoreGroup blocks starts on a word boundary in every array, so
+		// groups write disjoint words and are stored in parallel
+		const unsigned number_of_groups =
+			(layout.number_of_blocks + kBlocksPerStoreGroup - 1) / kBlocksPerStoreGroup;
+		tbb::parallel_for(tbb::blocked_range<unsigned>(0, number_of_groups, kStoreGrainSize),
+						  [first, hot_words, cold_words, &layout](
+							  const tbb::blocked_range<unsigned> &range)
+						  {
+			for (unsigned block = range.begin() * kBlocksPerStoreGroup;
+				 block < std::min(layout.number_of_blocks, range.end() * kBlocksPerStoreGroup);
+				 ++block)
+			{
+				const auto block_begin = first + block * kBlockSize;
+				const auto block_end = first + std::min(layout.number_of_edges, (block + 1) * kBlockSize);
+				const NodeID base = std::min_element(block_begin, block_end,
+													 [](const UnpackedEdgeArrayEntry &lhs,
+														const UnpackedEdgeArrayEntry &rhs)
+													 {
+					return lhs.target < rhs.target;
+				})->target;
+				WriteBits(hot_words, kBasesBitOffset + block * 32ull, 32, base);
+
+				for (auto edge = block_begin; edge != block_end; ++edge)
+				{
+					const std::uint64_t index = edge - first;
+					const std::uint64_t hot =
+						(edge->target - base) |
+						(static_cast<std::uint64_t>(edge->data.distance) << layout.target_bits) |
+						(static_cast<std::uint64_t>(edge->data.forward) << (layout.hot_bits - 2)) |
+						(static_cast<std::uint64_t>(edge->data.backward) << (layout.hot_bits - 1));
+					WriteBits(hot_words, layout.entries_word_offset * 64 + index * layout.hot_bits,
+							  layout.hot_bits, hot);
+					const std::uint64_t cold =
+						static_cast<std::uint64_t>(edge->data.id) |
+						(static_cast<std::uint64_t>(edge->data.shortcut) << layout.id_bits);
+					WriteBits(cold_words, index * layout.cold_bits, layout.cold_bits, cold);
+				}
+			}
+		});
+	}
+
+	EdgeRange GetAdjacentEdgeRange(const NodeID node) const
+	{
+		return osrm::irange(BeginEdges(node), EndEdges(node));
+	}
+
+	PackedStaticGraph(typename ShM<NodeArrayEntry, UseSharedMemory>::vector &nodes,
+					  typename ShM<HotEdgeArrayEntry, UseSharedMemory>::vector &hot_words,
+					  typename ShM<ColdEdgeArrayEntry, UseSharedMemory>::vector &cold_words)
+	{
+		number_of_nodes = static_cast<decltype(number_of_nodes)>(nodes.size() - 1);
+		node_array.swap(nodes);
+		hot_edge_words.swap(hot_words);
+		cold_edge_words.swap(cold_words);
+		ReadHeader();
+	}
+
+	// packs the edges as read from a .hsgr file, the input is flushed
+	PackedStaticGraph(std::vector<NodeArrayEntry> &nodes, std::vector<UnpackedEdgeArrayEntry> &edges)
+	{
+		number_of_nodes = static_cast<decltype(number_of_nodes)>(nodes.size() - 1);
+		node_array.swap(nodes);
+		std::vector<HotEdgeArrayEntry> hot_words(GetHotSize(edges.begin(), edges.end()));
+		std::vector<ColdEdgeArrayEntry> cold_words(GetColdSize(edges.begin(), edges.end()));
+		Store(edges.begin(), edges.end(), hot_words.data(), cold_words.data());
+		std::vector<UnpackedEdgeArrayEntry>().swap(edges);
+		hot_edge_words.swap(hot_words);
+		cold_edge_words.swap(cold_words);
+		ReadHeader();
+	}
+
+	unsigned GetNumberOfNodes() const { return number_of_nodes; }
+
+	unsigned GetNumberOfEdges() const { return number_of_edges; }
+
+	unsigned GetOutDegree(const NodeIterator n) const { return EndEdges(n) - BeginEdges(n); }
+
+	// bytes taken by the node and edge arrays
+	std::size_t GetMemoryUsage() const
+	{
+		return node_array.size() * sizeof(NodeArrayEntry) +
+			   hot_edge_words.size() * sizeof(HotEdgeArrayEntry) +
+			   cold_edge_words.size() * sizeof(ColdEdgeArrayEntry);
+	}
+
+	inline NodeIterator GetTarget(const EdgeIterator e) const
+	{
+		const NodeID base = static_cast<NodeID>(
+			ReadBits(hot_edge_words, kBasesBitOffset + (e / kBlockSize) * 32ull, 32));
+		return base + static_cast<NodeID>(
+						  ReadBits(hot_edge_words, entries_bit_offset + e * hot_bits, target_bits));
+	}
+
+	// returned by value, the packed bits have no QueryEdgeHotData to refer to
+	inline QueryEdgeHotData GetHotData(const EdgeIterator e) const
+	{
+		const std::uint64_t bits = ReadBits(hot_edge_words, entries_bit_offset + e * hot_bits, hot_bits);
+		const NodeID base = static_cast<NodeID>(
+			ReadBits(hot_edge_words, kBasesBitOffset + (e / kBlockSize) * 32ull, 32));
+		QueryEdgeHotData data;
+		data.target = base + static_cast<NodeID>(bits & target_mask);
+		data.distance = static_cast<int>((bits >> target_bits) & distance_mask);
+		data.forward = 0 != ((bits >> (hot_bits - 2)) & 1);
+		data.backward = 0 != ((bits >> (hot_bits - 1)) & 1);
+		return data;
+	}
+
+	// returned by value, the packed bits have no EdgeDataT to refer to
+	EdgeDataT GetEdgeData(const EdgeIterator e) const
+	{
+		const QueryEdgeHotData hot = GetHotData(e);
+		const std::uint64_t cold = ReadBits(cold_edge_words, e * cold_bits, cold_bits);
+		EdgeDataT data;
+		data.id = static_cast<NodeID>(cold & id_mask);
+		data.shortcut = 0 != ((cold >> id_bits) & 1);
+		data.distance = hot.distance;
+		data.forward = hot.forward;
+		data.backward = hot.backward;
+		return data;
+	}
+
+	EdgeIterator BeginEdges(const NodeIterator n) const
+	{
+		return EdgeIterator(node_array.at(n).first_edge);
+	}
+
+	EdgeIterator EndEdges(const NodeIterator n) const
+	{
+		return EdgeIterator(node_array.at(n + 1).first_edge);
+	}
+
+	// searches for a specific edge
+	EdgeIterator FindEdge(const NodeIterator from, const NodeIterator to) const
+	{
+		EdgeIterator smallest_edge = SPECIAL_EDGEID;
+		EdgeWeight smallest_weight = INVALID_EDGE_WEIGHT;
+		for (auto edge : GetAdjacentEdgeRange(from))
+		{
+			const QueryEdgeHotData data = GetHotData(edge);
+			if (data.target == to && data.distance < smallest_weight)
+			{
+				smallest_edge = edge;
+				smallest_weight = data.distance;
+			}
+		}
+		return smallest_edge;
+	}
+
+	EdgeIterator FindEdgeInEitherDirection(const NodeIterator from, const NodeIterator to) const
+	{
+		EdgeIterator tmp = FindEdge(from, to);
+		return (SPECIAL_NODEID != tmp ? tmp : FindEdge(to, from));
+	}
+
+	EdgeIterator
+	FindEdgeIndicateIfReverse(const NodeIterator from, const NodeIterator to, bool &result) const
+	{
+		EdgeIterator current_iterator = FindEdge(from, to);
+		if (SPECIAL_NODEID == current_iterator)
+		{
+			current_iterator = FindEdge(to, from);
+			if (SPECIAL_NODEID != current_iterator)
+			{
+				result = true;
+			}
+		}
+		return current_iterator;
+	}
+
+private:
+	// header words before the block bases
+	static constexpr std::uint64_t kBasesBitOffset = 2 * 64;
+	// 64 edges take a whole number of words for any width, and so do their 32 bit bases
+	static constexpr unsigned kBlocksPerStoreGroup = 64 / kBlockSize;
+	// groups per chunk, 16 MiB of input edges as datastore copies its blocks
+	static constexpr unsigned kStoreGrainSize =
+		16 * 1024 * 1024 / (kBlocksPerStoreGroup * kBlockSize * sizeof(UnpackedEdgeArrayEntry));
+
+	// widths and offsets for a range of unpacked edges
+	struct Layout
+	{
+		template <typename UnpackedEdgeIterator>
+		Layout(UnpackedEdgeIterator first, UnpackedEdgeIterator last)
+			: number_of_edges(static_cast<unsigned>(last - first)),
+			  number_of_blocks((number_of_edges + kBlockSize - 1) / kBlockSize)
+		{
+			NodeID max_target_delta = 0;
+			NodeID max_id = 0;
+			unsigned max_distance = 0;
+			for (const auto block : osrm::irange(0u, number_of_blocks))
+			{
+				const auto block_begin = first + block * kBlockSize;
+				const auto block_end = first + std::min(number_of_edges, (block + 1) * kBlockSize);
+				NodeID min_target = std::numeric_limits<NodeID>::max();
+				NodeID max_target = 0;
+				for (auto edge = block_begin; edge != block_end; ++edge)
+				{
+					BOOST_ASSERT(edge->data.distance >= 0);
+					min_target = std::min(min_target, static_cast<NodeID>(edge->target));
+					max_target = std::max(max_target, static_cast<NodeID>(edge->target));
+					max_id = std::max(max_id, static_cast<NodeID>(edge->data.id));
+					max_distance = std::max(max_distance, static_cast<unsigned>(edge->data.distance));
+				}
+				max_target_delta = std::max(max_target_delta, max_target - min_target);
+			}
+			target_bits = BitsFor(max_target_delta);
+			id_bits = BitsFor(max_id);
+			distance_bits = BitsFor(max_distance);
+			hot_bits = target_bits + distance_bits + 2;
+			cold_bits = id_bits + 1;
+			entries_word_offset = (kBasesBitOffset + number_of_blocks * 32ull + 63) / 64;
+		}
+
+		unsigned number_of_edges;
+		unsigned number_of_blocks;
+		std::uint64_t target_bits;
+		std::uint64_t id_bits;
+		std::uint64_t distance_bits;
+		std::uint64_t hot_bits;
+		std::uint64_t cold_bits;
+		std::uint64_t entries_word_offset;
+	};
+
+	static std::uint64_t BitsFor(std::uint64_t value)
+	{
+		std::uint64_t bits = 1;
+		while (0 != (value >>= 1))
+		{
+			++bits;
+		}
+		return bits;
+	}
+
+	static std::uint64_t MaskFor(const std::uint64_t bits)
+	{
+		return std::numeric_limits<std::uint64_t>::max() >> (64 - bits);
+	}
+
+	static void WriteBits(std::uint64_t *words,
+						  const std::uint64_t position,
+						  const std::uint64_t bits,
+						  const std::uint64_t value)
+	{
+		BOOST_ASSERT(0 == (value & ~MaskFor(bits)));
+		const std::uint64_t word = position / 64;
+		const std::uint64_t shift = position % 64;
+		words[word] |= value << shift;
+		if (shift + bits > 64)
+		{
+			words[word + 1] |= value >> (64 - shift);
+		}
+	}
+
+	// reads up to 64 bits, the trailing zero word keeps the second read in bounds
+	template <typename WordVector>
+	static inline std::uint64_t
+	ReadBits(const WordVector &words, const std::uint64_t position, const std::uint64_t bits)
+	{
+		const std::uint64_t word = position / 64;
+		const std::uint64_t shift = position % 64;
+		const std::uint64_t low = words[word] >> shift;
+		// shifting in two steps leaves nothing of the second word if shift is 0
+		const std::uint64_t high = (words[word + 1] << 1) << (63 - shift);
+		return (low | high) & MaskFor(bits);
+	}
+
+	void ReadHeader()
+	{
+		BOOST_ASSERT(hot_edge_words.size() >= 4);
+		const std::uint64_t header = hot_edge_words[0];
+		number_of_edges = static_cast<EdgeIterator>(hot_edge_words[1]);
+		target_bits = header & 0xFF;
+		id_bits = (header >> 8) & 0xFF;
+		distance_bits = (header >> 16) & 0xFF;
+		hot_bits = target_bits + distance_bits + 2;
+		cold_bits = id_bits + 1;
+		BOOST_ASSERT(hot_bits <= 64);
+		target_mask = MaskFor(target_bits);
+		id_mask = MaskFor(id_bits);
+		distance_mask = MaskFor(distance_bits);
+		const unsigned number_of_blocks = (number_of_edges + kBlockSize - 1) / kBlockSize;
+		entries_bit_offset = (kBasesBitOffset + number_of_blocks * 32ull + 63) / 64 * 64;
+	}
+
+	NodeIterator number_of_nodes;
+	EdgeIterator number_of_edges;
+
+	std::uint64_t target_bits;
+	std::uint64_t id_bits;
+	std::uint64_t distance_bits;
+	std::uint64_t hot_bits;
+	std::uint64_t cold_bits;
+	std::uint64_t target_mask;
+	std::uint64_t id_mask;
+	std::uint64_t distance_mask;
+	std::uint64_t entries_bit_offset;
+
+	typename ShM<NodeArrayEntry, UseSharedMemory>::vector node_array;
+	typename ShM<HotEdgeArrayEntry, UseSharedMemory>::vector hot_edge_words;
+	typename ShM<ColdEdgeArrayEntry, UseSharedMemory>::vector cold_edge_words;
+};
+
+#endif // PACKED_STATIC_GRAPH_HPP
@@ -0,0 +1,85 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef QUERY_DEADLINE_HPP
+#define QUERY_DEADLINE_HPP
+
+#include <chrono>
+
+// Wall clock budget of a single query. Search loops call Expired() once per
+// settled node, but the clock is only read every CheckInterval calls. Once
+// expired, the deadline stays expired.
+class QueryDeadline
+{
+  public:
+    static constexpr unsigned CheckInterval = 1024;
+
+    // no limit at all
+    QueryDeadline() : unlimited(true), expired(false), countdown(CheckInterval) {}
+
+    // a budget of zero means no limit
+    explicit QueryDeadline(const std::chrono::milliseconds budget)
+        : deadline(std::chrono::steady_clock::now() + budget), unlimited(0 == budget.count()),
+          expired(false), countdown(CheckInterval)
+    {
+    }
+
+    inline bool Expired()
+    {
+        if (unlimited || expired)
+        {
+            return expired;
+        }
+        if (0 != --countdown)
+        {
+            return false;
+        }
+        countdown = CheckInterval;
+        expired = (std::chrono::steady_clock::now() >= deadline);
+        return expired;
+    }
+
+    // reads the clock on every call, for loops with few but expensive iterations
+    inline bool ExpiredNow()
+    {
+        if (!unlimited && !expired)
+        {
+            expired = (std::chrono::steady_clock::now() >= deadline);
+        }
+        return expired;
+    }
+
+    bool HasExpired() const { return expired; }
+
+  private:
+    std::chrono::steady_clock::time_point deadline;
+    bool unlimited;
+    bool expired;
+    unsigned countdown;
+};
+
+#endif // QUERY_DEADLINE_HPP
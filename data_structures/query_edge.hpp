@@ -78,6 +78,22 @@ struct QueryEdge
 	}
 };
 
+// QueryEdge::EdgeData split by how it is used. A search reads the hot part of every edge it
+// relaxes or stalls on, the cold part is only needed to unpack the edges of the path.
+struct QueryEdgeHotData
+{
+	NodeID target;
+	int distance : 30;
+	bool forward : 1;
+	bool backward : 1;
+};
+
+struct QueryEdgeColdData
+{
+	NodeID id : 31;
+	bool shortcut : 1;
+};
+
 struct QueryEdgeWithArea
 {
 	NodeID source;
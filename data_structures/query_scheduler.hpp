@@ -0,0 +1,289 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef QUERY_SCHEDULER_HPP
+#define QUERY_SCHEDULER_HPP
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+enum class QueryClass : unsigned
+{
+    Interactive = 0,
+    Bulk = 1
+};
+
+// Admission control in front of the routing machine. Every query needs one of
+// a fixed number of execution slots. Queries that find no free slot wait in a
+// bounded FIFO of their class and are rejected right away once it is full.
+// Freed slots are handed to the waiting classes by smooth weighted round robin,
+// so a burst of table queries cannot starve viaroute and nearest calls.
+// Requests that wait for an identical one to finish need no slot, but they
+// park a thread just the same and count as interactive waiters.
+class QueryScheduler
+{
+  public:
+    static constexpr unsigned NumberOfClasses = 2;
+    // routes with more waypoints than this cost about as much as a table
+    static constexpr std::size_t BulkCoordinateThreshold = 16;
+
+    struct ClassLimits
+    {
+        unsigned max_running;
+        unsigned max_waiting;
+        unsigned weight;
+    };
+
+    // Holds a slot for its lifetime. Without a scheduler every query is admitted.
+    class Slot
+    {
+      public:
+        Slot(QueryScheduler *scheduler, const QueryClass query_class)
+            : scheduler(scheduler), query_class(query_class),
+              admitted(nullptr == scheduler || scheduler->Acquire(query_class))
+        {
+        }
+        Slot(const Slot &) = delete;
+        Slot &operator=(const Slot &) = delete;
+        ~Slot()
+        {
+            if (nullptr != scheduler && admitted)
+            {
+                scheduler->Release(query_class);
+            }
+        }
+
+        bool Admitted() const { return admitted; }
+
+      private:
+        QueryScheduler *scheduler;
+        QueryClass query_class;
+        bool admitted;
+    };
+
+    // Holds a place among the interactive waiters while a request waits for
+    // the result of another one.
+    class Follower
+    {
+      public:
+        explicit Follower(QueryScheduler *scheduler)
+            : scheduler(scheduler), admitted(nullptr == scheduler || scheduler->Follow())
+        {
+        }
+        Follower(const Follower &) = delete;
+        Follower &operator=(const Follower &) = delete;
+        ~Follower()
+        {
+            if (nullptr != scheduler && admitted)
+            {
+                scheduler->Unfollow();
+            }
+        }
+
+        bool Admitted() const { return admitted; }
+
+      private:
+        QueryScheduler *scheduler;
+        bool admitted;
+    };
+
+    QueryScheduler(const unsigned slots, const ClassLimits &interactive, const ClassLimits &bulk)
+        : slots(std::max(1u, slots)), running(0)
+    {
+        queues[static_cast<unsigned>(QueryClass::Interactive)].limits = interactive;
+        queues[static_cast<unsigned>(QueryClass::Bulk)].limits = bulk;
+    }
+
+    QueryScheduler(const QueryScheduler &) = delete;
+
+    // Every running or waiting query blocks a server thread. One thread is kept
+    // out of both, so there is always one left to accept and reject requests.
+    // The bulk class may never hold more than a quarter of the threads.
+    static std::unique_ptr<QueryScheduler> ForThreads(const unsigned thread_count)
+    {
+        const unsigned threads = std::max(1u, thread_count);
+        const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        const unsigned slots = std::min(threads > 1 ? threads - 1 : 1, cores);
+        const unsigned queue_capacity = threads > slots ? threads - slots - 1 : 0;
+        const unsigned bulk_waiting = std::min(std::max(1u, threads / 4), queue_capacity / 2);
+        const ClassLimits interactive{slots, queue_capacity - bulk_waiting, 4};
+        const ClassLimits bulk{std::max(1u, std::min(slots, threads / 4)), bulk_waiting, 1};
+        return std::unique_ptr<QueryScheduler>(new QueryScheduler(slots, interactive, bulk));
+    }
+
+    unsigned Slots() const { return slots; }
+
+    ClassLimits Limits(const QueryClass query_class) const
+    {
+        return queues[static_cast<unsigned>(query_class)].limits;
+    }
+
+    static QueryClass Classify(const std::string &service, const std::size_t number_of_coordinates)
+    {
+        if ("table" == service || number_of_coordinates > BulkCoordinateThreshold)
+        {
+            return QueryClass::Bulk;
+        }
+        return QueryClass::Interactive;
+    }
+
+    // Blocks until the query may run. Returns false if its queue is full.
+    bool Acquire(const QueryClass query_class)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ClassQueue &queue = queues[static_cast<unsigned>(query_class)];
+        if (0 == queue.waiting && running < slots && queue.running < queue.limits.max_running)
+        {
+            ++queue.next_ticket;
+            ++queue.granted;
+            ++queue.running;
+            ++running;
+            return true;
+        }
+        if (queue.waiting + queue.following >= queue.limits.max_waiting)
+        {
+            ++queue.rejected;
+            return false;
+        }
+        const std::uint64_t ticket = queue.next_ticket++;
+        ++queue.waiting;
+        queue.dispatched.wait(lock, [&queue, ticket]
+                              {
+                                  return ticket < queue.granted;
+                              });
+        return true;
+    }
+
+    void Release(const QueryClass query_class)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        --queues[static_cast<unsigned>(query_class)].running;
+        --running;
+        Dispatch();
+    }
+
+    // Returns false if the interactive waiters are at their limit.
+    bool Follow()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ClassQueue &queue = queues[static_cast<unsigned>(QueryClass::Interactive)];
+        if (queue.waiting + queue.following >= queue.limits.max_waiting)
+        {
+            ++queue.rejected;
+            return false;
+        }
+        ++queue.following;
+        return true;
+    }
+
+    void Unfollow()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        --queues[static_cast<unsigned>(QueryClass::Interactive)].following;
+    }
+
+    unsigned Waiting(const QueryClass query_class) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return queues[static_cast<unsigned>(query_class)].waiting;
+    }
+
+    std::uint64_t Rejected(const QueryClass query_class) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return queues[static_cast<unsigned>(query_class)].rejected;
+    }
+
+  private:
+    struct ClassQueue
+    {
+        ClassQueue()
+            : limits{0, 0, 1}, running(0), waiting(0), following(0), next_ticket(0), granted(0),
+              rejected(0), credit(0)
+        {
+        }
+
+        ClassLimits limits;
+        unsigned running;
+        unsigned waiting;
+        unsigned following;
+        // waiters are served in ticket order, every ticket below granted may run
+        std::uint64_t next_ticket;
+        std::uint64_t granted;
+        std::uint64_t rejected;
+        int credit;
+        std::condition_variable dispatched;
+    };
+
+    // expects the mutex to be held
+    void Dispatch()
+    {
+        while (running < slots)
+        {
+            int total_weight = 0;
+            ClassQueue *next = nullptr;
+            for (ClassQueue &queue : queues)
+            {
+                if (0 == queue.waiting || queue.running >= queue.limits.max_running)
+                {
+                    continue;
+                }
+                queue.credit += static_cast<int>(queue.limits.weight);
+                total_weight += static_cast<int>(queue.limits.weight);
+                if (nullptr == next || queue.credit > next->credit)
+                {
+                    next = &queue;
+                }
+            }
+            if (nullptr == next)
+            {
+                return;
+            }
+            next->credit -= total_weight;
+            --next->waiting;
+            ++next->granted;
+            ++next->running;
+            ++running;
+            next->dispatched.notify_all();
+        }
+    }
+
+    const unsigned slots;
+    unsigned running;
+    std::array<ClassQueue, NumberOfClasses> queues;
+    mutable std::mutex mutex;
+};
+
+#endif // QUERY_SCHEDULER_HPP
@@ -0,0 +1,154 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef REQUEST_COALESCER_HPP
+#define REQUEST_COALESCER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+// Lets identical requests that overlap in time share one computation. The
+// first caller for a key becomes the leader and computes the result, later
+// callers with the same key block until it is published and copy it. If the
+// leader gives up without publishing, e.g. because of an exception or because
+// its own time ran out, its followers get no result and compute their own. Followers wait no
+// longer than their own time limit, which a stuck leader cannot extend.
+template <typename ResultT> class RequestCoalescer
+{
+    using ResultPointer = std::shared_ptr<const ResultT>;
+
+  public:
+    class Flight
+    {
+      public:
+        Flight(Flight &&other)
+            : coalescer(other.coalescer), key(std::move(other.key)),
+              promise(std::move(other.promise)), result(std::move(other.result)),
+              leader(other.leader)
+        {
+            other.leader = false;
+        }
+        Flight(const Flight &) = delete;
+        ~Flight() { Finish(nullptr); }
+
+        bool IsLeader() const { return leader; }
+
+        // followers only, false if the leader is still busy after the timeout,
+        // a timeout of zero means no limit
+        bool WaitFor(const std::chrono::milliseconds timeout)
+        {
+            if (0 == timeout.count())
+            {
+                result.wait();
+                return true;
+            }
+            return std::future_status::ready == result.wait_for(timeout);
+        }
+
+        // followers only, nullptr if the leader did not publish
+        ResultPointer Wait() { return result.get(); }
+
+        // leader only, hands a copy of the result to everyone waiting
+        void Publish(const ResultT &value) { Finish(std::make_shared<const ResultT>(value)); }
+
+      private:
+        friend class RequestCoalescer;
+
+        Flight(RequestCoalescer *coalescer, const std::string &key)
+            : coalescer(coalescer), key(key), result(promise.get_future().share()), leader(true)
+        {
+        }
+
+        Flight(std::shared_future<ResultPointer> result)
+            : coalescer(nullptr), result(std::move(result)), leader(false)
+        {
+        }
+
+        void Finish(ResultPointer value)
+        {
+            if (!leader)
+            {
+                return;
+            }
+            leader = false;
+            // later requests for the key start a fresh computation
+            coalescer->Land(key);
+            promise.set_value(std::move(value));
+        }
+
+        RequestCoalescer *coalescer;
+        std::string key;
+        std::promise<ResultPointer> promise;
+        std::shared_future<ResultPointer> result;
+        bool leader;
+    };
+
+    RequestCoalescer() : led(0), coalesced(0) {}
+    RequestCoalescer(const RequestCoalescer &) = delete;
+
+    Flight Join(const std::string &key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto iter = in_flight.find(key);
+        if (iter != in_flight.end())
+        {
+            ++coalesced;
+            return Flight(iter->second);
+        }
+        ++led;
+        Flight flight(this, key);
+        in_flight.emplace(key, flight.result);
+        return flight;
+    }
+
+    // requests that were computed
+    std::uint64_t Led() const { return led.load(); }
+    // requests that waited for an identical one instead
+    std::uint64_t Coalesced() const { return coalesced.load(); }
+
+  private:
+    void Land(const std::string &key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        in_flight.erase(key);
+    }
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_future<ResultPointer>> in_flight;
+    std::atomic<std::uint64_t> led;
+    std::atomic<std::uint64_t> coalesced;
+};
+
+#endif // REQUEST_COALESCER_HPP
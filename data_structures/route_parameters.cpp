@@ -33,7 +33,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 RouteParameters::RouteParameters()
     : zoom_level(18), print_instructions(false), alternate_route(true), geometry(true),
-      compression(true), deprecatedAPI(false), uturn_default(false), check_sum(-1), num_results(1)
+      compression(true), deprecatedAPI(false), uturn_default(false), check_sum(-1), num_results(1),
+      timeout(0)
 {
 }
 
@@ -108,6 +109,8 @@ void RouteParameters::setGeometryFlag(const bool flag) { geometry = flag; }
 
 void RouteParameters::setCompressionFlag(const bool flag) { compression = flag; }
 
+void RouteParameters::setTimeout(const unsigned milliseconds) { timeout = milliseconds; }
+
 void
 RouteParameters::addCoordinate(const boost::fusion::vector<double, double> &transmitted_coordinates)
 {
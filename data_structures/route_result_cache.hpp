@@ -0,0 +1,189 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef ROUTE_RESULT_CACHE_HPP
+#define ROUTE_RESULT_CACHE_HPP
+
+#include "lru_cache.hpp"
+#include "phantom_node.hpp"
+
+#include <atomic>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Rendered route replies keyed by the snapped phantom nodes of every leg and
+// the options that change the output. Entries are tagged with the version of
+// the data they were computed on, the facade checksum together with the
+// dataset generation, and a lookup under another version is a miss. Entries
+// of a replaced dataset are never hit again and age out of the LRU shards.
+class RouteResultCache
+{
+  public:
+    static constexpr unsigned NumberOfShards = 16;
+    static constexpr unsigned EntriesPerShard = 512;
+    // very long routes are rarely repeated and would crowd out everything else
+    static constexpr std::size_t MaximumEntrySize = 256 * 1024;
+
+    RouteResultCache() : lookups(0), hits(0) {}
+
+    RouteResultCache(const RouteResultCache &) = delete;
+
+    static std::uint64_t DataVersion(const unsigned checksum, const unsigned generation)
+    {
+        return (static_cast<std::uint64_t>(generation) << 32) | checksum;
+    }
+
+    template <class ParametersT>
+    static std::string MakeKey(const ParametersT &parameters,
+                               const std::vector<PhantomNodes> &legs,
+                               const unsigned descriptor_id)
+    {
+        std::string key;
+        key.reserve(16 + legs.size() * 2 * sizeof(PhantomNode));
+        Append(key, descriptor_id);
+        Append(key, parameters.zoom_level);
+        Append(key, static_cast<unsigned char>(
+                        (parameters.print_instructions ? 1 : 0) | (parameters.geometry ? 2 : 0) |
+                        (parameters.compression ? 4 : 0) | (parameters.alternate_route ? 8 : 0) |
+                        (parameters.uturn_default ? 16 : 0)));
+        for (const bool uturn : parameters.uturns)
+        {
+            Append(key, static_cast<unsigned char>(uturn ? 1 : 0));
+        }
+        for (const PhantomNodes &leg : legs)
+        {
+            Append(key, leg.source_phantom);
+            Append(key, leg.target_phantom);
+        }
+        return key;
+    }
+
+    // appends the cached reply to output on a hit
+    bool Fetch(const std::string &key, const std::uint64_t data_version, std::vector<char> &output)
+    {
+        ++lookups;
+        std::shared_ptr<const Entry> entry;
+        {
+            Shard &shard = ShardFor(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.entries.Fetch(key, entry);
+        }
+        if (!entry || entry->data_version != data_version)
+        {
+            return false;
+        }
+        ++hits;
+        output.insert(output.end(), entry->content.begin(), entry->content.end());
+        return true;
+    }
+
+    template <typename IteratorT>
+    void Insert(const std::string &key,
+                const std::uint64_t data_version,
+                IteratorT begin,
+                IteratorT end)
+    {
+        if (static_cast<std::size_t>(std::distance(begin, end)) > MaximumEntrySize)
+        {
+            return;
+        }
+        std::shared_ptr<const Entry> entry =
+            std::make_shared<Entry>(data_version, begin, end);
+        Shard &shard = ShardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries.Insert(key, std::move(entry));
+    }
+
+    std::uint64_t Lookups() const { return lookups.load(); }
+    std::uint64_t Hits() const { return hits.load(); }
+
+  private:
+    struct Entry
+    {
+        template <typename IteratorT>
+        Entry(const std::uint64_t data_version, IteratorT begin, IteratorT end)
+            : data_version(data_version), content(begin, end)
+        {
+        }
+
+        const std::uint64_t data_version;
+        const std::vector<char> content;
+    };
+
+    struct Shard
+    {
+        Shard() : entries(EntriesPerShard) {}
+
+        std::mutex mutex;
+        LRUCache<std::string, std::shared_ptr<const Entry>> entries;
+    };
+
+    template <typename T> static void Append(std::string &key, const T &value)
+    {
+        static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value,
+                      "only plain values go into the key");
+        key.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    // field by field, the padding of the struct is not initialized
+    static void Append(std::string &key, const PhantomNode &phantom)
+    {
+        Append(key, phantom.forward_node_id);
+        Append(key, phantom.reverse_node_id);
+        Append(key, phantom.name_id);
+        Append(key, phantom.forward_weight);
+        Append(key, phantom.reverse_weight);
+        Append(key, phantom.forward_offset);
+        Append(key, phantom.reverse_offset);
+        Append(key, phantom.packed_geometry_id);
+        Append(key, phantom.component_id);
+        Append(key, phantom.location.lat);
+        Append(key, phantom.location.lon);
+        Append(key, phantom.fwd_segment_position);
+        Append(key, static_cast<unsigned char>(phantom.forward_travel_mode));
+        Append(key, static_cast<unsigned char>(phantom.backward_travel_mode));
+    }
+
+    Shard &ShardFor(const std::string &key)
+    {
+        return shards[std::hash<std::string>()(key) % NumberOfShards];
+    }
+
+    std::array<Shard, NumberOfShards> shards;
+    std::atomic<std::uint64_t> lookups;
+    std::atomic<std::uint64_t> hits;
+};
+
+#endif // ROUTE_RESULT_CACHE_HPP
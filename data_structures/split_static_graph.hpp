@@ -0,0 +1,244 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef SPLIT_STATIC_GRAPH_HPP
+#define SPLIT_STATIC_GRAPH_HPP
+
+#include "query_edge.hpp"
+#include "shared_memory_vector_wrapper.hpp"
+#include "static_graph.hpp"
+#include "../Util/integer_range.hpp"
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// StaticGraph with the edge array split into a hot and a cold array.
+//
+// The hot array holds target, distance and direction flags, which is all a search reads while
+// relaxing edges. Id and shortcut flag go to the cold array and are only touched when a path
+// gets unpacked. The edges are still addressed by their EdgeID in both arrays.
+//
+// EdgeDataT needs the fields of QueryEdge::EdgeData.
+template <typename EdgeDataT, bool UseSharedMemory = false> class SplitStaticGraph
+{
+public:
+	using NodeIterator = NodeID;
+	using EdgeIterator = NodeID;
+	using EdgeData = EdgeDataT;
+	using EdgeRange = osrm::range<EdgeIterator>;
+	using InputEdge = typename StaticGraph<EdgeDataT>::InputEdge;
+	// layout of the edges in a .hsgr file
+	using UnpackedEdgeArrayEntry = typename StaticGraph<EdgeDataT>::EdgeArrayEntry;
+
+	struct NodeArrayEntry
+	{
+		// index of the first edge
+		EdgeIterator first_edge;
+	};
+
+	using HotEdgeArrayEntry = QueryEdgeHotData;
+	using ColdEdgeArrayEntry = QueryEdgeColdData;
+
+	// number of entries of the hot array for the edges
+	template <typename UnpackedEdgeIterator>
+	static std::size_t GetHotSize(UnpackedEdgeIterator first, UnpackedEdgeIterator last)
+	{
+		return last - first;
+	}
+
+	// number of entries of the cold array for the edges
+	template <typename UnpackedEdgeIterator>
+	static std::size_t GetColdSize(UnpackedEdgeIterator first, UnpackedEdgeIterator last)
+	{
+		return last - first;
+	}
+
+	// splits the edges into GetHotSize(first, last) hot and GetColdSize(first, last) cold entries
+	template <typename UnpackedEdgeIterator>
+	static void Store(UnpackedEdgeIterator first,
+					  UnpackedEdgeIterator last,
+					  HotEdgeArrayEntry *hot_edges,
+					  ColdEdgeArrayEntry *cold_edges)
+	{
+		// entry e of both arrays depends on edge e only, so the chunks are stored in parallel
+		const std::size_t number_of_edges = last - first;
+		tbb::parallel_for(tbb::blocked_range<std::size_t>(0, number_of_edges, kStoreGrainSize),
+						  [first, hot_edges, cold_edges](const tbb::blocked_range<std::size_t> &range)
+						  {
+			for (std::size_t index = range.begin(); index != range.end(); ++index)
+			{
+				const auto &edge = first[index];
+				BOOST_ASSERT(edge.data.distance > 0);
+				hot_edges[index].target = edge.target;
+				hot_edges[index].distance = edge.data.distance;
+				hot_edges[index].forward = edge.data.forward;
+				hot_edges[index].backward = edge.data.backward;
+				cold_edges[index].id = edge.data.id;
+				cold_edges[index].shortcut = edge.data.shortcut;
+			}
+		});
+	}
+
+	EdgeRange GetAdjacentEdgeRange(const NodeID node) const
+	{
+		return osrm::irange(BeginEdges(node), EndEdges(node));
+	}
+
+	SplitStaticGraph(typename ShM<NodeArrayEntry, UseSharedMemory>::vector &nodes,
+					 typename ShM<HotEdgeArrayEntry, UseSharedMemory>::vector &hot_edges,
+					 typename ShM<ColdEdgeArrayEntry, UseSharedMemory>::vector &cold_edges)
+	{
+		BOOST_ASSERT(hot_edges.size() == cold_edges.size());
+		number_of_nodes = static_cast<decltype(number_of_nodes)>(nodes.size() - 1);
+		number_of_edges = static_cast<decltype(number_of_edges)>(hot_edges.size());
+
+		node_array.swap(nodes);
+		hot_edge_array.swap(hot_edges);
+		cold_edge_array.swap(cold_edges);
+	}
+
+	// splits the edges as read from a .hsgr file, the input is flushed
+	SplitStaticGraph(std::vector<NodeArrayEntry> &nodes, std::vector<UnpackedEdgeArrayEntry> &edges)
+	{
+		number_of_nodes = static_cast<decltype(number_of_nodes)>(nodes.size() - 1);
+		number_of_edges = static_cast<decltype(number_of_edges)>(edges.size());
+
+		node_array.swap(nodes);
+		std::vector<HotEdgeArrayEntry> hot_edges(GetHotSize(edges.begin(), edges.end()));
+		std::vector<ColdEdgeArrayEntry> cold_edges(GetColdSize(edges.begin(), edges.end()));
+		Store(edges.begin(), edges.end(), hot_edges.data(), cold_edges.data());
+		std::vector<UnpackedEdgeArrayEntry>().swap(edges);
+		hot_edge_array.swap(hot_edges);
+		cold_edge_array.swap(cold_edges);
+	}
+
+	unsigned GetNumberOfNodes() const { return number_of_nodes; }
+
+	unsigned GetNumberOfEdges() const { return number_of_edges; }
+
+	unsigned GetOutDegree(const NodeIterator n) const { return EndEdges(n) - BeginEdges(n); }
+
+	// bytes taken by the node and edge arrays
+	std::size_t GetMemoryUsage() const
+	{
+		return node_array.size() * sizeof(NodeArrayEntry) +
+			   hot_edge_array.size() * sizeof(HotEdgeArrayEntry) +
+			   cold_edge_array.size() * sizeof(ColdEdgeArrayEntry);
+	}
+
+	inline NodeIterator GetTarget(const EdgeIterator e) const
+	{
+		return NodeIterator(hot_edge_array[e].target);
+	}
+
+	inline const QueryEdgeHotData &GetHotData(const EdgeIterator e) const
+	{
+		return hot_edge_array[e];
+	}
+
+	// returned by value, the fields are assembled from both arrays
+	EdgeDataT GetEdgeData(const EdgeIterator e) const
+	{
+		EdgeDataT data;
+		data.id = cold_edge_array[e].id;
+		data.shortcut = cold_edge_array[e].shortcut;
+		data.distance = hot_edge_array[e].distance;
+		data.forward = hot_edge_array[e].forward;
+		data.backward = hot_edge_array[e].backward;
+		return data;
+	}
+
+	EdgeIterator BeginEdges(const NodeIterator n) const
+	{
+		return EdgeIterator(node_array.at(n).first_edge);
+	}
+
+	EdgeIterator EndEdges(const NodeIterator n) const
+	{
+		return EdgeIterator(node_array.at(n + 1).first_edge);
+	}
+
+	// searches for a specific edge
+	EdgeIterator FindEdge(const NodeIterator from, const NodeIterator to) const
+	{
+		EdgeIterator smallest_edge = SPECIAL_EDGEID;
+		EdgeWeight smallest_weight = INVALID_EDGE_WEIGHT;
+		for (auto edge : GetAdjacentEdgeRange(from))
+		{
+			const QueryEdgeHotData &data = GetHotData(edge);
+			if (data.target == to && data.distance < smallest_weight)
+			{
+				smallest_edge = edge;
+				smallest_weight = data.distance;
+			}
+		}
+		return smallest_edge;
+	}
+
+	EdgeIterator FindEdgeInEitherDirection(const NodeIterator from, const NodeIterator to) const
+	{
+		EdgeIterator tmp = FindEdge(from, to);
+		return (SPECIAL_NODEID != tmp ? tmp : FindEdge(to, from));
+	}
+
+	EdgeIterator
+	FindEdgeIndicateIfReverse(const NodeIterator from, const NodeIterator to, bool &result) const
+	{
+		EdgeIterator current_iterator = FindEdge(from, to);
+		if (SPECIAL_NODEID == current_iterator)
+		{
+			current_iterator = FindEdge(to, from);
+			if (SPECIAL_NODEID != current_iterator)
+			{
+				result = true;
+			}
+		}
+		return current_iterator;
+	}
+
+private:
+	// 16 MiB of input edges per chunk, as datastore copies its blocks
+	static constexpr std::size_t kStoreGrainSize =
+		16 * 1024 * 1024 / sizeof(UnpackedEdgeArrayEntry);
+
+	NodeIterator number_of_nodes;
+	EdgeIterator number_of_edges;
+
+	typename ShM<NodeArrayEntry, UseSharedMemory>::vector node_array;
+	typename ShM<HotEdgeArrayEntry, UseSharedMemory>::vector hot_edge_array;
+	typename ShM<ColdEdgeArrayEntry, UseSharedMemory>::vector cold_edge_array;
+};
+
+#endif // SPLIT_STATIC_GRAPH_HPP
@@ -0,0 +1,211 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef STRING_INTERNER_HPP
+#define STRING_INTERNER_HPP
+
+#include "range_table.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Hands out consecutive ids for distinct strings, the empty string is 0.
+// The characters go into large chunks in the order of their ids, so the
+// table is written in the .names layout without a copy and without an
+// allocation per string. Strings are compared in full, but only the first
+// 255 characters, all a RangeTable can hold, are written. Intern() may be
+// called from several threads at once.
+class StringInterner
+{
+  public:
+    static constexpr unsigned MaximumLength = 255;
+    static constexpr unsigned NumberOfShards = 64;
+    static constexpr std::size_t ChunkSize = 1024 * 1024;
+
+    StringInterner() : last_chunk_size(0), total_length(0) { Intern("", 0); }
+
+    StringInterner(const StringInterner &) = delete;
+
+    unsigned Intern(const std::string &value) { return Intern(value.data(), value.size()); }
+
+    unsigned Intern(const char *data, const std::size_t length)
+    {
+        const std::uint32_t hash = Hash(data, length);
+        Shard &shard = shards[hash % NumberOfShards];
+
+        std::lock_guard<std::mutex> shard_lock(shard.mutex);
+        if (2 * (shard.number_of_entries + 1) > shard.slots.size())
+        {
+            shard.Grow();
+        }
+        Slot &slot = shard.Find(hash, data, length);
+        if (InvalidID != slot.id)
+        {
+            return slot.id;
+        }
+
+        // ids are handed out in the order of the characters
+        {
+            std::lock_guard<std::mutex> arena_lock(arena_mutex);
+            const std::size_t written_length = std::min<std::size_t>(length, MaximumLength);
+            slot.data = Append(data, written_length);
+            if (written_length < length)
+            {
+                // the arena only holds the written characters, long names are compared in full
+                long_names.emplace_back(new char[length]);
+                std::copy(data, data + length, long_names.back().get());
+                slot.data = long_names.back().get();
+            }
+            slot.id = static_cast<unsigned>(lengths.size());
+            lengths.push_back(static_cast<unsigned>(written_length));
+            total_length += static_cast<unsigned>(written_length);
+        }
+        slot.hash = hash;
+        slot.length = length;
+        ++shard.number_of_entries;
+        return slot.id;
+    }
+
+    // not safe while other threads intern
+    unsigned Size() const { return static_cast<unsigned>(lengths.size()); }
+
+    // A RangeTable of the lengths, the total length and all characters.
+    // Not safe while other threads intern.
+    void Write(std::ostream &out) const
+    {
+        RangeTable<> table(lengths);
+        out << table;
+        out.write((char *)&total_length, sizeof(unsigned));
+        for (std::size_t i = 0; i < chunks.size(); ++i)
+        {
+            const std::size_t chunk_size = (i + 1 < chunks.size()) ? chunk_sizes[i] : last_chunk_size;
+            out.write(chunks[i].get(), chunk_size);
+        }
+    }
+
+  private:
+    static constexpr unsigned InvalidID = static_cast<unsigned>(-1);
+
+    struct Slot
+    {
+        Slot() : data(nullptr), id(InvalidID), hash(0), length(0) {}
+
+        const char *data;
+        unsigned id;
+        std::uint32_t hash;
+        std::size_t length;
+    };
+
+    struct Shard
+    {
+        Shard() : slots(16), number_of_entries(0) {}
+
+        // the slot holding the string or the free one where it belongs
+        Slot &Find(const std::uint32_t hash, const char *data, const std::size_t length)
+        {
+            const std::size_t mask = slots.size() - 1;
+            std::size_t position = (hash / NumberOfShards) & mask;
+            while (InvalidID != slots[position].id)
+            {
+                const Slot &slot = slots[position];
+                if (slot.hash == hash && slot.length == length &&
+                    0 == std::memcmp(slot.data, data, length))
+                {
+                    break;
+                }
+                position = (position + 1) & mask;
+            }
+            return slots[position];
+        }
+
+        void Grow()
+        {
+            std::vector<Slot> old_slots;
+            old_slots.swap(slots);
+            slots.resize(2 * old_slots.size());
+            for (const Slot &slot : old_slots)
+            {
+                if (InvalidID != slot.id)
+                {
+                    Find(slot.hash, slot.data, slot.length) = slot;
+                }
+            }
+        }
+
+        std::mutex mutex;
+        std::vector<Slot> slots;
+        std::size_t number_of_entries;
+    };
+
+    // FNV-1a
+    static std::uint32_t Hash(const char *data, const std::size_t length)
+    {
+        std::uint32_t hash = 2166136261u;
+        for (std::size_t i = 0; i < length; ++i)
+        {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+        }
+        return hash;
+    }
+
+    // strings never straddle two chunks, their characters stay where they are
+    const char *Append(const char *data, const std::size_t length)
+    {
+        if (chunks.empty() || last_chunk_size + length > ChunkSize)
+        {
+            if (!chunks.empty())
+            {
+                chunk_sizes.push_back(last_chunk_size);
+            }
+            chunks.emplace_back(new char[ChunkSize]);
+            last_chunk_size = 0;
+        }
+        char *position = chunks.back().get() + last_chunk_size;
+        std::copy(data, data + length, position);
+        last_chunk_size += length;
+        return position;
+    }
+
+    std::array<Shard, NumberOfShards> shards;
+
+    std::mutex arena_mutex;
+    std::vector<std::unique_ptr<char[]>> chunks;
+    std::vector<std::size_t> chunk_sizes;
+    std::size_t last_chunk_size;
+    std::vector<std::unique_ptr<char[]>> long_names;
+    std::vector<unsigned> lengths;
+    unsigned total_length;
+};
+
+#endif // STRING_INTERNER_HPP
@@ -0,0 +1,75 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef TURN_PENALTY_TABLE_HPP
+#define TURN_PENALTY_TABLE_HPP
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Samples a turn penalty that depends on nothing but the turn angle at a
+// fixed resolution over [0, 360] degrees. A lookup returns the penalty of
+// the nearest sampled angle, so it may differ from the sampled function
+// where that function is discontinuous.
+class TurnPenaltyTable
+{
+  public:
+    static constexpr unsigned SamplesPerDegree = 100;
+
+    TurnPenaltyTable() = default;
+
+    template <typename PenaltyFunction> explicit TurnPenaltyTable(PenaltyFunction penalty_of_angle)
+    {
+        penalties.reserve(360 * SamplesPerDegree + 1);
+        for (unsigned index = 0; index <= 360 * SamplesPerDegree; ++index)
+        {
+            penalties.push_back(penalty_of_angle(AngleOf(index)));
+        }
+    }
+
+    bool empty() const { return penalties.empty(); }
+
+    int operator()(const double angle) const
+    {
+        BOOST_ASSERT(!empty());
+        const double clamped_angle = std::min(std::max(angle, 0.), 360.);
+        return penalties[static_cast<unsigned>(std::lround(clamped_angle * SamplesPerDegree))];
+    }
+
+    static double AngleOf(const unsigned index)
+    {
+        return static_cast<double>(index) / SamplesPerDegree;
+    }
+
+  private:
+    std::vector<int> penalties;
+};
+
+#endif // TURN_PENALTY_TABLE_HPP
@@ -25,41 +25,39 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 
-#include "data_structures/original_edge_data.hpp"
-#include "data_structures/range_table.hpp"
 #include "data_structures/query_edge.hpp"
+#include "data_structures/search_graph.hpp"
 #include "data_structures/shared_memory_factory.hpp"
-#include "data_structures/shared_memory_vector_wrapper.hpp"
 #include "data_structures/static_graph.hpp"
-#include "data_structures/static_rtree.hpp"
-#include "data_structures/turn_instructions.hpp"
-#include "Server/DataStructures/BaseDataFacade.h"
 #include "Server/DataStructures/SharedDataType.h"
 #include "Server/DataStructures/SharedBarriers.h"
+#include "Server/DataStructures/SharedGeneration.h"
 #include "Util/BoostFileSystemFix.h"
+#include "Util/datastore_loader.hpp"
 #include "Util/DataStoreOptions.h"
 #include "Util/simple_logger.hpp"
 #include "Util/osrm_exception.hpp"
 #include "Util/FingerPrint.h"
+#include "Util/timing_util.hpp"
 #include "typedefs.h"
 
-#include <osrm/Coordinate.h>
-
-using RTreeLeaf = BaseDataFacade<QueryEdge::EdgeData>::RTreeLeaf;
-using RTreeNode = StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, true>::vector, true>::TreeNode;
-using QueryGraph = StaticGraph<QueryEdge::EdgeData>;
+using QueryGraph = SearchGraph<QueryEdge::EdgeData>;
+// the edges as stored in the .hsgr
+using HSGREdge = StaticGraph<QueryEdge::EdgeData>::EdgeArrayEntry;
 
 #ifdef __linux__
 #include <sys/mman.h>
 #endif
 
-#include <boost/filesystem/fstream.hpp>
-#include <boost/iostreams/seek.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/task_group.h>
 
-#include <cstdint>
+#include <chrono>
 
-#include <fstream>
+#include <algorithm>
+#include <array>
 #include <string>
+#include <vector>
 
 // delete a shared memory region. report warning if it could not be deleted
 void delete_region(const SharedDataType region)
@@ -72,18 +70,32 @@ void delete_region(const SharedDataType region)
             {
             case CURRENT_REGIONS:
                 return "CURRENT_REGIONS";
-            case LAYOUT_1:
-                return "LAYOUT_1";
-            case DATA_1:
-                return "DATA_1";
-            case LAYOUT_2:
-                return "LAYOUT_2";
-            case DATA_2:
-                return "DATA_2";
-            case LAYOUT_NONE:
-                return "LAYOUT_NONE";
-            default: // DATA_NONE:
-                return "DATA_NONE";
+            case GRAPH_1:
+                return "GRAPH_1";
+            case GRAPH_2:
+                return "GRAPH_2";
+            case ORIGINAL_EDGES_1:
+                return "ORIGINAL_EDGES_1";
+            case ORIGINAL_EDGES_2:
+                return "ORIGINAL_EDGES_2";
+            case GEOMETRIES_1:
+                return "GEOMETRIES_1";
+            case GEOMETRIES_2:
+                return "GEOMETRIES_2";
+            case NAMES_1:
+                return "NAMES_1";
+            case NAMES_2:
+                return "NAMES_2";
+            case R_TREE_1:
+                return "R_TREE_1";
+            case R_TREE_2:
+                return "R_TREE_2";
+            case TIMESTAMP_1:
+                return "TIMESTAMP_1";
+            case TIMESTAMP_2:
+                return "TIMESTAMP_2";
+            default: // REGION_NONE:
+                return "REGION_NONE";
             }
         }();
 
@@ -196,72 +208,24 @@ int main(const int argc, const char *argv[])
         BOOST_ASSERT(!paths_iterator->second.empty());
         const boost::filesystem::path &geometries_data_path = paths_iterator->second;
 
-        // determine segment to use
-        bool segment2_in_use = SharedMemory::RegionExists(LAYOUT_2);
-        const SharedDataType layout_region = [&]
-        {
-            return segment2_in_use ? LAYOUT_1 : LAYOUT_2;
-        }();
-        const SharedDataType data_region = [&]
-        {
-            return segment2_in_use ? DATA_1 : DATA_2;
-        }();
-        const SharedDataType previous_layout_region = [&]
-        {
-            return segment2_in_use ? LAYOUT_2 : LAYOUT_1;
-        }();
-        const SharedDataType previous_data_region = [&]
-        {
-            return segment2_in_use ? DATA_2 : DATA_1;
-        }();
+        SharedMemory *data_type_memory =
+            SharedMemoryFactory::Get(CURRENT_REGIONS, sizeof(SharedDataTimestamp), true, false);
+        SharedDataTimestamp *data_timestamp_ptr =
+            static_cast<SharedDataTimestamp *>(data_type_memory->Ptr());
+        const unsigned previous_generation = data_timestamp_ptr->generation.load();
+        const unsigned previous_timestamp = SharedDataTimestamp::Timestamp(previous_generation);
+
+        const OriginalDataFiles original_data(names_data_path, edges_data_path,
+                                              geometries_data_path, nodes_data_path,
+                                              ram_index_path, timestamp_path, file_index_path);
 
-        // Allocate a memory layout in shared memory, deallocate previous
-        SharedMemory *layout_memory =
-            SharedMemoryFactory::Get(layout_region, sizeof(SharedDataLayout));
-        SharedDataLayout *shared_layout_ptr = static_cast<SharedDataLayout *>(layout_memory->Ptr());
-        shared_layout_ptr = new (layout_memory->Ptr()) SharedDataLayout();
-
-        shared_layout_ptr->SetBlockSize<char>(SharedDataLayout::FILE_INDEX_PATH,
-                                              file_index_path.length() + 1);
-
-        // collect number of elements to store in shared memory object
-        SimpleLogger().Write() << "load names from: " << names_data_path;
-        // number of entries in name index
-        boost::filesystem::ifstream name_stream(names_data_path, std::ios::binary);
-        unsigned name_blocks = 0;
-        name_stream.read((char *)&name_blocks, sizeof(unsigned));
-        shared_layout_ptr->SetBlockSize<unsigned>(SharedDataLayout::NAME_OFFSETS, name_blocks);
-        shared_layout_ptr->SetBlockSize<typename RangeTable<16, true>::BlockT>(
-            SharedDataLayout::NAME_BLOCKS, name_blocks);
-        SimpleLogger().Write() << "name offsets size: " << name_blocks;
-        BOOST_ASSERT_MSG(0 != name_blocks, "name file broken");
-
-        unsigned number_of_chars = 0;
-        name_stream.read((char *)&number_of_chars, sizeof(unsigned));
-        shared_layout_ptr->SetBlockSize<char>(SharedDataLayout::NAME_CHAR_LIST, number_of_chars);
-
-        // Loading information for original edges
-        boost::filesystem::ifstream edges_input_stream(edges_data_path, std::ios::binary);
-        unsigned number_of_original_edges = 0;
-        edges_input_stream.read((char *)&number_of_original_edges, sizeof(unsigned));
-
-        // note: settings this all to the same size is correct, we extract them from the same struct
-        shared_layout_ptr->SetBlockSize<NodeID>(SharedDataLayout::VIA_NODE_LIST,
-                                                number_of_original_edges);
-        shared_layout_ptr->SetBlockSize<unsigned>(SharedDataLayout::NAME_ID_LIST,
-                                                  number_of_original_edges);
-        shared_layout_ptr->SetBlockSize<TravelMode>(SharedDataLayout::TRAVEL_MODE,
-                                                    number_of_original_edges);
-        shared_layout_ptr->SetBlockSize<TurnInstruction>(SharedDataLayout::TURN_INSTRUCTION,
-                                                         number_of_original_edges);
-        // note: there are 32 geometry indicators in one unsigned block
-        shared_layout_ptr->SetBlockSize<unsigned>(SharedDataLayout::GEOMETRIES_INDICATORS,
-                                                  number_of_original_edges);
-
-        boost::filesystem::ifstream hsgr_input_stream(hsgr_path, std::ios::binary);
+        const InputFile hsgr_file(hsgr_path);
 
         FingerPrint fingerprint_loaded, fingerprint_orig;
-        hsgr_input_stream.read((char *)&fingerprint_loaded, sizeof(FingerPrint));
+        // byte for byte, as the loaders read it from their streams
+        const char *fingerprint_bytes = hsgr_file.Data(0, sizeof(FingerPrint));
+        std::copy(fingerprint_bytes, fingerprint_bytes + sizeof(FingerPrint),
+                  reinterpret_cast<char *>(&fingerprint_loaded));
         if (fingerprint_loaded.TestGraphUtil(fingerprint_orig))
         {
             SimpleLogger().Write(logDEBUG) << "Fingerprint checked out ok";
@@ -272,285 +236,187 @@ int main(const int argc, const char *argv[])
                                                 "Reprocess to get rid of this warning.";
         }
 
-        // load checksum
-        unsigned checksum = 0;
-        hsgr_input_stream.read((char *)&checksum, sizeof(unsigned));
-        shared_layout_ptr->SetBlockSize<unsigned>(SharedDataLayout::HSGR_CHECKSUM, 1);
-        // load graph node size
-        unsigned number_of_graph_nodes = 0;
-        hsgr_input_stream.read((char *)&number_of_graph_nodes, sizeof(unsigned));
-
-        BOOST_ASSERT_MSG((0 != number_of_graph_nodes), "number of nodes is zero");
-        shared_layout_ptr->SetBlockSize<QueryGraph::NodeArrayEntry>(
-            SharedDataLayout::GRAPH_NODE_LIST, number_of_graph_nodes);
-
-        // load graph edge size
-        unsigned number_of_graph_edges = 0;
-        hsgr_input_stream.read((char *)&number_of_graph_edges, sizeof(unsigned));
-        // BOOST_ASSERT_MSG(0 != number_of_graph_edges, "number of graph edges is zero");
-        shared_layout_ptr->SetBlockSize<QueryGraph::EdgeArrayEntry>(
-            SharedDataLayout::GRAPH_EDGE_LIST, number_of_graph_edges);
-
-        // load rsearch tree size
-        boost::filesystem::ifstream tree_node_file(ram_index_path, std::ios::binary);
-
-        uint32_t tree_size = 0;
-        tree_node_file.read((char *)&tree_size, sizeof(uint32_t));
-        shared_layout_ptr->SetBlockSize<RTreeNode>(SharedDataLayout::R_SEARCH_TREE, tree_size);
-
-        // load timestamp size
-        std::string m_timestamp;
-        if (boost::filesystem::exists(timestamp_path))
-        {
-            boost::filesystem::ifstream timestamp_stream(timestamp_path);
-            if (!timestamp_stream)
-            {
-                SimpleLogger().Write(logWARNING) << timestamp_path
-                                                 << " not found. setting to default";
-            }
-            else
+        // a segment is only loaded again if its input files changed
+        TIMER_START(checksums);
+        std::array<unsigned, SharedDataLayout::NUM_SEGMENTS> checksums;
+        tbb::parallel_for(0, static_cast<int>(SharedDataLayout::NUM_SEGMENTS),
+                          [&](const int segment)
+                          {
+            const auto segment_id = static_cast<SharedDataLayout::SegmentID>(segment);
+            checksums[segment] = SharedDataLayout::GRAPH_SEGMENT == segment_id
+                                     ? file_checksum(hsgr_file)
+                                     : original_data.Checksum(segment_id);
+        });
+        TIMER_STOP(checksums);
+        SimpleLogger().Write() << "checksummed all files in " << TIMER_SEC(checksums) << "s";
+
+        std::vector<SharedDataLayout::SegmentID> changed_segments;
+        unsigned region_mask = previous_generation & ((1u << SharedDataLayout::NUM_SEGMENTS) - 1);
+        for (int segment = 0; segment < SharedDataLayout::NUM_SEGMENTS; ++segment)
+        {
+            const auto segment_id = static_cast<SharedDataLayout::SegmentID>(segment);
+            const unsigned index =
+                SharedDataTimestamp::RegionIndex(previous_generation, segment_id);
+            const bool is_current =
+                0 != previous_timestamp &&
+                checksums[segment] == data_timestamp_ptr->checksums[segment][index] &&
+                SharedMemory::RegionExists(SharedDataTimestamp::Region(segment_id, index));
+            if (!is_current)
             {
-                getline(timestamp_stream, m_timestamp);
-                timestamp_stream.close();
+                changed_segments.push_back(segment_id);
+                region_mask ^= (1u << segment);
             }
         }
-        if (m_timestamp.empty())
-        {
-            m_timestamp = "n/a";
-        }
-        if (25 < m_timestamp.length())
-        {
-            m_timestamp.resize(25);
-        }
-        shared_layout_ptr->SetBlockSize<char>(SharedDataLayout::TIMESTAMP, m_timestamp.length());
-
-        // load coordinate size
-        boost::filesystem::ifstream nodes_input_stream(nodes_data_path, std::ios::binary);
-        unsigned coordinate_list_size = 0;
-        nodes_input_stream.read((char *)&coordinate_list_size, sizeof(unsigned));
-        shared_layout_ptr->SetBlockSize<FixedPointCoordinate>(SharedDataLayout::COORDINATE_LIST,
-                                                              coordinate_list_size);
-
-        // load geometries sizes
-        std::ifstream geometry_input_stream(geometries_data_path.string().c_str(),
-                                            std::ios::binary);
-        unsigned number_of_geometries_indices = 0;
-        unsigned number_of_compressed_geometries = 0;
-
-        geometry_input_stream.read((char *)&number_of_geometries_indices, sizeof(unsigned));
-        shared_layout_ptr->SetBlockSize<unsigned>(SharedDataLayout::GEOMETRIES_INDEX,
-                                                  number_of_geometries_indices);
-        boost::iostreams::seek(
-            geometry_input_stream, number_of_geometries_indices * sizeof(unsigned), BOOST_IOS::cur);
-        geometry_input_stream.read((char *)&number_of_compressed_geometries, sizeof(unsigned));
-        shared_layout_ptr->SetBlockSize<unsigned>(SharedDataLayout::GEOMETRIES_LIST,
-                                                  number_of_compressed_geometries);
-        // allocate shared memory block
-        SimpleLogger().Write() << "allocating shared memory of "
-                               << shared_layout_ptr->GetSizeOfLayout() << " bytes";
-        SharedMemory *shared_memory =
-            SharedMemoryFactory::Get(data_region, shared_layout_ptr->GetSizeOfLayout());
-        char *shared_memory_ptr = static_cast<char *>(shared_memory->Ptr());
-
-        // read actual data into shared memory object //
-
-        // hsgr checksum
-        unsigned *checksum_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
-            shared_memory_ptr, SharedDataLayout::HSGR_CHECKSUM);
-        *checksum_ptr = checksum;
-
-        // ram index file name
-        char *file_index_path_ptr = shared_layout_ptr->GetBlockPtr<char, true>(
-            shared_memory_ptr, SharedDataLayout::FILE_INDEX_PATH);
-        // make sure we have 0 ending
-        std::fill(file_index_path_ptr,
-                  file_index_path_ptr +
-                      shared_layout_ptr->GetBlockSize(SharedDataLayout::FILE_INDEX_PATH),
-                  0);
-        std::copy(file_index_path.begin(), file_index_path.end(), file_index_path_ptr);
-
-        // Loading street names
-        unsigned *name_offsets_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
-            shared_memory_ptr, SharedDataLayout::NAME_OFFSETS);
-        if (shared_layout_ptr->GetBlockSize(SharedDataLayout::NAME_OFFSETS) > 0)
-        {
-            name_stream.read((char *)name_offsets_ptr,
-                             shared_layout_ptr->GetBlockSize(SharedDataLayout::NAME_OFFSETS));
-        }
 
-        unsigned *name_blocks_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
-            shared_memory_ptr, SharedDataLayout::NAME_BLOCKS);
-        if (shared_layout_ptr->GetBlockSize(SharedDataLayout::NAME_BLOCKS) > 0)
+        if (changed_segments.empty())
         {
-            name_stream.read((char *)name_blocks_ptr,
-                             shared_layout_ptr->GetBlockSize(SharedDataLayout::NAME_BLOCKS));
+            SimpleLogger().Write() << "shared memory is up to date";
+            return 0;
         }
 
-        char *name_char_ptr = shared_layout_ptr->GetBlockPtr<char, true>(
-            shared_memory_ptr, SharedDataLayout::NAME_CHAR_LIST);
-        unsigned temp_length;
-        name_stream.read((char *)&temp_length, sizeof(unsigned));
-
-        BOOST_ASSERT_MSG(temp_length ==
-                             shared_layout_ptr->GetBlockSize(SharedDataLayout::NAME_CHAR_LIST),
-                         "Name file corrupted!");
-
-        if (shared_layout_ptr->GetBlockSize(SharedDataLayout::NAME_CHAR_LIST) > 0)
+        // every segment goes into its own region, so they are all loaded at once
+        TIMER_START(load_all);
+        tbb::task_group loaders;
+        std::vector<SharedDataLayout *> changed_layouts;
+        for (const auto segment : changed_segments)
         {
-            name_stream.read(name_char_ptr,
-                             shared_layout_ptr->GetBlockSize(SharedDataLayout::NAME_CHAR_LIST));
-        }
-
-        name_stream.close();
-
-        // load original edge information
-        NodeID *via_node_ptr = shared_layout_ptr->GetBlockPtr<NodeID, true>(
-            shared_memory_ptr, SharedDataLayout::VIA_NODE_LIST);
-
-        unsigned *name_id_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
-            shared_memory_ptr, SharedDataLayout::NAME_ID_LIST);
-
-        TravelMode *travel_mode_ptr =
-            shared_layout_ptr->GetBlockPtr<TravelMode, true>(
-                shared_memory_ptr, SharedDataLayout::TRAVEL_MODE);
+            const SharedDataType region = SharedDataTimestamp::Region(
+                segment, SharedDataTimestamp::RegionIndex(region_mask, segment));
+            // left over from a load that did not finish
+            delete_region(region);
 
-        TurnInstruction *turn_instructions_ptr =
-            shared_layout_ptr->GetBlockPtr<TurnInstruction, true>(
-                shared_memory_ptr, SharedDataLayout::TURN_INSTRUCTION);
-
-        unsigned *geometries_indicator_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
-            shared_memory_ptr, SharedDataLayout::GEOMETRIES_INDICATORS);
-
-        OriginalEdgeData current_edge_data;
-        for (unsigned i = 0; i < number_of_original_edges; ++i)
-        {
-            edges_input_stream.read((char *)&(current_edge_data), sizeof(OriginalEdgeData));
-            via_node_ptr[i] = current_edge_data.via_node;
-            name_id_ptr[i] = current_edge_data.name_id;
-            travel_mode_ptr[i] = current_edge_data.travel_mode;
-            turn_instructions_ptr[i] = current_edge_data.turn_instruction;
-
-            const unsigned bucket = i / 32;
-            const unsigned offset = i % 32;
-            const unsigned value = [&]
+            // collect number of elements to store in shared memory object
+            SharedDataLayout layout;
+            if (SharedDataLayout::GRAPH_SEGMENT == segment)
             {
-                unsigned return_value = 0;
-                if (0 != offset)
-                {
-                    return_value = geometries_indicator_ptr[bucket];
-                }
-                return return_value;
-            }();
-            if (current_edge_data.compressed_geometry)
+                layout.SetBlockSize<unsigned>(SharedDataLayout::HSGR_CHECKSUM, 1);
+                const unsigned number_of_graph_nodes =
+                    hsgr_file.Read<unsigned>(sizeof(FingerPrint) + sizeof(unsigned));
+                BOOST_ASSERT_MSG((0 != number_of_graph_nodes), "number of nodes is zero");
+                layout.SetBlockSize<QueryGraph::NodeArrayEntry>(SharedDataLayout::GRAPH_NODE_LIST,
+                                                                number_of_graph_nodes);
+                const unsigned number_of_graph_edges =
+                    hsgr_file.Read<unsigned>(sizeof(FingerPrint) + 2 * sizeof(unsigned));
+                const HSGREdge *hsgr_edges = reinterpret_cast<const HSGREdge *>(hsgr_file.Data(
+                    sizeof(FingerPrint) + 3 * sizeof(unsigned) +
+                        layout.GetBlockSize(SharedDataLayout::GRAPH_NODE_LIST),
+                    number_of_graph_edges * sizeof(HSGREdge)));
+                layout.SetBlockSize<QueryGraph::HotEdgeArrayEntry>(
+                    SharedDataLayout::GRAPH_EDGE_LIST,
+                    QueryGraph::GetHotSize(hsgr_edges, hsgr_edges + number_of_graph_edges));
+                layout.SetBlockSize<QueryGraph::ColdEdgeArrayEntry>(
+                    SharedDataLayout::GRAPH_EDGE_COLD_LIST,
+                    QueryGraph::GetColdSize(hsgr_edges, hsgr_edges + number_of_graph_edges));
+                // files of an older build end after the edges and have no node id map
+                const std::size_t node_id_map_offset =
+                    sizeof(FingerPrint) + 3 * sizeof(unsigned) +
+                    layout.GetBlockSize(SharedDataLayout::GRAPH_NODE_LIST) +
+                    number_of_graph_edges * sizeof(HSGREdge);
+                const unsigned node_id_map_size =
+                    hsgr_file.Size() > node_id_map_offset
+                        ? hsgr_file.Read<unsigned>(node_id_map_offset)
+                        : 0;
+                layout.SetBlockSize<NodeID>(SharedDataLayout::GRAPH_NODE_ID_MAP, node_id_map_size);
+            }
+            else
             {
-                geometries_indicator_ptr[bucket] = (value | (1 << offset));
+                original_data.SetBlockSizes(layout, segment);
             }
-        }
-        edges_input_stream.close();
-
-        // load compressed geometry
-        unsigned temporary_value;
-        unsigned *geometries_index_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
-            shared_memory_ptr, SharedDataLayout::GEOMETRIES_INDEX);
-        geometry_input_stream.seekg(0, geometry_input_stream.beg);
-        geometry_input_stream.read((char *)&temporary_value, sizeof(unsigned));
-        BOOST_ASSERT(temporary_value ==
-                     shared_layout_ptr->num_entries[SharedDataLayout::GEOMETRIES_INDEX]);
-
-        if (shared_layout_ptr->GetBlockSize(SharedDataLayout::GEOMETRIES_INDEX) > 0)
-        {
-            geometry_input_stream.read(
-                (char *)geometries_index_ptr,
-                shared_layout_ptr->GetBlockSize(SharedDataLayout::GEOMETRIES_INDEX));
-        }
-        unsigned *geometries_list_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
-            shared_memory_ptr, SharedDataLayout::GEOMETRIES_LIST);
-
-        geometry_input_stream.read((char *)&temporary_value, sizeof(unsigned));
-        BOOST_ASSERT(temporary_value ==
-                     shared_layout_ptr->num_entries[SharedDataLayout::GEOMETRIES_LIST]);
-
-        if (shared_layout_ptr->GetBlockSize(SharedDataLayout::GEOMETRIES_LIST) > 0)
-        {
-            geometry_input_stream.read(
-                (char *)geometries_list_ptr,
-                shared_layout_ptr->GetBlockSize(SharedDataLayout::GEOMETRIES_LIST));
-        }
-
-        // Loading list of coordinates
-        FixedPointCoordinate *coordinates_ptr =
-            shared_layout_ptr->GetBlockPtr<FixedPointCoordinate, true>(
-                shared_memory_ptr, SharedDataLayout::COORDINATE_LIST);
-
-        QueryNode current_node;
-        for (unsigned i = 0; i < coordinate_list_size; ++i)
-        {
-            nodes_input_stream.read((char *)&current_node, sizeof(QueryNode));
-            coordinates_ptr[i] = FixedPointCoordinate(current_node.lat, current_node.lon);
-        }
-        nodes_input_stream.close();
 
-        // store timestamp
-        char *timestamp_ptr = shared_layout_ptr->GetBlockPtr<char, true>(
-            shared_memory_ptr, SharedDataLayout::TIMESTAMP);
-        std::copy(m_timestamp.c_str(), m_timestamp.c_str() + m_timestamp.length(), timestamp_ptr);
+            // the region starts with its layout, followed by the blocks
+            const std::size_t region_size = sizeof(SharedDataLayout) + layout.GetSizeOfLayout();
+            SimpleLogger().Write() << "allocating shared memory of " << region_size << " bytes";
+            SharedMemory *shared_memory = SharedMemoryFactory::Get(region, region_size);
+            SharedDataLayout *shared_layout_ptr =
+                new (shared_memory->Ptr()) SharedDataLayout(layout);
+            char *shared_memory_ptr =
+                static_cast<char *>(shared_memory->Ptr()) + sizeof(SharedDataLayout);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+            // only takes effect if transparent huge pages are enabled for shmem
+            if (0 != madvise(shared_memory->Ptr(), region_size, MADV_HUGEPAGE))
+            {
+                SimpleLogger().Write(logDEBUG) << "no huge pages for the data segment";
+            }
+#endif
+            changed_layouts.push_back(shared_layout_ptr);
+            SharedGeneration::RecordLoad(data_timestamp_ptr, segment,
+                                         SharedDataTimestamp::RegionIndex(region_mask, segment),
+                                         previous_timestamp + 1, checksums[segment]);
 
-        // store search tree portion of rtree
-        char *rtree_ptr = shared_layout_ptr->GetBlockPtr<char, true>(
-            shared_memory_ptr, SharedDataLayout::R_SEARCH_TREE);
+            if (SharedDataLayout::GRAPH_SEGMENT != segment)
+            {
+                original_data.Load(loaders, *shared_layout_ptr, shared_memory_ptr, segment);
+                continue;
+            }
 
-        if (tree_size > 0)
-        {
-            tree_node_file.read(rtree_ptr, sizeof(RTreeNode) * tree_size);
+            // hsgr checksum
+            unsigned *checksum_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
+                shared_memory_ptr, SharedDataLayout::HSGR_CHECKSUM);
+            *checksum_ptr = hsgr_file.Read<unsigned>(sizeof(FingerPrint));
+
+            // load the nodes and edges of the search graph
+            const std::size_t hsgr_offset = sizeof(FingerPrint) + 3 * sizeof(unsigned);
+            loaders.run([&hsgr_file, shared_layout_ptr, shared_memory_ptr, hsgr_offset]
+                        {
+                TIMER_START(load_graph);
+                const std::size_t graph_nodes_size =
+                    shared_layout_ptr->GetBlockSize(SharedDataLayout::GRAPH_NODE_LIST);
+                copy_block(hsgr_file, hsgr_offset,
+                           shared_layout_ptr->GetBlockPtr<char, true>(
+                               shared_memory_ptr, SharedDataLayout::GRAPH_NODE_LIST),
+                           graph_nodes_size);
+                const std::size_t graph_edges_size =
+                    hsgr_file.Read<unsigned>(sizeof(FingerPrint) + 2 * sizeof(unsigned)) *
+                    sizeof(HSGREdge);
+                const HSGREdge *hsgr_edges = reinterpret_cast<const HSGREdge *>(
+                    hsgr_file.Data(hsgr_offset + graph_nodes_size, graph_edges_size));
+                // the .hsgr keeps the edges interleaved, the search graph splits them
+                QueryGraph::Store(hsgr_edges, hsgr_edges + graph_edges_size / sizeof(HSGREdge),
+                                  shared_layout_ptr->GetBlockPtr<QueryGraph::HotEdgeArrayEntry, true>(
+                                      shared_memory_ptr, SharedDataLayout::GRAPH_EDGE_LIST),
+                                  shared_layout_ptr->GetBlockPtr<QueryGraph::ColdEdgeArrayEntry, true>(
+                                      shared_memory_ptr, SharedDataLayout::GRAPH_EDGE_COLD_LIST));
+                const std::size_t node_id_map_size =
+                    shared_layout_ptr->GetBlockSize(SharedDataLayout::GRAPH_NODE_ID_MAP);
+                if (node_id_map_size > 0)
+                {
+                    copy_block(hsgr_file,
+                               hsgr_offset + graph_nodes_size + graph_edges_size + sizeof(unsigned),
+                               shared_layout_ptr->GetBlockPtr<char, true>(
+                                   shared_memory_ptr, SharedDataLayout::GRAPH_NODE_ID_MAP),
+                               node_id_map_size);
+                }
+                TIMER_STOP(load_graph);
+                report_throughput(hsgr_file, TIMER_SEC(load_graph));
+            });
         }
-        tree_node_file.close();
 
-        // load the nodes of the search graph
-        QueryGraph::NodeArrayEntry *graph_node_list_ptr =
-            shared_layout_ptr->GetBlockPtr<QueryGraph::NodeArrayEntry, true>(
-                shared_memory_ptr, SharedDataLayout::GRAPH_NODE_LIST);
-        if (shared_layout_ptr->GetBlockSize(SharedDataLayout::GRAPH_NODE_LIST) > 0)
-        {
-            hsgr_input_stream.read(
-                (char *)graph_node_list_ptr,
-                shared_layout_ptr->GetBlockSize(SharedDataLayout::GRAPH_NODE_LIST));
-        }
+        loaders.wait();
+        TIMER_STOP(load_all);
+        SimpleLogger().Write() << "loaded " << changed_segments.size() << " of "
+                               << static_cast<int>(SharedDataLayout::NUM_SEGMENTS)
+                               << " segments in " << TIMER_SEC(load_all) << "s";
 
-        // load the edges of the search graph
-        QueryGraph::EdgeArrayEntry *graph_edge_list_ptr =
-            shared_layout_ptr->GetBlockPtr<QueryGraph::EdgeArrayEntry, true>(
-                shared_memory_ptr, SharedDataLayout::GRAPH_EDGE_LIST);
-        if (shared_layout_ptr->GetBlockSize(SharedDataLayout::GRAPH_EDGE_LIST) > 0)
+        // new queries switch over right away, the running ones finish on the old data
+        SharedGeneration::Publish(data_timestamp_ptr, previous_timestamp + 1, region_mask);
+        for (const auto segment : changed_segments)
         {
-            hsgr_input_stream.read(
-                (char *)graph_edge_list_ptr,
-                shared_layout_ptr->GetBlockSize(SharedDataLayout::GRAPH_EDGE_LIST));
+            const unsigned previous_index =
+                SharedDataTimestamp::RegionIndex(previous_generation, segment);
+            if (!SharedGeneration::WaitForReaders(data_timestamp_ptr, segment, previous_index,
+                                                  std::chrono::seconds(60)))
+            {
+                SimpleLogger().Write(logWARNING)
+                    << "previous data still pinned after 60 seconds, releasing it anyway";
+            }
+            delete_region(SharedDataTimestamp::Region(segment, previous_index));
         }
-        hsgr_input_stream.close();
-
-        // acquire lock
-        SharedMemory *data_type_memory =
-            SharedMemoryFactory::Get(CURRENT_REGIONS, sizeof(SharedDataTimestamp), true, false);
-        SharedDataTimestamp *data_timestamp_ptr =
-            static_cast<SharedDataTimestamp *>(data_type_memory->Ptr());
-
-        boost::interprocess::scoped_lock<boost::interprocess::named_mutex> query_lock(
-            barrier.query_mutex);
+        SimpleLogger().Write() << "all data loaded";
 
-        // notify all processes that were waiting for this condition
-        if (0 < barrier.number_of_queries)
+        for (const SharedDataLayout *shared_layout_ptr : changed_layouts)
         {
-            barrier.no_running_queries_condition.wait(query_lock);
+            shared_layout_ptr->PrintInformation();
         }
-
-        data_timestamp_ptr->layout = layout_region;
-        data_timestamp_ptr->data = data_region;
-        data_timestamp_ptr->timestamp += 1;
-        delete_region(previous_data_region);
-        delete_region(previous_layout_region);
-        SimpleLogger().Write() << "all data loaded";
-
-        shared_layout_ptr->PrintInformation();
     }
     catch (const std::exception &e)
     {
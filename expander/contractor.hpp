@@ -154,13 +154,22 @@ private:
 	};
 
 public:
-	template <class ContainerT> Contractor(int nodes, ContainerT &input_edge_list)
+	template <class ContainerT>
+	Contractor(int nodes, ContainerT &input_edge_list)
+		: Contractor(nodes, input_edge_list.size(), input_edge_list.dbegin(), input_edge_list.dend())
+	{
+		// clear input vector
+		input_edge_list.clear();
+	}
+
+	// reads the input edges without consuming them, they may be shared with another reader
+	template <class EdgeIterator>
+	Contractor(int nodes, const std::size_t number_of_input_edges, EdgeIterator first, const EdgeIterator last)
 	{
 		std::vector<ContractorEdge> edges;
-		edges.reserve(input_edge_list.size() * 2);
+		edges.reserve(number_of_input_edges * 2);
 
-		const auto dend = input_edge_list.dend();
-		for (auto diter = input_edge_list.dbegin(); diter != dend; ++diter)
+		for (auto diter = first; diter != last; ++diter)
 		{
 			BOOST_ASSERT_MSG(static_cast<unsigned int>(std::max(diter->weight, 1)) > 0, "edge distance < 1");
 #ifndef NDEBUG
@@ -186,8 +195,6 @@ public:
 							   diter->backward ? true : false,
 							   diter->forward ? true : false);
 		}
-		// clear input vector
-		input_edge_list.clear();
 		edges.shrink_to_fit();
 
 		tbb::parallel_sort(edges.begin(), edges.end());
@@ -303,6 +310,9 @@ public:
 		ThreadDataContainer thread_data_list(number_of_nodes);
 
 		NodeID number_of_contracted_nodes = 0;
+		// nodes contracted in the same round of independent sets share a level
+		unsigned current_level = 0;
+		node_levels.assign(number_of_nodes, 0);
 		std::vector<RemainingNodeData> remaining_nodes(number_of_nodes);
 		std::vector<float> node_priorities(number_of_nodes);
 		std::vector<NodePriorityData> node_data(number_of_nodes);
@@ -515,6 +525,12 @@ public:
 			}
 			);
 
+			for (const auto position : osrm::irange(first_independent_node, last))
+			{
+				node_levels[GetOriginalNodeID(remaining_nodes[position].id)] = current_level;
+			}
+			++current_level;
+
 			// remove contracted nodes from the pool
 			number_of_contracted_nodes += last - first_independent_node;
 			remaining_nodes.resize(first_independent_node);
@@ -547,9 +563,18 @@ public:
 			p.printStatus(number_of_contracted_nodes);
 		}
 
+		// whatever is left over sits on top of the hierarchy
+		for (const RemainingNodeData &remaining_node : remaining_nodes)
+		{
+			node_levels[GetOriginalNodeID(remaining_node.id)] = current_level;
+		}
+
 		thread_data_list.data.clear();
 	}
 
+	// level of every node in the contraction order, the higher the later it was contracted
+	const std::vector<unsigned> &GetNodeLevels() const { return node_levels; }
+
 	template <class Edge> inline void GetEdges(DeallocatingVector<Edge> &edges)
 	{
 		Percent p(contractor_graph->GetNumberOfNodes());
@@ -606,6 +631,11 @@ public:
 	}
 
 private:
+	inline NodeID GetOriginalNodeID(const NodeID node) const
+	{
+		return orig_node_id_to_new_id_map.empty() ? node : orig_node_id_to_new_id_map[node];
+	}
+
 	inline void Dijkstra(const int max_distance,
 						 const unsigned number_of_targets,
 						 const int maxNodes,
@@ -966,6 +996,7 @@ private:
 	std::vector<ContractorGraph::InputEdge> contracted_edge_list;
 	stxxl::vector<QueryEdge> external_edge_list;
 	std::vector<NodeID> orig_node_id_to_new_id_map;
+	std::vector<unsigned> node_levels;
 	XORFastHash fast_hash;
 };
 
@@ -36,9 +36,19 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <boost/assert.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+#include <tbb/pipeline.h>
+
+#include <cstdlib>
 #include <fstream>
 #include <iomanip>
 #include <limits>
+#include <memory>
+#include <random>
+#include <tuple>
 
 EdgeBasedGraphFactory::EdgeBasedGraphFactory(
 		const std::shared_ptr<NodeBasedDynamicGraph> &node_based_graph,
@@ -77,6 +87,11 @@ void EdgeBasedGraphFactory::GetEdgeBasedNodes(std::vector<EdgeBasedNode> &nodes)
 	nodes.swap(m_edge_based_node_list);
 }
 
+const GeometryCompressor &EdgeBasedGraphFactory::GetGeometryCompressor() const
+{
+	return m_geometry_compressor;
+}
+
 void
 EdgeBasedGraphFactory::InsertEdgeBasedNode(const NodeID node_u,
 										   const NodeID node_v,
@@ -118,9 +133,9 @@ EdgeBasedGraphFactory::InsertEdgeBasedNode(const NodeID node_u,
 		BOOST_ASSERT(m_geometry_compressor.HasEntryForID(e2));
 
 		// reconstruct geometry and put in each individual edge with its offset
-		const std::vector<GeometryCompressor::CompressedNode> &forward_geometry =
+		const GeometryCompressor::BucketRange forward_geometry =
 				m_geometry_compressor.GetBucketReference(e1);
-		const std::vector<GeometryCompressor::CompressedNode> &reverse_geometry =
+		const GeometryCompressor::BucketRange reverse_geometry =
 				m_geometry_compressor.GetBucketReference(e2);
 		BOOST_ASSERT(forward_geometry.size() == reverse_geometry.size());
 		BOOST_ASSERT(0 != forward_geometry.size());
@@ -255,7 +270,7 @@ void EdgeBasedGraphFactory::FlushVectorToStream(
 
 void EdgeBasedGraphFactory::Run(const std::string &original_edge_data_filename,
 								const std::string &geometry_filename,
-								lua_State *lua_state)
+								const std::function<lua_State *()> &get_lua_state)
 {
 
 	TIMER_START(geometry);
@@ -271,7 +286,11 @@ void EdgeBasedGraphFactory::Run(const std::string &original_edge_data_filename,
 	TIMER_STOP(generate_nodes);
 
 	TIMER_START(generate_edges);
-	GenerateEdgeExpandedEdges(original_edge_data_filename, lua_state);
+	if (speed_profile.has_turn_penalty_function && speed_profile.tabulate_turn_function)
+	{
+		TabulateTurnPenalties(get_lua_state());
+	}
+	GenerateEdgeExpandedEdges(original_edge_data_filename, get_lua_state);
 	TIMER_STOP(generate_edges);
 
 	m_geometry_compressor.SerializeInternalVector(geometry_filename);
@@ -283,6 +302,153 @@ void EdgeBasedGraphFactory::Run(const std::string &original_edge_data_filename,
 	SimpleLogger().Write() << "Generating edges: " << TIMER_SEC(generate_edges) << "s";
 }
 
+// a path of removable nodes between two nodes that stay
+struct EdgeBasedGraphFactory::CompressibleChain
+{
+	NodeID source;
+	NodeID target;
+	// the edges at source and target that lead into the chain
+	EdgeID first_edge;
+	EdgeID last_edge;
+	unsigned length;
+	// the nodes removed from the front of the chain and the node the merged
+	// edge ends at, the target unless nodes of the chain are kept
+	unsigned removed;
+	unsigned bucket;
+	NodeID first_removed;
+	NodeID last_removed;
+	NodeID end;
+};
+
+bool EdgeBasedGraphFactory::IsRemovable(const NodeID node_v) const
+{
+	// only contract degree 2 vertices
+	if (2 != m_node_based_graph->GetOutDegree(node_v))
+	{
+		return false;
+	}
+
+	// don't contract barrier node
+	if (m_barrier_nodes.end() != m_barrier_nodes.find(node_v))
+	{
+		return false;
+	}
+
+	// check if v is a via node for a turn restriction, i.e. a 'directed' barrier node
+	if (m_restriction_map->IsViaNode(node_v))
+	{
+		return false;
+	}
+
+	const bool reverse_edge_order =
+			!(m_node_based_graph->GetEdgeData(m_node_based_graph->BeginEdges(node_v)).forward);
+	const EdgeID forward_e2 = m_node_based_graph->BeginEdges(node_v) + reverse_edge_order;
+	const EdgeID reverse_e2 = m_node_based_graph->BeginEdges(node_v) + 1 - reverse_edge_order;
+
+	const NodeID node_w = m_node_based_graph->GetTarget(forward_e2);
+	BOOST_ASSERT(SPECIAL_NODEID != node_w);
+	BOOST_ASSERT(node_v != node_w);
+	const NodeID node_u = m_node_based_graph->GetTarget(reverse_e2);
+	BOOST_ASSERT(SPECIAL_NODEID != node_u);
+	BOOST_ASSERT(node_u != node_v);
+
+	const EdgeID forward_e1 = m_node_based_graph->FindEdge(node_u, node_v);
+	BOOST_ASSERT(m_node_based_graph->EndEdges(node_u) != forward_e1);
+	const EdgeID reverse_e1 = m_node_based_graph->FindEdge(node_w, node_v);
+	BOOST_ASSERT(m_node_based_graph->EndEdges(node_w) != reverse_e1);
+
+	// TODO: rename to IsCompatibleTo
+	return m_node_based_graph->GetEdgeData(forward_e1)
+				   .IsEqualTo(m_node_based_graph->GetEdgeData(forward_e2)) &&
+		   m_node_based_graph->GetEdgeData(reverse_e1)
+				   .IsEqualTo(m_node_based_graph->GetEdgeData(reverse_e2));
+}
+
+// the edge of the removable node_v that does not lead back to node_u
+EdgeID EdgeBasedGraphFactory::NextChainEdge(const NodeID node_u, const NodeID node_v) const
+{
+	const EdgeID first_edge = m_node_based_graph->BeginEdges(node_v);
+	return first_edge + (node_u == m_node_based_graph->GetTarget(first_edge) ? 1 : 0);
+}
+
+/**
+ * Merges the edges along a chain into its first edge and the edge leading back
+ * from its end. Each compressed node carries the weight of the segment leading
+ * to it plus the traffic signal penalty if it is a removed signal.
+ */
+void EdgeBasedGraphFactory::CompressChain(CompressibleChain &chain)
+{
+	if (0 == chain.removed)
+	{
+		return;
+	}
+	const unsigned forward_bucket = chain.bucket;
+	const unsigned reverse_bucket = chain.bucket + 1;
+
+	NodeID previous = chain.source;
+	NodeID current = m_node_based_graph->GetTarget(chain.first_edge);
+	EdgeWeight forward_weight = m_node_based_graph->GetEdgeData(chain.first_edge).distance;
+	EdgeWeight previous_penalty = 0;
+	EdgeWeight forward_distance = 0;
+	EdgeWeight reverse_distance = 0;
+	chain.first_removed = current;
+	for (const auto index : osrm::irange(0u, chain.removed))
+	{
+		BOOST_ASSERT(2 == m_node_based_graph->GetOutDegree(current));
+		const EdgeID forward_edge = NextChainEdge(previous, current);
+		const EdgeID backward_edge = (forward_edge == m_node_based_graph->BeginEdges(current))
+										 ? forward_edge + 1
+										 : forward_edge - 1;
+		const EdgeWeight penalty = (m_traffic_lights.find(current) != m_traffic_lights.end())
+									   ? speed_profile.traffic_signal_penalty
+									   : 0;
+
+		m_geometry_compressor.SetBucketEntry(forward_bucket, index, current,
+											 forward_weight + penalty);
+		forward_distance += forward_weight + penalty;
+		const EdgeWeight reverse_weight =
+				m_node_based_graph->GetEdgeData(backward_edge).distance + previous_penalty;
+		m_geometry_compressor.SetBucketEntry(reverse_bucket, chain.removed - index, previous,
+											 reverse_weight);
+		reverse_distance += reverse_weight;
+
+		const NodeID next = m_node_based_graph->GetTarget(forward_edge);
+		forward_weight = m_node_based_graph->GetEdgeData(forward_edge).distance;
+		m_node_based_graph->DeleteEdge(current, m_node_based_graph->BeginEdges(current) + 1);
+		m_node_based_graph->DeleteEdge(current, m_node_based_graph->BeginEdges(current));
+
+		previous_penalty = penalty;
+		previous = current;
+		current = next;
+	}
+	chain.last_removed = previous;
+	chain.end = current;
+
+	// the edges of the chain's target may be changed by other chains, the ones
+	// of a kept node are not
+	const EdgeID end_edge = (chain.removed == chain.length)
+								? chain.last_edge
+								: m_node_based_graph->FindEdge(current, previous);
+	BOOST_ASSERT(previous == m_node_based_graph->GetTarget(end_edge));
+
+	m_geometry_compressor.SetBucketEntry(forward_bucket, chain.removed, current, forward_weight);
+	forward_distance += forward_weight;
+	const EdgeWeight reverse_weight =
+			m_node_based_graph->GetEdgeData(end_edge).distance + previous_penalty;
+	m_geometry_compressor.SetBucketEntry(reverse_bucket, 0, previous, reverse_weight);
+	reverse_distance += reverse_weight;
+
+	m_node_based_graph->GetEdgeData(chain.first_edge).distance = forward_distance;
+	m_node_based_graph->SetTarget(chain.first_edge, current);
+	m_geometry_compressor.AssignBucket(chain.first_edge, forward_bucket);
+	m_node_based_graph->GetEdgeData(end_edge).distance = reverse_distance;
+	m_node_based_graph->SetTarget(end_edge, chain.source);
+	m_geometry_compressor.AssignBucket(end_edge, reverse_bucket);
+
+	BOOST_ASSERT(m_node_based_graph->GetEdgeData(chain.first_edge).nameID ==
+				 m_node_based_graph->GetEdgeData(end_edge).nameID);
+}
+
 void EdgeBasedGraphFactory::CompressGeometry()
 {
 	SimpleLogger().Write() << "Removing graph geometry while preserving topology";
@@ -290,137 +456,132 @@ void EdgeBasedGraphFactory::CompressGeometry()
 	const unsigned original_number_of_nodes = m_node_based_graph->GetNumberOfNodes();
 	const unsigned original_number_of_edges = m_node_based_graph->GetNumberOfEdges();
 
-	Percent progress(original_number_of_nodes);
-
-	for (const NodeID node_v : osrm::irange(0u, original_number_of_nodes))
+	// a degree 2 node is removed if the edges on both sides can be merged
+	std::vector<char> is_removable(original_number_of_nodes, false);
+	tbb::parallel_for(tbb::blocked_range<NodeID>(0, original_number_of_nodes),
+					  [&](const tbb::blocked_range<NodeID> &range)
 	{
-		progress.printStatus(node_v);
-
-		// only contract degree 2 vertices
-		if (2 != m_node_based_graph->GetOutDegree(node_v))
+		for (const NodeID node_v : osrm::irange(range.begin(), range.end()))
 		{
-			continue;
+			is_removable[node_v] = IsRemovable(node_v);
 		}
+	});
 
-		// don't contract barrier node
-		if (m_barrier_nodes.end() != m_barrier_nodes.find(node_v))
+	// Removable nodes form chains between two nodes that stay. Each chain is
+	// found from both of its ends and kept once.
+	tbb::enumerable_thread_specific<std::vector<CompressibleChain>> local_chains;
+	tbb::parallel_for(tbb::blocked_range<NodeID>(0, original_number_of_nodes),
+					  [&](const tbb::blocked_range<NodeID> &range)
+	{
+		std::vector<CompressibleChain> &chains = local_chains.local();
+		for (const NodeID node_u : osrm::irange(range.begin(), range.end()))
 		{
-			continue;
+			if (is_removable[node_u])
+			{
+				continue;
+			}
+			for (const EdgeID first_edge : m_node_based_graph->GetAdjacentEdgeRange(node_u))
+			{
+				NodeID previous = node_u;
+				NodeID current = m_node_based_graph->GetTarget(first_edge);
+				unsigned length = 0;
+				while (is_removable[current])
+				{
+					const NodeID next = m_node_based_graph->GetTarget(NextChainEdge(previous, current));
+					previous = current;
+					current = next;
+					++length;
+				}
+				if (0 == length)
+				{
+					continue;
+				}
+				const EdgeID last_edge = m_node_based_graph->FindEdge(current, previous);
+				if (node_u < current || (node_u == current && first_edge < last_edge))
+				{
+					CompressibleChain chain;
+					chain.source = node_u;
+					chain.target = current;
+					chain.first_edge = first_edge;
+					chain.last_edge = last_edge;
+					chain.length = length;
+					chains.push_back(chain);
+				}
+			}
 		}
+	});
 
-		// check if v is a via node for a turn restriction, i.e. a 'directed' barrier node
-		if (m_restriction_map->IsViaNode(node_v))
+	std::vector<CompressibleChain> chains;
+	for (const std::vector<CompressibleChain> &chains_of_thread : local_chains)
+	{
+		chains.insert(chains.end(), chains_of_thread.begin(), chains_of_thread.end());
+	}
+	tbb::parallel_sort(chains.begin(), chains.end(),
+					   [](const CompressibleChain &lhs, const CompressibleChain &rhs)
+	{
+		return std::tie(lhs.source, lhs.target, lhs.first_edge) <
+				std::tie(rhs.source, rhs.target, rhs.first_edge);
+	});
+
+	// A chain collapses into a single edge unless its ends are connected already,
+	// by an edge or by an earlier chain. Then the node next to its target stays,
+	// and on a loop the two nodes next to its end, so no parallel edges appear.
+	std::vector<unsigned> bucket_sizes;
+	for (const auto i : osrm::irange<std::size_t>(0, chains.size()))
+	{
+		CompressibleChain &chain = chains[i];
+		unsigned kept_nodes = 0;
+		if (chain.source == chain.target)
 		{
-			continue;
+			kept_nodes = 2;
 		}
-
-		const bool reverse_edge_order =
-				!(m_node_based_graph->GetEdgeData(m_node_based_graph->BeginEdges(node_v)).forward);
-		const EdgeID forward_e2 = m_node_based_graph->BeginEdges(node_v) + reverse_edge_order;
-		BOOST_ASSERT(SPECIAL_EDGEID != forward_e2);
-		const EdgeID reverse_e2 = m_node_based_graph->BeginEdges(node_v) + 1 - reverse_edge_order;
-		BOOST_ASSERT(SPECIAL_EDGEID != reverse_e2);
-
-		const EdgeData &fwd_edge_data2 = m_node_based_graph->GetEdgeData(forward_e2);
-		const EdgeData &rev_edge_data2 = m_node_based_graph->GetEdgeData(reverse_e2);
-
-		const NodeID node_w = m_node_based_graph->GetTarget(forward_e2);
-		BOOST_ASSERT(SPECIAL_NODEID != node_w);
-		BOOST_ASSERT(node_v != node_w);
-		const NodeID node_u = m_node_based_graph->GetTarget(reverse_e2);
-		BOOST_ASSERT(SPECIAL_NODEID != node_u);
-		BOOST_ASSERT(node_u != node_v);
-
-		const EdgeID forward_e1 = m_node_based_graph->FindEdge(node_u, node_v);
-		BOOST_ASSERT(m_node_based_graph->EndEdges(node_u) != forward_e1);
-		BOOST_ASSERT(SPECIAL_EDGEID != forward_e1);
-		BOOST_ASSERT(node_v == m_node_based_graph->GetTarget(forward_e1));
-		const EdgeID reverse_e1 = m_node_based_graph->FindEdge(node_w, node_v);
-		BOOST_ASSERT(SPECIAL_EDGEID != reverse_e1);
-		BOOST_ASSERT(node_v == m_node_based_graph->GetTarget(reverse_e1));
-
-		const EdgeData &fwd_edge_data1 = m_node_based_graph->GetEdgeData(forward_e1);
-		const EdgeData &rev_edge_data1 = m_node_based_graph->GetEdgeData(reverse_e1);
-
-		if ((m_node_based_graph->FindEdge(node_u, node_w) != m_node_based_graph->EndEdges(node_u)) ||
-				(m_node_based_graph->FindEdge(node_w, node_u) != m_node_based_graph->EndEdges(node_w)))
+		else if ((0 < i && chains[i - 1].source == chain.source &&
+				  chains[i - 1].target == chain.target) ||
+				 (m_node_based_graph->FindEdge(chain.source, chain.target) !=
+				  m_node_based_graph->EndEdges(chain.source)) ||
+				 (m_node_based_graph->FindEdge(chain.target, chain.source) !=
+				  m_node_based_graph->EndEdges(chain.target)))
+		{
+			kept_nodes = 1;
+		}
+		chain.removed = (chain.length > kept_nodes) ? chain.length - kept_nodes : 0;
+		if (0 == chain.removed)
 		{
 			continue;
 		}
+		chain.bucket = bucket_sizes.size();
+		bucket_sizes.push_back(chain.removed + 1);
+		bucket_sizes.push_back(chain.removed + 1);
+		removed_node_count += chain.removed;
+	}
+	m_geometry_compressor.AllocateBuckets(original_number_of_edges, bucket_sizes);
 
-		if ( // TODO: rename to IsCompatibleTo
-			 fwd_edge_data1.IsEqualTo(fwd_edge_data2) &&
-			 rev_edge_data1.IsEqualTo(rev_edge_data2))
+	// Chains share no nodes but their ends and no edges, so each one is
+	// collapsed on its own. The surviving edges are the ones at the ends.
+	tbb::parallel_for(tbb::blocked_range<std::size_t>(0, chains.size()),
+					  [&](const tbb::blocked_range<std::size_t> &range)
+	{
+		for (const auto i : osrm::irange(range.begin(), range.end()))
 		{
-			// Get distances before graph is modified
-			const int forward_weight1 = m_node_based_graph->GetEdgeData(forward_e1).distance;
-			const int forward_weight2 = m_node_based_graph->GetEdgeData(forward_e2).distance;
-
-			BOOST_ASSERT(0 != forward_weight1);
-			BOOST_ASSERT(0 != forward_weight2);
-
-			const int reverse_weight1 = m_node_based_graph->GetEdgeData(reverse_e1).distance;
-			const int reverse_weight2 = m_node_based_graph->GetEdgeData(reverse_e2).distance;
-
-			BOOST_ASSERT(0 != reverse_weight1);
-			BOOST_ASSERT(0 != forward_weight2);
-
-			const bool add_traffic_signal_penalty =
-					(m_traffic_lights.find(node_v) != m_traffic_lights.end());
-
-			// add weight of e2's to e1
-			m_node_based_graph->GetEdgeData(forward_e1).distance += fwd_edge_data2.distance;
-			m_node_based_graph->GetEdgeData(reverse_e1).distance += rev_edge_data2.distance;
-			if (add_traffic_signal_penalty)
-			{
-				m_node_based_graph->GetEdgeData(forward_e1).distance +=
-						speed_profile.traffic_signal_penalty;
-				m_node_based_graph->GetEdgeData(reverse_e1).distance +=
-						speed_profile.traffic_signal_penalty;
-			}
+			CompressChain(chains[i]);
+		}
+	});
 
-			// extend e1's to targets of e2's
-			m_node_based_graph->SetTarget(forward_e1, node_w);
-			m_node_based_graph->SetTarget(reverse_e1, node_u);
-
-			// remove e2's (if bidir, otherwise only one)
-			m_node_based_graph->DeleteEdge(node_v, forward_e2);
-			m_node_based_graph->DeleteEdge(node_v, reverse_e2);
-
-			// update any involved turn restrictions
-			m_restriction_map->FixupStartingTurnRestriction(node_u, node_v, node_w);
-			m_restriction_map->FixupArrivingTurnRestriction(node_u, node_v,
-															node_w,
-															m_node_based_graph);
-
-			m_restriction_map->FixupStartingTurnRestriction(node_w, node_v, node_u);
-			m_restriction_map->FixupArrivingTurnRestriction(node_w,
-															node_v,
-															node_u, m_node_based_graph);
-
-			// store compressed geometry in container
-			m_geometry_compressor.CompressEdge(
-						forward_e1,
-						forward_e2,
-						node_v,
-						node_w,
-						forward_weight1 +
-						(add_traffic_signal_penalty ? speed_profile.traffic_signal_penalty : 0),
-						forward_weight2);
-			m_geometry_compressor.CompressEdge(
-						reverse_e1,
-						reverse_e2,
-						node_v,
-						node_u,
-						reverse_weight1,
-						reverse_weight2 +
-						(add_traffic_signal_penalty ? speed_profile.traffic_signal_penalty : 0));
-			++removed_node_count;
-
-			BOOST_ASSERT(m_node_based_graph->GetEdgeData(forward_e1).nameID ==
-						 m_node_based_graph->GetEdgeData(reverse_e1).nameID);
+	// the turn restrictions are updated as if the nodes were removed one by one
+	for (const CompressibleChain &chain : chains)
+	{
+		if (0 == chain.removed)
+		{
+			continue;
 		}
+		m_restriction_map->FixupStartingTurnRestriction(chain.source, chain.last_removed, chain.end);
+		m_restriction_map->FixupArrivingTurnRestriction(chain.source, chain.first_removed, chain.end,
+														m_node_based_graph);
+		m_restriction_map->FixupStartingTurnRestriction(chain.end, chain.first_removed, chain.source);
+		m_restriction_map->FixupArrivingTurnRestriction(chain.end, chain.last_removed, chain.source,
+														m_node_based_graph);
 	}
+
 	SimpleLogger().Write() << "removed " << removed_node_count << " nodes";
 	m_geometry_compressor.PrintStatistics();
 
@@ -541,12 +702,33 @@ void EdgeBasedGraphFactory::GenerateEdgeExpandedNodes()
 						   << " nodes in edge-expanded graph";
 }
 
+// the turns out of a range of nodes, in the order of the serial loop
+struct EdgeBasedGraphFactory::TurnChunk
+{
+	explicit TurnChunk(const NodeID begin, const NodeID end)
+		: begin(begin), end(end), node_based_edge_counter(0), restricted_turns_counter(0),
+		  skipped_uturns_counter(0), skipped_barrier_turns_counter(0), compressed(0)
+	{
+	}
+
+	NodeID begin;
+	NodeID end;
+	// the edge ids are the positions in the chunk until the chunks are merged
+	std::vector<EdgeBasedEdge> edge_based_edges;
+	std::vector<OriginalEdgeData> original_edge_data;
+	unsigned node_based_edge_counter;
+	unsigned restricted_turns_counter;
+	unsigned skipped_uturns_counter;
+	unsigned skipped_barrier_turns_counter;
+	unsigned compressed;
+};
+
 /**
  * Actually it also generates OriginalEdgeData and serializes them...
  */
 void
 EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(const std::string &original_edge_data_filename,
-												 lua_State *lua_state)
+												 const std::function<lua_State *()> &get_lua_state)
 {
 	SimpleLogger().Write() << "generating edge-expanded edges";
 
@@ -558,22 +740,90 @@ EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(const std::string &original_edg
 	// writes a dummy value that is updated later
 	edge_data_file.write((char *)&original_edges_counter, sizeof(unsigned));
 
-	std::vector<OriginalEdgeData> original_edge_data_vector;
-	original_edge_data_vector.reserve(1024 * 1024);
-
-	// Loop over all turns and generate new set of edges.
-	// Three nested loop look super-linear, but we are dealing with a (kind of)
-	// linear number of turns only.
 	unsigned restricted_turns_counter = 0;
 	unsigned skipped_uturns_counter = 0;
 	unsigned skipped_barrier_turns_counter = 0;
 	unsigned compressed = 0;
 
-	Percent progress(m_node_based_graph->GetNumberOfNodes());
+	const NodeID number_of_nodes = m_node_based_graph->GetNumberOfNodes();
+	Percent progress(number_of_nodes);
+
+	// The turns of chunks of nodes are generated in parallel and merged in the
+	// order of the nodes, so the edge ids and the .edges file come out as in
+	// a serial loop. Only a bounded number of chunks is held at a time.
+	const NodeID nodes_per_chunk = 16 * 1024;
+	const std::size_t chunks_in_flight = 64;
+	NodeID next_chunk_begin = 0;
+	tbb::parallel_pipeline(
+		chunks_in_flight,
+		tbb::make_filter<void, std::shared_ptr<TurnChunk>>(
+			tbb::filter::serial_in_order,
+			[&](tbb::flow_control &flow_control) -> std::shared_ptr<TurnChunk>
+			{
+				if (next_chunk_begin >= number_of_nodes)
+				{
+					flow_control.stop();
+					return nullptr;
+				}
+				const NodeID begin = next_chunk_begin;
+				next_chunk_begin = begin + std::min(nodes_per_chunk, number_of_nodes - begin);
+				return std::make_shared<TurnChunk>(begin, next_chunk_begin);
+			}) &
+		tbb::make_filter<std::shared_ptr<TurnChunk>, std::shared_ptr<TurnChunk>>(
+			tbb::filter::parallel,
+			[&](std::shared_ptr<TurnChunk> chunk)
+			{
+				GenerateTurns(*chunk, get_lua_state);
+				return chunk;
+			}) &
+		tbb::make_filter<std::shared_ptr<TurnChunk>, void>(
+			tbb::filter::serial_in_order,
+			[&](std::shared_ptr<TurnChunk> chunk)
+			{
+				for (EdgeBasedEdge &edge : chunk->edge_based_edges)
+				{
+					edge.edge_id = m_edge_based_edge_list.size();
+					m_edge_based_edge_list.push_back(edge);
+				}
+				original_edges_counter += chunk->original_edge_data.size();
+				FlushVectorToStream(edge_data_file, chunk->original_edge_data);
 
-	for (const auto u : osrm::irange(0u, m_node_based_graph->GetNumberOfNodes()))
+				node_based_edge_counter += chunk->node_based_edge_counter;
+				restricted_turns_counter += chunk->restricted_turns_counter;
+				skipped_uturns_counter += chunk->skipped_uturns_counter;
+				skipped_barrier_turns_counter += chunk->skipped_barrier_turns_counter;
+				compressed += chunk->compressed;
+				progress.printStatus(chunk->end - 1);
+			}));
+
+	edge_data_file.seekp(std::ios::beg);
+	edge_data_file.write((char *)&original_edges_counter, sizeof(unsigned));
+	edge_data_file.close();
+
+	SimpleLogger().Write() << "Generated " << m_edge_based_node_list.size() << " edge based nodes";
+	SimpleLogger().Write() << "Node-based graph contains " << node_based_edge_counter << " edges";
+	SimpleLogger().Write() << "Edge-expanded graph ...";
+	SimpleLogger().Write() << "  contains " << m_edge_based_edge_list.size() << " edges";
+	SimpleLogger().Write() << "  skips " << restricted_turns_counter << " turns, "
+																		"defined by "
+						   << m_restriction_map->size() << " restrictions";
+	SimpleLogger().Write() << "  skips " << skipped_uturns_counter << " U turns";
+	SimpleLogger().Write() << "  skips " << skipped_barrier_turns_counter << " turns over barriers";
+}
+
+void EdgeBasedGraphFactory::GenerateTurns(TurnChunk &chunk,
+										  const std::function<lua_State *()> &get_lua_state) const
+{
+	// only a turn function that is not tabulated needs the Lua state of this thread
+	lua_State *lua_state =
+			(speed_profile.has_turn_penalty_function && m_turn_penalty_table.empty()) ? get_lua_state()
+																					  : nullptr;
+
+	// Loop over all turns and generate new set of edges.
+	// Three nested loop look super-linear, but we are dealing with a (kind of)
+	// linear number of turns only.
+	for (const auto u : osrm::irange(chunk.begin, chunk.end))
 	{
-		progress.printStatus(u);
 		for (const EdgeID e1 : m_node_based_graph->GetAdjacentEdgeRange(u))
 		{
 			if (!m_node_based_graph->GetEdgeData(e1).forward)
@@ -581,7 +831,7 @@ EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(const std::string &original_edg
 				continue;
 			}
 
-			++node_based_edge_counter;
+			++chunk.node_based_edge_counter;
 			const NodeID v = m_node_based_graph->GetTarget(e1);
 			const NodeID to_node_of_only_restriction =
 					m_restriction_map->CheckForEmanatingIsOnlyTurn(u, v);
@@ -599,7 +849,7 @@ EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(const std::string &original_edg
 						(w != to_node_of_only_restriction))
 				{
 					// We are at an only_-restriction but not at the right turn.
-					++restricted_turns_counter;
+					++chunk.restricted_turns_counter;
 					continue;
 				}
 
@@ -607,7 +857,7 @@ EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(const std::string &original_edg
 				{
 					if (u != w)
 					{
-						++skipped_barrier_turns_counter;
+						++chunk.skipped_barrier_turns_counter;
 						continue;
 					}
 				}
@@ -615,7 +865,7 @@ EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(const std::string &original_edg
 				{
 					if ((u == w) && (m_node_based_graph->GetOutDegree(v) > 1))
 					{
-						++skipped_uturns_counter;
+						++chunk.skipped_uturns_counter;
 						continue;
 					}
 				}
@@ -627,7 +877,7 @@ EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(const std::string &original_edg
 						(w != to_node_of_only_restriction))
 				{
 					// We are at an only_-restriction but not at the right turn.
-					++restricted_turns_counter;
+					++chunk.restricted_turns_counter;
 					continue;
 				}
 
@@ -671,53 +921,40 @@ EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(const std::string &original_edg
 
 				if (edge_is_compressed)
 				{
-					++compressed;
+					++chunk.compressed;
 				}
 
-				original_edge_data_vector.emplace_back(
+				chunk.original_edge_data.emplace_back(
 							(edge_is_compressed ? m_geometry_compressor.GetPositionForID(e1) : v),
 							edge_data1.nameID,
 							turn_instruction,
 							edge_is_compressed,
 							edge_data2.travel_mode);
 
-				++original_edges_counter;
-
-				if (original_edge_data_vector.size() > 1024 * 1024 * 10)
-				{
-					FlushVectorToStream(edge_data_file, original_edge_data_vector);
-				}
-
 				BOOST_ASSERT(SPECIAL_NODEID != edge_data1.edgeBasedNodeID);
 				BOOST_ASSERT(SPECIAL_NODEID != edge_data2.edgeBasedNodeID);
 
-				m_edge_based_edge_list.emplace_back(EdgeBasedEdge(edge_data1.edgeBasedNodeID,
-																  edge_data2.edgeBasedNodeID,
-																  m_edge_based_edge_list.size(),
-																  distance,
-																  true,
-																  false));
+				chunk.edge_based_edges.emplace_back(edge_data1.edgeBasedNodeID,
+													edge_data2.edgeBasedNodeID,
+													chunk.edge_based_edges.size(),
+													distance,
+													true,
+													false);
 			}
 		}
 	}
-	FlushVectorToStream(edge_data_file, original_edge_data_vector);
-
-	edge_data_file.seekp(std::ios::beg);
-	edge_data_file.write((char *)&original_edges_counter, sizeof(unsigned));
-	edge_data_file.close();
-
-	SimpleLogger().Write() << "Generated " << m_edge_based_node_list.size() << " edge based nodes";
-	SimpleLogger().Write() << "Node-based graph contains " << node_based_edge_counter << " edges";
-	SimpleLogger().Write() << "Edge-expanded graph ...";
-	SimpleLogger().Write() << "  contains " << m_edge_based_edge_list.size() << " edges";
-	SimpleLogger().Write() << "  skips " << restricted_turns_counter << " turns, "
-																		"defined by "
-						   << m_restriction_map->size() << " restrictions";
-	SimpleLogger().Write() << "  skips " << skipped_uturns_counter << " U turns";
-	SimpleLogger().Write() << "  skips " << skipped_barrier_turns_counter << " turns over barriers";
 }
 
 int EdgeBasedGraphFactory::GetTurnPenalty(double angle, lua_State *lua_state) const
+{
+	if (!m_turn_penalty_table.empty())
+	{
+		return m_turn_penalty_table(angle);
+	}
+	return CallTurnFunction(angle, lua_state);
+}
+
+int EdgeBasedGraphFactory::CallTurnFunction(double angle, lua_State *lua_state) const
 {
 
 	if (speed_profile.has_turn_penalty_function)
@@ -732,6 +969,51 @@ int EdgeBasedGraphFactory::GetTurnPenalty(double angle, lua_State *lua_state) co
 	return 0;
 }
 
+void EdgeBasedGraphFactory::TabulateTurnPenalties(lua_State *lua_state)
+{
+	m_turn_penalty_table = TurnPenaltyTable([&](const double angle)
+											{
+												return CallTurnFunction(angle, lua_state);
+											});
+	SimpleLogger().Write() << "Sampled turn_function at " << TurnPenaltyTable::SamplesPerDegree
+						   << " angles per degree";
+
+	if (0 == speed_profile.turn_penalty_validation_samples)
+	{
+		return;
+	}
+
+	// the same angles are drawn on every run
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<double> angle_distribution(0., 360.);
+	unsigned mismatches = 0;
+	int max_deviation = 0;
+	for (unsigned sample = 0; sample < speed_profile.turn_penalty_validation_samples; ++sample)
+	{
+		const double angle = angle_distribution(generator);
+		const int deviation =
+				std::abs(m_turn_penalty_table(angle) - CallTurnFunction(angle, lua_state));
+		if (0 != deviation)
+		{
+			++mismatches;
+			max_deviation = std::max(max_deviation, deviation);
+		}
+	}
+
+	if (0 == mismatches)
+	{
+		SimpleLogger().Write() << "Turn penalty table matches turn_function on "
+							   << speed_profile.turn_penalty_validation_samples << " sampled angles";
+	}
+	else
+	{
+		SimpleLogger().Write(logWARNING) << "Turn penalty table differs from turn_function on "
+										 << mismatches << " of "
+										 << speed_profile.turn_penalty_validation_samples
+										 << " sampled angles, by up to " << max_deviation;
+	}
+}
+
 TurnInstruction EdgeBasedGraphFactory::AnalyzeTurn(const NodeID node_u,
 												   const NodeID node_v,
 												   const NodeID node_w,
@@ -39,8 +39,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../data_structures/turn_instructions.hpp"
 #include "../data_structures/node_based_graph.hpp"
 #include "../data_structures/restriction_map.hpp"
+#include "../data_structures/turn_penalty_table.hpp"
 
 #include <algorithm>
+#include <functional>
 #include <iosfwd>
 #include <memory>
 #include <queue>
@@ -66,9 +68,10 @@ public:
 								   std::vector<QueryNode> &node_info_list,
 								   SpeedProfileProperties &speed_profile);
 
+	// get_lua_state returns the Lua state of the calling thread
 	void Run(const std::string &original_edge_data_filename,
 			 const std::string &geometry_filename,
-			 lua_State *lua_state);
+			 const std::function<lua_State *()> &get_lua_state);
 
 	void GetEdgeBasedEdges(DeallocatingVector<EdgeBasedEdge> &edges);
 
@@ -80,16 +83,27 @@ public:
 
 	unsigned GetNumberOfEdgeBasedNodes() const;
 
+	// Removes the degree 2 nodes between edges that can be merged and keeps them
+	// in the geometry of the merged edges. The first step of Run().
+	void CompressGeometry();
+
+	const GeometryCompressor &GetGeometryCompressor() const;
+
 	struct SpeedProfileProperties
 	{
 		SpeedProfileProperties()
-			: traffic_signal_penalty(0), u_turn_penalty(0), has_turn_penalty_function(false)
+			: traffic_signal_penalty(0), u_turn_penalty(0), has_turn_penalty_function(false),
+			  tabulate_turn_function(false), turn_penalty_validation_samples(0)
 		{
 		}
 
 		int traffic_signal_penalty;
 		int u_turn_penalty;
 		bool has_turn_penalty_function;
+		// the turn function depends on the angle only and is sampled into a table
+		bool tabulate_turn_function;
+		// number of random angles on which the table is compared against the turn function
+		unsigned turn_penalty_validation_samples;
 	} speed_profile;
 
 private:
@@ -109,11 +123,23 @@ private:
 
 	GeometryCompressor m_geometry_compressor;
 
-	void CompressGeometry();
+	TurnPenaltyTable m_turn_penalty_table;
+
+	struct CompressibleChain;
+
+	bool IsRemovable(const NodeID node_v) const;
+	EdgeID NextChainEdge(const NodeID node_u, const NodeID node_v) const;
+	void CompressChain(CompressibleChain &chain);
 	void RenumberEdges();
 	void GenerateEdgeExpandedNodes();
+	void TabulateTurnPenalties(lua_State *lua_state);
+	int CallTurnFunction(double angle, lua_State *lua_state) const;
+
+	struct TurnChunk;
+
 	void GenerateEdgeExpandedEdges(const std::string &original_edge_data_filename,
-								   lua_State *lua_state);
+								   const std::function<lua_State *()> &get_lua_state);
+	void GenerateTurns(TurnChunk &chunk, const std::function<lua_State *()> &get_lua_state) const;
 
 	void InsertEdgeBasedNode(const NodeID u, const NodeID v, const unsigned component_id);
 
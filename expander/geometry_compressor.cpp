@@ -26,185 +26,122 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "geometry_compressor.hpp"
+#include "../data_structures/geometry_coding.hpp"
+#include "../Util/integer_range.hpp"
 #include "../Util/simple_logger.hpp"
 
 #include <boost/assert.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 
+#include <algorithm>
+#include <cstdint>
 #include <limits>
 #include <string>
 
-int free_list_maximum = 0;
-int UniqueNumber() { return ++free_list_maximum; }
+GeometryCompressor::GeometryCompressor() : m_bucket_offsets(1, 0) {}
 
-GeometryCompressor::GeometryCompressor()
+void GeometryCompressor::AllocateBuckets(const EdgeID number_of_edges,
+                                         const std::vector<unsigned> &bucket_sizes)
 {
-    m_free_list.reserve(100);
-    IncreaseFreeList();
-}
-
-void GeometryCompressor::IncreaseFreeList()
-{
-    m_compressed_geometries.resize(m_compressed_geometries.size() + 100);
-    for (unsigned i = 100; i > 0; --i)
+    m_bucket_offsets.clear();
+    m_bucket_offsets.reserve(bucket_sizes.size() + 1);
+    unsigned prefix_sum_of_bucket_sizes = 0;
+    for (const unsigned bucket_size : bucket_sizes)
     {
-        m_free_list.emplace_back(free_list_maximum);
-        ++free_list_maximum;
+        m_bucket_offsets.emplace_back(prefix_sum_of_bucket_sizes);
+        BOOST_ASSERT(std::numeric_limits<unsigned>::max() - bucket_size >=
+                     prefix_sum_of_bucket_sizes);
+        prefix_sum_of_bucket_sizes += bucket_size;
     }
+    m_bucket_offsets.emplace_back(prefix_sum_of_bucket_sizes);
+
+    m_compressed_nodes.clear();
+    m_compressed_nodes.resize(prefix_sum_of_bucket_sizes);
+    m_edge_id_to_bucket.assign(number_of_edges, std::numeric_limits<unsigned>::max());
 }
 
-bool GeometryCompressor::HasEntryForID(const EdgeID edge_id) const
+void GeometryCompressor::SetBucketEntry(const unsigned position,
+                                        const unsigned index,
+                                        const NodeID node_id,
+                                        const EdgeWeight weight)
 {
-    auto iter = m_edge_id_to_list_index_map.find(edge_id);
-    return iter != m_edge_id_to_list_index_map.end();
+    BOOST_ASSERT(position + 1 < m_bucket_offsets.size());
+    BOOST_ASSERT(m_bucket_offsets[position] + index < m_bucket_offsets[position + 1]);
+    BOOST_ASSERT(SPECIAL_NODEID != node_id);
+    BOOST_ASSERT(INVALID_EDGE_WEIGHT != weight);
+    m_compressed_nodes[m_bucket_offsets[position] + index] = CompressedNode(node_id, weight);
 }
 
-unsigned GeometryCompressor::GetPositionForID(const EdgeID edge_id) const
+void GeometryCompressor::AssignBucket(const EdgeID edge_id, const unsigned position)
 {
-    auto map_iterator = m_edge_id_to_list_index_map.find(edge_id);
-    BOOST_ASSERT(map_iterator != m_edge_id_to_list_index_map.end());
-    BOOST_ASSERT(map_iterator->second < m_compressed_geometries.size());
-    return map_iterator->second;
+    BOOST_ASSERT(edge_id < m_edge_id_to_bucket.size());
+    BOOST_ASSERT(position + 1 < m_bucket_offsets.size());
+    m_edge_id_to_bucket[edge_id] = position;
 }
 
-void GeometryCompressor::SerializeInternalVector(const std::string &path) const
+bool GeometryCompressor::HasEntryForID(const EdgeID edge_id) const
 {
+    return edge_id < m_edge_id_to_bucket.size() &&
+           std::numeric_limits<unsigned>::max() != m_edge_id_to_bucket[edge_id];
+}
 
-    boost::filesystem::fstream geometry_out_stream(path, std::ios::binary | std::ios::out);
-    const unsigned compressed_geometries = m_compressed_geometries.size() + 1;
-    BOOST_ASSERT(std::numeric_limits<unsigned>::max() != compressed_geometries);
-    geometry_out_stream.write((char *)&compressed_geometries, sizeof(unsigned));
-
-    // write indices array
-    unsigned prefix_sum_of_list_indices = 0;
-    for (const auto &elem : m_compressed_geometries)
-    {
-        geometry_out_stream.write((char *)&prefix_sum_of_list_indices, sizeof(unsigned));
-
-        const std::vector<CompressedNode> &current_vector = elem;
-        const unsigned unpacked_size = current_vector.size();
-        BOOST_ASSERT(std::numeric_limits<unsigned>::max() != unpacked_size);
-        prefix_sum_of_list_indices += unpacked_size;
-    }
-    // sentinel element
-    geometry_out_stream.write((char *)&prefix_sum_of_list_indices, sizeof(unsigned));
-
-    // number of geometry entries to follow, it is the (inclusive) prefix sum
-    geometry_out_stream.write((char *)&prefix_sum_of_list_indices, sizeof(unsigned));
-
-    unsigned control_sum = 0;
-    // write compressed geometries
-    for (auto &elem : m_compressed_geometries)
-    {
-        const std::vector<CompressedNode> &current_vector = elem;
-        const unsigned unpacked_size = current_vector.size();
-        control_sum += unpacked_size;
-        BOOST_ASSERT(std::numeric_limits<unsigned>::max() != unpacked_size);
-        for (const CompressedNode current_node : current_vector)
-        {
-            geometry_out_stream.write((char *)&(current_node.first), sizeof(NodeID));
-        }
-    }
-    BOOST_ASSERT(control_sum == prefix_sum_of_list_indices);
-    // all done, let's close the resource
-    geometry_out_stream.close();
+unsigned GeometryCompressor::GetPositionForID(const EdgeID edge_id) const
+{
+    BOOST_ASSERT(HasEntryForID(edge_id));
+    BOOST_ASSERT(m_edge_id_to_bucket[edge_id] + 1 < m_bucket_offsets.size());
+    return m_edge_id_to_bucket[edge_id];
 }
 
-void GeometryCompressor::CompressEdge(const EdgeID edge_id_1,
-                                      const EdgeID edge_id_2,
-                                      const NodeID via_node_id,
-                                      const NodeID target_node_id,
-                                      const EdgeWeight weight1,
-                                      const EdgeWeight weight2)
+// The file holds the number of buckets plus one, the byte offset of every
+// bucket and a sentinel, the number of bytes and the node ids of all buckets
+// in the layout of GeometryCoding. Everything but the ids is 64 bit wide, so
+// the arrays stay aligned when the file is mapped.
+void GeometryCompressor::SerializeInternalVector(const std::string &path) const
 {
-    // remove super-trivial geometries
-    BOOST_ASSERT(SPECIAL_EDGEID != edge_id_1);
-    BOOST_ASSERT(SPECIAL_EDGEID != edge_id_2);
-    BOOST_ASSERT(SPECIAL_NODEID != via_node_id);
-    BOOST_ASSERT(SPECIAL_NODEID != target_node_id);
-    BOOST_ASSERT(INVALID_EDGE_WEIGHT != weight1);
-    BOOST_ASSERT(INVALID_EDGE_WEIGHT != weight2);
-
-    // append list of removed edge_id plus via node to surviving edge id:
-    // <surv_1, .. , surv_n, via_node_id, rem_1, .. rem_n
-    //
-    // General scheme:
-    // 1. append via node id to list of edge_id_1
-    // 2. find list for edge_id_2, if yes add all elements and delete it
-
-    // Add via node id. List is created if it does not exist
-    if (!HasEntryForID(edge_id_1))
+    std::vector<std::uint64_t> byte_offsets;
+    byte_offsets.reserve(m_bucket_offsets.size());
+    std::vector<unsigned char> encoded_node_ids;
+    encoded_node_ids.reserve(2 * m_compressed_nodes.size());
+    for (const auto i : osrm::irange<std::size_t>(1, m_bucket_offsets.size()))
     {
-        // create a new entry in the map
-        if (0 == m_free_list.size())
+        byte_offsets.emplace_back(encoded_node_ids.size());
+        NodeID previous_node_id = 0;
+        for (const auto j : osrm::irange(m_bucket_offsets[i - 1], m_bucket_offsets[i]))
         {
-            // make sure there is a place to put the entries
-            IncreaseFreeList();
+            GeometryCoding::Encode(m_compressed_nodes[j].first, previous_node_id, encoded_node_ids);
         }
-        BOOST_ASSERT(!m_free_list.empty());
-        m_edge_id_to_list_index_map[edge_id_1] = m_free_list.back();
-        m_free_list.pop_back();
     }
+    // sentinel element
+    byte_offsets.emplace_back(encoded_node_ids.size());
 
-    // find bucket index
-    const auto iter = m_edge_id_to_list_index_map.find(edge_id_1);
-    BOOST_ASSERT(iter != m_edge_id_to_list_index_map.end());
-    const unsigned edge_bucket_id1 = iter->second;
-    BOOST_ASSERT(edge_bucket_id1 == GetPositionForID(edge_id_1));
-    BOOST_ASSERT(edge_bucket_id1 < m_compressed_geometries.size());
-
-    std::vector<CompressedNode> &edge_bucket_list1 = m_compressed_geometries[edge_bucket_id1];
-
-    if (edge_bucket_list1.empty())
-    {
-        edge_bucket_list1.emplace_back(via_node_id, weight1);
-    }
+    boost::filesystem::fstream geometry_out_stream(path, std::ios::binary | std::ios::out);
+    const std::uint64_t number_of_indices = byte_offsets.size();
+    geometry_out_stream.write((char *)&number_of_indices, sizeof(std::uint64_t));
+    geometry_out_stream.write((char *)byte_offsets.data(),
+                              byte_offsets.size() * sizeof(std::uint64_t));
 
-    BOOST_ASSERT(0 < edge_bucket_list1.size());
-    BOOST_ASSERT(!edge_bucket_list1.empty());
+    const std::uint64_t number_of_bytes = encoded_node_ids.size();
+    geometry_out_stream.write((char *)&number_of_bytes, sizeof(std::uint64_t));
+    geometry_out_stream.write((char *)encoded_node_ids.data(), encoded_node_ids.size());
 
-    if (HasEntryForID(edge_id_2))
-    {
-        // second edge is not atomic anymore
-        const unsigned list_to_remove_index = GetPositionForID(edge_id_2);
-        BOOST_ASSERT(list_to_remove_index < m_compressed_geometries.size());
-
-        std::vector<CompressedNode> &edge_bucket_list2 =
-            m_compressed_geometries[list_to_remove_index];
-
-        // found an existing list, append it to the list of edge_id_1
-        edge_bucket_list1.insert(
-            edge_bucket_list1.end(), edge_bucket_list2.begin(), edge_bucket_list2.end());
-
-        // remove the list of edge_id_2
-        m_edge_id_to_list_index_map.erase(edge_id_2);
-        BOOST_ASSERT(m_edge_id_to_list_index_map.end() ==
-                     m_edge_id_to_list_index_map.find(edge_id_2));
-        edge_bucket_list2.clear();
-        BOOST_ASSERT(0 == edge_bucket_list2.size());
-        m_free_list.emplace_back(list_to_remove_index);
-        BOOST_ASSERT(list_to_remove_index == m_free_list.back());
-    }
-    else
-    {
-        // we are certain that the second edge is atomic.
-        edge_bucket_list1.emplace_back(target_node_id, weight2);
-    }
+    SimpleLogger().Write() << "encoded " << m_compressed_nodes.size() << " geometry nodes in "
+                           << number_of_bytes << " bytes";
+    // all done, let's close the resource
+    geometry_out_stream.close();
 }
 
 void GeometryCompressor::PrintStatistics() const
 {
-    const uint64_t compressed_edges = m_compressed_geometries.size();
+    const uint64_t compressed_edges = m_bucket_offsets.size() - 1;
     BOOST_ASSERT(0 == compressed_edges % 2);
-    BOOST_ASSERT(m_compressed_geometries.size() + m_free_list.size() > 0);
 
-    uint64_t compressed_geometries = 0;
+    const uint64_t compressed_geometries = m_compressed_nodes.size();
     uint64_t longest_chain_length = 0;
-    for (const std::vector<CompressedNode> &current_vector : m_compressed_geometries)
+    for (const auto i : osrm::irange<std::size_t>(1, m_bucket_offsets.size()))
     {
-        compressed_geometries += current_vector.size();
-        longest_chain_length = std::max(longest_chain_length, (uint64_t)current_vector.size());
+        longest_chain_length = std::max(longest_chain_length,
+                                        (uint64_t)(m_bucket_offsets[i] - m_bucket_offsets[i - 1]));
     }
 
     SimpleLogger().Write() << "Geometry successfully removed:"
@@ -219,23 +156,22 @@ void GeometryCompressor::PrintStatistics() const
                                   std::max((uint64_t)1, compressed_edges);
 }
 
-const std::vector<GeometryCompressor::CompressedNode> &
-GeometryCompressor::GetBucketReference(const EdgeID edge_id) const
+GeometryCompressor::BucketRange GeometryCompressor::GetBucketReference(const EdgeID edge_id) const
 {
-    const unsigned index = m_edge_id_to_list_index_map.at(edge_id);
-    return m_compressed_geometries.at(index);
+    const unsigned position = GetPositionForID(edge_id);
+    return osrm::util::range(m_compressed_nodes.begin() + m_bucket_offsets[position],
+                             m_compressed_nodes.begin() + m_bucket_offsets[position + 1]);
 }
 
     NodeID GeometryCompressor::GetFirstNodeIDOfBucket(const EdgeID edge_id) const
     {
-        const auto &bucket = GetBucketReference(edge_id);
+        const auto bucket = GetBucketReference(edge_id);
         BOOST_ASSERT(bucket.size() >= 2);
         return bucket[1].first;
     }
     NodeID GeometryCompressor::GetLastNodeIDOfBucket(const EdgeID edge_id) const
     {
-        const auto &bucket = GetBucketReference(edge_id);
+        const auto bucket = GetBucketReference(edge_id);
         BOOST_ASSERT(bucket.size() >= 2);
         return bucket[bucket.size()-2].first;
     }
-
@@ -29,39 +29,46 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define GEOMETRY_COMPRESSOR_HPP_
 
 #include "../typedefs.h"
-
-#include <unordered_map>
+#include "../Util/iterator_range.hpp"
 
 #include <string>
 #include <vector>
 
+// Holds the nodes removed from compressed edges. The geometries of all edges
+// are stored back to back in one array, a bucket is a range of that array
+// and holds the removed nodes plus the target of the edge, each with the
+// weight of the segment that leads to it.
 class GeometryCompressor
 {
   public:
     using CompressedNode = std::pair<NodeID, EdgeWeight>;
+    using BucketRange = osrm::util::Range<std::vector<CompressedNode>::const_iterator>;
 
     GeometryCompressor();
-    void CompressEdge(const EdgeID surviving_edge_id,
-                      const EdgeID removed_edge_id,
-                      const NodeID via_node_id,
-                      const NodeID target_node,
-                      const EdgeWeight weight1,
-                      const EdgeWeight weight2);
+
+    // Makes room for one bucket per entry of bucket_sizes, in that order.
+    // Edge ids below number_of_edges can be assigned a bucket afterwards.
+    void AllocateBuckets(const EdgeID number_of_edges, const std::vector<unsigned> &bucket_sizes);
+    // Distinct buckets and edges may be set from several threads at once.
+    void SetBucketEntry(const unsigned position,
+                        const unsigned index,
+                        const NodeID node_id,
+                        const EdgeWeight weight);
+    void AssignBucket(const EdgeID edge_id, const unsigned position);
 
     bool HasEntryForID(const EdgeID edge_id) const;
     void PrintStatistics() const;
     void SerializeInternalVector(const std::string &path) const;
     unsigned GetPositionForID(const EdgeID edge_id) const;
-    const std::vector<GeometryCompressor::CompressedNode> &
-    GetBucketReference(const EdgeID edge_id) const;
+    BucketRange GetBucketReference(const EdgeID edge_id) const;
     NodeID GetFirstNodeIDOfBucket(const EdgeID edge_id) const;
     NodeID GetLastNodeIDOfBucket(const EdgeID edge_id) const;
 
   private:
-    void IncreaseFreeList();
-    std::vector<std::vector<CompressedNode>> m_compressed_geometries;
-    std::vector<unsigned> m_free_list;
-    std::unordered_map<EdgeID, unsigned> m_edge_id_to_list_index_map;
+    std::vector<CompressedNode> m_compressed_nodes;
+    // bucket i is [m_bucket_offsets[i], m_bucket_offsets[i + 1])
+    std::vector<unsigned> m_bucket_offsets;
+    std::vector<unsigned> m_edge_id_to_bucket;
 };
 
 #endif // GEOMETRY_COMPRESSOR_HPP_
@@ -29,8 +29,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "contractor.hpp"
 
+#include "../preprocessor/ch.hpp"
+#include "../preprocessor/dcap.hpp"
+
 #include "../algorithms/crc32_processor.hpp"
 #include "../data_structures/deallocating_vector.hpp"
+#include "../data_structures/hilbert_value.hpp"
 #include "../data_structures/static_rtree.hpp"
 #include "../data_structures/restriction_map.hpp"
 
@@ -38,6 +42,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../Util/graph_loader.hpp"
 #include "../Util/integer_range.hpp"
 #include "../Util/lua_util.hpp"
+#include "../Util/MercatorUtil.h"
 #include "../Util/make_unique.hpp"
 #include "../Util/osrm_exception.hpp"
 #include "../Util/simple_logger.hpp"
@@ -48,16 +53,24 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/filesystem/fstream.hpp>
 #include <boost/program_options.hpp>
 
-#include <tbb/task_scheduler_init.h>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_sort.h>
+#include <tbb/task_scheduler_init.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <future>
 #include <memory>
+#include <numeric>
 #include <string>
 #include <thread>
 #include <vector>
 
-Prepare::Prepare() : requested_num_threads(1) {}
+Prepare::Prepare()
+	: requested_num_threads(1), turn_penalty_validation_samples(0), level_order(false)
+{
+}
 
 Prepare::~Prepare() {}
 
@@ -89,6 +102,30 @@ int Prepare::Process(int argc, char *argv[])
 		return 1;
 	}
 
+	// hands the edge-expanded graph to the next step without reading it back from .expanded
+	std::unique_ptr<Preprocess> preprocessor;
+	if ("ch" == preprocessor_name)
+	{
+		preprocessor = osrm::make_unique<CHPreprocess>(level_order);
+	}
+	else if ("dcap" == preprocessor_name)
+	{
+		preprocessor = osrm::make_unique<DCAPPreprocess>();
+	}
+	else if (!preprocessor_name.empty())
+	{
+		SimpleLogger().Write(logWARNING) << "Unknown preprocessing " << preprocessor_name
+										 << ", use ch or dcap";
+		return 1;
+	}
+
+	if (!renumbering.empty() && "hilbert" != renumbering && "bfs" != renumbering)
+	{
+		SimpleLogger().Write(logWARNING) << "Unknown renumbering " << renumbering
+										 << ", use hilbert or bfs";
+		return 1;
+	}
+
 	const unsigned recommended_num_threads = tbb::task_scheduler_init::default_num_threads();
 
 	SimpleLogger().Write() << "Input file: " << input_path.filename().string();
@@ -133,6 +170,9 @@ int Prepare::Process(int argc, char *argv[])
 	{
 		return 1;
 	}
+	speed_profile.turn_penalty_validation_samples = turn_penalty_validation_samples;
+	// the turn penalties are computed on the per-thread states of GetLuaState
+	lua_close(lua_state);
 
 #ifdef WIN32
 #pragma message("Memory consumption on Windows can be higher due to different bit packing")
@@ -161,15 +201,18 @@ int Prepare::Process(int argc, char *argv[])
 
 	std::vector<EdgeBasedNode> node_based_edge_list;
 	unsigned number_of_edge_based_nodes = 0;
-	DeallocatingVector<EdgeBasedEdge> edge_based_edge_list;
+	auto edge_based_edge_list = std::make_shared<DeallocatingVector<EdgeBasedEdge>>();
 
 	// init node_based_edge_list, edge_based_edge_list by edgeList
-	number_of_edge_based_nodes = BuildEdgeExpandedGraph(lua_state,
-														number_of_node_based_nodes,
+	number_of_edge_based_nodes = BuildEdgeExpandedGraph(number_of_node_based_nodes,
 														node_based_edge_list,
-														edge_based_edge_list,
+														*edge_based_edge_list,
 														speed_profile);
-	lua_close(lua_state);
+
+	if (!renumbering.empty())
+	{
+		RenumberEdgeBasedNodes(number_of_edge_based_nodes, node_based_edge_list, *edge_based_edge_list);
+	}
 
 	TIMER_STOP(expansion);
 
@@ -192,8 +235,55 @@ int Prepare::Process(int argc, char *argv[])
 
 	WriteNodeMapping();
 
-	tbb::parallel_sort(edge_based_edge_list.begin(), edge_based_edge_list.end());
+	tbb::parallel_sort(edge_based_edge_list->begin(), edge_based_edge_list->end());
+
+	if (!preprocessor)
+	{
+		WriteExpandedGraph(crc32_value, number_of_edge_based_nodes, *edge_based_edge_list);
+	}
+	else
+	{
+		// the dynamic server still reads .expanded, it is written while the graph is preprocessed.
+		// whoever of the writer and the preprocessor finishes reading last frees the edges.
+		auto expanded_graph_writer = std::async(
+			std::launch::async,
+			[this, crc32_value, number_of_edge_based_nodes, edge_based_edge_list]() mutable
+			{
+				WriteExpandedGraph(crc32_value, number_of_edge_based_nodes, *edge_based_edge_list);
+				edge_based_edge_list.reset();
+			});
+
+		const int preprocessing_result = preprocessor->Run(input_path,
+														   fingerprint_orig,
+														   crc32_value,
+														   number_of_edge_based_nodes,
+														   std::move(edge_based_edge_list));
+		expanded_graph_writer.get();
+		if (0 != preprocessing_result)
+		{
+			return preprocessing_result;
+		}
+	}
+
+	TIMER_STOP(preparing);
 
+	SimpleLogger().Write() << "Preprocessing : " << TIMER_SEC(preparing) << " seconds";
+	SimpleLogger().Write() << "Expansion  : " << (number_of_node_based_nodes / TIMER_SEC(expansion))
+						   << " nodes/sec and "
+						   << (number_of_edge_based_nodes / TIMER_SEC(expansion)) << " edges/sec";
+
+	SimpleLogger().Write() << "finished preparing";
+
+	return 0;
+}
+
+/**
+ \brief Writes the sorted edge-expanded graph to .expanded
+*/
+void Prepare::WriteExpandedGraph(const unsigned crc32_value,
+								 const unsigned number_of_edge_based_nodes,
+								 const DeallocatingVector<EdgeBasedEdge> &edge_based_edge_list)
+{
 	// Storing edges in vector in preparation for preprocessing
 	boost::filesystem::ofstream expanded_graph_output_stream(expanded_graph_out, std::ios::binary);
 	//check sum
@@ -203,31 +293,20 @@ int Prepare::Process(int argc, char *argv[])
 	//number of edges
 	unsigned nedges = edge_based_edge_list.size();
 	expanded_graph_output_stream.write((char *)&nedges, sizeof(unsigned));
-	//serializing edges
-	const auto dend = edge_based_edge_list.dend();
-	for (auto diter = edge_based_edge_list.dbegin(); diter != dend; ++diter)
+	//serializing edges, without deallocating them as they may still be preprocessed
+	for (const auto i : osrm::irange<std::size_t>(0, edge_based_edge_list.size()))
 	{
+		const EdgeBasedEdge &edge = edge_based_edge_list[i];
 		ExpandedEdge tmp_edge;
-		tmp_edge.source = diter->source;
-		tmp_edge.target = diter->target;
-		tmp_edge.distance = static_cast<unsigned int>(std::max(diter->weight, 1));
-		tmp_edge.id = diter->edge_id;
-		tmp_edge.forward = diter->forward ? true : false;
-		tmp_edge.backward = diter->backward ? true : false;
+		tmp_edge.source = edge.source;
+		tmp_edge.target = edge.target;
+		tmp_edge.distance = static_cast<unsigned int>(std::max(edge.weight, 1));
+		tmp_edge.id = edge.edge_id;
+		tmp_edge.forward = edge.forward ? true : false;
+		tmp_edge.backward = edge.backward ? true : false;
 		expanded_graph_output_stream.write((char *)&tmp_edge, sizeof(ExpandedEdge));
 	}
 	expanded_graph_output_stream.close();
-
-	TIMER_STOP(preparing);
-
-	SimpleLogger().Write() << "Preprocessing : " << TIMER_SEC(preparing) << " seconds";
-	SimpleLogger().Write() << "Expansion  : " << (number_of_node_based_nodes / TIMER_SEC(expansion))
-						   << " nodes/sec and "
-						   << (number_of_edge_based_nodes / TIMER_SEC(expansion)) << " edges/sec";
-
-	SimpleLogger().Write() << "finished preparing";
-
-	return 0;
 }
 
 /**
@@ -260,7 +339,20 @@ bool Prepare::ParseArguments(int argc, char *argv[])
 				"threads,t",
 				boost::program_options::value<unsigned int>(&requested_num_threads)
 				->default_value(tbb::task_scheduler_init::default_num_threads()),
-				"Number of threads to use");
+				"Number of threads to use")(
+				"validate-turn-penalties",
+				boost::program_options::value<unsigned>(&turn_penalty_validation_samples)
+				->default_value(0),
+				"Compare a tabulated turn_function against the profile on this many random angles")(
+				"preprocess",
+				boost::program_options::value<std::string>(&preprocessor_name),
+				"Preprocess the edge-expanded graph in memory with ch or dcap, .expanded is still written")(
+				"renumber",
+				boost::program_options::value<std::string>(&renumbering),
+				"Renumber the edge-based nodes in hilbert or bfs order for cache locality")(
+				"level-order",
+				boost::program_options::bool_switch(&level_order)->default_value(false),
+				"With --preprocess ch, number the nodes of the .hsgr by contraction level");
 
 	// hidden options, will be allowed both on command line and in config file, but will not be
 	// shown to the user
@@ -392,15 +484,47 @@ Prepare::SetupScriptingEnvironment(lua_State *lua_state,
 	speed_profile.u_turn_penalty = 10 * lua_tointeger(lua_state, -1);
 	speed_profile.has_turn_penalty_function = lua_function_exists(lua_state, "turn_function");
 
+	// profiles whose turn_function depends on the angle only set tabulate_turn_function = true
+	if (0 == luaL_dostring(lua_state, "return tabulate_turn_function\n"))
+	{
+		if (lua_isboolean(lua_state, -1))
+		{
+			speed_profile.tabulate_turn_function = lua_toboolean(lua_state, -1);
+		}
+		lua_pop(lua_state, 1);
+	}
+
 	return true;
 }
 
+/**
+ \brief Returns the Lua state of the calling thread, loading the profile on first use
+*/
+lua_State *Prepare::GetLuaState()
+{
+	std::lock_guard<std::mutex> lock(lua_state_mutex);
+	bool initialized = false;
+	auto &state = lua_states.local(initialized);
+	if (!initialized)
+	{
+		state = std::shared_ptr<lua_State>(luaL_newstate(), lua_close);
+		luabind::open(state.get());
+
+		// the penalties have been read from the profile of the main state already
+		EdgeBasedGraphFactory::SpeedProfileProperties speed_profile;
+		if (!SetupScriptingEnvironment(state.get(), speed_profile))
+		{
+			throw osrm::exception("could not load the profile " + profile_path.string());
+		}
+	}
+	return state.get();
+}
+
 /**
  \brief Building an edge-expanded graph from node-based input and turn restrictions
 */
 std::size_t
-Prepare::BuildEdgeExpandedGraph(lua_State *lua_state,
-								NodeID number_of_node_based_nodes,
+Prepare::BuildEdgeExpandedGraph(NodeID number_of_node_based_nodes,
 								std::vector<EdgeBasedNode> &node_based_edge_list,
 								DeallocatingVector<EdgeBasedEdge> &edge_based_edge_list,
 								EdgeBasedGraphFactory::SpeedProfileProperties &speed_profile)
@@ -419,7 +543,10 @@ Prepare::BuildEdgeExpandedGraph(lua_State *lua_state,
 	edge_list.clear();
 	edge_list.shrink_to_fit();
 
-	edge_based_graph_factory->Run(edge_out, geometry_filename, lua_state);
+	edge_based_graph_factory->Run(edge_out, geometry_filename, [this]()
+								  {
+									  return GetLuaState();
+								  });
 
 	restriction_list.clear();
 	restriction_list.shrink_to_fit();
@@ -446,6 +573,197 @@ Prepare::BuildEdgeExpandedGraph(lua_State *lua_state,
 	return number_of_edge_based_nodes;
 }
 
+/**
+ \brief Gives edge-based nodes that are close to each other close ids
+
+ The node ids follow the order in which the node-based edges were visited, which has little to do
+ with their location. Renumbering them by the Hilbert value of their location or in breadth-first
+ order keeps the adjacency lists that a query touches close in memory. Only the node ids change,
+ the ids of the edge-based edges into .edges and the geometries stay as they are.
+*/
+void Prepare::RenumberEdgeBasedNodes(const unsigned number_of_edge_based_nodes,
+									 std::vector<EdgeBasedNode> &node_based_edge_list,
+									 DeallocatingVector<EdgeBasedEdge> &edge_based_edge_list)
+{
+	SimpleLogger().Write() << "renumbering edge-based nodes in " << renumbering << " order ...";
+	TIMER_START(renumbering);
+
+	// mean difference of the ids at both ends of an edge, a cheap measure of locality
+	const auto mean_id_distance = [&edge_based_edge_list]()
+	{
+		double sum = 0.;
+		for (const auto i : osrm::irange<std::size_t>(0, edge_based_edge_list.size()))
+		{
+			const EdgeBasedEdge &edge = edge_based_edge_list[i];
+			sum += std::abs(static_cast<double>(edge.source) - static_cast<double>(edge.target));
+		}
+		return edge_based_edge_list.size() > 0 ? sum / edge_based_edge_list.size() : 0.;
+	};
+	const double id_distance_before = mean_id_distance();
+
+	// lists the old ids in their new order
+	const std::vector<NodeID> order =
+			("hilbert" == renumbering)
+				? HilbertOrder(number_of_edge_based_nodes, node_based_edge_list)
+				: BreadthFirstOrder(number_of_edge_based_nodes, edge_based_edge_list);
+	BOOST_ASSERT(order.size() == number_of_edge_based_nodes);
+
+	std::vector<NodeID> new_ids(number_of_edge_based_nodes);
+	tbb::parallel_for(tbb::blocked_range<NodeID>(0, number_of_edge_based_nodes),
+					  [&order, &new_ids](const tbb::blocked_range<NodeID> &range)
+	{
+		for (NodeID position = range.begin(); position != range.end(); ++position)
+		{
+			new_ids[order[position]] = position;
+		}
+	});
+
+	tbb::parallel_for(tbb::blocked_range<std::size_t>(0, node_based_edge_list.size()),
+					  [&node_based_edge_list, &new_ids](const tbb::blocked_range<std::size_t> &range)
+	{
+		for (std::size_t i = range.begin(); i != range.end(); ++i)
+		{
+			EdgeBasedNode &node = node_based_edge_list[i];
+			if (SPECIAL_NODEID != node.forward_edge_based_node_id)
+			{
+				node.forward_edge_based_node_id = new_ids[node.forward_edge_based_node_id];
+			}
+			if (SPECIAL_NODEID != node.reverse_edge_based_node_id)
+			{
+				node.reverse_edge_based_node_id = new_ids[node.reverse_edge_based_node_id];
+			}
+		}
+	});
+
+	tbb::parallel_for(tbb::blocked_range<std::size_t>(0, edge_based_edge_list.size()),
+					  [&edge_based_edge_list, &new_ids](const tbb::blocked_range<std::size_t> &range)
+	{
+		for (std::size_t i = range.begin(); i != range.end(); ++i)
+		{
+			EdgeBasedEdge &edge = edge_based_edge_list[i];
+			edge.source = new_ids[edge.source];
+			edge.target = new_ids[edge.target];
+		}
+	});
+
+	TIMER_STOP(renumbering);
+	SimpleLogger().Write() << "renumbering took " << TIMER_SEC(renumbering) << "s, mean id distance "
+						   << "along edges went from " << id_distance_before << " to "
+						   << mean_id_distance();
+}
+
+/**
+ \brief Orders the edge-based nodes by the Hilbert value of the centroid of their first segment
+*/
+std::vector<NodeID>
+Prepare::HilbertOrder(const unsigned number_of_edge_based_nodes,
+					  const std::vector<EdgeBasedNode> &node_based_edge_list) const
+{
+	// nodes without a segment, if any, go last
+	std::vector<std::pair<uint64_t, NodeID>> hilbert_values(number_of_edge_based_nodes);
+	for (const auto node : osrm::irange(0u, number_of_edge_based_nodes))
+	{
+		hilbert_values[node] = std::make_pair(std::numeric_limits<uint64_t>::max(), node);
+	}
+
+	HilbertCode get_hilbert_number;
+	tbb::parallel_for(tbb::blocked_range<std::size_t>(0, node_based_edge_list.size()),
+					  [this, &node_based_edge_list, &hilbert_values, &get_hilbert_number](
+						  const tbb::blocked_range<std::size_t> &range)
+	{
+		for (std::size_t i = range.begin(); i != range.end(); ++i)
+		{
+			const EdgeBasedNode &node = node_based_edge_list[i];
+			// every edge-based node has exactly one first segment
+			if (0 != node.fwd_segment_position)
+			{
+				continue;
+			}
+			FixedPointCoordinate centroid = EdgeBasedNode::Centroid(
+				FixedPointCoordinate(internal_to_external_node_map[node.u].lat,
+									 internal_to_external_node_map[node.u].lon),
+				FixedPointCoordinate(internal_to_external_node_map[node.v].lat,
+									 internal_to_external_node_map[node.v].lon));
+			centroid.lat = COORDINATE_PRECISION * lat2y(centroid.lat / COORDINATE_PRECISION);
+			const uint64_t hilbert_value = get_hilbert_number(centroid);
+			if (SPECIAL_NODEID != node.forward_edge_based_node_id)
+			{
+				hilbert_values[node.forward_edge_based_node_id].first = hilbert_value;
+			}
+			if (SPECIAL_NODEID != node.reverse_edge_based_node_id)
+			{
+				hilbert_values[node.reverse_edge_based_node_id].first = hilbert_value;
+			}
+		}
+	});
+	tbb::parallel_sort(hilbert_values.begin(), hilbert_values.end());
+
+	std::vector<NodeID> order(number_of_edge_based_nodes);
+	for (const auto position : osrm::irange(0u, number_of_edge_based_nodes))
+	{
+		order[position] = hilbert_values[position].second;
+	}
+	return order;
+}
+
+/**
+ \brief Orders the edge-based nodes by a breadth-first search that ignores edge directions
+
+ Each search starts at the smallest id that has not been visited yet.
+*/
+std::vector<NodeID>
+Prepare::BreadthFirstOrder(const unsigned number_of_edge_based_nodes,
+						   DeallocatingVector<EdgeBasedEdge> &edge_based_edge_list) const
+{
+	// adjacency array of the undirected edge-based graph
+	std::vector<std::size_t> first_neighbor(number_of_edge_based_nodes + 1, 0);
+	for (const auto i : osrm::irange<std::size_t>(0, edge_based_edge_list.size()))
+	{
+		const EdgeBasedEdge &edge = edge_based_edge_list[i];
+		++first_neighbor[edge.source + 1];
+		++first_neighbor[edge.target + 1];
+	}
+	std::partial_sum(first_neighbor.begin(), first_neighbor.end(), first_neighbor.begin());
+	std::vector<NodeID> neighbors(first_neighbor.back());
+	std::vector<std::size_t> next_neighbor(first_neighbor.begin(), first_neighbor.end() - 1);
+	for (const auto i : osrm::irange<std::size_t>(0, edge_based_edge_list.size()))
+	{
+		const EdgeBasedEdge &edge = edge_based_edge_list[i];
+		neighbors[next_neighbor[edge.source]++] = edge.target;
+		neighbors[next_neighbor[edge.target]++] = edge.source;
+	}
+	next_neighbor.clear();
+	next_neighbor.shrink_to_fit();
+
+	std::vector<NodeID> order;
+	order.reserve(number_of_edge_based_nodes);
+	std::vector<bool> visited(number_of_edge_based_nodes, false);
+	for (const auto root : osrm::irange(0u, number_of_edge_based_nodes))
+	{
+		if (visited[root])
+		{
+			continue;
+		}
+		// the output order doubles as the queue
+		std::size_t head = order.size();
+		visited[root] = true;
+		order.push_back(root);
+		while (head < order.size())
+		{
+			const NodeID node = order[head++];
+			for (const auto i : osrm::irange(first_neighbor[node], first_neighbor[node + 1]))
+			{
+				if (!visited[neighbors[i]])
+				{
+					visited[neighbors[i]] = true;
+					order.push_back(neighbors[i]);
+				}
+			}
+		}
+	}
+	return order;
+}
+
 /**
   \brief Writing info on original (node-based) nodes
  */
@@ -38,6 +38,11 @@ struct lua_State;
 
 #include <boost/filesystem.hpp>
 
+#include <tbb/enumerable_thread_specific.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
 /**
@@ -113,12 +118,22 @@ protected:
 	void CheckRestrictionsFile(FingerPrint &fingerprint_orig);
 	bool SetupScriptingEnvironment(lua_State *myLuaState,
 								   EdgeBasedGraphFactory::SpeedProfileProperties &speed_profile);
-	std::size_t BuildEdgeExpandedGraph(lua_State *myLuaState,
-									   NodeID nodeBasedNodeNumber,
+	lua_State *GetLuaState();
+	std::size_t BuildEdgeExpandedGraph(NodeID nodeBasedNodeNumber,
 									   std::vector<EdgeBasedNode> &nodeBasedEdgeList,
 									   DeallocatingVector<EdgeBasedEdge> &edgeBasedEdgeList,
 									   EdgeBasedGraphFactory::SpeedProfileProperties &speed_profile);
+	void RenumberEdgeBasedNodes(const unsigned number_of_edge_based_nodes,
+								std::vector<EdgeBasedNode> &node_based_edge_list,
+								DeallocatingVector<EdgeBasedEdge> &edge_based_edge_list);
+	std::vector<NodeID> HilbertOrder(const unsigned number_of_edge_based_nodes,
+									 const std::vector<EdgeBasedNode> &node_based_edge_list) const;
+	std::vector<NodeID> BreadthFirstOrder(const unsigned number_of_edge_based_nodes,
+										  DeallocatingVector<EdgeBasedEdge> &edge_based_edge_list) const;
 	void WriteNodeMapping();
+	void WriteExpandedGraph(const unsigned crc32_value,
+							const unsigned number_of_edge_based_nodes,
+							const DeallocatingVector<EdgeBasedEdge> &edge_based_edge_list);
 	void BuildRTree(std::vector<EdgeBasedNode> &node_based_edge_list);
 
 private:
@@ -129,6 +144,10 @@ private:
 	std::vector<ImportEdge> edge_list;
 
 	unsigned requested_num_threads;
+	unsigned turn_penalty_validation_samples;
+	std::string preprocessor_name;
+	bool level_order;
+	std::string renumbering;
 	boost::filesystem::path config_file_path;
 	boost::filesystem::path input_path;
 	boost::filesystem::path restrictions_path;
@@ -144,6 +163,10 @@ private:
 	std::string rtree_leafs_path;
 
 	std::string expanded_graph_out;
+
+	// the profile is loaded once per thread that computes turn penalties
+	std::mutex lua_state_mutex;
+	tbb::enumerable_thread_specific<std::shared_ptr<lua_State>> lua_states;
 };
 
 #endif // PROCESSING_CHAIN_HPP
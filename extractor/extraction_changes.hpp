@@ -0,0 +1,221 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef EXTRACTION_CHANGES_HPP
+#define EXTRACTION_CHANGES_HPP
+
+#include "extraction_state.hpp"
+#include "../data_structures/external_memory_node.hpp"
+#include "../data_structures/restriction.hpp"
+#include "../typedefs.h"
+
+#include <osmium/osm/types.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+// The latest version of every object in the change files. A change without
+// object stands for a deletion, or for a relation that is no turn restriction
+// (any more). The object is kept by value: mapbox::util::optional swaps its
+// storage bytewise, which breaks the std::string in the name of a way.
+struct ChangeSet
+{
+	template <typename T> struct Change
+	{
+		Change() : version(0), has_object(false) {}
+
+		osmium::object_version_type version;
+		bool has_object;
+		T object;
+	};
+
+	// a later version wins, within a file and across files
+	template <typename KeyT, typename T>
+	static void Set(std::map<KeyT, Change<T>> &changes,
+					const KeyT id,
+					const osmium::object_version_type version,
+					const T &object)
+	{
+		Change<T> &change = changes[id];
+		if (change.version <= version)
+		{
+			change.version = version;
+			change.has_object = true;
+			change.object = object;
+		}
+	}
+
+	template <typename KeyT, typename T>
+	static void Delete(std::map<KeyT, Change<T>> &changes,
+					   const KeyT id,
+					   const osmium::object_version_type version)
+	{
+		Change<T> &change = changes[id];
+		if (change.version <= version)
+		{
+			change.version = version;
+			change.has_object = false;
+			change.object = T();
+		}
+	}
+
+	std::map<NodeID, Change<ExternalMemoryNode>> nodes;
+	std::map<std::uint64_t, Change<ExtractionStateWay>> ways;
+	std::map<std::uint64_t, Change<InputRestrictionContainer>> restrictions;
+};
+
+// Walks the records of the kept state and the changes, both sorted by id.
+// Records without a change go to keep_record, changes to apply_change along
+// with the record they replace, if any.
+template <typename RecordT, typename KeyT, typename ChangeT, typename ReadT, typename KeyOfT,
+		  typename KeepT, typename ApplyT>
+void merge_changes(const ReadT &read_record,
+				   const KeyOfT &key_of,
+				   const std::map<KeyT, ChangeT> &changes,
+				   const KeepT &keep_record,
+				   const ApplyT &apply_change)
+{
+	RecordT record;
+	bool has_record = read_record(record);
+	auto change = changes.begin();
+	while (has_record || changes.end() != change)
+	{
+		if (changes.end() == change || (has_record && key_of(record) < change->first))
+		{
+			keep_record(record);
+			has_record = read_record(record);
+			continue;
+		}
+		const bool replaces_record = has_record && key_of(record) == change->first;
+		apply_change(change->first, replaces_record ? &record : nullptr, change->second);
+		if (replaces_record)
+		{
+			has_record = read_record(record);
+		}
+		++change;
+	}
+}
+
+// segments as pairs of OSM node ids, the smaller one first
+template <typename PredicateT>
+void add_segments(const std::vector<NodeID> &way_nodes,
+				  const PredicateT &is_changed,
+				  std::vector<std::pair<NodeID, NodeID>> &segments)
+{
+	for (std::size_t i = 1; i < way_nodes.size(); ++i)
+	{
+		const NodeID first = way_nodes[i - 1];
+		const NodeID second = way_nodes[i];
+		if (is_changed(first, second))
+		{
+			segments.emplace_back(std::min(first, second), std::max(first, second));
+		}
+	}
+}
+
+// Replays the kept state with the changes applied. Collects the segments
+// whose existence or attributes may have changed: those of changed ways
+// before and after the change and those at a changed node. The callbacks are
+// those of ExtractorCallbacks taking the records of the state.
+template <typename CallbacksT>
+void apply_changes(ExtractionStateReader &state_reader,
+				   const ChangeSet &changes,
+				   CallbacksT &extractor_callbacks,
+				   std::vector<std::pair<NodeID, NodeID>> &changed_segments)
+{
+	merge_changes<ExternalMemoryNode>(
+		[&](ExternalMemoryNode &node) { return state_reader.ReadNode(node); },
+		[](const ExternalMemoryNode &node) { return node.node_id; },
+		changes.nodes,
+		[&](const ExternalMemoryNode &node) { extractor_callbacks.ProcessNode(node); },
+		[&](NodeID, const ExternalMemoryNode *, const ChangeSet::Change<ExternalMemoryNode> &change)
+		{
+			if (change.has_object)
+			{
+				extractor_callbacks.ProcessNode(change.object);
+			}
+		});
+
+	const auto any_segment = [](const NodeID, const NodeID) { return true; };
+	const auto at_changed_node = [&](const NodeID first, const NodeID second)
+	{
+		return changes.nodes.count(first) > 0 || changes.nodes.count(second) > 0;
+	};
+	merge_changes<ExtractionStateWay>(
+		[&](ExtractionStateWay &way) { return state_reader.ReadWay(way); },
+		[](const ExtractionStateWay &way) { return way.id; },
+		changes.ways,
+		[&](ExtractionStateWay &way)
+		{
+			if (!changes.nodes.empty())
+			{
+				add_segments(way.nodes, at_changed_node, changed_segments);
+			}
+			extractor_callbacks.ProcessWay(way);
+		},
+		[&](std::uint64_t, const ExtractionStateWay *old_way,
+			const ChangeSet::Change<ExtractionStateWay> &change)
+		{
+			if (nullptr != old_way)
+			{
+				add_segments(old_way->nodes, any_segment, changed_segments);
+			}
+			if (change.has_object)
+			{
+				ExtractionStateWay way = change.object;
+				if (extractor_callbacks.ProcessWay(way))
+				{
+					add_segments(way.nodes, any_segment, changed_segments);
+				}
+			}
+		});
+
+	merge_changes<ExtractionStateRestriction>(
+		[&](ExtractionStateRestriction &restriction)
+		{ return state_reader.ReadRestriction(restriction); },
+		[](const ExtractionStateRestriction &restriction) { return restriction.id; },
+		changes.restrictions,
+		[&](const ExtractionStateRestriction &restriction)
+		{ extractor_callbacks.ProcessRestriction(restriction); },
+		[&](const std::uint64_t id, const ExtractionStateRestriction *,
+			const ChangeSet::Change<InputRestrictionContainer> &change)
+		{
+			if (change.has_object)
+			{
+				extractor_callbacks.ProcessRestriction({id, change.object});
+			}
+		});
+
+	std::sort(changed_segments.begin(), changed_segments.end());
+	changed_segments.erase(std::unique(changed_segments.begin(), changed_segments.end()),
+						   changed_segments.end());
+}
+
+#endif /* EXTRACTION_CHANGES_HPP */
@@ -41,14 +41,27 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stxxl/sort>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+#include <cmath>
+
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
 #include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
 
 ExtractionContainers::ExtractionContainers()
 {
 	// Check if stxxl can be instantiated
 	stxxl::vector<unsigned> dummy_vector;
-	name_list.push_back("");
 }
 
 ExtractionContainers::~ExtractionContainers()
@@ -56,68 +69,192 @@ ExtractionContainers::~ExtractionContainers()
 	used_node_id_list.clear();
 	all_nodes_list.clear();
 	all_edges_list.clear();
-	name_list.clear();
 	restrictions_list.clear();
 	way_start_end_id_list.clear();
 }
 
-void ExtractionContainers::PrepareData(const std::string &output_file_name,
-									   const std::string &restrictions_file_name)
+namespace
 {
-	try
+// Sorts the external memory vectors with a bounded amount of RAM and merges
+// them in one sequential pass.
+struct ExternalMemoryAlgorithms
+{
+	template <typename Iterator, typename Compare>
+	void Sort(Iterator begin, Iterator end, Compare compare) const
+	{
+		stxxl::sort(begin, end, compare, memory);
+	}
+
+	template <typename LeftVector, typename RightVector, typename Compare, typename Join>
+	unsigned MergeJoin(LeftVector &left, RightVector &right, Compare, Join join) const
+	{
+		return join(left.begin(), left.end(), right.begin(), right.end());
+	}
+
+	template <typename LeftVector, typename RightVector, typename Compare, typename Join>
+	unsigned MergeJoinInOrder(
+		LeftVector &left, RightVector &right, Compare, std::ostream &output_stream, Join join) const
+	{
+		return join(left.begin(), left.end(), right.begin(), right.end(), output_stream);
+	}
+
+	unsigned memory;
+};
+
+// Sorts plain vectors on all cores. The merge joins split the left input into
+// key ranges that start their merge at the first matching element on the
+// right, which gives the same result as one merge over the whole input.
+struct ParallelAlgorithms
+{
+	template <typename Iterator, typename Compare>
+	void Sort(Iterator begin, Iterator end, Compare compare) const
+	{
+		tbb::parallel_sort(begin, end, compare);
+	}
+
+	template <typename LeftVector, typename RightVector, typename Compare, typename Join>
+	unsigned MergeJoin(LeftVector &left, RightVector &right, Compare compare, Join join) const
+	{
+		std::atomic<unsigned> result(0);
+		tbb::parallel_for(tbb::blocked_range<std::size_t>(0, left.size(), chunk_size),
+						  [&](const tbb::blocked_range<std::size_t> &range)
+		{
+			const auto left_begin = left.begin() + range.begin();
+			const auto left_end = left.begin() + range.end();
+			result += join(left_begin, left_end,
+						   std::lower_bound(right.begin(), right.end(), *left_begin, compare),
+						   right.end());
+		});
+		return result;
+	}
+
+	// The chunks write into buffers that are appended to the output in order.
+	// Batches of chunks bound the size of the buffered output.
+	template <typename LeftVector, typename RightVector, typename Compare, typename Join>
+	unsigned MergeJoinInOrder(LeftVector &left,
+							  RightVector &right,
+							  Compare compare,
+							  std::ostream &output_stream,
+							  Join join) const
+	{
+		unsigned result = 0;
+		const std::size_t batch_size = 256 * chunk_size;
+		for (std::size_t batch_begin = 0; batch_begin < left.size(); batch_begin += batch_size)
+		{
+			const std::size_t batch_end = std::min(left.size(), batch_begin + batch_size);
+			const std::size_t number_of_chunks = (batch_end - batch_begin + chunk_size - 1) / chunk_size;
+			std::vector<std::string> chunk_output(number_of_chunks);
+			std::vector<unsigned> chunk_result(number_of_chunks);
+			tbb::parallel_for(std::size_t(0), number_of_chunks, [&](const std::size_t chunk)
+			{
+				const auto left_begin = left.begin() + batch_begin + chunk * chunk_size;
+				const auto left_end =
+						left.begin() + std::min(batch_end, batch_begin + (chunk + 1) * chunk_size);
+				std::ostringstream chunk_stream;
+				chunk_result[chunk] =
+						join(left_begin, left_end,
+							 std::lower_bound(right.begin(), right.end(), *left_begin, compare),
+							 right.end(), chunk_stream);
+				chunk_output[chunk] = chunk_stream.str();
+			});
+			for (std::size_t chunk = 0; chunk < number_of_chunks; ++chunk)
+			{
+				output_stream.write(chunk_output[chunk].data(), chunk_output[chunk].size());
+				result += chunk_result[chunk];
+			}
+		}
+		return result;
+	}
+
+	static const std::size_t chunk_size = 64 * 1024;
+};
+
+// streams an external memory vector into RAM and frees its blocks
+template <typename T> std::vector<T> MoveToRAM(stxxl::vector<T> &external_vector)
+{
+	std::vector<T> result;
+	result.reserve(external_vector.size());
+	std::copy(external_vector.cbegin(), external_vector.cend(), std::back_inserter(result));
+	external_vector.clear();
+	return result;
+}
+
+// Sorts and merges the extracted nodes, ways and restrictions and writes them
+// out. Works the same on stxxl vectors and on vectors that are held in RAM.
+template <typename NodeIDVectorT,
+		  typename NodeVectorT,
+		  typename EdgeVectorT,
+		  typename RestrictionsVectorT,
+		  typename WayIDStartEndVectorT,
+		  typename AlgorithmsT>
+void WriteNodesEdgesAndRestrictions(NodeIDVectorT &used_node_id_list,
+									NodeVectorT &all_nodes_list,
+									EdgeVectorT &all_edges_list,
+									RestrictionsVectorT &restrictions_list,
+									WayIDStartEndVectorT &way_start_end_id_list,
+									const AlgorithmsT &algorithms,
+									const FingerPrint &fingerprint,
+									const std::string &output_file_name,
+									const std::string &restrictions_file_name)
+{
+	using NodeIDIterator = typename NodeIDVectorT::iterator;
+	using NodeIterator = typename NodeVectorT::iterator;
+	using EdgeIterator = typename EdgeVectorT::iterator;
+	using RestrictionIterator = typename RestrictionsVectorT::iterator;
+	using WayIterator = typename WayIDStartEndVectorT::iterator;
+
+	unsigned number_of_used_nodes = 0;
+	unsigned number_of_used_edges = 0;
+
+	std::cout << "[extractor] Sorting used nodes        ... " << std::flush;
+	TIMER_START(sorting_used_nodes);
+	algorithms.Sort(used_node_id_list.begin(), used_node_id_list.end(), Cmp());
+	TIMER_STOP(sorting_used_nodes);
+	std::cout << "ok, after " << TIMER_SEC(sorting_used_nodes) << "s" << std::endl;
+
+	std::cout << "[extractor] Erasing duplicate nodes   ... " << std::flush;
+	TIMER_START(erasing_dups);
+	auto new_end = std::unique(used_node_id_list.begin(), used_node_id_list.end());
+	used_node_id_list.resize(new_end - used_node_id_list.begin());
+	TIMER_STOP(erasing_dups);
+	std::cout << "ok, after " << TIMER_SEC(erasing_dups) << "s" << std::endl;
+
+
+	std::cout << "[extractor] Sorting all nodes         ... " << std::flush;
+	TIMER_START(sorting_nodes);
+	algorithms.Sort(all_nodes_list.begin(), all_nodes_list.end(), ExternalMemoryNodeSTXXLCompare());
+	TIMER_STOP(sorting_nodes);
+	std::cout << "ok, after " << TIMER_SEC(sorting_nodes) << "s" << std::endl;
+
+
+	std::cout << "[extractor] Sorting used ways         ... " << std::flush;
+	TIMER_START(sort_ways);
+	algorithms.Sort(way_start_end_id_list.begin(),
+		 way_start_end_id_list.end(),
+		 FirstAndLastSegmentOfWayStxxlCompare());
+	TIMER_STOP(sort_ways);
+	std::cout << "ok, after " << TIMER_SEC(sort_ways) << "s" << std::endl;
+
+	std::cout << "[extractor] Sorting " << restrictions_list.size() << " restrictions. by from... " << std::flush;
+	TIMER_START(sort_restrictions);
+	algorithms.Sort(restrictions_list.begin(), restrictions_list.end(), CmpRestrictionContainerByFrom());
+	TIMER_STOP(sort_restrictions);
+	std::cout << "ok, after " << TIMER_SEC(sort_restrictions) << "s" << std::endl;
+
+	std::cout << "[extractor] Fixing restriction starts ... " << std::flush;
+	TIMER_START(fix_restriction_starts);
+	algorithms.MergeJoin(
+		restrictions_list,
+		way_start_end_id_list,
+		[](const FirstAndLastSegmentOfWay &way, const InputRestrictionContainer &restriction)
+		{ return way.way_id < restriction.restriction.from.way; },
+		[](RestrictionIterator restrictions_iterator,
+		   const RestrictionIterator restrictions_end,
+		   WayIterator way_start_and_end_iterator,
+		   const WayIterator ways_end)
 	{
-		unsigned number_of_used_nodes = 0;
-		unsigned number_of_used_edges = 0;
-
-		std::cout << "[extractor] Sorting used nodes        ... " << std::flush;
-		TIMER_START(sorting_used_nodes);
-		stxxl::sort(used_node_id_list.begin(), used_node_id_list.end(), Cmp(), stxxl_memory);
-		TIMER_STOP(sorting_used_nodes);
-		std::cout << "ok, after " << TIMER_SEC(sorting_used_nodes) << "s" << std::endl;
-
-		std::cout << "[extractor] Erasing duplicate nodes   ... " << std::flush;
-		TIMER_START(erasing_dups);
-		auto new_end = std::unique(used_node_id_list.begin(), used_node_id_list.end());
-		used_node_id_list.resize(new_end - used_node_id_list.begin());
-		TIMER_STOP(erasing_dups);
-		std::cout << "ok, after " << TIMER_SEC(erasing_dups) << "s" << std::endl;
-
-
-		std::cout << "[extractor] Sorting all nodes         ... " << std::flush;
-		TIMER_START(sorting_nodes);
-		stxxl::sort(all_nodes_list.begin(),
-					all_nodes_list.end(),
-					ExternalMemoryNodeSTXXLCompare(),
-					stxxl_memory);
-		TIMER_STOP(sorting_nodes);
-		std::cout << "ok, after " << TIMER_SEC(sorting_nodes) << "s" << std::endl;
-
-
-		std::cout << "[extractor] Sorting used ways         ... " << std::flush;
-		TIMER_START(sort_ways);
-		stxxl::sort(way_start_end_id_list.begin(),
-					way_start_end_id_list.end(),
-					FirstAndLastSegmentOfWayStxxlCompare(),
-					stxxl_memory);
-		TIMER_STOP(sort_ways);
-		std::cout << "ok, after " << TIMER_SEC(sort_ways) << "s" << std::endl;
-
-		std::cout << "[extractor] Sorting " << restrictions_list.size() << " restrictions. by from... " << std::flush;
-		TIMER_START(sort_restrictions);
-		stxxl::sort(restrictions_list.begin(),
-					restrictions_list.end(),
-					CmpRestrictionContainerByFrom(),
-					stxxl_memory);
-		TIMER_STOP(sort_restrictions);
-		std::cout << "ok, after " << TIMER_SEC(sort_restrictions) << "s" << std::endl;
-
-		std::cout << "[extractor] Fixing restriction starts ... " << std::flush;
-		TIMER_START(fix_restriction_starts);
-		auto restrictions_iterator = restrictions_list.begin();
-		auto way_start_and_end_iterator = way_start_end_id_list.begin();
-
-		while (way_start_and_end_iterator != way_start_end_id_list.end() &&
-			   restrictions_iterator != restrictions_list.end())
+		while (way_start_and_end_iterator != ways_end &&
+			   restrictions_iterator != restrictions_end)
 		{
 			if (way_start_and_end_iterator->way_id < restrictions_iterator->restriction.from.way)
 			{
@@ -155,26 +292,33 @@ void ExtractionContainers::PrepareData(const std::string &output_file_name,
 			}
 			++restrictions_iterator;
 		}
-
-		TIMER_STOP(fix_restriction_starts);
-		std::cout << "ok, after " << TIMER_SEC(fix_restriction_starts) << "s" << std::endl;
-
-		std::cout << "[extractor] Sorting restrictions. by to  ... " << std::flush;
-		TIMER_START(sort_restrictions_to);
-		stxxl::sort(restrictions_list.begin(),
-					restrictions_list.end(),
-					CmpRestrictionContainerByTo(),
-					stxxl_memory);
-		TIMER_STOP(sort_restrictions_to);
-		std::cout << "ok, after " << TIMER_SEC(sort_restrictions_to) << "s" << std::endl;
-
-		unsigned number_of_useable_restrictions = 0;
-		std::cout << "[extractor] Fixing restriction ends   ... " << std::flush;
-		TIMER_START(fix_restriction_ends);
-		restrictions_iterator = restrictions_list.begin();
-		way_start_and_end_iterator = way_start_end_id_list.begin();
-		while (way_start_and_end_iterator != way_start_end_id_list.end() &&
-			   restrictions_iterator != restrictions_list.end())
+		return 0u;
+	});
+
+	TIMER_STOP(fix_restriction_starts);
+	std::cout << "ok, after " << TIMER_SEC(fix_restriction_starts) << "s" << std::endl;
+
+	std::cout << "[extractor] Sorting restrictions. by to  ... " << std::flush;
+	TIMER_START(sort_restrictions_to);
+	algorithms.Sort(restrictions_list.begin(), restrictions_list.end(), CmpRestrictionContainerByTo());
+	TIMER_STOP(sort_restrictions_to);
+	std::cout << "ok, after " << TIMER_SEC(sort_restrictions_to) << "s" << std::endl;
+
+	std::cout << "[extractor] Fixing restriction ends   ... " << std::flush;
+	TIMER_START(fix_restriction_ends);
+	const unsigned number_of_useable_restrictions = algorithms.MergeJoin(
+		restrictions_list,
+		way_start_end_id_list,
+		[](const FirstAndLastSegmentOfWay &way, const InputRestrictionContainer &restriction)
+		{ return way.way_id < restriction.restriction.to.way; },
+		[](RestrictionIterator restrictions_iterator,
+		   const RestrictionIterator restrictions_end,
+		   WayIterator way_start_and_end_iterator,
+		   const WayIterator ways_end)
+	{
+		unsigned number_of_restrictions = 0;
+		while (way_start_and_end_iterator != ways_end &&
+			   restrictions_iterator != restrictions_end)
 		{
 			if (way_start_and_end_iterator->way_id < restrictions_iterator->restriction.to.way)
 			{
@@ -207,41 +351,54 @@ void ExtractionContainers::PrepareData(const std::string &output_file_name,
 			if (std::numeric_limits<unsigned>::max() != restrictions_iterator->restriction.from.node &&
 					std::numeric_limits<unsigned>::max() != restrictions_iterator->restriction.to.node)
 			{
-				++number_of_useable_restrictions;
+				++number_of_restrictions;
 			}
 			++restrictions_iterator;
 		}
-		TIMER_STOP(fix_restriction_ends);
-		std::cout << "ok, after " << TIMER_SEC(fix_restriction_ends) << "s" << std::endl;
-
-		SimpleLogger().Write() << "usable restrictions: " << number_of_useable_restrictions;
-		// serialize restrictions
-		std::ofstream restrictions_out_stream;
-		restrictions_out_stream.open(restrictions_file_name.c_str(), std::ios::binary);
-		restrictions_out_stream.write((char *)&fingerprint, sizeof(FingerPrint));
-		restrictions_out_stream.write((char *)&number_of_useable_restrictions, sizeof(unsigned));
-
-		for(const auto & restriction_container : restrictions_list)
+		return number_of_restrictions;
+	});
+	TIMER_STOP(fix_restriction_ends);
+	std::cout << "ok, after " << TIMER_SEC(fix_restriction_ends) << "s" << std::endl;
+
+	SimpleLogger().Write() << "usable restrictions: " << number_of_useable_restrictions;
+	// serialize restrictions
+	std::ofstream restrictions_out_stream;
+	restrictions_out_stream.open(restrictions_file_name.c_str(), std::ios::binary);
+	restrictions_out_stream.write((char *)&fingerprint, sizeof(FingerPrint));
+	restrictions_out_stream.write((char *)&number_of_useable_restrictions, sizeof(unsigned));
+
+	for(const auto & restriction_container : restrictions_list)
+	{
+		if (std::numeric_limits<unsigned>::max() != restriction_container.restriction.from.node &&
+				std::numeric_limits<unsigned>::max() != restriction_container.restriction.to.node)
 		{
-			if (std::numeric_limits<unsigned>::max() != restriction_container.restriction.from.node &&
-					std::numeric_limits<unsigned>::max() != restriction_container.restriction.to.node)
-			{
-				restrictions_out_stream.write((char *)&(restriction_container.restriction),
-											  sizeof(TurnRestriction));
-			}
+			restrictions_out_stream.write((char *)&(restriction_container.restriction),
+										  sizeof(TurnRestriction));
 		}
-		restrictions_out_stream.close();
-
-		std::ofstream file_out_stream;
-		file_out_stream.open(output_file_name.c_str(), std::ios::binary);
-		file_out_stream.write((char *)&fingerprint, sizeof(FingerPrint));
-		file_out_stream.write((char *)&number_of_used_nodes, sizeof(unsigned));
-		std::cout << "[extractor] Confirming/Writing used nodes     ... " << std::flush;
-		TIMER_START(write_nodes);
-		// identify all used nodes by a merging step of two sorted lists
-		auto node_iterator = all_nodes_list.begin();
-		auto node_id_iterator = used_node_id_list.begin();
-		while (node_id_iterator != used_node_id_list.end() && node_iterator != all_nodes_list.end())
+	}
+	restrictions_out_stream.close();
+
+	std::ofstream file_out_stream;
+	file_out_stream.open(output_file_name.c_str(), std::ios::binary);
+	file_out_stream.write((char *)&fingerprint, sizeof(FingerPrint));
+	file_out_stream.write((char *)&number_of_used_nodes, sizeof(unsigned));
+	std::cout << "[extractor] Confirming/Writing used nodes     ... " << std::flush;
+	TIMER_START(write_nodes);
+	// identify all used nodes by a merging step of two sorted lists
+	number_of_used_nodes = algorithms.MergeJoinInOrder(
+		used_node_id_list,
+		all_nodes_list,
+		[](const ExternalMemoryNode &node, const NodeID node_id)
+		{ return node.node_id < node_id; },
+		file_out_stream,
+		[](NodeIDIterator node_id_iterator,
+		   const NodeIDIterator node_id_end,
+		   NodeIterator node_iterator,
+		   const NodeIterator node_end,
+		   std::ostream &output_stream)
+	{
+		unsigned number_of_nodes = 0;
+		while (node_id_iterator != node_id_end && node_iterator != node_end)
 		{
 			if (*node_id_iterator < node_iterator->node_id)
 			{
@@ -255,39 +412,48 @@ void ExtractionContainers::PrepareData(const std::string &output_file_name,
 			}
 			BOOST_ASSERT(*node_id_iterator == node_iterator->node_id);
 
-			file_out_stream.write((char *)&(*node_iterator), sizeof(ExternalMemoryNode));
+			output_stream.write((char *)&(*node_iterator), sizeof(ExternalMemoryNode));
 
-			++number_of_used_nodes;
+			++number_of_nodes;
 			++node_id_iterator;
 			++node_iterator;
 		}
-
-		TIMER_STOP(write_nodes);
-		std::cout << "ok, after " << TIMER_SEC(write_nodes) << "s" << std::endl;
-
-		std::cout << "[extractor] setting number of nodes   ... " << std::flush;
-		std::ios::pos_type previous_file_position = file_out_stream.tellp();
-		file_out_stream.seekp(std::ios::beg + sizeof(FingerPrint));
-		file_out_stream.write((char *)&number_of_used_nodes, sizeof(unsigned));
-		file_out_stream.seekp(previous_file_position);
-
-		std::cout << "ok" << std::endl;
-
-		// Sort edges by start.
-		std::cout << "[extractor] Sorting edges by start    ... " << std::flush;
-		TIMER_START(sort_edges_by_start);
-		stxxl::sort(all_edges_list.begin(), all_edges_list.end(), CmpEdgeByStartID(), stxxl_memory);
-		TIMER_STOP(sort_edges_by_start);
-		std::cout << "ok, after " << TIMER_SEC(sort_edges_by_start) << "s" << std::endl;
-
-
-		std::cout << "[extractor] Setting start coords      ... " << std::flush;
-		TIMER_START(set_start_coords);
-		file_out_stream.write((char *)&number_of_used_edges, sizeof(unsigned));
-		// Traverse list of edges and nodes in parallel and set start coord
-		node_iterator = all_nodes_list.begin();
-		auto edge_iterator = all_edges_list.begin();
-		while (edge_iterator != all_edges_list.end() && node_iterator != all_nodes_list.end())
+		return number_of_nodes;
+	});
+
+	TIMER_STOP(write_nodes);
+	std::cout << "ok, after " << TIMER_SEC(write_nodes) << "s" << std::endl;
+
+	std::cout << "[extractor] setting number of nodes   ... " << std::flush;
+	std::ios::pos_type previous_file_position = file_out_stream.tellp();
+	file_out_stream.seekp(std::ios::beg + sizeof(FingerPrint));
+	file_out_stream.write((char *)&number_of_used_nodes, sizeof(unsigned));
+	file_out_stream.seekp(previous_file_position);
+
+	std::cout << "ok" << std::endl;
+
+	// Sort edges by start.
+	std::cout << "[extractor] Sorting edges by start    ... " << std::flush;
+	TIMER_START(sort_edges_by_start);
+	algorithms.Sort(all_edges_list.begin(), all_edges_list.end(), CmpEdgeByStartID());
+	TIMER_STOP(sort_edges_by_start);
+	std::cout << "ok, after " << TIMER_SEC(sort_edges_by_start) << "s" << std::endl;
+
+
+	std::cout << "[extractor] Setting start coords      ... " << std::flush;
+	TIMER_START(set_start_coords);
+	file_out_stream.write((char *)&number_of_used_edges, sizeof(unsigned));
+	// Traverse list of edges and nodes in parallel and set start coord
+	algorithms.MergeJoin(all_edges_list,
+						 all_nodes_list,
+						 [](const ExternalMemoryNode &node, const InternalExtractorEdge &edge)
+						 { return node.node_id < edge.start; },
+						 [](EdgeIterator edge_iterator,
+							const EdgeIterator edge_end,
+							NodeIterator node_iterator,
+							const NodeIterator node_end)
+	{
+		while (edge_iterator != edge_end && node_iterator != node_end)
 		{
 			if (edge_iterator->start < node_iterator->node_id)
 			{
@@ -305,23 +471,35 @@ void ExtractionContainers::PrepareData(const std::string &output_file_name,
 			edge_iterator->source_coordinate.lon = node_iterator->lon;
 			++edge_iterator;
 		}
-		TIMER_STOP(set_start_coords);
-		std::cout << "ok, after " << TIMER_SEC(set_start_coords) << "s" << std::endl;
-
-		// Sort Edges by target
-		std::cout << "[extractor] Sorting edges by target   ... " << std::flush;
-		TIMER_START(sort_edges_by_target);
-		stxxl::sort(all_edges_list.begin(), all_edges_list.end(), CmpEdgeByTargetID(), stxxl_memory);
-		TIMER_STOP(sort_edges_by_target);
-		std::cout << "ok, after " << TIMER_SEC(sort_edges_by_target) << "s" << std::endl;
-
-		std::cout << "[extractor] Setting target coords     ... " << std::flush;
-		TIMER_START(set_target_coords);
-		// Traverse list of edges and nodes in parallel and set target coord
-		node_iterator = all_nodes_list.begin();
-		edge_iterator = all_edges_list.begin();
-
-		while (edge_iterator != all_edges_list.end() && node_iterator != all_nodes_list.end())
+		return 0u;
+	});
+	TIMER_STOP(set_start_coords);
+	std::cout << "ok, after " << TIMER_SEC(set_start_coords) << "s" << std::endl;
+
+	// Sort Edges by target
+	std::cout << "[extractor] Sorting edges by target   ... " << std::flush;
+	TIMER_START(sort_edges_by_target);
+	algorithms.Sort(all_edges_list.begin(), all_edges_list.end(), CmpEdgeByTargetID());
+	TIMER_STOP(sort_edges_by_target);
+	std::cout << "ok, after " << TIMER_SEC(sort_edges_by_target) << "s" << std::endl;
+
+	std::cout << "[extractor] Setting target coords     ... " << std::flush;
+	TIMER_START(set_target_coords);
+	// Traverse list of edges and nodes in parallel and set target coord
+	number_of_used_edges = algorithms.MergeJoinInOrder(
+		all_edges_list,
+		all_nodes_list,
+		[](const ExternalMemoryNode &node, const InternalExtractorEdge &edge)
+		{ return node.node_id < edge.target; },
+		file_out_stream,
+		[](EdgeIterator edge_iterator,
+		   const EdgeIterator edge_end,
+		   NodeIterator node_iterator,
+		   const NodeIterator node_end,
+		   std::ostream &output_stream)
+	{
+		unsigned number_of_edges = 0;
+		while (edge_iterator != edge_end && node_iterator != node_end)
 		{
 			if (edge_iterator->target < node_iterator->node_id)
 			{
@@ -356,83 +534,123 @@ void ExtractionContainers::PrepareData(const std::string &output_file_name,
 				short zero = 0;
 				short one = 1;
 
-				file_out_stream.write((char *)&edge_iterator->start, sizeof(unsigned));
-				file_out_stream.write((char *)&edge_iterator->target, sizeof(unsigned));
-				file_out_stream.write((char *)&integer_distance, sizeof(int));
+				output_stream.write((char *)&edge_iterator->start, sizeof(unsigned));
+				output_stream.write((char *)&edge_iterator->target, sizeof(unsigned));
+				output_stream.write((char *)&integer_distance, sizeof(int));
 				switch (edge_iterator->direction)
 				{
 				case ExtractionWay::notSure:
-					file_out_stream.write((char *)&zero, sizeof(short));
+					output_stream.write((char *)&zero, sizeof(short));
 					break;
 				case ExtractionWay::oneway:
-					file_out_stream.write((char *)&one, sizeof(short));
+					output_stream.write((char *)&one, sizeof(short));
 					break;
 				case ExtractionWay::bidirectional:
-					file_out_stream.write((char *)&zero, sizeof(short));
+					output_stream.write((char *)&zero, sizeof(short));
 					break;
 				case ExtractionWay::opposite:
-					file_out_stream.write((char *)&one, sizeof(short));
+					output_stream.write((char *)&one, sizeof(short));
 					break;
 				default:
 					throw osrm::exception("edge has broken direction");
 				}
 
-				file_out_stream.write((char *)&integer_weight, sizeof(int));
-				file_out_stream.write((char *)&edge_iterator->name_id, sizeof(unsigned));
-				file_out_stream.write((char *)&edge_iterator->is_roundabout, sizeof(bool));
-				file_out_stream.write((char *)&edge_iterator->is_in_tiny_cc, sizeof(bool));
-				file_out_stream.write((char *)&edge_iterator->is_access_restricted, sizeof(bool));
+				output_stream.write((char *)&integer_weight, sizeof(int));
+				output_stream.write((char *)&edge_iterator->name_id, sizeof(unsigned));
+				output_stream.write((char *)&edge_iterator->is_roundabout, sizeof(bool));
+				output_stream.write((char *)&edge_iterator->is_in_tiny_cc, sizeof(bool));
+				output_stream.write((char *)&edge_iterator->is_access_restricted, sizeof(bool));
 
 				// cannot take adress of bit field, so use local
 				const TravelMode  travel_mode = edge_iterator->travel_mode;
-				file_out_stream.write((char *)&travel_mode, sizeof(TravelMode));
+				output_stream.write((char *)&travel_mode, sizeof(TravelMode));
 
-				file_out_stream.write((char *)&edge_iterator->is_split, sizeof(bool));
-				++number_of_used_edges;
+				output_stream.write((char *)&edge_iterator->is_split, sizeof(bool));
+				++number_of_edges;
 			}
 			++edge_iterator;
 		}
-		TIMER_STOP(set_target_coords);
-		std::cout << "ok, after " << TIMER_SEC(set_target_coords) << "s" << std::endl;
+		return number_of_edges;
+	});
+	TIMER_STOP(set_target_coords);
+	std::cout << "ok, after " << TIMER_SEC(set_target_coords) << "s" << std::endl;
 
-		std::cout << "[extractor] setting number of edges   ... " << std::flush;
+	std::cout << "[extractor] setting number of edges   ... " << std::flush;
 
-		file_out_stream.seekp(previous_file_position);
-		file_out_stream.write((char *)&number_of_used_edges, sizeof(unsigned));
-		file_out_stream.close();
-		std::cout << "ok" << std::endl;
+	file_out_stream.seekp(previous_file_position);
+	file_out_stream.write((char *)&number_of_used_edges, sizeof(unsigned));
+	file_out_stream.close();
+	std::cout << "ok" << std::endl;
 
-		std::cout << "[extractor] writing street name index ... " << std::flush;
-		TIMER_START(write_name_index);
-		std::string name_file_streamName = (output_file_name + ".names");
-		boost::filesystem::ofstream name_file_stream(name_file_streamName, std::ios::binary);
+	SimpleLogger().Write() << "Processed " << number_of_used_nodes << " nodes and "
+						   << number_of_used_edges << " edges";
+}
+}
 
-		unsigned total_length = 0;
-		std::vector<unsigned> name_lengths;
-		for (const std::string &temp_string : name_list)
+void ExtractionContainers::PrepareData(const std::string &output_file_name,
+									   const std::string &restrictions_file_name,
+									   const std::uint64_t sort_memory_budget)
+{
+	try
+	{
+		// everything but the names is sorted, all of it at once has to fit the budget
+		const std::uint64_t working_set_size =
+				used_node_id_list.size() * sizeof(NodeID) +
+				all_nodes_list.size() * sizeof(ExternalMemoryNode) +
+				all_edges_list.size() * sizeof(InternalExtractorEdge) +
+				restrictions_list.size() * sizeof(InputRestrictionContainer) +
+				way_start_end_id_list.size() * sizeof(FirstAndLastSegmentOfWay);
+		const std::uint64_t mebibyte = 1024 * 1024;
+
+		if (working_set_size <= sort_memory_budget)
 		{
-			const unsigned string_length = std::min(static_cast<unsigned>(temp_string.length()), 255u);
-			name_lengths.push_back(string_length);
-			total_length += string_length;
+			SimpleLogger().Write() << "Sorting " << working_set_size / mebibyte
+								   << " MiB of extracted data in RAM";
+			std::cout << "[extractor] Loading data into RAM    ... " << std::flush;
+			TIMER_START(load_into_ram);
+			auto used_node_ids = MoveToRAM(used_node_id_list);
+			auto all_nodes = MoveToRAM(all_nodes_list);
+			auto all_edges = MoveToRAM(all_edges_list);
+			auto restrictions = MoveToRAM(restrictions_list);
+			auto way_start_end_ids = MoveToRAM(way_start_end_id_list);
+			TIMER_STOP(load_into_ram);
+			std::cout << "ok, after " << TIMER_SEC(load_into_ram) << "s" << std::endl;
+
+			WriteNodesEdgesAndRestrictions(used_node_ids,
+										   all_nodes,
+										   all_edges,
+										   restrictions,
+										   way_start_end_ids,
+										   ParallelAlgorithms(),
+										   fingerprint,
+										   output_file_name,
+										   restrictions_file_name);
 		}
-
-		RangeTable<> table(name_lengths);
-		name_file_stream << table;
-
-		name_file_stream.write((char*) &total_length, sizeof(unsigned));
-		// write all chars consecutively
-		for (const std::string &temp_string : name_list)
+		else
 		{
-			const unsigned string_length = std::min(static_cast<unsigned>(temp_string.length()), 255u);
-			name_file_stream.write(temp_string.c_str(), string_length);
+			SimpleLogger().Write() << "Sorting " << working_set_size / mebibyte
+								   << " MiB of extracted data in external memory, the sort memory is "
+								   << sort_memory_budget / mebibyte << " MiB";
+			WriteNodesEdgesAndRestrictions(used_node_id_list,
+										   all_nodes_list,
+										   all_edges_list,
+										   restrictions_list,
+										   way_start_end_id_list,
+										   ExternalMemoryAlgorithms{stxxl_memory},
+										   fingerprint,
+										   output_file_name,
+										   restrictions_file_name);
 		}
 
+		std::cout << "[extractor] writing street name index ... " << std::flush;
+		TIMER_START(write_name_index);
+		std::string name_file_streamName = (output_file_name + ".names");
+		boost::filesystem::ofstream name_file_stream(name_file_streamName, std::ios::binary);
+
+		names.Write(name_file_stream);
 		name_file_stream.close();
 		TIMER_STOP(write_name_index);
 		std::cout << "ok, after " << TIMER_SEC(write_name_index) << "s" << std::endl;
-
-		SimpleLogger().Write() << "Processed " << number_of_used_nodes << " nodes and "
-							   << number_of_used_edges << " edges";
 	}
 	catch (const std::exception &e) { std::cerr << "Caught Execption:" << e.what() << std::endl; }
 }
@@ -32,10 +32,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "first_and_last_segment_of_way.hpp"
 #include "../data_structures/external_memory_node.hpp"
 #include "../data_structures/restriction.hpp"
+#include "../data_structures/string_interner.hpp"
 #include "../Util/FingerPrint.h"
 
 #include <stxxl/vector>
 
+#include <cstdint>
+
 class ExtractionContainers
 {
 #ifndef _MSC_VER
@@ -47,14 +50,13 @@ public:
 	using  STXXLNodeIDVector = stxxl::vector<NodeID>;
 	using  STXXLNodeVector = stxxl::vector<ExternalMemoryNode>;
 	using  STXXLEdgeVector = stxxl::vector<InternalExtractorEdge>;
-	using  STXXLStringVector = stxxl::vector<std::string>;
 	using  STXXLRestrictionsVector = stxxl::vector<InputRestrictionContainer>;
 	using  STXXLWayIDStartEndVector = stxxl::vector<FirstAndLastSegmentOfWay>;
 
 	STXXLNodeIDVector used_node_id_list;
 	STXXLNodeVector all_nodes_list;
 	STXXLEdgeVector all_edges_list;
-	STXXLStringVector name_list;
+	StringInterner names;
 	STXXLRestrictionsVector restrictions_list;
 	STXXLWayIDStartEndVector way_start_end_id_list;
 	const FingerPrint fingerprint;
@@ -63,8 +65,11 @@ public:
 
 	~ExtractionContainers();
 
+	// Sorts with tbb::parallel_sort in RAM when all containers fit into the
+	// budget and with stxxl::sort otherwise.
 	void PrepareData(const std::string &output_file_name,
-					 const std::string &restrictions_file_name);
+					 const std::string &restrictions_file_name,
+					 const std::uint64_t sort_memory_budget);
 };
 
 #endif /* EXTRACTION_CONTAINERS_HPP */
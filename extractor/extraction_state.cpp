@@ -0,0 +1,244 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "extraction_state.hpp"
+
+#include "../Util/FingerPrint.h"
+#include "../Util/osrm_exception.hpp"
+
+#include <boost/filesystem.hpp>
+
+
+namespace
+{
+const char *const node_suffix = ".nodes";
+const char *const way_suffix = ".ways";
+const char *const restriction_suffix = ".restrictions";
+const char *const temporary_suffix = ".tmp";
+
+template <typename T> void write_value(std::ostream &stream, const T &value)
+{
+	stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> bool read_value(std::istream &stream, T &value)
+{
+	return static_cast<bool>(stream.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+void open_state_file(boost::filesystem::ifstream &stream, const std::string &file_name)
+{
+	stream.open(file_name, std::ios::binary);
+	if (!stream)
+	{
+		throw osrm::exception("no extraction state at " + file_name +
+							  ", run a full extraction with --keep-state first");
+	}
+
+	const FingerPrint fingerprint_orig;
+	FingerPrint fingerprint_loaded;
+	stream.read((char *)&fingerprint_loaded, sizeof(FingerPrint));
+	if (!stream || !fingerprint_loaded.TestPrepare(fingerprint_orig))
+	{
+		throw osrm::exception(file_name + " was written by a different build, "
+							  "run a full extraction with --keep-state");
+	}
+}
+
+enum WayFlags : unsigned char
+{
+	WAY_ROUNDABOUT = 1,
+	WAY_ACCESS_RESTRICTED = 2,
+	WAY_IGNORE_IN_GRID = 4
+};
+}
+
+ExtractionStateWriter::ExtractionStateWriter(const std::string &state_file_name)
+	: state_file_name(state_file_name), number_of_nodes(0), number_of_ways(0),
+	  number_of_restrictions(0), last_node_id(0), last_way_id(0), last_restriction_id(0),
+	  is_sorted(true), is_open(true)
+{
+	node_stream.open(state_file_name + node_suffix + temporary_suffix, std::ios::binary);
+	way_stream.open(state_file_name + way_suffix + temporary_suffix, std::ios::binary);
+	restriction_stream.open(state_file_name + restriction_suffix + temporary_suffix,
+							std::ios::binary);
+	if (!node_stream || !way_stream || !restriction_stream)
+	{
+		Discard();
+		throw osrm::exception("cannot write the extraction state to " + state_file_name);
+	}
+
+	const FingerPrint fingerprint;
+	for (std::ostream *stream : {static_cast<std::ostream *>(&node_stream),
+								 static_cast<std::ostream *>(&way_stream),
+								 static_cast<std::ostream *>(&restriction_stream)})
+	{
+		stream->write((char *)&fingerprint, sizeof(FingerPrint));
+	}
+}
+
+ExtractionStateWriter::~ExtractionStateWriter()
+{
+	if (is_open)
+	{
+		Discard();
+	}
+}
+
+void ExtractionStateWriter::WriteNode(const ExternalMemoryNode &node)
+{
+	is_sorted = is_sorted && (0 == number_of_nodes || last_node_id < node.node_id);
+	last_node_id = node.node_id;
+	++number_of_nodes;
+	write_value(node_stream, node);
+}
+
+void ExtractionStateWriter::WriteWay(const ExtractionStateWay &way)
+{
+	is_sorted = is_sorted && (0 == number_of_ways || last_way_id < way.id);
+	last_way_id = way.id;
+	++number_of_ways;
+
+	const ExtractionWay &result = way.result;
+	const unsigned number_of_way_nodes = way.nodes.size();
+	const unsigned char flags = (result.roundabout ? WAY_ROUNDABOUT : 0) |
+								(result.is_access_restricted ? WAY_ACCESS_RESTRICTED : 0) |
+								(result.ignore_in_grid ? WAY_IGNORE_IN_GRID : 0);
+	const unsigned name_length = result.name.size();
+
+	write_value(way_stream, way.id);
+	write_value(way_stream, number_of_way_nodes);
+	way_stream.write(reinterpret_cast<const char *>(way.nodes.data()),
+					 number_of_way_nodes * sizeof(NodeID));
+	write_value(way_stream, result.forward_speed);
+	write_value(way_stream, result.backward_speed);
+	write_value(way_stream, result.duration);
+	write_value(way_stream, flags);
+	write_value(way_stream, result.get_forward_mode());
+	write_value(way_stream, result.get_backward_mode());
+	write_value(way_stream, name_length);
+	way_stream.write(result.name.data(), name_length);
+}
+
+void ExtractionStateWriter::WriteRestriction(const ExtractionStateRestriction &restriction)
+{
+	is_sorted =
+		is_sorted && (0 == number_of_restrictions || last_restriction_id < restriction.id);
+	last_restriction_id = restriction.id;
+	++number_of_restrictions;
+	write_value(restriction_stream, restriction.id);
+	write_value(restriction_stream, restriction.restriction);
+}
+
+bool ExtractionStateWriter::Commit()
+{
+	node_stream.close();
+	way_stream.close();
+	restriction_stream.close();
+	if (!is_sorted || !node_stream || !way_stream || !restriction_stream)
+	{
+		Discard();
+		return false;
+	}
+
+	for (const char *suffix : {node_suffix, way_suffix, restriction_suffix})
+	{
+		boost::filesystem::rename(state_file_name + suffix + temporary_suffix,
+								  state_file_name + suffix);
+	}
+	is_open = false;
+	return true;
+}
+
+void ExtractionStateWriter::Discard()
+{
+	node_stream.close();
+	way_stream.close();
+	restriction_stream.close();
+	for (const char *suffix : {node_suffix, way_suffix, restriction_suffix})
+	{
+		boost::system::error_code ignored;
+		boost::filesystem::remove(state_file_name + suffix + temporary_suffix, ignored);
+	}
+	is_open = false;
+}
+
+ExtractionStateReader::ExtractionStateReader(const std::string &state_file_name)
+{
+	open_state_file(node_stream, state_file_name + node_suffix);
+	open_state_file(way_stream, state_file_name + way_suffix);
+	open_state_file(restriction_stream, state_file_name + restriction_suffix);
+}
+
+bool ExtractionStateReader::ReadNode(ExternalMemoryNode &node)
+{
+	return read_value(node_stream, node);
+}
+
+bool ExtractionStateReader::ReadWay(ExtractionStateWay &way)
+{
+	unsigned number_of_way_nodes = 0;
+	if (!read_value(way_stream, way.id) || !read_value(way_stream, number_of_way_nodes))
+	{
+		return false;
+	}
+	way.nodes.resize(number_of_way_nodes);
+	way_stream.read(reinterpret_cast<char *>(way.nodes.data()),
+					number_of_way_nodes * sizeof(NodeID));
+
+	ExtractionWay &result = way.result;
+	unsigned char flags = 0;
+	TravelMode forward_mode = TRAVEL_MODE_INACCESSIBLE;
+	TravelMode backward_mode = TRAVEL_MODE_INACCESSIBLE;
+	unsigned name_length = 0;
+	read_value(way_stream, result.forward_speed);
+	read_value(way_stream, result.backward_speed);
+	read_value(way_stream, result.duration);
+	read_value(way_stream, flags);
+	read_value(way_stream, forward_mode);
+	read_value(way_stream, backward_mode);
+	read_value(way_stream, name_length);
+	result.name.resize(name_length);
+	way_stream.read(&result.name[0], name_length);
+	if (!way_stream)
+	{
+		throw osrm::exception("the way state ends in the middle of a way");
+	}
+
+	result.roundabout = 0 != (flags & WAY_ROUNDABOUT);
+	result.is_access_restricted = 0 != (flags & WAY_ACCESS_RESTRICTED);
+	result.ignore_in_grid = 0 != (flags & WAY_IGNORE_IN_GRID);
+	result.set_forward_mode(forward_mode);
+	result.set_backward_mode(backward_mode);
+	return true;
+}
+
+bool ExtractionStateReader::ReadRestriction(ExtractionStateRestriction &restriction)
+{
+	return read_value(restriction_stream, restriction.id) &&
+		   read_value(restriction_stream, restriction.restriction);
+}
@@ -0,0 +1,112 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef EXTRACTION_STATE_HPP
+#define EXTRACTION_STATE_HPP
+
+#include "extraction_way.hpp"
+#include "../data_structures/external_memory_node.hpp"
+#include "../data_structures/restriction.hpp"
+#include "../typedefs.h"
+
+#include <boost/filesystem/fstream.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The profile results of an extraction, kept next to the .osrm file so that a
+// later run can apply OSM change files without parsing the whole input again.
+// There is one file per kind of object, each sorted by OSM id: all nodes, the
+// ways that made it into the graph and the turn restrictions.
+struct ExtractionStateWay
+{
+	std::uint64_t id;
+	std::vector<NodeID> nodes;
+	ExtractionWay result;
+};
+
+struct ExtractionStateRestriction
+{
+	std::uint64_t id;
+	InputRestrictionContainer restriction;
+};
+
+class ExtractionStateWriter
+{
+public:
+	ExtractionStateWriter() = delete;
+	ExtractionStateWriter(const ExtractionStateWriter &) = delete;
+	explicit ExtractionStateWriter(const std::string &state_file_name);
+	// drops the files written so far unless they were committed
+	~ExtractionStateWriter();
+
+	void WriteNode(const ExternalMemoryNode &node);
+	void WriteWay(const ExtractionStateWay &way);
+	void WriteRestriction(const ExtractionStateRestriction &restriction);
+
+	// Replaces the previous state. Fails and drops the files if the objects
+	// did not come sorted by id, which a later merge relies on.
+	bool Commit();
+
+private:
+	void Discard();
+
+	const std::string state_file_name;
+	boost::filesystem::ofstream node_stream;
+	boost::filesystem::ofstream way_stream;
+	boost::filesystem::ofstream restriction_stream;
+	std::uint64_t number_of_nodes;
+	std::uint64_t number_of_ways;
+	std::uint64_t number_of_restrictions;
+	NodeID last_node_id;
+	std::uint64_t last_way_id;
+	std::uint64_t last_restriction_id;
+	bool is_sorted;
+	bool is_open;
+};
+
+class ExtractionStateReader
+{
+public:
+	ExtractionStateReader() = delete;
+	ExtractionStateReader(const ExtractionStateReader &) = delete;
+	// throws if the state is missing or was written by another build
+	explicit ExtractionStateReader(const std::string &state_file_name);
+
+	// false at the end of the respective file
+	bool ReadNode(ExternalMemoryNode &node);
+	bool ReadWay(ExtractionStateWay &way);
+	bool ReadRestriction(ExtractionStateRestriction &restriction);
+
+private:
+	boost::filesystem::ifstream node_stream;
+	boost::filesystem::ifstream way_stream;
+	boost::filesystem::ifstream restriction_stream;
+};
+
+#endif /* EXTRACTION_STATE_HPP */
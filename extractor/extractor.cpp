@@ -27,16 +27,20 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "extractor.hpp"
 
+#include "extraction_changes.hpp"
 #include "extraction_containers.hpp"
 #include "extraction_node.hpp"
+#include "extraction_state.hpp"
 #include "extraction_way.hpp"
 #include "extractor_callbacks.hpp"
 #include "extractor_options.hpp"
 #include "restriction_parser.hpp"
 #include "scripting_environment.hpp"
+#include "way_function_cache.hpp"
 
 #include "../Util/git_sha.hpp"
 #include "../Util/IniFileUtil.h"
+#include "../Util/lua_util.hpp"
 #include "../Util/simple_logger.hpp"
 #include "../Util/timing_util.hpp"
 #include "../Util/make_unique.hpp"
@@ -47,22 +51,159 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <osmium/io/any_input.hpp>
 
+#include <tbb/concurrent_vector.h>
+#include <tbb/enumerable_thread_specific.h>
 #include <tbb/parallel_for.h>
+#include <tbb/pipeline.h>
 #include <tbb/task_scheduler_init.h>
 
 #include <variant/optional.hpp>
 
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#include <cstdint>
 #include <cstdlib>
 
 #include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <thread>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
+namespace
+{
+// size of the physical RAM, 0 if it cannot be determined
+std::uint64_t physical_memory()
+{
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGE_SIZE)
+	const long number_of_pages = sysconf(_SC_PHYS_PAGES);
+	const long page_size = sysconf(_SC_PAGE_SIZE);
+	if (0 < number_of_pages && 0 < page_size)
+	{
+		return static_cast<std::uint64_t>(number_of_pages) * page_size;
+	}
+#endif
+	return 0;
+}
+
+// orders the results of a buffer by the position of the object in it
+struct ByElement
+{
+	template <typename ResultT> bool operator()(const ResultT &left, const ResultT &right) const
+	{
+		return left.first < right.first;
+	}
+};
+
+// one buffer of the input on its way through the parsing pipeline
+struct ParsedBuffer
+{
+	explicit ParsedBuffer(osmium::memory::Buffer input_buffer) : buffer(std::move(input_buffer))
+	{
+		for (auto iter = buffer.cbegin(); iter != buffer.cend(); ++iter)
+		{
+			osm_elements.push_back(iter);
+		}
+	}
+
+	osmium::memory::Buffer buffer;
+	std::vector<osmium::memory::Buffer::const_iterator> osm_elements;
+	tbb::concurrent_vector<std::pair<std::size_t, ExtractionNode>> resulting_nodes;
+	tbb::concurrent_vector<std::pair<std::size_t, ExtractionWay>> resulting_ways;
+	tbb::concurrent_vector<std::pair<std::size_t, mapbox::util::optional<InputRestrictionContainer>>>
+			resulting_restrictions;
+	// objects a change file deletes, the profile does not see them
+	tbb::concurrent_vector<std::size_t> deleted_elements;
+
+	// the parallel stage fills the results in any order
+	void SortResults()
+	{
+		std::sort(resulting_nodes.begin(), resulting_nodes.end(), ByElement());
+		std::sort(resulting_ways.begin(), resulting_ways.end(), ByElement());
+		std::sort(resulting_restrictions.begin(), resulting_restrictions.end(), ByElement());
+		std::sort(deleted_elements.begin(), deleted_elements.end());
+	}
+};
+
+// records the latest version of every object in the change files
+void add_changes(const ParsedBuffer &parsed, ChangeSet &changes)
+{
+	for (const auto &result : parsed.resulting_nodes)
+	{
+		const osmium::Node &node =
+				static_cast<const osmium::Node &>(*(parsed.osm_elements[result.first]));
+		ChangeSet::Set(changes.nodes, static_cast<NodeID>(node.id()), node.version(),
+					   ExtractorCallbacks::MakeNode(node, result.second));
+	}
+	ExtractionStateWay state_way;
+	for (const auto &result : parsed.resulting_ways)
+	{
+		const osmium::Way &way =
+				static_cast<const osmium::Way &>(*(parsed.osm_elements[result.first]));
+		ExtractorCallbacks::MakeWay(way, result.second, state_way);
+		ChangeSet::Set(changes.ways, state_way.id, way.version(), state_way);
+	}
+	for (const auto &result : parsed.resulting_restrictions)
+	{
+		const osmium::Relation &relation =
+				static_cast<const osmium::Relation &>(*(parsed.osm_elements[result.first]));
+		const std::uint64_t relation_id = static_cast<std::uint64_t>(relation.id());
+		if (result.second)
+		{
+			ChangeSet::Set(changes.restrictions, relation_id, relation.version(),
+						   result.second.get());
+		}
+		else
+		{
+			ChangeSet::Delete(changes.restrictions, relation_id, relation.version());
+		}
+	}
+	for (const std::size_t element : parsed.deleted_elements)
+	{
+		const osmium::OSMObject &object =
+				static_cast<const osmium::OSMObject &>(*(parsed.osm_elements[element]));
+		switch (object.type())
+		{
+		case osmium::item_type::node:
+			ChangeSet::Delete(changes.nodes, static_cast<NodeID>(object.id()), object.version());
+			break;
+		case osmium::item_type::way:
+			ChangeSet::Delete(changes.ways, static_cast<std::uint64_t>(object.id()),
+							  object.version());
+			break;
+		case osmium::item_type::relation:
+			ChangeSet::Delete(changes.restrictions, static_cast<std::uint64_t>(object.id()),
+							  object.version());
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+// profiles whose way_function keeps state between calls set cache_way_function = false
+bool use_way_function_cache(lua_State *lua_state)
+{
+	bool use_cache = true;
+	if (0 == luaL_dostring(lua_state, "return cache_way_function\n"))
+	{
+		if (lua_isboolean(lua_state, -1))
+		{
+			use_cache = lua_toboolean(lua_state, -1);
+		}
+		lua_pop(lua_state, 1);
+	}
+	return use_cache;
+}
+}
+
 int Extractor::Run(int argc, char *argv[])
 {
 	ExtractorConfig extractor_config;
@@ -84,13 +225,25 @@ int Extractor::Run(int argc, char *argv[])
 			return 1;
 		}
 
-		if (!boost::filesystem::is_regular_file(extractor_config.input_path))
+		// an incremental run reads the change files and the kept state instead of the input
+		const bool is_incremental = !extractor_config.change_paths.empty();
+		if (!is_incremental && !boost::filesystem::is_regular_file(extractor_config.input_path))
 		{
 			SimpleLogger().Write(logWARNING)
 					<< "Input file " << extractor_config.input_path.string() << " not found!";
 			return 1;
 		}
 
+		for (const boost::filesystem::path &change_path : extractor_config.change_paths)
+		{
+			if (!boost::filesystem::is_regular_file(change_path))
+			{
+				SimpleLogger().Write(logWARNING)
+						<< "Change file " << change_path.string() << " not found!";
+				return 1;
+			}
+		}
+
 		if (!boost::filesystem::is_regular_file(extractor_config.profile_path))
 		{
 			SimpleLogger().Write(logWARNING) << "Profile " << extractor_config.profile_path.string()
@@ -103,132 +256,225 @@ int Extractor::Run(int argc, char *argv[])
 		tbb::task_scheduler_init init(number_of_threads);
 
 		SimpleLogger().Write() << "Input file: " << extractor_config.input_path.filename().string();
+		if (is_incremental)
+		{
+			SimpleLogger().Write() << "Change files: " << extractor_config.change_paths.size();
+		}
 		SimpleLogger().Write() << "Profile: " << extractor_config.profile_path.filename().string();
 		SimpleLogger().Write() << "Threads: " << number_of_threads;
 
 		// setup scripting environment
 		ScriptingEnvironment scripting_environment(extractor_config.profile_path.string().c_str());
 
-		std::unordered_map<std::string, NodeID> string_map;
-		string_map[""] = 0;
-
 		ExtractionContainers extraction_containers;
-		auto extractor_callbacks =
-				osrm::make_unique<ExtractorCallbacks>(extraction_containers, string_map);
-
-		const osmium::io::File input_file(extractor_config.input_path.string());
-		osmium::io::Reader reader(input_file);
-		const osmium::io::Header header = reader.header();
+		std::unique_ptr<ExtractionStateWriter> state_writer;
+		if (extractor_config.keep_state || is_incremental)
+		{
+			state_writer = osrm::make_unique<ExtractionStateWriter>(extractor_config.state_file_name);
+		}
+		auto extractor_callbacks = osrm::make_unique<ExtractorCallbacks>(
+				extraction_containers, state_writer.get());
 
 		std::atomic<unsigned> number_of_nodes {0};
 		std::atomic<unsigned> number_of_ways {0};
 		std::atomic<unsigned> number_of_relations {0};
 		std::atomic<unsigned> number_of_others {0};
 
-		SimpleLogger().Write() << "Parsing in progress..";
-		TIMER_START(parsing);
-
-		std::string generator = header.get("generator");
-		if (generator.empty())
-		{
-			generator = "unknown tool";
-		}
-		SimpleLogger().Write() << "input file generated by " << generator;
+		// setup restriction parser
+		const RestrictionParser restriction_parser(scripting_environment.get_lua_state());
 
-		// write .timestamp data file
-		std::string timestamp = header.get("osmosis_replication_timestamp");
-		if (timestamp.empty())
+		// ways with the same tags share the way_function result
+		const bool use_way_cache = use_way_function_cache(scripting_environment.get_lua_state());
+		tbb::enumerable_thread_specific<WayFunctionCache> way_caches;
+		SimpleLogger().Write() << (use_way_cache ? "Caching" : "Not caching")
+							   << " way_function results";
+
+		// Decoding, running the profile and storing the results overlap: while
+		// some buffers are parsed in parallel the reader decodes the next ones
+		// and the results of earlier ones are consumed in input order.
+		// The number of buffers in flight is bounded.
+		const auto parse_input = [&](osmium::io::Reader &reader,
+									 const std::function<void(const ParsedBuffer &)> &consume_buffer)
 		{
-			timestamp = "n/a";
-		}
-		SimpleLogger().Write() << "timestamp: " << timestamp;
+			tbb::parallel_pipeline(
+				2 * number_of_threads,
+				tbb::make_filter<void, std::shared_ptr<ParsedBuffer>>(
+					tbb::filter::serial_in_order,
+					[&](tbb::flow_control &flow_control) -> std::shared_ptr<ParsedBuffer>
+					{
+						osmium::memory::Buffer buffer = reader.read();
+						if (!buffer)
+						{
+							flow_control.stop();
+							return nullptr;
+						}
+						return std::make_shared<ParsedBuffer>(std::move(buffer));
+					}) &
+				tbb::make_filter<std::shared_ptr<ParsedBuffer>, std::shared_ptr<ParsedBuffer>>(
+					tbb::filter::parallel,
+					[&](std::shared_ptr<ParsedBuffer> parsed)
+					{
+						// parse OSM entities in parallel, store in resulting vectors
+						tbb::parallel_for(tbb::blocked_range<std::size_t>(0, parsed->osm_elements.size()),
+										  [&](const tbb::blocked_range<std::size_t> &range)
+						{
+							std::string way_key;
+							for (auto x = range.begin(); x != range.end(); ++x)
+							{
+								const auto entity = parsed->osm_elements[x];
+								const bool is_object = osmium::item_type::node == entity->type() ||
+													   osmium::item_type::way == entity->type() ||
+													   osmium::item_type::relation == entity->type();
+								if (is_object && static_cast<const osmium::OSMObject &>(*entity).deleted())
+								{
+									parsed->deleted_elements.push_back(x);
+									continue;
+								}
+
+								ExtractionNode result_node;
+								ExtractionWay result_way;
+
+								lua_State * local_state = scripting_environment.get_lua_state();
+
+								switch (entity->type())
+								{
+								case osmium::item_type::node:
+									++number_of_nodes;
+									luabind::call_function<void>(
+												local_state,
+												"node_function",
+												boost::cref(static_cast<const osmium::Node &>(*entity)),
+												boost::ref(result_node));
+									parsed->resulting_nodes.push_back(std::make_pair(x, result_node));
+									break;
+								case osmium::item_type::way:
+								{
+									++number_of_ways;
+									const osmium::Way &way = static_cast<const osmium::Way &>(*entity);
+									WayFunctionCache *way_cache = nullptr;
+									if (use_way_cache)
+									{
+										way_cache = &way_caches.local();
+										WayFunctionCache::MakeKey(way.tags(), way_key);
+									}
+									if (nullptr == way_cache || !way_cache->Fetch(way_key, result_way))
+									{
+										luabind::call_function<void>(
+													local_state, "way_function", boost::cref(way), boost::ref(result_way));
+										if (nullptr != way_cache)
+										{
+											way_cache->Insert(way_key, result_way);
+										}
+									}
+									parsed->resulting_ways.push_back(std::make_pair(x, result_way));
+									break;
+								}
+								case osmium::item_type::relation:
+									++number_of_relations;
+									parsed->resulting_restrictions.push_back(std::make_pair(
+												x, restriction_parser.TryParse(static_cast<const osmium::Relation &>(*entity))));
+									break;
+								default:
+									++number_of_others;
+									break;
+								}
+							}
+						});
+						return parsed;
+					}) &
+				tbb::make_filter<std::shared_ptr<ParsedBuffer>, void>(
+					tbb::filter::serial_in_order,
+					[&](std::shared_ptr<ParsedBuffer> parsed)
+					{
+						parsed->SortResults();
+						consume_buffer(*parsed);
+					}));
+		};
 
-		boost::filesystem::ofstream timestamp_out(extractor_config.timestamp_file_name);
-		timestamp_out.write(timestamp.c_str(), timestamp.length());
-		timestamp_out.close();
+		SimpleLogger().Write() << "Parsing in progress..";
+		TIMER_START(parsing);
 
-		// initialize vectors holding parsed objects
-		tbb::concurrent_vector<std::pair<std::size_t, ExtractionNode>> resulting_nodes;
-		tbb::concurrent_vector<std::pair<std::size_t, ExtractionWay>> resulting_ways;
-		tbb::concurrent_vector<mapbox::util::optional<InputRestrictionContainer>>
-				resulting_restrictions;
+		std::vector<std::pair<NodeID, NodeID>> changed_segments;
+		if (!is_incremental)
+		{
+			const osmium::io::File input_file(extractor_config.input_path.string());
+			osmium::io::Reader reader(input_file);
+			const osmium::io::Header header = reader.header();
 
-		// setup restriction parser
-		const RestrictionParser restriction_parser(scripting_environment.get_lua_state());
+			std::string generator = header.get("generator");
+			if (generator.empty())
+			{
+				generator = "unknown tool";
+			}
+			SimpleLogger().Write() << "input file generated by " << generator;
 
-		while (const osmium::memory::Buffer buffer = reader.read())
-		{
-			// create a vector of iterators into the buffer
-			std::vector<osmium::memory::Buffer::const_iterator> osm_elements;
-			for (auto iter = std::begin(buffer); iter != std::end(buffer); ++iter) {
-				osm_elements.push_back(iter);
+			// write .timestamp data file
+			std::string timestamp = header.get("osmosis_replication_timestamp");
+			if (timestamp.empty())
+			{
+				timestamp = "n/a";
 			}
+			SimpleLogger().Write() << "timestamp: " << timestamp;
 
-			// clear resulting vectors
-			resulting_nodes.clear();
-			resulting_ways.clear();
-			resulting_restrictions.clear();
+			boost::filesystem::ofstream timestamp_out(extractor_config.timestamp_file_name);
+			timestamp_out.write(timestamp.c_str(), timestamp.length());
+			timestamp_out.close();
 
-			// parse OSM entities in parallel, store in resulting vectors
-			tbb::parallel_for(tbb::blocked_range<std::size_t>(0, osm_elements.size()),
-							  [&](const tbb::blocked_range<std::size_t> &range)
+			parse_input(reader, [&](const ParsedBuffer &parsed)
 			{
-				for (auto x = range.begin(); x != range.end(); ++x)
+				// put parsed objects thru extractor callbacks
+				for (const auto &result : parsed.resulting_nodes)
 				{
-					const auto entity = osm_elements[x];
-
-					ExtractionNode result_node;
-					ExtractionWay result_way;
-
-					lua_State * local_state = scripting_environment.get_lua_state();
-
-					switch (entity->type())
-					{
-					case osmium::item_type::node:
-						++number_of_nodes;
-						luabind::call_function<void>(
-									local_state,
-									"node_function",
-									boost::cref(static_cast<const osmium::Node &>(*entity)),
-									boost::ref(result_node));
-						resulting_nodes.push_back(std::make_pair(x, result_node));
-						break;
-					case osmium::item_type::way:
-						++number_of_ways;
-						luabind::call_function<void>(
-									local_state,
-									"way_function",
-									boost::cref(static_cast<const osmium::Way &>(*entity)),
-									boost::ref(result_way));
-						resulting_ways.push_back(std::make_pair(x, result_way));
-						break;
-					case osmium::item_type::relation:
-						++number_of_relations;
-						resulting_restrictions.push_back(
-									restriction_parser.TryParse(static_cast<const osmium::Relation &>(*entity)));
-						break;
-					default:
-						++number_of_others;
-						break;
-					}
+					extractor_callbacks->ProcessNode(
+								static_cast<const osmium::Node &>(*(parsed.osm_elements[result.first])),
+								result.second);
+				}
+				for (const auto &result : parsed.resulting_ways)
+				{
+					extractor_callbacks->ProcessWay(
+								static_cast<const osmium::Way &>(*(parsed.osm_elements[result.first])),
+								result.second);
+				}
+				for (const auto &result : parsed.resulting_restrictions)
+				{
+					extractor_callbacks->ProcessRestriction(
+								static_cast<const osmium::Relation &>(*(parsed.osm_elements[result.first])),
+								result.second);
 				}
 			});
-
-			// put parsed objects thru extractor callbacks
-			for (const auto &result : resulting_nodes)
-			{
-				extractor_callbacks->ProcessNode(
-							static_cast<const osmium::Node &>(*(osm_elements[result.first])), result.second);
-			}
-			for (const auto &result : resulting_ways)
+		}
+		else
+		{
+			ChangeSet changes;
+			std::string timestamp;
+			for (const boost::filesystem::path &change_path : extractor_config.change_paths)
 			{
-				extractor_callbacks->ProcessWay(
-							static_cast<const osmium::Way &>(*(osm_elements[result.first])), result.second);
+				const osmium::io::File change_file(change_path.string());
+				osmium::io::Reader reader(change_file);
+				const std::string change_timestamp =
+						reader.header().get("osmosis_replication_timestamp");
+				if (!change_timestamp.empty())
+				{
+					timestamp = change_timestamp;
+				}
+				parse_input(reader, [&](const ParsedBuffer &parsed) { add_changes(parsed, changes); });
 			}
-			for (const auto &result : resulting_restrictions)
+			SimpleLogger().Write() << "changes touch " << changes.nodes.size() << " nodes, "
+								   << changes.ways.size() << " ways and "
+								   << changes.restrictions.size() << " relations";
+
+			// change files rarely carry a timestamp, the last one known stays otherwise
+			if (!timestamp.empty())
 			{
-				extractor_callbacks->ProcessRestriction(result);
+				SimpleLogger().Write() << "timestamp: " << timestamp;
+				boost::filesystem::ofstream timestamp_out(extractor_config.timestamp_file_name);
+				timestamp_out.write(timestamp.c_str(), timestamp.length());
+				timestamp_out.close();
 			}
+
+			ExtractionStateReader state_reader(extractor_config.state_file_name);
+			apply_changes(state_reader, changes, *extractor_callbacks, changed_segments);
+			SimpleLogger().Write() << changed_segments.size() << " segments changed";
 		}
 		TIMER_STOP(parsing);
 		SimpleLogger().Write() << "Parsing finished after " << TIMER_SEC(parsing) << " seconds";
@@ -243,6 +489,20 @@ int Extractor::Run(int argc, char *argv[])
 							   << nr << " relations, and "
 							   << no << " unknown entities";
 
+		if (use_way_cache)
+		{
+			std::uint64_t way_cache_lookups = 0;
+			std::uint64_t way_cache_hits = 0;
+			for (const WayFunctionCache &way_cache : way_caches)
+			{
+				way_cache_lookups += way_cache.Lookups();
+				way_cache_hits += way_cache.Hits();
+			}
+			SimpleLogger().Write() << "way_function cache hit rate: "
+								   << (0 < way_cache_lookups ? 100. * way_cache_hits / way_cache_lookups : 0.)
+								   << "% of " << way_cache_lookups << " ways";
+		}
+
 		extractor_callbacks.reset();
 
 		if (extraction_containers.all_edges_list.empty())
@@ -251,8 +511,34 @@ int Extractor::Run(int argc, char *argv[])
 			return 1;
 		}
 
+		const std::uint64_t sort_memory_budget =
+				0 < extractor_config.sort_memory
+						? static_cast<std::uint64_t>(extractor_config.sort_memory) << 30
+						: physical_memory() / 2;
 		extraction_containers.PrepareData(extractor_config.output_file_name,
-										  extractor_config.restriction_file_name);
+										  extractor_config.restriction_file_name,
+										  sort_memory_budget);
+
+		if (is_incremental)
+		{
+			// segments as pairs of OSM node ids, the node ids of the graph change with every run
+			boost::filesystem::ofstream changed_edges_out(extractor_config.changed_edges_file_name,
+														   std::ios::binary);
+			const unsigned number_of_changed_segments = changed_segments.size();
+			changed_edges_out.write((char *)&extraction_containers.fingerprint, sizeof(FingerPrint));
+			changed_edges_out.write((char *)&number_of_changed_segments, sizeof(unsigned));
+			changed_edges_out.write((char *)changed_segments.data(),
+									number_of_changed_segments * sizeof(std::pair<NodeID, NodeID>));
+			SimpleLogger().Write() << "changed segments written to "
+								   << extractor_config.changed_edges_file_name;
+		}
+
+		// only now the state matches the output files
+		if (nullptr != state_writer && !state_writer->Commit())
+		{
+			SimpleLogger().Write(logWARNING)
+					<< "The input is not sorted by id, no extraction state was kept";
+		}
 		TIMER_STOP(extracting);
 		SimpleLogger().Write() << "extraction finished after " << TIMER_SEC(extracting) << "s";
 		SimpleLogger().Write() << "To prepare the data for routing, run: "
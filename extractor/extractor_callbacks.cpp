@@ -37,91 +37,138 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <osrm/Coordinate.h>
 
+#include <cstdint>
 #include <limits>
 #include <string>
 #include <vector>
 
 ExtractorCallbacks::ExtractorCallbacks(ExtractionContainers &extraction_containers,
-									   std::unordered_map<std::string, NodeID> &string_map)
-	: string_map(string_map), external_memory(extraction_containers)
+									   ExtractionStateWriter *state_writer)
+	: external_memory(extraction_containers), state_writer(state_writer)
 {
 }
 
+ExternalMemoryNode ExtractorCallbacks::MakeNode(const osmium::Node &input_node,
+											   const ExtractionNode &result_node)
+{
+	return {
+		static_cast<int>(input_node.location().lat() * COORDINATE_PRECISION),
+		static_cast<int>(input_node.location().lon() * COORDINATE_PRECISION),
+		static_cast<NodeID>(input_node.id()),
+		result_node.barrier,
+		result_node.traffic_lights
+	};
+}
+
+void ExtractorCallbacks::MakeWay(const osmium::Way &input_way,
+								 const ExtractionWay &parsed_way,
+								 ExtractionStateWay &way)
+{
+	way.id = static_cast<std::uint64_t>(input_way.id());
+	way.nodes.clear();
+	for (const osmium::NodeRef &node_ref : input_way.nodes())
+	{
+		way.nodes.push_back(static_cast<NodeID>(node_ref.ref()));
+	}
+	way.result = parsed_way;
+}
+
 /** warning: caller needs to take care of synchronization! */
 void ExtractorCallbacks::ProcessNode(const osmium::Node &input_node,
 									 const ExtractionNode &result_node)
 {
-	external_memory.all_nodes_list.push_back({
-												 static_cast<int>(input_node.location().lat() * COORDINATE_PRECISION),
-												 static_cast<int>(input_node.location().lon() * COORDINATE_PRECISION),
-												 static_cast<NodeID>(input_node.id()),
-												 result_node.barrier,
-												 result_node.traffic_lights
-											 });
+	ProcessNode(MakeNode(input_node, result_node));
+}
+
+/** warning: caller needs to take care of synchronization! */
+void ExtractorCallbacks::ProcessNode(const ExternalMemoryNode &node)
+{
+	external_memory.all_nodes_list.push_back(node);
+	if (nullptr != state_writer)
+	{
+		state_writer->WriteNode(node);
+	}
 }
 
 void ExtractorCallbacks::ProcessRestriction(
+		const osmium::Relation &input_relation,
 		const mapbox::util::optional<InputRestrictionContainer> &restriction)
 {
 	if (restriction)
 	{
-		external_memory.restrictions_list.push_back(restriction.get());
+		ProcessRestriction({static_cast<std::uint64_t>(input_relation.id()), restriction.get()});
 		// SimpleLogger().Write() << "from: " << restriction.get().restriction.from.node <<
 		//                           ",via: " << restriction.get().restriction.via.node <<
 		//                           ", to: " << restriction.get().restriction.to.node <<
 		//                           ", only: " << (restriction.get().restriction.flags.is_only ? "y" : "n");
 	}
 }
+
+void ExtractorCallbacks::ProcessRestriction(const ExtractionStateRestriction &restriction)
+{
+	external_memory.restrictions_list.push_back(restriction.restriction);
+	if (nullptr != state_writer)
+	{
+		state_writer->WriteRestriction(restriction);
+	}
+}
+
 /** warning: caller needs to take care of synchronization! */
 void ExtractorCallbacks::ProcessWay(const osmium::Way &input_way, const ExtractionWay &parsed_way)
 {
+	MakeWay(input_way, parsed_way, current_way);
+	ProcessWay(current_way);
+}
+
+/** warning: caller needs to take care of synchronization! */
+bool ExtractorCallbacks::ProcessWay(ExtractionStateWay &way)
+{
+	ExtractionWay &parsed_way = way.result;
+	const std::vector<NodeID> &way_nodes = way.nodes;
+
 	if (((0 >= parsed_way.forward_speed) ||
 		 (TRAVEL_MODE_INACCESSIBLE == parsed_way.forward_travel_mode)) &&
 			((0 >= parsed_way.backward_speed) ||
 			 (TRAVEL_MODE_INACCESSIBLE == parsed_way.backward_travel_mode)) &&
 			(0 >= parsed_way.duration))
 	{ // Only true if the way is specified by the speed profile
-		return;
+		return false;
 	}
 
-	if (input_way.nodes().size() <= 1)
+	if (way_nodes.size() <= 1)
 	{ // safe-guard against broken data
-		return;
+		return false;
 	}
 
-	if (std::numeric_limits<decltype(input_way.id())>::max() == input_way.id())
+	if (static_cast<std::uint64_t>(std::numeric_limits<osmium::object_id_type>::max()) == way.id)
 	{
-		SimpleLogger().Write(logDEBUG) << "found bogus way with id: " << input_way.id()
-									   << " of size " << input_way.nodes().size();
-		return;
+		SimpleLogger().Write(logDEBUG) << "found bogus way with id: " << way.id
+									   << " of size " << way_nodes.size();
+		return false;
 	}
 	if (0 < parsed_way.duration)
 	{
 		// TODO: iterate all way segments and set duration corresponding to the length of each
 		// segment
-		const_cast<ExtractionWay&>(parsed_way).forward_speed = parsed_way.duration / (input_way.nodes().size() - 1);
-		const_cast<ExtractionWay&>(parsed_way).backward_speed = parsed_way.duration / (input_way.nodes().size() - 1);
+		parsed_way.forward_speed = parsed_way.duration / (way_nodes.size() - 1);
+		parsed_way.backward_speed = parsed_way.duration / (way_nodes.size() - 1);
 	}
 
 	if (std::numeric_limits<double>::epsilon() >= std::abs(-1. - parsed_way.forward_speed))
 	{
-		SimpleLogger().Write(logDEBUG) << "found way with bogus speed, id: " << input_way.id();
-		return;
+		SimpleLogger().Write(logDEBUG) << "found way with bogus speed, id: " << way.id;
+		return false;
 	}
 
-	// Get the unique identifier for the street name
-	const auto &string_map_iterator = string_map.find(parsed_way.name);
-	unsigned name_id = external_memory.name_list.size();
-	if (string_map.end() == string_map_iterator)
-	{
-		external_memory.name_list.push_back(parsed_way.name);
-		string_map.insert(std::make_pair(parsed_way.name, name_id));
-	}
-	else
+	// the speeds above are derived from the duration again when the state is replayed
+	if (nullptr != state_writer)
 	{
-		name_id = string_map_iterator->second;
+		state_writer->WriteWay(way);
 	}
 
+	// Get the unique identifier for the street name
+	const unsigned name_id = external_memory.names.Intern(parsed_way.name);
+
 	const bool split_edge = (parsed_way.forward_speed > 0) &&
 			(TRAVEL_MODE_INACCESSIBLE != parsed_way.forward_travel_mode) &&
 			(parsed_way.backward_speed > 0) &&
@@ -129,14 +176,13 @@ void ExtractorCallbacks::ProcessWay(const osmium::Way &input_way, const Extracti
 			((parsed_way.forward_speed != parsed_way.backward_speed) ||
 			 (parsed_way.forward_travel_mode != parsed_way.backward_travel_mode));
 
-	auto pair_wise_segment_split = [&](const osmium::NodeRef &first_node,
-			const osmium::NodeRef &last_node)
+	auto pair_wise_segment_split = [&](const NodeID first_node, const NodeID last_node)
 	{
-		// SimpleLogger().Write() << "adding edge (" << first_node.ref() << "," <<
-		// last_node.ref() << "), fwd speed: " << parsed_way.forward_speed;
+		// SimpleLogger().Write() << "adding edge (" << first_node << "," <<
+		// last_node << "), fwd speed: " << parsed_way.forward_speed;
 		external_memory.all_edges_list.push_back(InternalExtractorEdge(
-													 first_node.ref(),
-													 last_node.ref(),
+													 first_node,
+													 last_node,
 													 ((split_edge || TRAVEL_MODE_INACCESSIBLE == parsed_way.backward_travel_mode)
 													  ? ExtractionWay::oneway
 													  : ExtractionWay::bidirectional),
@@ -148,44 +194,41 @@ void ExtractorCallbacks::ProcessWay(const osmium::Way &input_way, const Extracti
 													 parsed_way.is_access_restricted,
 													 parsed_way.forward_travel_mode,
 													 split_edge));
-		external_memory.used_node_id_list.push_back(first_node.ref());
+		external_memory.used_node_id_list.push_back(first_node);
 	};
 
 	const bool is_opposite_way = TRAVEL_MODE_INACCESSIBLE == parsed_way.forward_travel_mode;
 	if (is_opposite_way)
 	{
-		const_cast<ExtractionWay&>(parsed_way).forward_travel_mode = parsed_way.backward_travel_mode;
-		const_cast<ExtractionWay&>(parsed_way).backward_travel_mode = TRAVEL_MODE_INACCESSIBLE;
-		osrm::for_each_pair(
-					input_way.nodes().crbegin(), input_way.nodes().crend(), pair_wise_segment_split);
-		external_memory.used_node_id_list.push_back(input_way.nodes().front().ref());
+		parsed_way.forward_travel_mode = parsed_way.backward_travel_mode;
+		parsed_way.backward_travel_mode = TRAVEL_MODE_INACCESSIBLE;
+		osrm::for_each_pair(way_nodes.crbegin(), way_nodes.crend(), pair_wise_segment_split);
+		external_memory.used_node_id_list.push_back(way_nodes.front());
 	}
 	else
 	{
-		osrm::for_each_pair(
-					input_way.nodes().cbegin(), input_way.nodes().cend(), pair_wise_segment_split);
-		external_memory.used_node_id_list.push_back(input_way.nodes().back().ref());
+		osrm::for_each_pair(way_nodes.cbegin(), way_nodes.cend(), pair_wise_segment_split);
+		external_memory.used_node_id_list.push_back(way_nodes.back());
 	}
 
 	// The following information is needed to identify start and end segments of restrictions
 	external_memory.way_start_end_id_list.push_back(
-	{(EdgeID)input_way.id(),
-	 (NodeID)input_way.nodes()[0].ref(),
-	 (NodeID)input_way.nodes()[1].ref(),
-	 (NodeID)input_way.nodes()[input_way.nodes().size() - 2].ref(),
-	 (NodeID)input_way.nodes().back().ref()});
+	{(EdgeID)way.id,
+	 way_nodes[0],
+	 way_nodes[1],
+	 way_nodes[way_nodes.size() - 2],
+	 way_nodes.back()});
 
 	if (split_edge)
 	{ // Only true if the way should be split
 		BOOST_ASSERT(parsed_way.backward_travel_mode>0);
-		auto pair_wise_segment_split_2 = [&](const osmium::NodeRef &first_node,
-				const osmium::NodeRef &last_node)
+		auto pair_wise_segment_split_2 = [&](const NodeID first_node, const NodeID last_node)
 		{
-			// SimpleLogger().Write() << "adding edge (" << last_node.ref() << "," <<
-			// first_node.ref() << "), bwd speed: " << parsed_way.backward_speed;
+			// SimpleLogger().Write() << "adding edge (" << last_node << "," <<
+			// first_node << "), bwd speed: " << parsed_way.backward_speed;
 			external_memory.all_edges_list.push_back(
-						InternalExtractorEdge(last_node.ref(),
-											  first_node.ref(),
+						InternalExtractorEdge(last_node,
+											  first_node,
 											  ExtractionWay::oneway,
 											  parsed_way.backward_speed,
 											  name_id,
@@ -200,24 +243,21 @@ void ExtractorCallbacks::ProcessWay(const osmium::Way &input_way, const Extracti
 		if (is_opposite_way)
 		{
 			// SimpleLogger().Write() << "opposite2";
-			osrm::for_each_pair(input_way.nodes().crbegin(),
-								input_way.nodes().crend(),
-								pair_wise_segment_split_2);
-			external_memory.used_node_id_list.push_back(input_way.nodes().front().ref());
+			osrm::for_each_pair(way_nodes.crbegin(), way_nodes.crend(), pair_wise_segment_split_2);
+			external_memory.used_node_id_list.push_back(way_nodes.front());
 		}
 		else
 		{
-			osrm::for_each_pair(input_way.nodes().cbegin(),
-								input_way.nodes().cend(),
-								pair_wise_segment_split_2);
-			external_memory.used_node_id_list.push_back(input_way.nodes().back().ref());
+			osrm::for_each_pair(way_nodes.cbegin(), way_nodes.cend(), pair_wise_segment_split_2);
+			external_memory.used_node_id_list.push_back(way_nodes.back());
 		}
 
 		external_memory.way_start_end_id_list.push_back(
-		{(EdgeID)input_way.id(),
-		 (NodeID)input_way.nodes()[1].ref(),
-		 (NodeID)input_way.nodes()[0].ref(),
-		 (NodeID)input_way.nodes().back().ref(),
-		 (NodeID)input_way.nodes()[input_way.nodes().size() - 2].ref()});
+		{(EdgeID)way.id,
+		 way_nodes[1],
+		 way_nodes[0],
+		 way_nodes.back(),
+		 way_nodes[way_nodes.size() - 2]});
 	}
+	return true;
 }
@@ -28,6 +28,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef EXTRACTOR_CALLBACKS_HPP
 #define EXTRACTOR_CALLBACKS_HPP
 
+#include "extraction_state.hpp"
 #include "extraction_way.hpp"
 #include "../typedefs.h"
 
@@ -36,7 +37,6 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <variant/optional.hpp>
 
 #include <string>
-#include <unordered_map>
 
 struct ExternalMemoryNode;
 class ExtractionContainers;
@@ -46,23 +46,44 @@ struct ExtractionNode;
 class ExtractorCallbacks
 {
 private:
-	std::unordered_map<std::string, NodeID> &string_map;
 	ExtractionContainers &external_memory;
+	ExtractionStateWriter *state_writer;
+	ExtractionStateWay current_way;
 
 public:
 	ExtractorCallbacks() = delete;
 	ExtractorCallbacks(const ExtractorCallbacks &) = delete;
+	// every object that is processed also goes to the state writer, if any
 	explicit ExtractorCallbacks(ExtractionContainers &extraction_containers,
-								std::unordered_map<std::string, NodeID> &string_map);
+								ExtractionStateWriter *state_writer = nullptr);
+
+	// the records in which the profile results of an object are kept
+	static ExternalMemoryNode MakeNode(const osmium::Node &current_node,
+									   const ExtractionNode &result_node);
+	static void MakeWay(const osmium::Way &current_way,
+						const ExtractionWay &result_way,
+						ExtractionStateWay &way);
 
 	// warning: caller needs to take care of synchronization!
 	void ProcessNode(const osmium::Node &current_node, const ExtractionNode &result_node);
 
 	// warning: caller needs to take care of synchronization!
-	void ProcessRestriction(const mapbox::util::optional<InputRestrictionContainer> &restriction);
+	void ProcessNode(const ExternalMemoryNode &node);
+
+	// warning: caller needs to take care of synchronization!
+	void ProcessRestriction(const osmium::Relation &current_relation,
+							const mapbox::util::optional<InputRestrictionContainer> &restriction);
+
+	// warning: caller needs to take care of synchronization!
+	void ProcessRestriction(const ExtractionStateRestriction &restriction);
 
 	// warning: caller needs to take care of synchronization!
 	void ProcessWay(const osmium::Way &current_way, const ExtractionWay &result_way);
+
+	// Adds the segments of a way that passed the profile, false if it is not
+	// routable. Normalizes the speeds of ways with a duration in place.
+	// warning: caller needs to take care of synchronization!
+	bool ProcessWay(ExtractionStateWay &way);
 };
 
 #endif /* EXTRACTOR_CALLBACKS_HPP */
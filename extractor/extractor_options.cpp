@@ -55,7 +55,18 @@ bool ExtractorOptions::ParseArguments(int argc, char *argv[], ExtractorConfig &e
         "threads,t",
         boost::program_options::value<unsigned int>(&extractor_config.requested_num_threads)
             ->default_value(tbb::task_scheduler_init::default_num_threads()),
-        "Number of threads to use");
+        "Number of threads to use")(
+        "sort-memory",
+        boost::program_options::value<unsigned int>(&extractor_config.sort_memory)
+            ->default_value(0),
+        "GiB of RAM to sort the extracted data in memory, 0 uses half of the physical RAM")(
+        "keep-state",
+        boost::program_options::bool_switch(&extractor_config.keep_state)->default_value(false),
+        "Keep the profile results next to the .osrm file for later incremental runs")(
+        "changes",
+        boost::program_options::value<std::vector<boost::filesystem::path>>(
+            &extractor_config.change_paths)->multitoken()->composing(),
+        "OSM change files to apply to the kept state instead of reading the input file");
 
     // hidden options, will be allowed both on command line and in config file, but will not be
     // shown to the user
@@ -164,4 +175,6 @@ void ExtractorOptions::GenerateOutputFilesNames(ExtractorConfig &extractor_confi
         extractor_config.restriction_file_name.replace(pos, 8, ".osrm.restrictions");
         extractor_config.timestamp_file_name.replace(pos, 8, ".osrm.timestamp");
     }
+    extractor_config.state_file_name = extractor_config.output_file_name + ".state";
+    extractor_config.changed_edges_file_name = extractor_config.output_file_name + ".changed_edges";
 }
@@ -30,17 +30,27 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "extractor.hpp"
 
+#include <boost/filesystem/path.hpp>
+
+#include <string>
+#include <vector>
+
 struct ExtractorConfig
 {
-    ExtractorConfig() noexcept : requested_num_threads(0) {}
+    ExtractorConfig() noexcept : requested_num_threads(0), sort_memory(0), keep_state(false) {}
     unsigned requested_num_threads;
+    unsigned sort_memory;
+    bool keep_state;
     boost::filesystem::path config_file_path;
     boost::filesystem::path input_path;
     boost::filesystem::path profile_path;
+    std::vector<boost::filesystem::path> change_paths;
 
     std::string output_file_name;
     std::string restriction_file_name;
     std::string timestamp_file_name;
+    std::string state_file_name;
+    std::string changed_edges_file_name;
 };
 
 struct ExtractorOptions
@@ -0,0 +1,89 @@
+/*
+
+Copyright (c) 2015, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef WAY_FUNCTION_CACHE_HPP
+#define WAY_FUNCTION_CACHE_HPP
+
+#include "extraction_way.hpp"
+#include "../data_structures/lru_cache.hpp"
+
+#include <cstdint>
+#include <string>
+
+// Results of the profile's way_function keyed by the ordered tag list of the
+// way. The Lua bindings only expose the tags of a way, so two ways with the
+// same tags get the same result unless the profile keeps state between calls.
+// Not thread-safe, every parser thread owns one.
+class WayFunctionCache
+{
+  public:
+    static constexpr unsigned DefaultCapacity = 64 * 1024;
+
+    explicit WayFunctionCache(const unsigned capacity = DefaultCapacity)
+        : entries(capacity), lookups(0), hits(0)
+    {
+    }
+
+    // key and value of a tag are C strings, a 0 byte cannot occur inside them
+    template <class TagListT> static void MakeKey(const TagListT &tags, std::string &key)
+    {
+        key.clear();
+        for (const auto &tag : tags)
+        {
+            key.append(tag.key());
+            key.push_back('\0');
+            key.append(tag.value());
+            key.push_back('\0');
+        }
+    }
+
+    bool Fetch(const std::string &key, ExtractionWay &result)
+    {
+        ++lookups;
+        if (entries.Fetch(key, result))
+        {
+            ++hits;
+            return true;
+        }
+        return false;
+    }
+
+    void Insert(const std::string &key, const ExtractionWay &result)
+    {
+        entries.Insert(key, result);
+    }
+
+    std::uint64_t Lookups() const { return lookups; }
+    std::uint64_t Hits() const { return hits; }
+
+  private:
+    LRUCache<std::string, ExtractionWay> entries;
+    std::uint64_t lookups;
+    std::uint64_t hits;
+};
+
+#endif // WAY_FUNCTION_CACHE_HPP
@@ -24,8 +24,9 @@ Feature: osrm-routed command line options: help
         And stdout should contain "--ip"
         And stdout should contain "--port"
         And stdout should contain "--threads"
+        And stdout should contain "--querytimeout"
         And stdout should contain "--sharedmemory"
-        And stdout should contain 22 lines
+        And stdout should contain 23 lines
         And it should exit with code 0
 
     Scenario: osrm-routed - Help, short
@@ -48,8 +49,9 @@ Feature: osrm-routed command line options: help
         And stdout should contain "--ip"
         And stdout should contain "--port"
         And stdout should contain "--threads"
+        And stdout should contain "--querytimeout"
         And stdout should contain "--sharedmemory"
-        And stdout should contain 22 lines
+        And stdout should contain 23 lines
         And it should exit with code 0
 
     Scenario: osrm-routed - Help, long
@@ -72,6 +74,7 @@ Feature: osrm-routed command line options: help
         And stdout should contain "--ip"
         And stdout should contain "--port"
         And stdout should contain "--threads"
+        And stdout should contain "--querytimeout"
         And stdout should contain "--sharedmemory"
-        And stdout should contain 22 lines
+        And stdout should contain 23 lines
         And it should exit with code 0
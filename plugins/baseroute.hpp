@@ -4,6 +4,8 @@
 #include "plugin_base.hpp"
 
 #include "../algorithms/object_encoder.hpp"
+#include "../data_structures/query_deadline.hpp"
+#include "../data_structures/route_result_cache.hpp"
 #include "../data_structures/search_engine.hpp"
 #include "../descriptors/descriptor_base.hpp"
 #include "../descriptors/gpx_descriptor.hpp"
@@ -13,11 +15,12 @@
 #include "../Util/make_unique.hpp"
 #include "../Util/simple_logger.hpp"
 #include "../data_structures/drm_search_engine.hpp"
-#include "../DynamicServer/DataStructures/InternalDataFacade.h"
+#include "../DynamicServer/DataStructures/BaseDataFacade.h"
 
 #include <cstdlib>
 
 #include <algorithm>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
@@ -28,16 +31,23 @@ private:
 	DescriptorTable descriptor_table;
 	std::string descriptor_string;
 	std::unique_ptr<DRMSearchEngine<EdgeDataT>> search_engine_ptr;
-	InternalDataFacade<EdgeDataT> *facade;
+	BaseDataFacade<EdgeDataT> *facade;
+	RouteResultCache result_cache;
 
 public:
-	explicit BaseRoutePlugin(InternalDataFacade<EdgeDataT> *facade) : descriptor_string("baseroute"), facade(facade)
+	explicit BaseRoutePlugin(BaseDataFacade<EdgeDataT> *facade) : descriptor_string("baseroute"), facade(facade)
 	{
 		search_engine_ptr = osrm::make_unique<DRMSearchEngine<EdgeDataT>>(facade);
 		descriptor_table.emplace("json", 0);
 	}
 
-	virtual ~BaseRoutePlugin() {}
+	virtual ~BaseRoutePlugin()
+	{
+		const std::uint64_t lookups = result_cache.Lookups();
+		SimpleLogger().Write() << "route cache hit rate: "
+							   << (0 < lookups ? 100. * result_cache.Hits() / lookups : 0.)
+							   << "% of " << lookups << " routes";
+	}
 
 	const std::string GetDescriptor() const final { return descriptor_string; }
 
@@ -51,6 +61,7 @@ public:
 			return;
 		}
 		reply.status = http::Reply::ok;
+		QueryDeadline deadline(std::chrono::milliseconds(route_parameters.timeout));
 
 		PhantomNode source, target;
 		facade->IncrementalFindPhantomNodeForCoordinate(route_parameters.coordinates[0], source);
@@ -59,19 +70,42 @@ public:
 		RawRouteData raw_route;
 		raw_route.segment_end_coordinates.emplace_back(PhantomNodes{source, target});
 
+		const std::string cache_key =
+				RouteResultCache::MakeKey(route_parameters, raw_route.segment_end_coordinates, 0);
+		const std::uint64_t data_version =
+				RouteResultCache::DataVersion(facade->GetCheckSum(), facade->GetDataGeneration());
+		if (result_cache.Fetch(cache_key, data_version, reply.content))
+		{
+			return;
+		}
+
 		search_engine_ptr->dijkstra_path(raw_route.segment_end_coordinates,
 										 route_parameters.uturns,
-										 raw_route);
+										 raw_route,
+										 deadline);
+
+		if (INVALID_EDGE_WEIGHT == raw_route.shortest_path_length && deadline.HasExpired())
+		{
+			reply = http::Reply::StockReply(http::Reply::requestTimeout);
+			return;
+		}
 
 		if (INVALID_EDGE_WEIGHT == raw_route.shortest_path_length)
 		{
 			SimpleLogger().Write(logDEBUG) << "Error occurred, single path not found";
 		}
 
-		std::unique_ptr<BaseDescriptor<InternalDataFacade<EdgeDataT>>> descriptor;
-		descriptor = osrm::make_unique<JSONDescriptor<InternalDataFacade<EdgeDataT>>>(facade);
+		std::unique_ptr<BaseDescriptor<BaseDataFacade<EdgeDataT>>> descriptor;
+		descriptor = osrm::make_unique<JSONDescriptor<BaseDataFacade<EdgeDataT>>>(facade);
+		// the reply may already start with a jsonp prefix, which is not cached
+		const auto content_begin = reply.content.size();
 		descriptor->SetConfig(route_parameters);
 		descriptor->Run(raw_route, reply);
+		if (INVALID_EDGE_WEIGHT != raw_route.shortest_path_length)
+		{
+			result_cache.Insert(cache_key, data_version, reply.content.begin() + content_begin,
+								reply.content.end());
+		}
 	}
 };
 
@@ -31,6 +31,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "plugin_base.hpp"
 
 #include "../algorithms/object_encoder.hpp"
+#include "../data_structures/query_deadline.hpp"
+#include "../data_structures/route_result_cache.hpp"
 #include "../data_structures/search_engine.hpp"
 #include "../descriptors/descriptor_base.hpp"
 #include "../descriptors/gpx_descriptor.hpp"
@@ -43,6 +45,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <cstdlib>
 
 #include <algorithm>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
@@ -54,6 +57,7 @@ private:
 	std::string descriptor_string;
 	std::unique_ptr<SearchEngine<DataFacadeT>> search_engine_ptr;
 	DataFacadeT *facade;
+	RouteResultCache result_cache;
 
 public:
 	explicit ViaRoutePlugin(DataFacadeT *facade) : descriptor_string("viaroute"), facade(facade)
@@ -65,7 +69,13 @@ public:
 		// descriptor_table.emplace("geojson", 2);
 	}
 
-	virtual ~ViaRoutePlugin() {}
+	virtual ~ViaRoutePlugin()
+	{
+		const std::uint64_t lookups = result_cache.Lookups();
+		SimpleLogger().Write() << "route cache hit rate: "
+							   << (0 < lookups ? 100. * result_cache.Hits() / lookups : 0.)
+							   << "% of " << lookups << " routes";
+	}
 
 	const std::string GetDescriptor() const final { return descriptor_string; }
 
@@ -77,6 +87,7 @@ public:
 			return;
 		}
 		reply.status = http::Reply::ok;
+		QueryDeadline deadline(std::chrono::milliseconds(route_parameters.timeout));
 
 		std::vector<phantom_node_pair> phantom_node_pair_list(route_parameters.coordinates.size());
 		const bool checksum_OK = (route_parameters.check_sum == facade->GetCheckSum());
@@ -152,15 +163,31 @@ public:
 		};
 		osrm::for_each_pair(phantom_node_pair_list, build_phantom_pairs);
 
+		const unsigned descriptor_id = descriptor_table.get_id(route_parameters.output_format);
+		const std::string cache_key = RouteResultCache::MakeKey(
+					route_parameters, raw_route.segment_end_coordinates, descriptor_id);
+		const std::uint64_t data_version =
+				RouteResultCache::DataVersion(facade->GetCheckSum(), facade->GetDataGeneration());
+		if (result_cache.Fetch(cache_key, data_version, reply.content))
+		{
+			return;
+		}
+
 		if (route_parameters.alternate_route && 1 == raw_route.segment_end_coordinates.size())
 		{
 			search_engine_ptr->alternative_path(raw_route.segment_end_coordinates.front(),
-												raw_route);
+												raw_route, deadline);
 		}
 		else
 		{
 			search_engine_ptr->shortest_path(raw_route.segment_end_coordinates,
-											 route_parameters.uturns, raw_route);
+											 route_parameters.uturns, raw_route, deadline);
+		}
+
+		if (INVALID_EDGE_WEIGHT == raw_route.shortest_path_length && deadline.HasExpired())
+		{
+			reply = http::Reply::StockReply(http::Reply::requestTimeout);
+			return;
 		}
 
 		if (INVALID_EDGE_WEIGHT == raw_route.shortest_path_length)
@@ -169,7 +196,7 @@ public:
 		}
 
 		std::unique_ptr<BaseDescriptor<DataFacadeT>> descriptor;
-		switch (descriptor_table.get_id(route_parameters.output_format))
+		switch (descriptor_id)
 		{
 		case 1:
 			descriptor = osrm::make_unique<GPXDescriptor<DataFacadeT>>(facade);
@@ -182,8 +209,15 @@ public:
 			break;
 		}
 
+		// the reply may already start with a jsonp prefix, which is not cached
+		const auto content_begin = reply.content.size();
 		descriptor->SetConfig(route_parameters);
 		descriptor->Run(raw_route, reply);
+		if (INVALID_EDGE_WEIGHT != raw_route.shortest_path_length)
+		{
+			result_cache.Insert(cache_key, data_version, reply.content.begin() + content_begin,
+								reply.content.end());
+		}
 	}
 };
 
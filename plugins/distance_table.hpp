@@ -32,6 +32,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "../algorithms/object_encoder.hpp"
 #include "../data_structures/json_container.hpp"
+#include "../data_structures/query_deadline.hpp"
 #include "../data_structures/query_edge.hpp"
 #include "../data_structures/search_engine.hpp"
 #include "../descriptors/descriptor_base.hpp"
@@ -43,6 +44,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <cstdlib>
 
 #include <algorithm>
+#include <chrono>
 #include <memory>
 #include <unordered_map>
 #include <string>
@@ -71,6 +73,7 @@ template <class DataFacadeT> class DistanceTablePlugin final : public BasePlugin
             return;
         }
 
+        QueryDeadline deadline(std::chrono::milliseconds(route_parameters.timeout));
         const bool checksum_OK = (route_parameters.check_sum == facade->GetCheckSum());
         unsigned max_locations =
             std::min(100u, static_cast<unsigned>(route_parameters.coordinates.size()));
@@ -97,9 +100,15 @@ template <class DataFacadeT> class DistanceTablePlugin final : public BasePlugin
 
         // TIMER_START(distance_table);
         std::shared_ptr<std::vector<EdgeWeight>> result_table =
-            search_engine_ptr->distance_table(phantom_node_vector);
+            search_engine_ptr->distance_table(phantom_node_vector, deadline);
         // TIMER_STOP(distance_table);
 
+        if (!result_table && deadline.HasExpired())
+        {
+            reply = http::Reply::StockReply(http::Reply::requestTimeout);
+            return;
+        }
+
         if (!result_table)
         {
             reply = http::Reply::StockReply(http::Reply::badRequest);
@@ -12,7 +12,7 @@
 #include "../Util/json_renderer.hpp"
 #include "../Util/make_unique.hpp"
 #include "../Util/simple_logger.hpp"
-#include "../DynamicServer/DataStructures/InternalDataFacade.h"
+#include "../DynamicServer/DataStructures/BaseDataFacade.h"
 
 #include <cstdlib>
 
@@ -26,10 +26,10 @@ template <class EdgeDataT> class NodeIDPlugin final : public BasePlugin
 private:
 	DescriptorTable descriptor_table;
 	std::string descriptor_string;
-	InternalDataFacade<EdgeDataT> *facade;
+	BaseDataFacade<EdgeDataT> *facade;
 
 public:
-	explicit NodeIDPlugin(InternalDataFacade<EdgeDataT> *facade) : descriptor_string("nodeid"), facade(facade)
+	explicit NodeIDPlugin(BaseDataFacade<EdgeDataT> *facade) : descriptor_string("nodeid"), facade(facade)
 	{
 		descriptor_table.emplace("json", 0);
 	}
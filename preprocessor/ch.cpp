@@ -50,17 +50,22 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/filesystem/fstream.hpp>
 #include <boost/program_options.hpp>
 
-#include <tbb/task_scheduler_init.h>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_sort.h>
+#include <tbb/task_scheduler_init.h>
 
 #include <chrono>
 #include <memory>
+#include <numeric>
 #include <string>
 #include <thread>
 #include <vector>
 
 
-CHPreprocess::CHPreprocess() : requested_num_threads(1) {}
+CHPreprocess::CHPreprocess(const bool level_order)
+	: requested_num_threads(1), level_order(level_order)
+{
+}
 
 CHPreprocess::~CHPreprocess() {}
 
@@ -127,8 +132,7 @@ int CHPreprocess::Run(int argc, char *argv[])
 	unsigned number_of_edge_based_nodes = 0;
 	unsigned nedges = 0;
 	unsigned crc32_value;
-	DeallocatingVector<EdgeBasedEdge> restored_edge_based_edge_list;
-	restored_edge_based_edge_list.clear();
+	auto restored_edge_based_edge_list = std::make_shared<EdgeBasedEdgeList>();
 
 	//reading check sum
 	expanded_graph_stream.read((char *)&crc32_value, sizeof(unsigned));
@@ -141,7 +145,7 @@ int CHPreprocess::Run(int argc, char *argv[])
 	for ( unsigned i = 0; i < nedges ; ++ i )
 	{
 		expanded_graph_stream.read((char *)&tmp_edge, sizeof(ExpandedEdge));
-		restored_edge_based_edge_list.emplace_back(EdgeBasedEdge(tmp_edge.source,
+		restored_edge_based_edge_list->emplace_back(EdgeBasedEdge(tmp_edge.source,
 														  tmp_edge.target,
 														  tmp_edge.id,
 														  tmp_edge.distance,
@@ -150,13 +154,40 @@ int CHPreprocess::Run(int argc, char *argv[])
 	}
 	expanded_graph_stream.close();
 
+	return Run(input_path,
+			   fingerprint_orig,
+			   crc32_value,
+			   number_of_edge_based_nodes,
+			   std::move(restored_edge_based_edge_list));
+}
+
+int CHPreprocess::Run(const boost::filesystem::path &osrm_path,
+					  const FingerPrint &fingerprint,
+					  const unsigned crc32_value,
+					  const unsigned number_of_edge_based_nodes,
+					  std::shared_ptr<EdgeBasedEdgeList> edge_based_edge_list)
+{
+	graph_out = osrm_path.string() + ".hsgr";
+
 	/***
 	 * Contracting the edge-expanded graph
 	 */
 
 	SimpleLogger().Write() << "initializing contractor";
-	auto contractor =
-			osrm::make_unique<Contractor>(number_of_edge_based_nodes, restored_edge_based_edge_list);
+	// the edges are only consumed while building the contractor graph if no one else reads them
+	std::unique_ptr<Contractor> contractor;
+	if (edge_based_edge_list.unique())
+	{
+		contractor = osrm::make_unique<Contractor>(number_of_edge_based_nodes, *edge_based_edge_list);
+	}
+	else
+	{
+		contractor = osrm::make_unique<Contractor>(number_of_edge_based_nodes,
+												   edge_based_edge_list->size(),
+												   edge_based_edge_list->begin(),
+												   edge_based_edge_list->end());
+	}
+	edge_based_edge_list.reset();
 
 	TIMER_START(contraction);
 	contractor->Run();
@@ -166,6 +197,12 @@ int CHPreprocess::Run(int argc, char *argv[])
 
 	DeallocatingVector<QueryEdge> contracted_edge_list;
 	contractor->GetEdges(contracted_edge_list);
+	// hsgr id of every edge-based node, empty if they are the same
+	std::vector<NodeID> node_id_map;
+	if (level_order)
+	{
+		node_id_map = RenumberByLevel(contractor->GetNodeLevels(), contracted_edge_list);
+	}
 	contractor.reset();
 
 	/***
@@ -178,7 +215,7 @@ int CHPreprocess::Run(int argc, char *argv[])
 						   << " edges";
 
 	boost::filesystem::ofstream hsgr_output_stream(graph_out, std::ios::binary);
-	hsgr_output_stream.write((char *)&fingerprint_orig, sizeof(FingerPrint));
+	hsgr_output_stream.write((char *)&fingerprint, sizeof(FingerPrint));
 	const unsigned max_used_node_id = 1 + [&contracted_edge_list]
 	{
 		unsigned tmp_max = 0;
@@ -271,6 +308,13 @@ int CHPreprocess::Run(int argc, char *argv[])
 
 		++number_of_used_edges;
 	}
+	// the server maps the node ids of the r-tree into the hsgr ids with this
+	const unsigned node_id_map_size = node_id_map.size();
+	hsgr_output_stream.write((char *)&node_id_map_size, sizeof(unsigned));
+	if (node_id_map_size > 0)
+	{
+		hsgr_output_stream.write((char *)&node_id_map[0], sizeof(NodeID) * node_id_map_size);
+	}
 	hsgr_output_stream.close();
 
 	SimpleLogger().Write() << "Contraction: "
@@ -284,6 +328,48 @@ int CHPreprocess::Run(int argc, char *argv[])
 	return 0;
 }
 
+/**
+ \brief Gives the nodes on top of the hierarchy the smallest ids
+
+ Nearly every query ends up in the top levels, numbering them first keeps their adjacency lists
+ together in the node and edge arrays. Nodes of the same level keep the order of their edge-based
+ ids, which follow the geography if the expander renumbered them.
+*/
+std::vector<NodeID> CHPreprocess::RenumberByLevel(const std::vector<unsigned> &node_levels,
+												  DeallocatingVector<QueryEdge> &contracted_edge_list) const
+{
+	SimpleLogger().Write() << "renumbering nodes by contraction level";
+	std::vector<NodeID> order(node_levels.size());
+	std::iota(order.begin(), order.end(), 0);
+	tbb::parallel_sort(order.begin(), order.end(), [&node_levels](const NodeID a, const NodeID b)
+	{
+		return node_levels[a] > node_levels[b] || (node_levels[a] == node_levels[b] && a < b);
+	});
+
+	std::vector<NodeID> node_id_map(node_levels.size());
+	for (const auto position : osrm::irange<std::size_t>(0, order.size()))
+	{
+		node_id_map[order[position]] = position;
+	}
+
+	tbb::parallel_for(tbb::blocked_range<std::size_t>(0, contracted_edge_list.size()),
+					  [&contracted_edge_list, &node_id_map](const tbb::blocked_range<std::size_t> &range)
+	{
+		for (std::size_t i = range.begin(); i != range.end(); ++i)
+		{
+			QueryEdge &edge = contracted_edge_list[i];
+			edge.source = node_id_map[edge.source];
+			edge.target = node_id_map[edge.target];
+			// shortcuts point to their middle node, other edges into .edges
+			if (edge.data.shortcut)
+			{
+				edge.data.id = node_id_map[edge.data.id];
+			}
+		}
+	});
+	return node_id_map;
+}
+
 bool CHPreprocess::ParseArguments(int argc, char *argv[])
 {
 	// declare a group of options that will be allowed only on command line
@@ -307,7 +393,10 @@ bool CHPreprocess::ParseArguments(int argc, char *argv[])
 				"threads,t",
 				boost::program_options::value<unsigned int>(&requested_num_threads)
 				->default_value(tbb::task_scheduler_init::default_num_threads()),
-				"Number of threads to use");
+				"Number of threads to use")(
+				"level-order",
+				boost::program_options::bool_switch(&level_order)->default_value(false),
+				"Number the nodes of the .hsgr by contraction level, top of the hierarchy first");
 
 	// hidden options, will be allowed both on command line and in config file, but will not be
 	// shown to the user
@@ -40,9 +40,10 @@ struct lua_State;
 
 #include <boost/filesystem.hpp>
 
+#include <memory>
 #include <vector>
 
-class CHPreprocess : Preprocess
+class CHPreprocess : public Preprocess
 {
 	struct ExpandedEdge
 	{
@@ -101,15 +102,22 @@ public:
 	using InputEdge = DynamicGraph<EdgeData>::InputEdge;
 	using StaticEdge = StaticGraph<EdgeData>::InputEdge;
 
-	explicit CHPreprocess();
+	explicit CHPreprocess(const bool level_order = false);
 	CHPreprocess(const CHPreprocess &) = delete;
 	~CHPreprocess();
 
 	int Run(int argc, char *argv[]);
+	int Run(const boost::filesystem::path &osrm_path,
+			const FingerPrint &fingerprint,
+			const unsigned crc32_value,
+			const unsigned number_of_edge_based_nodes,
+			std::shared_ptr<EdgeBasedEdgeList> edge_based_edge_list) final;
 
 protected:
 	bool ParseArguments(int argc, char *argv[]);
 	void CheckRestrictionsFile(FingerPrint &fingerprint_orig);
+	std::vector<NodeID> RenumberByLevel(const std::vector<unsigned> &node_levels,
+										DeallocatingVector<QueryEdge> &contracted_edge_list) const;
 
 private:
 	std::vector<QueryNode> internal_to_external_node_map;
@@ -119,6 +127,7 @@ private:
 	std::vector<ImportEdge> edge_list;
 
 	unsigned requested_num_threads;
+	bool level_order;
 	boost::filesystem::path config_file_path;
 	boost::filesystem::path input_path;
 	boost::filesystem::path restrictions_path;
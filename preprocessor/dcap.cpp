@@ -127,8 +127,7 @@ int DCAPPreprocess::Run(int argc, char *argv[])
 	unsigned number_of_edge_based_nodes = 0;
 	unsigned number_of_edge_based_edges = 0;
 	unsigned crc32_value;
-	DeallocatingVector<EdgeBasedEdge> restored_edge_based_edge_list;
-	restored_edge_based_edge_list.clear();
+	auto restored_edge_based_edge_list = std::make_shared<EdgeBasedEdgeList>();
 
 	//reading check sum
 	expanded_graph_stream.read((char *)&crc32_value, sizeof(unsigned));
@@ -141,7 +140,7 @@ int DCAPPreprocess::Run(int argc, char *argv[])
 	for ( unsigned i = 0; i < number_of_edge_based_edges ; ++ i )
 	{
 		expanded_graph_stream.read((char *)&tmp_edge, sizeof(ExpandedEdge));
-		restored_edge_based_edge_list.emplace_back(EdgeBasedEdge(tmp_edge.source,
+		restored_edge_based_edge_list->emplace_back(EdgeBasedEdge(tmp_edge.source,
 														  tmp_edge.target,
 														  tmp_edge.id,
 														  tmp_edge.distance,
@@ -150,6 +149,19 @@ int DCAPPreprocess::Run(int argc, char *argv[])
 	}
 	expanded_graph_stream.close();
 
+	return Run(input_path,
+			   fingerprint_orig,
+			   crc32_value,
+			   number_of_edge_based_nodes,
+			   std::move(restored_edge_based_edge_list));
+}
+
+int DCAPPreprocess::Run(const boost::filesystem::path &osrm_path,
+						const FingerPrint &fingerprint,
+						const unsigned crc32_value,
+						const unsigned number_of_edge_based_nodes,
+						std::shared_ptr<EdgeBasedEdgeList> edge_based_edge_list)
+{
 	/***
 	 * Partitioning graph
 	 */
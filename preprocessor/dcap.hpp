@@ -13,9 +13,10 @@ struct lua_State;
 
 #include <boost/filesystem.hpp>
 
+#include <memory>
 #include <vector>
 
-class DCAPPreprocess : Preprocess
+class DCAPPreprocess : public Preprocess
 {
 	struct ExpandedEdge
 	{
@@ -79,6 +80,11 @@ public:
 	~DCAPPreprocess();
 
 	int Run(int argc, char *argv[]);
+	int Run(const boost::filesystem::path &osrm_path,
+			const FingerPrint &fingerprint,
+			const unsigned crc32_value,
+			const unsigned number_of_edge_based_nodes,
+			std::shared_ptr<EdgeBasedEdgeList> edge_based_edge_list) final;
 
 protected:
 	bool ParseArguments(int argc, char *argv[]);
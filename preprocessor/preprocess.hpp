@@ -1,8 +1,29 @@
 #ifndef PREPROCESS_HPP
 #define PREPROCESS_HPP
 
+#include "../data_structures/deallocating_vector.hpp"
+#include "../data_structures/import_edge.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <memory>
+
+class FingerPrint;
+
 class Preprocess {
+public:
+	using EdgeBasedEdgeList = DeallocatingVector<EdgeBasedEdge>;
+
+	virtual ~Preprocess() {}
 
+	// Preprocesses an edge-expanded graph that is already in memory, as it would be read from
+	// <osrm_path>.expanded. The edges may be shared with a concurrent reader, the last owner
+	// frees them.
+	virtual int Run(const boost::filesystem::path &osrm_path,
+					const FingerPrint &fingerprint,
+					const unsigned crc32_value,
+					const unsigned number_of_edge_based_nodes,
+					std::shared_ptr<EdgeBasedEdgeList> edge_based_edge_list) = 0;
 };
 
 #endif //PREPROCESS_HPP
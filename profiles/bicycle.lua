@@ -95,6 +95,7 @@ u_turn_penalty      = 20
 use_turn_restrictions   = false
 turn_penalty      = 60
 turn_bias         = 1.4
+tabulate_turn_function = true  -- turn_function depends on the angle only
 
 
 --modes
@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define ALTERNATIVE_PATH_ROUTING_HPP
 
 #include "routing_base.hpp"
+#include "../data_structures/query_deadline.hpp"
 #include "../data_structures/search_engine_data.hpp"
 #include "../Util/integer_range.hpp"
 #include "../Util/container.hpp"
@@ -78,7 +79,9 @@ public:
 
 	virtual ~AlternativeRouting() {}
 
-	void operator()(const PhantomNodes &phantom_node_pair, RawRouteData &raw_route_data)
+	void operator()(const PhantomNodes &phantom_node_pair,
+					RawRouteData &raw_route_data,
+					QueryDeadline &deadline)
 	{
 		std::vector<NodeID> alternative_path;
 		std::vector<NodeID> via_node_candidate_list;
@@ -146,6 +149,10 @@ public:
 		// search from s and t till new_min/(1+epsilon) > length_of_shortest_path
 		while (0 < (forward_heap1.Size() + reverse_heap1.Size()))
 		{
+			if (deadline.Expired())
+			{
+				return;
+			}
 			if (0 < forward_heap1.Size())
 			{
 				AlternativeRoutingStep<true>(forward_heap1,
@@ -281,6 +288,11 @@ public:
 		// prioritizing via nodes for deep inspection
 		for (const NodeID node : preselected_node_list)
 		{
+			// each candidate runs its own searches, so look at the clock every time
+			if (deadline.ExpiredNow())
+			{
+				break;
+			}
 			int length_of_via_path = 0, sharing_of_via_path = 0;
 			ComputeLengthAndSharingOfViaPath(node,
 											 &length_of_via_path,
@@ -302,6 +314,11 @@ public:
 		NodeID s_v_middle = SPECIAL_NODEID, v_t_middle = SPECIAL_NODEID;
 		for (const RankedCandidateNode &candidate : ranked_candidates_list)
 		{
+			// out of time, settle for the shortest path alone
+			if (deadline.ExpiredNow())
+			{
+				break;
+			}
 			if (ViaNodeCandidatePassesTTest(forward_heap1,
 											reverse_heap1,
 											forward_heap2,
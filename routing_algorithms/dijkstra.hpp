@@ -4,7 +4,7 @@
 #include <boost/assert.hpp>
 
 #include "routing_base.hpp"
-#include "../DynamicServer/DataStructures/InternalDataFacade.h"
+#include "../data_structures/query_deadline.hpp"
 #include "../data_structures/search_engine_data.hpp"
 #include "../Util/integer_range.hpp"
 #include "../Util/timing_util.hpp"
@@ -28,7 +28,8 @@ public:
 
 	void operator()(const std::vector<PhantomNodes> &phantom_nodes_vector,
 					const std::vector<bool> &uturn_indicators,
-					RawRouteData &raw_route_data) const
+					RawRouteData &raw_route_data,
+					QueryDeadline &deadline) const
 	{
 		TIMER_START(query);
 
@@ -60,6 +61,13 @@ public:
 
 			while ( !dijkstra_heap.Empty() )
 			{
+				if (deadline.Expired())
+				{
+					SimpleLogger().Write(logDEBUG) << "query timed out after " << setteled_nodes
+												   << " setteled nodes";
+					raw_route_data.shortest_path_length = INVALID_EDGE_WEIGHT;
+					return;
+				}
 				current = dijkstra_heap.DeleteMin();
 				distance = dijkstra_heap.GetKey(current);
 
@@ -73,32 +81,7 @@ public:
 					break;
 				}
 
-				for (const auto edge : super::facade->GetAdjacentEdgeRange(current))
-				{
-					const EdgeData &data = super::facade->GetEdgeData(edge);
-					const int edge_weight = data.distance;
-					BOOST_ASSERT_MSG(edge_weight > 0, "edge_weight invalid");
-
-					if ( data.forward )
-					{
-						// New Node discovered -> Add to Heap + Node Info Storage
-						const NodeID to = super::facade->GetTarget(edge);
-						const int to_distance = distance + edge_weight;
-						if (!dijkstra_heap.WasInserted(to))
-						{
-							dijkstra_heap.Insert(to, to_distance, current);
-							//SimpleLogger().Write(logDEBUG) << "discovering node " << to << " with distance " << to_distance;
-						}
-						// Found a shorter Path -> Update distance
-						else if (to_distance < dijkstra_heap.GetKey(to))
-						{
-							// new parent
-							dijkstra_heap.GetData(to).parent = current;
-							dijkstra_heap.DecreaseKey(to, to_distance);
-							//SimpleLogger().Write(logDEBUG) << "improving road to " << to << " with " << to_distance;
-						}
-					}
-				}
+				super::RelaxOutgoingEdges(dijkstra_heap, current, distance, true);
 				++setteled_nodes;
 			}
 		}
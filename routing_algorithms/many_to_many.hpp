@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MANY_TO_MANY_ROUTING_HPP
 
 #include "routing_base.hpp"
+#include "../data_structures/query_deadline.hpp"
 #include "../data_structures/search_engine_data.hpp"
 #include "../typedefs.h"
 
@@ -64,8 +65,9 @@ public:
 
 	~ManyToManyRouting() {}
 
-	std::shared_ptr<std::vector<EdgeWeight>> operator()(const PhantomNodeArray &phantom_nodes_array)
-	const
+	// returns an empty pointer if the deadline expired before the table was complete
+	std::shared_ptr<std::vector<EdgeWeight>> operator()(const PhantomNodeArray &phantom_nodes_array,
+														QueryDeadline &deadline) const
 	{
 		const auto number_of_locations = phantom_nodes_array.size();
 		std::shared_ptr<std::vector<EdgeWeight>> result_table =
@@ -104,6 +106,10 @@ public:
 			// explore search space
 			while (!query_heap.Empty())
 			{
+				if (deadline.Expired())
+				{
+					return nullptr;
+				}
 				BackwardRoutingStep(target_id, query_heap, search_space_with_buckets);
 			}
 			++target_id;
@@ -134,6 +140,10 @@ public:
 			// explore search space
 			while (!query_heap.Empty())
 			{
+				if (deadline.Expired())
+				{
+					return nullptr;
+				}
 				ForwardRoutingStep(source_id,
 								   number_of_locations,
 								   query_heap,
@@ -209,11 +219,11 @@ public:
 	{
 		for (auto edge : super::facade->GetAdjacentEdgeRange(node))
 		{
-			const auto &data = super::facade->GetEdgeData(edge);
+			const QueryEdgeHotData data = super::facade->GetHotData(edge);
 			const bool direction_flag = (forward_direction ? data.forward : data.backward);
 			if (direction_flag)
 			{
-				const NodeID to = super::facade->GetTarget(edge);
+				const NodeID to = data.target;
 				const int edge_weight = data.distance;
 
 				BOOST_ASSERT_MSG(edge_weight > 0, "edge_weight invalid");
@@ -242,11 +252,11 @@ public:
 	{
 		for (auto edge : super::facade->GetAdjacentEdgeRange(node))
 		{
-			const auto &data = super::facade->GetEdgeData(edge);
+			const QueryEdgeHotData data = super::facade->GetHotData(edge);
 			const bool reverse_flag = ((!forward_direction) ? data.forward : data.backward);
 			if (reverse_flag)
 			{
-				const NodeID to = super::facade->GetTarget(edge);
+				const NodeID to = data.target;
 				const int edge_weight = data.distance;
 				BOOST_ASSERT_MSG(edge_weight > 0, "edge_weight invalid");
 				if (query_heap.WasInserted(to))
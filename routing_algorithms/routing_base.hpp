@@ -28,13 +28,16 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef ROUTING_BASE_HPP
 #define ROUTING_BASE_HPP
 
+#include "../data_structures/query_edge.hpp"
 #include "../data_structures/raw_route_data.hpp"
 #include "../data_structures/search_engine_data.hpp"
 #include "../data_structures/turn_instructions.hpp"
+#include "../Util/integer_range.hpp"
 // #include "../Util/simple_logger.hpp.h"
 
 #include <boost/assert.hpp>
 
+#include <algorithm>
 #include <stack>
 
 SearchEngineData::SearchEngineHeapPtr SearchEngineData::forwardHeap;
@@ -58,6 +61,80 @@ public:
 	explicit BasicRoutingInterface(DataFacadeT *facade) : facade(facade) {}
 	virtual ~BasicRoutingInterface() {};
 
+	// edges whose heap entries are prefetched together
+	static constexpr unsigned EDGE_BATCH_SIZE = 16;
+
+	// Reads the hot data of up to EDGE_BATCH_SIZE edges from [begin, end) and prefetches the
+	// heap entries of their targets, so the cache misses of the batch overlap instead of
+	// each edge waiting for the one before it. Returns the number of edges read.
+	inline unsigned ReadEdgeBatch(const SearchEngineData::QueryHeap &heap,
+								  const EdgeID begin,
+								  const EdgeID end,
+								  QueryEdgeHotData *batch,
+								  const bool prefetch) const
+	{
+		const unsigned batch_size = std::min(static_cast<EdgeID>(EDGE_BATCH_SIZE), end - begin);
+		for (const auto i : osrm::irange(0u, batch_size))
+		{
+			batch[i] = facade->GetHotData(begin + i);
+			if (prefetch)
+			{
+				heap.PrefetchIndex(batch[i].target);
+			}
+		}
+		if (prefetch)
+		{
+			for (const auto i : osrm::irange(0u, batch_size))
+			{
+				heap.PrefetchData(batch[i].target);
+			}
+		}
+		return batch_size;
+	}
+
+	// prefetch is false if the heap entries of the targets were just prefetched
+	inline void RelaxOutgoingEdges(SearchEngineData::QueryHeap &heap,
+								   const NodeID node,
+								   const int distance,
+								   const bool forward_direction,
+								   const bool prefetch = true) const
+	{
+		QueryEdgeHotData batch[EDGE_BATCH_SIZE];
+		const EdgeID end_edge = facade->EndEdges(node);
+		for (EdgeID batch_begin = facade->BeginEdges(node); batch_begin < end_edge;
+			 batch_begin += EDGE_BATCH_SIZE)
+		{
+			const unsigned batch_size =
+				ReadEdgeBatch(heap, batch_begin, end_edge, batch, prefetch);
+			for (const auto i : osrm::irange(0u, batch_size))
+			{
+				const QueryEdgeHotData &data = batch[i];
+				const bool direction_flag = (forward_direction ? data.forward : data.backward);
+				if (direction_flag)
+				{
+					const NodeID to = data.target;
+					const int edge_weight = data.distance;
+
+					BOOST_ASSERT_MSG(edge_weight > 0, "edge_weight invalid");
+					const int to_distance = distance + edge_weight;
+
+					// New Node discovered -> Add to Heap + Node Info Storage
+					if (!heap.WasInserted(to))
+					{
+						heap.Insert(to, to_distance, node);
+					}
+					// Found a shorter Path -> Update distance
+					else if (to_distance < heap.GetKey(to))
+					{
+						// new parent
+						heap.GetData(to).parent = node;
+						heap.DecreaseKey(to, to_distance);
+					}
+				}
+			}
+		}
+	}
+
 	inline void RoutingStep(SearchEngineData::QueryHeap &forward_heap,
 							SearchEngineData::QueryHeap &reverse_heap,
 							NodeID *middle_node_id,
@@ -95,54 +172,37 @@ public:
 		}
 
 		// Stalling
-		for (const auto edge : facade->GetAdjacentEdgeRange(node))
+		QueryEdgeHotData batch[EDGE_BATCH_SIZE];
+		const EdgeID end_edge = facade->EndEdges(node);
+		for (EdgeID batch_begin = facade->BeginEdges(node); batch_begin < end_edge;
+			 batch_begin += EDGE_BATCH_SIZE)
 		{
-			const EdgeData &data = facade->GetEdgeData(edge);
-			const bool reverse_flag = ((!forward_direction) ? data.forward : data.backward);
-			if (reverse_flag)
+			const unsigned batch_size =
+				ReadEdgeBatch(forward_heap, batch_begin, end_edge, batch, true);
+			for (const auto i : osrm::irange(0u, batch_size))
 			{
-				const NodeID to = facade->GetTarget(edge);
-				const int edge_weight = data.distance;
+				const QueryEdgeHotData &data = batch[i];
+				const bool reverse_flag = ((!forward_direction) ? data.forward : data.backward);
+				if (reverse_flag)
+				{
+					const NodeID to = data.target;
+					const int edge_weight = data.distance;
 
-				BOOST_ASSERT_MSG(edge_weight > 0, "edge_weight invalid");
+					BOOST_ASSERT_MSG(edge_weight > 0, "edge_weight invalid");
 
-				if (forward_heap.WasInserted(to))
-				{
-					if (forward_heap.GetKey(to) + edge_weight < distance)
+					if (forward_heap.WasInserted(to))
 					{
-						return;
+						if (forward_heap.GetKey(to) + edge_weight < distance)
+						{
+							return;
+						}
 					}
 				}
 			}
 		}
 
-		for (const auto edge : facade->GetAdjacentEdgeRange(node))
-		{
-			const EdgeData &data = facade->GetEdgeData(edge);
-			bool forward_directionFlag = (forward_direction ? data.forward : data.backward);
-			if (forward_directionFlag)
-			{
-
-				const NodeID to = facade->GetTarget(edge);
-				const int edge_weight = data.distance;
-
-				BOOST_ASSERT_MSG(edge_weight > 0, "edge_weight invalid");
-				const int to_distance = distance + edge_weight;
-
-				// New Node discovered -> Add to Heap + Node Info Storage
-				if (!forward_heap.WasInserted(to))
-				{
-					forward_heap.Insert(to, to_distance, node);
-				}
-				// Found a shorter Path -> Update distance
-				else if (to_distance < forward_heap.GetKey(to))
-				{
-					// new parent
-					forward_heap.GetData(to).parent = node;
-					forward_heap.DecreaseKey(to, to_distance);
-				}
-			}
-		}
+		// stalling has prefetched the heap entries of all targets already
+		RelaxOutgoingEdges(forward_heap, node, distance, forward_direction, false);
 	}
 
 	inline void UnpackPath(const std::vector<NodeID> &packed_path,
@@ -182,9 +242,9 @@ public:
 			int edge_weight = std::numeric_limits<EdgeWeight>::max();
 			for (const auto edge_id : facade->GetAdjacentEdgeRange(edge.first))
 			{
-				const int weight = facade->GetEdgeData(edge_id).distance;
-				if ((facade->GetTarget(edge_id) == edge.second) && (weight < edge_weight) &&
-						facade->GetEdgeData(edge_id).forward)
+				const QueryEdgeHotData data = facade->GetHotData(edge_id);
+				const int weight = data.distance;
+				if ((data.target == edge.second) && (weight < edge_weight) && data.forward)
 				{
 					smaller_edge_id = edge_id;
 					edge_weight = weight;
@@ -202,9 +262,9 @@ public:
 			{
 				for (const auto edge_id : facade->GetAdjacentEdgeRange(edge.second))
 				{
-					const int weight = facade->GetEdgeData(edge_id).distance;
-					if ((facade->GetTarget(edge_id) == edge.first) && (weight < edge_weight) &&
-							facade->GetEdgeData(edge_id).backward)
+					const QueryEdgeHotData data = facade->GetHotData(edge_id);
+					const int weight = data.distance;
+					if ((data.target == edge.first) && (weight < edge_weight) && data.backward)
 					{
 						smaller_edge_id = edge_id;
 						edge_weight = weight;
@@ -345,9 +405,9 @@ public:
 			int edge_weight = std::numeric_limits<EdgeWeight>::max();
 			for (const auto edge_id : facade->GetAdjacentEdgeRange(edge.first))
 			{
-				const int weight = facade->GetEdgeData(edge_id).distance;
-				if ((facade->GetTarget(edge_id) == edge.second) && (weight < edge_weight) &&
-						facade->GetEdgeData(edge_id).forward)
+				const QueryEdgeHotData data = facade->GetHotData(edge_id);
+				const int weight = data.distance;
+				if ((data.target == edge.second) && (weight < edge_weight) && data.forward)
 				{
 					smaller_edge_id = edge_id;
 					edge_weight = weight;
@@ -358,9 +418,9 @@ public:
 			{
 				for (const auto edge_id : facade->GetAdjacentEdgeRange(edge.second))
 				{
-					const int weight = facade->GetEdgeData(edge_id).distance;
-					if ((facade->GetTarget(edge_id) == edge.first) && (weight < edge_weight) &&
-							facade->GetEdgeData(edge_id).backward)
+					const QueryEdgeHotData data = facade->GetHotData(edge_id);
+					const int weight = data.distance;
+					if ((data.target == edge.first) && (weight < edge_weight) && data.backward)
 					{
 						smaller_edge_id = edge_id;
 						edge_weight = weight;
@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/assert.hpp>
 
 #include "routing_base.hpp"
+#include "../data_structures/query_deadline.hpp"
 #include "../data_structures/search_engine_data.hpp"
 #include "../Util/integer_range.hpp"
 #include "../typedefs.h"
@@ -51,7 +52,8 @@ public:
 
 	void operator()(const std::vector<PhantomNodes> &phantom_nodes_vector,
 					const std::vector<bool> &uturn_indicators,
-					RawRouteData &raw_route_data) const
+					RawRouteData &raw_route_data,
+					QueryDeadline &deadline) const
 	{
 		int distance1 = 0;
 		int distance2 = 0;
@@ -150,6 +152,12 @@ public:
 			// run two-Target Dijkstra routing step.
 			while (0 < (forward_heap1.Size() + reverse_heap1.Size()))
 			{
+				if (deadline.Expired())
+				{
+					raw_route_data.shortest_path_length = INVALID_EDGE_WEIGHT;
+					raw_route_data.alternative_path_length = INVALID_EDGE_WEIGHT;
+					return;
+				}
 				if (!forward_heap1.Empty())
 				{
 					super::RoutingStep(
@@ -166,6 +174,12 @@ public:
 			{
 				while (0 < (forward_heap2.Size() + reverse_heap2.Size()))
 				{
+					if (deadline.Expired())
+					{
+						raw_route_data.shortest_path_length = INVALID_EDGE_WEIGHT;
+						raw_route_data.alternative_path_length = INVALID_EDGE_WEIGHT;
+						return;
+					}
 					if (!forward_heap2.Empty())
 					{
 						super::RoutingStep(
@@ -71,7 +71,7 @@ int main(int argc, const char *argv[])
 
 		bool use_shared_memory = false, trial_run = false;
 		std::string ip_address;
-		int ip_port, requested_thread_num;
+		int ip_port, requested_thread_num, max_query_time;
 
 		ServerPaths server_paths;
 
@@ -81,6 +81,7 @@ int main(int argc, const char *argv[])
 																  ip_address,
 																  ip_port,
 																  requested_thread_num,
+																  max_query_time,
 																  use_shared_memory,
 																  trial_run);
 		if (init_result == INIT_OK_DO_NOT_START_ENGINE)
@@ -109,6 +110,7 @@ int main(int argc, const char *argv[])
 		SimpleLogger().Write(logDEBUG) << "Threads:\t" << requested_thread_num;
 		SimpleLogger().Write(logDEBUG) << "IP address:\t" << ip_address;
 		SimpleLogger().Write(logDEBUG) << "IP port:\t" << ip_port;
+		SimpleLogger().Write(logDEBUG) << "Query timeout:\t" << max_query_time << " ms";
 #ifndef _WIN32
 		int sig = 0;
 		sigset_t new_mask;
@@ -122,6 +124,8 @@ int main(int argc, const char *argv[])
 				Server::CreateServer(ip_address, ip_port, requested_thread_num);
 
 		routing_server->GetRequestHandlerPtr().RegisterRoutingMachine(&osrm_lib);
+		routing_server->GetRequestHandlerPtr().SetMaxQueryTime(static_cast<unsigned>(max_query_time));
+		routing_server->GetRequestHandlerPtr().EnableAdmissionControl(requested_thread_num);
 
 		if (trial_run)
 		{
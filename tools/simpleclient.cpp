@@ -65,7 +65,7 @@ int main(int argc, const char *argv[])
     try
     {
         std::string ip_address;
-        int ip_port, requested_thread_num;
+        int ip_port, requested_thread_num, max_query_time;
         bool use_shared_memory = false, trial_run = false;
         ServerPaths server_paths;
 
@@ -75,6 +75,7 @@ int main(int argc, const char *argv[])
                                                                   ip_address,
                                                                   ip_port,
                                                                   requested_thread_num,
+                                                                  max_query_time,
                                                                   use_shared_memory,
                                                                   trial_run);
 
@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "../data_structures/shared_memory_factory.hpp"
 #include "../Server/DataStructures/SharedDataType.h"
+#include "../DynamicServer/DataStructures/SharedDataType.h"
 #include "../Util/git_sha.hpp"
 #include "../Util/simple_logger.hpp"
 
@@ -42,18 +43,32 @@ void delete_region(const SharedDataType region)
             {
             case CURRENT_REGIONS:
                 return "CURRENT_REGIONS";
-            case LAYOUT_1:
-                return "LAYOUT_1";
-            case DATA_1:
-                return "DATA_1";
-            case LAYOUT_2:
-                return "LAYOUT_2";
-            case DATA_2:
-                return "DATA_2";
-            case LAYOUT_NONE:
-                return "LAYOUT_NONE";
-            default: // DATA_NONE:
-                return "DATA_NONE";
+            case GRAPH_1:
+                return "GRAPH_1";
+            case GRAPH_2:
+                return "GRAPH_2";
+            case ORIGINAL_EDGES_1:
+                return "ORIGINAL_EDGES_1";
+            case ORIGINAL_EDGES_2:
+                return "ORIGINAL_EDGES_2";
+            case GEOMETRIES_1:
+                return "GEOMETRIES_1";
+            case GEOMETRIES_2:
+                return "GEOMETRIES_2";
+            case NAMES_1:
+                return "NAMES_1";
+            case NAMES_2:
+                return "NAMES_2";
+            case R_TREE_1:
+                return "R_TREE_1";
+            case R_TREE_2:
+                return "R_TREE_2";
+            case TIMESTAMP_1:
+                return "TIMESTAMP_1";
+            case TIMESTAMP_2:
+                return "TIMESTAMP_2";
+            default: // REGION_NONE:
+                return "REGION_NONE";
             }
         }();
 
@@ -61,15 +76,38 @@ void delete_region(const SharedDataType region)
     }
 }
 
+void delete_region(const DynamicDataType region)
+{
+    if (SharedMemory::RegionExists(region) && !SharedMemory::Remove(region))
+    {
+        SimpleLogger().Write(logWARNING) << "could not delete shared memory region " << region;
+    }
+}
+
 // find all existing shmem regions and remove them.
 void springclean()
 {
     SimpleLogger().Write() << "spring-cleaning all shared memory regions";
-    delete_region(DATA_1);
-    delete_region(LAYOUT_1);
-    delete_region(DATA_2);
-    delete_region(LAYOUT_2);
+    delete_region(GRAPH_1);
+    delete_region(GRAPH_2);
+    delete_region(ORIGINAL_EDGES_1);
+    delete_region(ORIGINAL_EDGES_2);
+    delete_region(GEOMETRIES_1);
+    delete_region(GEOMETRIES_2);
+    delete_region(NAMES_1);
+    delete_region(NAMES_2);
+    delete_region(R_TREE_1);
+    delete_region(R_TREE_2);
+    delete_region(TIMESTAMP_1);
+    delete_region(TIMESTAMP_2);
     delete_region(CURRENT_REGIONS);
+    delete_region(TOPOLOGY_DATA_1);
+    delete_region(TOPOLOGY_LAYOUT_1);
+    delete_region(TOPOLOGY_DATA_2);
+    delete_region(TOPOLOGY_LAYOUT_2);
+    delete_region(WEIGHTS_1);
+    delete_region(WEIGHTS_2);
+    delete_region(DYNAMIC_REGIONS);
 }
 
 int main()
@@ -84,7 +122,7 @@ int main()
         SimpleLogger().Write() << "This tool may put osrm-routed into an undefined state!";
         SimpleLogger().Write() << "Type 'Y' to acknowledge that you know what your are doing.";
         SimpleLogger().Write() << "\n\nDo you want to purge all shared memory allocated " <<
-                                  "by osrm-datastore? [type 'Y' to confirm]";
+                                  "by osrm-datastore and d_datastore? [type 'Y' to confirm]";
 
         const auto letter = getchar();
         if (letter != 'Y')
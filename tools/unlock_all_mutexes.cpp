@@ -27,7 +27,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "../Util/git_sha.hpp"
 #include "../Util/simple_logger.hpp"
+#include "../data_structures/shared_memory_factory.hpp"
 #include "../Server/DataStructures/SharedBarriers.h"
+#include "../Server/DataStructures/SharedGeneration.h"
+#include "../DynamicServer/DataStructures/SharedGeneration.h"
 
 #include <iostream>
 
@@ -42,6 +45,24 @@ int main()
         barrier.pending_update_mutex.unlock();
         barrier.query_mutex.unlock();
         barrier.update_mutex.unlock();
+
+        if (SharedMemory::RegionExists(CURRENT_REGIONS))
+        {
+            SimpleLogger().Write() << "Releasing all dataset pins";
+            SharedMemory *data_type_memory = SharedMemoryFactory::Get(
+                CURRENT_REGIONS, sizeof(SharedDataTimestamp), true, false);
+            SharedGeneration::ResetReaders(
+                static_cast<SharedDataTimestamp *>(data_type_memory->Ptr()));
+        }
+
+        if (SharedMemory::RegionExists(DYNAMIC_REGIONS))
+        {
+            SimpleLogger().Write() << "Releasing all dynamic dataset pins";
+            SharedMemory *data_type_memory = SharedMemoryFactory::Get(
+                DYNAMIC_REGIONS, sizeof(DynamicDataTimestamp), true, false);
+            DynamicGeneration::ResetReaders(
+                static_cast<DynamicDataTimestamp *>(data_type_memory->Ptr()));
+        }
     }
     catch (const std::exception &e)
     {